@@ -0,0 +1,188 @@
+#include "Benchmark.hpp"
+
+#include <algorithm>
+#include <cmath>
+
+namespace gps {
+namespace bench {
+
+    namespace detail {
+        const void* volatile sink = NULL;
+    }
+
+    namespace {
+
+        std::string assetDirectory = "../GP_Project";
+
+        std::vector<std::pair<std::string, Function> >& registry() {
+
+            //function-local, so it exists before the static registrations of the other files run
+            static std::vector<std::pair<std::string, Function> > benchmarks;
+            return benchmarks;
+        }
+
+        //runs the benchmark once for the given number of iterations, the state has the results
+        State runOnce(const Function& function, int64_t iterations) {
+
+            State state(iterations);
+            function(state);
+            if (state.GetIterations() == 0 && state.GetError().empty()) {
+                state.SkipWithError("returned without calling KeepRunning");
+            }
+            return state;
+        }
+    }
+
+    State::State(int64_t iterations) {
+
+        maxIterations = iterations;
+        iteration = 0;
+        pausedSeconds = 0.0;
+        seconds = 0.0;
+        finished = false;
+        itemsPerIteration = 0;
+        bytesPerIteration = 0;
+    }
+
+    void State::Finish() {
+
+        if (finished) {
+            return;
+        }
+        finished = true;
+        if (iteration > 0) {
+            seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count() - pausedSeconds;
+        }
+    }
+
+    void State::PauseTiming() {
+
+        pauseStart = std::chrono::steady_clock::now();
+    }
+
+    void State::ResumeTiming() {
+
+        pausedSeconds += std::chrono::duration<double>(std::chrono::steady_clock::now() - pauseStart).count();
+    }
+
+    void State::SetItemsPerIteration(int64_t items) {
+
+        itemsPerIteration = items;
+    }
+
+    void State::SetBytesPerIteration(int64_t bytes) {
+
+        bytesPerIteration = bytes;
+    }
+
+    void State::SkipWithError(const std::string& message) {
+
+        skipped = message.empty() ? "skipped" : message;
+    }
+
+    int64_t State::GetIterations() const {
+
+        return iteration;
+    }
+
+    double State::GetSeconds() const {
+
+        return seconds;
+    }
+
+    int64_t State::GetItemsPerIteration() const {
+
+        return itemsPerIteration;
+    }
+
+    int64_t State::GetBytesPerIteration() const {
+
+        return bytesPerIteration;
+    }
+
+    const std::string& State::GetError() const {
+
+        return skipped;
+    }
+
+    void SetAssetDirectory(const std::string& directory) {
+
+        assetDirectory = directory;
+    }
+
+    std::string AssetPath(const std::string& relativePath) {
+
+        return assetDirectory.empty() ? relativePath : assetDirectory + "/" + relativePath;
+    }
+
+    int Register(const std::string& name, Function function) {
+
+        registry().push_back(std::make_pair(name, function));
+        return (int)registry().size();
+    }
+
+    const std::vector<std::pair<std::string, Function> >& GetBenchmarks() {
+
+        return registry();
+    }
+
+    Result Run(const std::string& name, const Function& function, const Options& options) {
+
+        Result result;
+        result.name = name;
+        result.iterations = 0;
+        result.repetitions = 0;
+        result.meanNs = result.medianNs = result.minNs = result.stddevNs = 0.0;
+        result.itemsPerSecond = result.bytesPerSecond = 0.0;
+
+        //grow the iteration count by 10x until a run is long enough to estimate the time per iteration
+        int64_t iterations = 1;
+        for (;;) {
+            State state = runOnce(function, iterations);
+            if (!state.GetError().empty()) {
+                result.error = state.GetError();
+                return result;
+            }
+            if (state.GetSeconds() >= options.minTime / 10.0 || iterations >= 1000000000) {
+                double perIteration = std::max(state.GetSeconds() / iterations, 1e-9);
+                iterations = std::max((int64_t)std::ceil(options.minTime / perIteration), (int64_t)1);
+                break;
+            }
+            iterations *= 10;
+        }
+
+        std::vector<double> times;
+        int64_t items = 0;
+        int64_t bytes = 0;
+        for (int i = 0; i < options.repetitions; i++) {
+            State state = runOnce(function, iterations);
+            if (!state.GetError().empty()) {
+                result.error = state.GetError();
+                return result;
+            }
+            times.push_back(state.GetSeconds() * 1e9 / iterations);
+            items = state.GetItemsPerIteration();
+            bytes = state.GetBytesPerIteration();
+        }
+
+        std::sort(times.begin(), times.end());
+        double sum = 0.0;
+        for (size_t i = 0; i < times.size(); i++) {
+            sum += times[i];
+        }
+        result.iterations = iterations;
+        result.repetitions = (int)times.size();
+        result.meanNs = sum / times.size();
+        result.medianNs = times.size() % 2 == 1 ? times[times.size() / 2] : 0.5 * (times[times.size() / 2 - 1] + times[times.size() / 2]);
+        result.minNs = times.front();
+        double variance = 0.0;
+        for (size_t i = 0; i < times.size(); i++) {
+            variance += (times[i] - result.meanNs) * (times[i] - result.meanNs);
+        }
+        result.stddevNs = times.size() > 1 ? std::sqrt(variance / (times.size() - 1)) : 0.0;
+        result.itemsPerSecond = items > 0 && result.medianNs > 0.0 ? items * 1e9 / result.medianNs : 0.0;
+        result.bytesPerSecond = bytes > 0 && result.medianNs > 0.0 ? bytes * 1e9 / result.medianNs : 0.0;
+        return result;
+    }
+}
+}
@@ -0,0 +1,126 @@
+#ifndef Benchmark_hpp
+#define Benchmark_hpp
+
+#include <chrono>
+#include <cstdint>
+#include <functional>
+#include <string>
+#include <vector>
+
+namespace gps {
+namespace bench {
+
+    //Iteration state of a running benchmark, in the style of Google Benchmark:
+    //    void BM_Something(bench::State& state) {
+    //        ...setup...
+    //        while (state.KeepRunning()) {
+    //            ...timed code...
+    //        }
+    //    }
+    //the timer starts at the first KeepRunning and stops when it returns false
+    class State {
+
+    public:
+        explicit State(int64_t iterations);
+
+        bool KeepRunning() {
+            if (iteration < maxIterations && skipped.empty()) {
+                if (iteration == 0) {
+                    start = std::chrono::steady_clock::now();
+                }
+                iteration++;
+                return true;
+            }
+            Finish();
+            return false;
+        }
+        //excludes per-iteration setup from the time
+        void PauseTiming();
+        void ResumeTiming();
+        //work done by one iteration, reported as items/s and bytes/s
+        void SetItemsPerIteration(int64_t items);
+        void SetBytesPerIteration(int64_t bytes);
+        //ends the benchmark, the message is reported instead of times (missing asset...)
+        void SkipWithError(const std::string& message);
+
+        int64_t GetIterations() const;
+        double GetSeconds() const;
+        int64_t GetItemsPerIteration() const;
+        int64_t GetBytesPerIteration() const;
+        const std::string& GetError() const;
+
+    private:
+        int64_t maxIterations;
+        int64_t iteration;
+        std::chrono::steady_clock::time_point start;
+        std::chrono::steady_clock::time_point pauseStart;
+        double pausedSeconds;
+        double seconds;
+        bool finished;
+        int64_t itemsPerIteration;
+        int64_t bytesPerIteration;
+        std::string skipped;
+
+        void Finish();
+    };
+
+    struct Result {
+        std::string name;
+        //per repetition
+        int64_t iterations;
+        int repetitions;
+        //nanoseconds per iteration over the repetitions
+        double meanNs;
+        double medianNs;
+        double minNs;
+        double stddevNs;
+        double itemsPerSecond;
+        double bytesPerSecond;
+        std::string error;
+    };
+
+    struct Options {
+        //benchmarks whose name contains it, all when empty
+        std::string filter;
+        //time of one repetition, in seconds
+        double minTime;
+        int repetitions;
+    };
+
+    typedef std::function<void(State&)> Function;
+
+    //the assets (models, textures) are looked up relative to it, GP_Project by default
+    void SetAssetDirectory(const std::string& directory);
+    std::string AssetPath(const std::string& relativePath);
+
+    //registers a benchmark, normally through BENCHMARK / BENCHMARK_CAPTURE
+    int Register(const std::string& name, Function function);
+    const std::vector<std::pair<std::string, Function> >& GetBenchmarks();
+    Result Run(const std::string& name, const Function& function, const Options& options);
+
+    namespace detail {
+        extern const void* volatile sink;
+    }
+
+    //keeps the compiler from optimizing away a computed value
+    template <class T>
+    inline void DoNotOptimize(const T& value) {
+        detail::sink = &value;
+#if defined(__GNUC__) || defined(__clang__)
+        asm volatile("" : : "r"(&value) : "memory");
+#endif
+    }
+}
+}
+
+#define BENCHMARK_CONCAT(a, b) a##b
+#define BENCHMARK_REGISTRATION(line) BENCHMARK_CONCAT(benchmarkRegistration, line)
+//registers void function(gps::bench::State&) under its own name
+#define BENCHMARK(function) \
+    static int BENCHMARK_REGISTRATION(__LINE__) = gps::bench::Register(#function, function)
+//registers function(state, arguments...) as "function/suffix"
+#define BENCHMARK_CAPTURE(function, suffix, ...) \
+    static int BENCHMARK_REGISTRATION(__LINE__) = gps::bench::Register(#function "/" #suffix, \
+        [](gps::bench::State& state) { function(state, __VA_ARGS__); })
+
+#endif /* Benchmark_hpp */
@@ -0,0 +1,199 @@
+#include "Benchmark.hpp"
+#include "Logger.hpp"
+
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <ctime>
+#include <fstream>
+#include <map>
+#include <sstream>
+
+//Runs the registered benchmarks, prints a table and writes the results as JSON
+//(the layout of Google Benchmark's --benchmark_format=json, with real_time the median)
+//usage: GP_Benchmarks [--filter text] [--min-time seconds] [--repetitions n] [--json file]
+//                     [--assets directory] [--baseline file --max-regression percent]
+
+namespace {
+
+    std::string escape(const std::string& text) {
+
+        std::string escaped;
+        for (size_t i = 0; i < text.size(); i++) {
+            if (text[i] == '"' || text[i] == '\\') {
+                escaped += '\\';
+            }
+            escaped += text[i];
+        }
+        return escaped;
+    }
+
+    bool writeJson(const std::string& fileName, const std::vector<gps::bench::Result>& results, const gps::bench::Options& options) {
+
+        std::ofstream file(fileName.c_str());
+        if (!file) {
+            LOG_ERROR("could not create %s", fileName.c_str());
+            return false;
+        }
+
+        char date[64];
+        time_t now = time(NULL);
+        strftime(date, sizeof(date), "%Y-%m-%dT%H:%M:%S", localtime(&now));
+        char line[1024];
+        snprintf(line, sizeof(line), "{\n  \"context\": { \"date\": \"%s\", \"min_time\": %.3f, \"repetitions\": %d },\n  \"benchmarks\": [",
+            date, options.minTime, options.repetitions);
+        file << line;
+        for (size_t i = 0; i < results.size(); i++) {
+            const gps::bench::Result& result = results[i];
+            snprintf(line, sizeof(line), "%s\n    { \"name\": \"%s\", \"iterations\": %lld, \"repetitions\": %d, \"real_time\": %.3f, "
+                "\"mean_ns\": %.3f, \"median_ns\": %.3f, \"min_ns\": %.3f, \"stddev_ns\": %.3f, \"time_unit\": \"ns\", "
+                "\"items_per_second\": %.1f, \"bytes_per_second\": %.1f, \"error\": \"%s\" }",
+                i == 0 ? "" : ",", escape(result.name).c_str(), (long long)result.iterations, result.repetitions, result.medianNs,
+                result.meanNs, result.medianNs, result.minNs, result.stddevNs,
+                result.itemsPerSecond, result.bytesPerSecond, escape(result.error).c_str());
+            file << line;
+        }
+        file << "\n  ]\n}\n";
+        return (bool)file;
+    }
+
+    //the medians of a file written by writeJson, by benchmark name
+    bool readBaseline(const std::string& fileName, std::map<std::string, double>& medians) {
+
+        std::ifstream file(fileName.c_str());
+        if (!file) {
+            LOG_ERROR("could not open baseline %s", fileName.c_str());
+            return false;
+        }
+        std::stringstream contents;
+        contents << file.rdbuf();
+        std::string text = contents.str();
+
+        size_t position = 0;
+        while ((position = text.find("\"name\": \"", position)) != std::string::npos) {
+            position += 9;
+            size_t nameEnd = text.find('"', position);
+            size_t median = text.find("\"median_ns\": ", nameEnd);
+            if (nameEnd == std::string::npos || median == std::string::npos) {
+                break;
+            }
+            medians[text.substr(position, nameEnd - position)] = std::atof(text.c_str() + median + 13);
+            position = median;
+        }
+        return true;
+    }
+
+    std::string formatTime(double nanoseconds) {
+
+        char text[32];
+        if (nanoseconds >= 1e6) {
+            snprintf(text, sizeof(text), "%10.3f ms", nanoseconds / 1e6);
+        }
+        else if (nanoseconds >= 1e3) {
+            snprintf(text, sizeof(text), "%10.3f us", nanoseconds / 1e3);
+        }
+        else {
+            snprintf(text, sizeof(text), "%10.3f ns", nanoseconds);
+        }
+        return text;
+    }
+}
+
+int runBenchmarks(int argc, const char* argv[]) {
+
+    gps::bench::Options options;
+    options.minTime = 0.2;
+    options.repetitions = 5;
+    std::string jsonOutput;
+    std::string baselineFile;
+    double maxRegression = 10.0;
+
+    for (int i = 1; i < argc; i++) {
+        std::string argument = argv[i];
+        if (argument == "--filter" && i + 1 < argc) {
+            options.filter = argv[++i];
+        }
+        else if (argument == "--min-time" && i + 1 < argc) {
+            options.minTime = std::atof(argv[++i]);
+        }
+        else if (argument == "--repetitions" && i + 1 < argc) {
+            options.repetitions = std::max(std::atoi(argv[++i]), 1);
+        }
+        else if (argument == "--json" && i + 1 < argc) {
+            jsonOutput = argv[++i];
+        }
+        else if (argument == "--assets" && i + 1 < argc) {
+            gps::bench::SetAssetDirectory(argv[++i]);
+        }
+        else if (argument == "--baseline" && i + 1 < argc) {
+            baselineFile = argv[++i];
+        }
+        else if (argument == "--max-regression" && i + 1 < argc) {
+            maxRegression = std::atof(argv[++i]);
+        }
+        else {
+            LOG_WARNING("unknown argument %s", argument.c_str());
+        }
+    }
+
+    std::map<std::string, double> baseline;
+    if (!baselineFile.empty() && !readBaseline(baselineFile, baseline)) {
+        return EXIT_FAILURE;
+    }
+
+    std::vector<gps::bench::Result> results;
+    int regressions = 0;
+    printf("%-48s %13s %13s %12s %14s %s\n", "benchmark", "median", "min", "iterations", "throughput", baseline.empty() ? "" : "vs baseline");
+    const std::vector<std::pair<std::string, gps::bench::Function> >& benchmarks = gps::bench::GetBenchmarks();
+    for (size_t i = 0; i < benchmarks.size(); i++) {
+        if (!options.filter.empty() && benchmarks[i].first.find(options.filter) == std::string::npos) {
+            continue;
+        }
+        gps::bench::Result result = gps::bench::Run(benchmarks[i].first, benchmarks[i].second, options);
+        results.push_back(result);
+        if (!result.error.empty()) {
+            printf("%-48s skipped: %s\n", result.name.c_str(), result.error.c_str());
+            fflush(stdout);
+            continue;
+        }
+
+        char throughput[32] = "";
+        if (result.bytesPerSecond > 0.0) {
+            snprintf(throughput, sizeof(throughput), "%9.1f MB/s", result.bytesPerSecond / (1024.0 * 1024.0));
+        }
+        else if (result.itemsPerSecond > 0.0) {
+            snprintf(throughput, sizeof(throughput), "%9.2f M/s", result.itemsPerSecond / 1e6);
+        }
+        char comparison[64] = "";
+        std::map<std::string, double>::const_iterator old = baseline.find(result.name);
+        if (old != baseline.end() && old->second > 0.0) {
+            double change = (result.medianNs / old->second - 1.0) * 100.0;
+            bool regressed = change > maxRegression;
+            regressions += regressed ? 1 : 0;
+            snprintf(comparison, sizeof(comparison), "%+7.1f%%%s", change, regressed ? " REGRESSION" : "");
+        }
+        printf("%-48s %s %s %12lld %14s %s\n", result.name.c_str(), formatTime(result.medianNs).c_str(), formatTime(result.minNs).c_str(),
+            (long long)result.iterations, throughput, comparison);
+        fflush(stdout);
+    }
+
+    if (!jsonOutput.empty()) {
+        if (!writeJson(jsonOutput, results, options)) {
+            return EXIT_FAILURE;
+        }
+        LOG_INFO("Results written to %s", jsonOutput.c_str());
+    }
+    if (regressions > 0) {
+        LOG_ERROR("%d benchmarks slower than the baseline by more than %.1f%%", regressions, maxRegression);
+        return EXIT_FAILURE;
+    }
+    return EXIT_SUCCESS;
+}
+
+int main(int argc, const char* argv[]) {
+
+    gps::Logger::Start();
+    int status = runBenchmarks(argc, argv);
+    gps::Logger::Stop();
+    return status;
+}
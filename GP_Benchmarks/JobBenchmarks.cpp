@@ -0,0 +1,170 @@
+#include "Benchmark.hpp"
+#include "Frustum.hpp"
+#include "JobSystem.hpp"
+#include "Logger.hpp"
+#include "Model3D.hpp"
+
+#include <glm/gtc/matrix_transform.hpp>
+
+#include <fstream>
+#include <random>
+#include <string>
+#include <thread>
+#include <vector>
+
+//The job system: the cost of scheduling a job, and how a culling workload and the loading of the
+//shipped assets scale with the threads (suffix threads_N); counts above the hardware threads are skipped
+
+namespace {
+
+    using gps::bench::State;
+
+    //the job system of one benchmark, started before its timer and stopped after it
+    class ScopedJobSystem {
+
+    public:
+        explicit ScopedJobSystem(int threads) {
+            gps::JobSystem::Start(threads);
+        }
+        ~ScopedJobSystem() {
+            gps::JobSystem::Stop();
+        }
+    };
+
+    bool skipOversubscribed(State& state, int threads) {
+
+        int hardwareThreads = std::max((int)std::thread::hardware_concurrency(), 1);
+        if (threads > hardwareThreads) {
+            state.SkipWithError("only " + std::to_string(hardwareThreads) + " hardware threads");
+            return true;
+        }
+        return false;
+    }
+
+    //one job queued and waited for, the latency of a single task
+    void BM_JobRunWait(State& state, int threads) {
+
+        if (skipOversubscribed(state, threads)) {
+            return;
+        }
+        ScopedJobSystem jobSystem(threads);
+        int counter = 0;
+        while (state.KeepRunning()) {
+            gps::Job* job = gps::JobSystem::Create([&counter]() { counter++; });
+            gps::JobSystem::Run(job);
+            gps::JobSystem::Wait(job);
+        }
+        gps::bench::DoNotOptimize(counter);
+    }
+    BENCHMARK_CAPTURE(BM_JobRunWait, threads_1, 1);
+    BENCHMARK_CAPTURE(BM_JobRunWait, threads_4, 4);
+
+    //empty ranges of one item: what the system costs per job, split, queue, steal and finish included
+    void BM_ParallelForOverhead(State& state, int threads) {
+
+        if (skipOversubscribed(state, threads)) {
+            return;
+        }
+        const int jobs = 4096;
+        ScopedJobSystem jobSystem(threads);
+        while (state.KeepRunning()) {
+            gps::JobSystem::ParallelFor(jobs, 1, [](int begin, int end) {
+                gps::bench::DoNotOptimize(begin);
+            });
+        }
+        state.SetItemsPerIteration(jobs);
+    }
+    BENCHMARK_CAPTURE(BM_ParallelForOverhead, threads_1, 1);
+    BENCHMARK_CAPTURE(BM_ParallelForOverhead, threads_2, 2);
+    BENCHMARK_CAPTURE(BM_ParallelForOverhead, threads_4, 4);
+    BENCHMARK_CAPTURE(BM_ParallelForOverhead, threads_8, 8);
+
+    //synthetic workload: bounding spheres moved by their transforms and culled, 256 objects per job
+    void BM_ParallelCullScaling(State& state, int threads) {
+
+        if (skipOversubscribed(state, threads)) {
+            return;
+        }
+        const int objectCount = 1 << 16;
+        std::mt19937 random(42);
+        std::uniform_real_distribution<float> position(-50.0f, 50.0f);
+        std::vector<glm::mat4> transforms(objectCount);
+        for (int i = 0; i < objectCount; i++) {
+            transforms[i] = glm::translate(glm::mat4(1.0f), glm::vec3(position(random), position(random) * 0.1f, position(random)));
+        }
+        gps::Frustum frustum;
+        glm::mat4 projection = glm::perspective(glm::radians(45.0f), 1024.0f / 768.0f, 0.1f, 1000.0f);
+        frustum.Update(projection * glm::lookAt(glm::vec3(0.0f, 2.0f, 5.5f), glm::vec3(0.0f, 0.0f, -10.0f), glm::vec3(0.0f, 1.0f, 0.0f)));
+        std::vector<unsigned char> visible(objectCount);
+
+        ScopedJobSystem jobSystem(threads);
+        while (state.KeepRunning()) {
+            gps::JobSystem::ParallelFor(objectCount, 256, [&](int begin, int end) {
+                for (int i = begin; i < end; i++) {
+                    visible[i] = frustum.IntersectsSphere(gps::transformBoundingSphere(transforms[i], glm::vec4(0.0f, 1.0f, 0.0f, 1.5f)));
+                }
+            });
+            gps::bench::DoNotOptimize(visible[0]);
+        }
+        state.SetItemsPerIteration(objectCount);
+    }
+    BENCHMARK_CAPTURE(BM_ParallelCullScaling, threads_1, 1);
+    BENCHMARK_CAPTURE(BM_ParallelCullScaling, threads_2, 2);
+    BENCHMARK_CAPTURE(BM_ParallelCullScaling, threads_4, 4);
+    BENCHMARK_CAPTURE(BM_ParallelCullScaling, threads_8, 8);
+
+    //the CPU half of the startup model loading (initObjects): every model parsed on its own job,
+    //every texture decoded on its own job; the models missing from the checkout are left out
+    void BM_ParseShippedAssets(State& state, int threads) {
+
+        if (skipOversubscribed(state, threads)) {
+            return;
+        }
+        const char* files[] = {
+            "models/Honda/ImageToStl.com_honda_nr750_1994.obj",
+            "models/parking_lot/ImageToStl.com_parking_lot.obj",
+            "models/teapot/teapot20segUT.obj",
+            "models/cube/cube.obj",
+            "models/quad/quad.obj",
+        };
+        std::vector<std::string> fileNames;
+        for (size_t i = 0; i < sizeof(files) / sizeof(files[0]); i++) {
+            std::string fileName = gps::bench::AssetPath(files[i]);
+            if (std::ifstream(fileName.c_str())) {
+                fileNames.push_back(fileName);
+            }
+        }
+        const int fileCount = (int)fileNames.size();
+        if (fileCount == 0) {
+            state.SkipWithError("no model found under " + gps::bench::AssetPath("models"));
+            return;
+        }
+
+        //the parser announces every file
+        gps::Logger::SetLevel(gps::LOG_LEVEL_WARNING);
+        ScopedJobSystem jobSystem(threads);
+        std::vector<char> parsed(fileCount);
+        while (state.KeepRunning()) {
+            //never uploaded, so no GL object is created or deleted
+            std::vector<gps::Model3D> models(fileCount);
+            gps::JobSystem::ParallelFor(fileCount, 1, [&](int begin, int end) {
+                for (int i = begin; i < end; i++) {
+                    parsed[i] = models[i].ParseModel(fileNames[i]);
+                }
+            });
+            for (int i = 0; i < fileCount; i++) {
+                if (!parsed[i]) {
+                    gps::Logger::SetLevel(gps::LOG_LEVEL_INFO);
+                    state.SkipWithError("could not load " + fileNames[i]);
+                    return;
+                }
+            }
+        }
+        gps::Logger::SetLevel(gps::LOG_LEVEL_INFO);
+        state.SetItemsPerIteration(fileCount);
+    }
+    BENCHMARK_CAPTURE(BM_ParseShippedAssets, threads_1, 1);
+    BENCHMARK_CAPTURE(BM_ParseShippedAssets, threads_2, 2);
+    BENCHMARK_CAPTURE(BM_ParseShippedAssets, threads_4, 4);
+    BENCHMARK_CAPTURE(BM_ParseShippedAssets, threads_8, 8);
+}
@@ -0,0 +1,166 @@
+#include "Benchmark.hpp"
+#include "Model3D.hpp"
+
+#include <fstream>
+#include <map>
+
+//Model loading on the CPU: the OBJ parser, the vertex assembly of Model3D::ReadOBJ
+//and the image decoding + row flip of Model3D::DecodeTexture (no GL involved)
+
+namespace {
+
+    using gps::bench::State;
+
+    struct ObjData {
+        tinyobj::attrib_t attrib;
+        std::vector<tinyobj::shape_t> shapes;
+        std::vector<tinyobj::material_t> materials;
+    };
+
+    struct Image {
+        std::vector<unsigned char> pixels;
+        int width;
+        int height;
+    };
+
+    int64_t fileSize(const std::string& fileName) {
+
+        std::ifstream file(fileName.c_str(), std::ios::binary | std::ios::ate);
+        return file ? (int64_t)file.tellg() : -1;
+    }
+
+    bool loadObj(const std::string& fileName, ObjData& data) {
+
+        std::string err;
+        std::string basePath = fileName.substr(0, fileName.find_last_of('/') + 1);
+        return tinyobj::LoadObj(&data.attrib, &data.shapes, &data.materials, &err, fileName.c_str(), basePath.c_str(), true);
+    }
+
+    //parsed once and kept for the benchmarks that start from tinyobj's output
+    const ObjData* cachedObj(const std::string& fileName) {
+
+        static std::map<std::string, ObjData> cache;
+        std::map<std::string, ObjData>::iterator it = cache.find(fileName);
+        if (it == cache.end()) {
+            ObjData data;
+            if (!loadObj(fileName, data)) {
+                return NULL;
+            }
+            it = cache.insert(std::make_pair(fileName, data)).first;
+        }
+        return &it->second;
+    }
+
+    const Image* cachedImage(const std::string& fileName) {
+
+        static std::map<std::string, Image> cache;
+        std::map<std::string, Image>::iterator it = cache.find(fileName);
+        if (it == cache.end()) {
+            Image image;
+            int channels;
+            unsigned char* pixels = stbi_load(fileName.c_str(), &image.width, &image.height, &channels, 4);
+            if (!pixels) {
+                return NULL;
+            }
+            image.pixels.assign(pixels, pixels + (size_t)image.width * image.height * 4);
+            stbi_image_free(pixels);
+            it = cache.insert(std::make_pair(fileName, image)).first;
+        }
+        return &it->second;
+    }
+
+    void BM_TinyObjLoad(State& state, const char* file) {
+
+        std::string fileName = gps::bench::AssetPath(file);
+        int64_t bytes = fileSize(fileName);
+        if (bytes < 0) {
+            state.SkipWithError("missing " + fileName);
+            return;
+        }
+        while (state.KeepRunning()) {
+            ObjData data;
+            if (!loadObj(fileName, data)) {
+                state.SkipWithError("could not parse " + fileName);
+                return;
+            }
+            gps::bench::DoNotOptimize(data);
+        }
+        state.SetBytesPerIteration(bytes);
+    }
+    BENCHMARK_CAPTURE(BM_TinyObjLoad, parking_lot, "models/parking_lot/ImageToStl.com_parking_lot.obj");
+    BENCHMARK_CAPTURE(BM_TinyObjLoad, teapot, "models/teapot/teapot20segUT.obj");
+    BENCHMARK_CAPTURE(BM_TinyObjLoad, honda, "models/Honda/ImageToStl.com_honda_nr750_1994.obj");
+
+    //the per-shape loop of Model3D::ReadOBJ, from the parsed OBJ to the mesh vertex and index arrays
+    void BM_AssembleShapes(State& state, const char* file) {
+
+        std::string fileName = gps::bench::AssetPath(file);
+        const ObjData* data = cachedObj(fileName);
+        if (data == NULL) {
+            state.SkipWithError("could not load " + fileName);
+            return;
+        }
+        int64_t corners = 0;
+        for (size_t s = 0; s < data->shapes.size(); s++) {
+            corners += (int64_t)data->shapes[s].mesh.indices.size();
+        }
+        std::vector<gps::Vertex> vertices;
+        std::vector<GLuint> indices;
+        while (state.KeepRunning()) {
+            for (size_t s = 0; s < data->shapes.size(); s++) {
+                //ReadOBJ starts every shape with empty arrays
+                std::vector<gps::Vertex>().swap(vertices);
+                std::vector<GLuint>().swap(indices);
+                bool hasTexCoords = gps::Model3D::AssembleShape(data->attrib, data->shapes[s], vertices, indices);
+                gps::bench::DoNotOptimize(hasTexCoords);
+                gps::bench::DoNotOptimize(vertices);
+            }
+        }
+        state.SetItemsPerIteration(corners);
+    }
+    BENCHMARK_CAPTURE(BM_AssembleShapes, parking_lot, "models/parking_lot/ImageToStl.com_parking_lot.obj");
+    BENCHMARK_CAPTURE(BM_AssembleShapes, teapot, "models/teapot/teapot20segUT.obj");
+    BENCHMARK_CAPTURE(BM_AssembleShapes, honda, "models/Honda/ImageToStl.com_honda_nr750_1994.obj");
+
+    //decode and flip, as Model3D::DecodeTexture does before the upload
+    void BM_StbiLoadFlip(State& state, const char* file) {
+
+        std::string fileName = gps::bench::AssetPath(file);
+        int64_t bytes = fileSize(fileName);
+        if (bytes < 0) {
+            state.SkipWithError("missing " + fileName);
+            return;
+        }
+        while (state.KeepRunning()) {
+            int width, height, channels;
+            unsigned char* pixels = stbi_load(fileName.c_str(), &width, &height, &channels, 4);
+            if (!pixels) {
+                state.SkipWithError("could not decode " + fileName);
+                return;
+            }
+            gps::Model3D::FlipRows(pixels, width, height, 4);
+            gps::bench::DoNotOptimize(pixels[0]);
+            stbi_image_free(pixels);
+        }
+        state.SetBytesPerIteration(bytes);
+    }
+    BENCHMARK_CAPTURE(BM_StbiLoadFlip, honda_material_jpg, "models/Honda/material_baseColor.jpg");
+    BENCHMARK_CAPTURE(BM_StbiLoadFlip, honda_glass_png, "models/Honda/Glass_baseColor.png");
+
+    void BM_FlipRows(State& state, const char* file) {
+
+        std::string fileName = gps::bench::AssetPath(file);
+        const Image* image = cachedImage(fileName);
+        if (image == NULL) {
+            state.SkipWithError("could not decode " + fileName);
+            return;
+        }
+        std::vector<unsigned char> pixels = image->pixels;
+        while (state.KeepRunning()) {
+            gps::Model3D::FlipRows(pixels.data(), image->width, image->height, 4);
+            gps::bench::DoNotOptimize(pixels[0]);
+        }
+        state.SetBytesPerIteration((int64_t)pixels.size());
+    }
+    BENCHMARK_CAPTURE(BM_FlipRows, honda_material_jpg, "models/Honda/material_baseColor.jpg");
+}
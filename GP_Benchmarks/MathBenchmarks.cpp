@@ -0,0 +1,144 @@
+#include "Benchmark.hpp"
+#include "Camera.hpp"
+#include "CameraPath.hpp"
+#include "Frustum.hpp"
+#include "LightSpace.hpp"
+
+#include <glm/gtc/matrix_transform.hpp>
+
+#include <random>
+
+//Per-frame CPU math: the camera, the sun shadow matrix and the culling kernels
+
+namespace {
+
+    using gps::bench::State;
+
+    //objects scattered around the parking lot, in world space
+    const int SPHERE_COUNT = 1024;
+
+    std::vector<glm::vec4> randomSpheres() {
+
+        std::mt19937 random(42);
+        std::uniform_real_distribution<float> position(-50.0f, 50.0f);
+        std::uniform_real_distribution<float> radius(0.1f, 3.0f);
+        std::vector<glm::vec4> spheres(SPHERE_COUNT);
+        for (int i = 0; i < SPHERE_COUNT; i++) {
+            spheres[i] = glm::vec4(position(random), position(random) * 0.1f, position(random), radius(random));
+        }
+        return spheres;
+    }
+
+    glm::mat4 sceneViewProjection() {
+
+        glm::mat4 projection = glm::perspective(glm::radians(45.0f), 1024.0f / 768.0f, 0.1f, 1000.0f);
+        glm::mat4 view = glm::lookAt(glm::vec3(0.0f, 2.0f, 5.5f), glm::vec3(0.0f, 0.0f, -10.0f), glm::vec3(0.0f, 1.0f, 0.0f));
+        return projection * view;
+    }
+
+    void BM_CameraViewMatrix(State& state) {
+
+        gps::Camera camera(glm::vec3(0.0f, 2.0f, 5.5f), glm::vec3(0.0f, 0.0f, -10.0f), glm::vec3(0.0f, 1.0f, 0.0f));
+        while (state.KeepRunning()) {
+            glm::mat4 view = camera.getViewMatrix();
+            gps::bench::DoNotOptimize(view);
+        }
+    }
+    BENCHMARK(BM_CameraViewMatrix);
+
+    void BM_CameraRotate(State& state) {
+
+        gps::Camera camera(glm::vec3(0.0f, 2.0f, 5.5f), glm::vec3(0.0f, 0.0f, -10.0f), glm::vec3(0.0f, 1.0f, 0.0f));
+        float yaw = 0.0f;
+        while (state.KeepRunning()) {
+            yaw += 0.5f;
+            camera.rotate(10.0f, yaw);
+            gps::bench::DoNotOptimize(camera);
+        }
+    }
+    BENCHMARK(BM_CameraRotate);
+
+    void BM_CameraMove(State& state) {
+
+        gps::Camera camera(glm::vec3(0.0f, 2.0f, 5.5f), glm::vec3(0.0f, 0.0f, -10.0f), glm::vec3(0.0f, 1.0f, 0.0f));
+        int step = 0;
+        while (state.KeepRunning()) {
+            camera.move((gps::MOVE_DIRECTION)(step++ & 3), 0.01f);
+            gps::bench::DoNotOptimize(camera);
+        }
+    }
+    BENCHMARK(BM_CameraMove);
+
+    void BM_SunLightSpaceMatrix(State& state) {
+
+        glm::vec3 sunLightDir(0.0f, 10.0f, 1.0f);
+        float lightAngle = 0.0f;
+        while (state.KeepRunning()) {
+            lightAngle += 1.0f;
+            glm::mat4 lightRotation = glm::rotate(glm::mat4(1.0f), glm::radians(lightAngle), glm::vec3(0.0f, 1.0f, 0.0f));
+            glm::mat4 lightSpace = gps::computeSunLightSpaceMatrix(lightRotation, sunLightDir);
+            gps::bench::DoNotOptimize(lightSpace);
+        }
+    }
+    BENCHMARK(BM_SunLightSpaceMatrix);
+
+    void BM_FrustumUpdate(State& state) {
+
+        glm::mat4 viewProjection = sceneViewProjection();
+        gps::Frustum frustum;
+        while (state.KeepRunning()) {
+            frustum.Update(viewProjection);
+            gps::bench::DoNotOptimize(frustum);
+        }
+    }
+    BENCHMARK(BM_FrustumUpdate);
+
+    void BM_FrustumCullSpheres(State& state) {
+
+        gps::Frustum frustum;
+        frustum.Update(sceneViewProjection());
+        std::vector<glm::vec4> spheres = randomSpheres();
+        while (state.KeepRunning()) {
+            int visible = 0;
+            for (int i = 0; i < SPHERE_COUNT; i++) {
+                visible += frustum.IntersectsSphere(spheres[i]) ? 1 : 0;
+            }
+            gps::bench::DoNotOptimize(visible);
+        }
+        state.SetItemsPerIteration(SPHERE_COUNT);
+    }
+    BENCHMARK(BM_FrustumCullSpheres);
+
+    //object space spheres moved into world space, as done for every object before culling
+    void BM_TransformBoundingSpheres(State& state) {
+
+        std::vector<glm::vec4> spheres = randomSpheres();
+        std::vector<glm::vec4> transformed(SPHERE_COUNT);
+        glm::mat4 transform = glm::scale(glm::rotate(glm::translate(glm::mat4(1.0f), glm::vec3(1.0f, 0.0f, -2.0f)),
+            glm::radians(30.0f), glm::vec3(0.0f, 1.0f, 0.0f)), glm::vec3(1.5f));
+        while (state.KeepRunning()) {
+            for (int i = 0; i < SPHERE_COUNT; i++) {
+                transformed[i] = gps::transformBoundingSphere(transform, spheres[i]);
+            }
+            gps::bench::DoNotOptimize(transformed[0]);
+        }
+        state.SetItemsPerIteration(SPHERE_COUNT);
+    }
+    BENCHMARK(BM_TransformBoundingSpheres);
+
+    void BM_CameraPathEvaluate(State& state) {
+
+        gps::CameraPath path;
+        for (int i = 0; i < 32; i++) {
+            gps::CameraKey key = { (float)i, glm::vec3((float)i, 2.0f, 0.0f), glm::vec3(0.0f), 8.0f + i * 0.25f };
+            path.AddKey(key);
+        }
+        float time = 0.0f;
+        while (state.KeepRunning()) {
+            time = time >= path.GetDuration() ? 0.0f : time + 0.0167f;
+            gps::CameraKey key = path.Evaluate(time);
+            gps::bench::DoNotOptimize(key);
+        }
+    }
+    BENCHMARK(BM_CameraPathEvaluate);
+}
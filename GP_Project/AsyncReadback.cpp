@@ -0,0 +1,138 @@
+#include "AsyncReadback.hpp"
+#include "Logger.hpp"
+
+#include <cstring>
+
+namespace gps {
+
+    namespace {
+
+        //a single wait on a fence, repeated until it signals
+        const GLuint64 WAIT_TIMEOUT_NANOSECONDS = 100000000;
+    }
+
+    AsyncReadback::AsyncReadback() {
+
+        first = 0;
+        pending = 0;
+        width = 0;
+        height = 0;
+    }
+
+    bool AsyncReadback::Create(int width, int height, int slots) {
+
+        Delete();
+        this->width = width;
+        this->height = height;
+        Slot empty = { 0, 0, -1 };
+        this->slots.assign(slots, empty);
+        for (int i = 0; i < slots; i++) {
+            glGenBuffers(1, &this->slots[i].buffer);
+            glBindBuffer(GL_PIXEL_PACK_BUFFER, this->slots[i].buffer);
+            glBufferData(GL_PIXEL_PACK_BUFFER, (GLsizeiptr)width * height * 4, NULL, GL_STREAM_READ);
+        }
+        glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+        return glGetError() == GL_NO_ERROR;
+    }
+
+    void AsyncReadback::Delete() {
+
+        for (size_t i = 0; i < slots.size(); i++) {
+            if (slots[i].fence != 0) {
+                glDeleteSync(slots[i].fence);
+                slots[i].fence = 0;
+            }
+            if (slots[i].buffer != 0) {
+                glDeleteBuffers(1, &slots[i].buffer);
+                slots[i].buffer = 0;
+            }
+        }
+        slots.clear();
+        first = 0;
+        pending = 0;
+    }
+
+    bool AsyncReadback::Request(GLuint framebuffer, int id) {
+
+        if (pending == (int)slots.size()) {
+            return false;
+        }
+        Slot& slot = slots[(first + pending) % slots.size()];
+        glBindFramebuffer(GL_READ_FRAMEBUFFER, framebuffer);
+        glReadBuffer(framebuffer == 0 ? GL_BACK : GL_COLOR_ATTACHMENT0);
+        glBindBuffer(GL_PIXEL_PACK_BUFFER, slot.buffer);
+        glPixelStorei(GL_PACK_ALIGNMENT, 1);
+        //with a pack buffer bound the last argument is an offset, and the call returns right away
+        glReadPixels(0, 0, width, height, GL_RGBA, GL_UNSIGNED_BYTE, 0);
+        glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+        slot.fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+        slot.id = id;
+        pending++;
+        return true;
+    }
+
+    bool AsyncReadback::Retrieve(std::vector<unsigned char>& pixels, int& id, bool wait) {
+
+        if (pending == 0) {
+            return false;
+        }
+        Slot& slot = slots[first];
+        //the first wait flushes, so the fence is guaranteed to reach the GPU
+        GLenum status = glClientWaitSync(slot.fence, GL_SYNC_FLUSH_COMMANDS_BIT, wait ? WAIT_TIMEOUT_NANOSECONDS : 0);
+        while (wait && status == GL_TIMEOUT_EXPIRED) {
+            status = glClientWaitSync(slot.fence, 0, WAIT_TIMEOUT_NANOSECONDS);
+        }
+        if (status == GL_TIMEOUT_EXPIRED) {
+            return false;
+        }
+        if (status == GL_WAIT_FAILED) {
+            LOG_ERROR("readback fence wait failed");
+        }
+
+        size_t size = (size_t)width * height * 4;
+        pixels.resize(size);
+        glBindBuffer(GL_PIXEL_PACK_BUFFER, slot.buffer);
+        void* mapped = glMapBufferRange(GL_PIXEL_PACK_BUFFER, 0, (GLsizeiptr)size, GL_MAP_READ_BIT);
+        if (mapped != NULL) {
+            memcpy(pixels.data(), mapped, size);
+            glUnmapBuffer(GL_PIXEL_PACK_BUFFER);
+        }
+        glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+
+        glDeleteSync(slot.fence);
+        slot.fence = 0;
+        id = slot.id;
+        first = (first + 1) % (int)slots.size();
+        pending--;
+        return mapped != NULL;
+    }
+
+    bool AsyncReadback::IsReady() {
+
+        if (pending == 0) {
+            return false;
+        }
+        //flushes like Retrieve, so the fence is guaranteed to reach the GPU
+        return glClientWaitSync(slots[first].fence, GL_SYNC_FLUSH_COMMANDS_BIT, 0) != GL_TIMEOUT_EXPIRED;
+    }
+
+    int AsyncReadback::GetPending() {
+
+        return pending;
+    }
+
+    int AsyncReadback::GetSlotCount() {
+
+        return (int)slots.size();
+    }
+
+    int AsyncReadback::GetWidth() {
+
+        return width;
+    }
+
+    int AsyncReadback::GetHeight() {
+
+        return height;
+    }
+}
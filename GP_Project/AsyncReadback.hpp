@@ -0,0 +1,59 @@
+#ifndef AsyncReadback_hpp
+#define AsyncReadback_hpp
+
+#if defined (__APPLE__)
+    #define GL_SILENCE_DEPRECATION
+    #include <OpenGL/gl3.h>
+#else
+    #define GLEW_STATIC
+    #include <GL/glew.h>
+#endif
+
+#include <vector>
+
+namespace gps {
+
+    //Reads framebuffers back without stalling the pipeline
+    //glReadPixels goes into a pixel pack buffer and a fence marks when the GPU has written it,
+    //so the frame keeps rendering while the copy is in flight; the buffer is only mapped
+    //once its fence has signaled (or when the caller chooses to wait)
+    class AsyncReadback {
+
+    public:
+        //reads in flight at the same time, unless Create asks for more
+        static const int DEFAULT_SLOTS = 3;
+
+        AsyncReadback();
+        //slots buffers for width x height RGBA8 reads
+        bool Create(int width, int height, int slots = DEFAULT_SLOTS);
+        void Delete();
+        //queues a read of the first color attachment of framebuffer, tagged with id;
+        //false when every slot already has a read in flight
+        bool Request(GLuint framebuffer, int id);
+        //copies the oldest read into pixels (RGBA8, rows bottom up) once the GPU is done with it;
+        //false when nothing is pending, or when it isn't finished and wait is false
+        bool Retrieve(std::vector<unsigned char>& pixels, int& id, bool wait);
+        //whether the oldest read is finished, so Retrieve would not wait; never blocks
+        bool IsReady();
+        int GetPending();
+        int GetSlotCount();
+        int GetWidth();
+        int GetHeight();
+
+    private:
+        struct Slot {
+            GLuint buffer;
+            GLsync fence;
+            int id;
+        };
+
+        std::vector<Slot> slots;
+        //slot of the oldest pending read
+        int first;
+        int pending;
+        int width;
+        int height;
+    };
+}
+
+#endif /* AsyncReadback_hpp */
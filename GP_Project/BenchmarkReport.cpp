@@ -0,0 +1,172 @@
+#include "BenchmarkReport.hpp"
+#include "Logger.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <fstream>
+#include <numeric>
+
+namespace gps {
+
+    void BenchmarkReport::SetInfo(const std::string& key, const std::string& value) {
+
+        info.push_back(std::make_pair(key, value));
+    }
+
+    void BenchmarkReport::AddFrame(double cpuMilliseconds, double frameMilliseconds) {
+
+        cpuTimes.push_back(cpuMilliseconds);
+        frameTimes.push_back(frameMilliseconds);
+    }
+
+    void BenchmarkReport::AddPassTimes(const std::vector<PassTime>& passTimes) {
+
+        for (size_t i = 0; i < passTimes.size(); i++) {
+            size_t pass = std::find(passNames.begin(), passNames.end(), passTimes[i].name) - passNames.begin();
+            if (pass == passNames.size()) {
+                passNames.push_back(passTimes[i].name);
+                gpuPassTimes.push_back(std::vector<double>());
+                cpuPassTimes.push_back(std::vector<double>());
+            }
+            if (passTimes[i].gpuTimed) {
+                gpuPassTimes[pass].push_back(passTimes[i].gpuMilliseconds);
+            }
+            cpuPassTimes[pass].push_back(passTimes[i].cpuMilliseconds);
+        }
+    }
+
+    void BenchmarkReport::AddRenderCounters(const RenderCounters& counters) {
+
+        RenderStats::Add(renderCounters, counters);
+        renderCounterFrames++;
+    }
+
+    void BenchmarkReport::AddImageDiff(const std::string& name, const ImageDiffResult& diff, bool passed) {
+
+        ImageDiffEntry entry = { name, diff, passed };
+        imageDiffs.push_back(entry);
+    }
+
+    int BenchmarkReport::GetFrameCount() const {
+
+        return (int)frameTimes.size();
+    }
+
+    //nearest rank
+    double BenchmarkReport::Percentile(std::vector<double> values, double percentile) {
+
+        if (values.empty()) {
+            return 0.0;
+        }
+        size_t rank = (size_t)std::ceil(percentile / 100.0 * values.size());
+        rank = std::min(std::max(rank, (size_t)1), values.size());
+        std::nth_element(values.begin(), values.begin() + (rank - 1), values.end());
+        return values[rank - 1];
+    }
+
+    std::string BenchmarkReport::StatsJson(const std::vector<double>& values) {
+
+        double mean = values.empty() ? 0.0 : std::accumulate(values.begin(), values.end(), 0.0) / values.size();
+        double maximum = values.empty() ? 0.0 : *std::max_element(values.begin(), values.end());
+        char text[256];
+        snprintf(text, sizeof(text), "{ \"samples\": %d, \"mean\": %.4f, \"p50\": %.4f, \"p95\": %.4f, \"p99\": %.4f, \"max\": %.4f }",
+            (int)values.size(), mean, Percentile(values, 50.0), Percentile(values, 95.0), Percentile(values, 99.0), maximum);
+        return text;
+    }
+
+    std::string BenchmarkReport::Escape(const std::string& text) {
+
+        std::string escaped;
+        for (size_t i = 0; i < text.size(); i++) {
+            char c = text[i];
+            if (c == '"' || c == '\\') {
+                escaped += '\\';
+                escaped += c;
+            }
+            else if ((unsigned char)c < 0x20) {
+                char code[8];
+                snprintf(code, sizeof(code), "\\u%04x", c);
+                escaped += code;
+            }
+            else {
+                escaped += c;
+            }
+        }
+        return escaped;
+    }
+
+    //CPU only scopes have no GPU samples and are left out
+    std::string BenchmarkReport::PassesJson(const std::vector<std::vector<double> >& passTimes) const {
+
+        std::string json = "{";
+        bool first = true;
+        for (size_t i = 0; i < passNames.size(); i++) {
+            if (passTimes[i].empty()) {
+                continue;
+            }
+            json += (first ? "\n" : ",\n");
+            json += "    \"" + Escape(passNames[i]) + "\": " + StatsJson(passTimes[i]);
+            first = false;
+        }
+        json += (first ? "}" : "\n  }");
+        return json;
+    }
+
+    std::string BenchmarkReport::ImageDiffsJson() const {
+
+        std::string json = "[";
+        for (size_t i = 0; i < imageDiffs.size(); i++) {
+            const ImageDiffEntry& entry = imageDiffs[i];
+            char text[512];
+            //JSON has no infinity, identical images get a null PSNR
+            char psnr[32] = "null";
+            if (!std::isinf(entry.diff.psnr)) {
+                snprintf(psnr, sizeof(psnr), "%.2f", entry.diff.psnr);
+            }
+            snprintf(text, sizeof(text), "%s\n    { \"name\": \"%s\", \"passed\": %s, \"different_pixels\": %d, \"different_fraction\": %.6f, "
+                "\"max_difference\": %.4f, \"mean_difference\": %.6f, \"psnr\": %s }",
+                i == 0 ? "" : ",", Escape(entry.name).c_str(), entry.passed ? "true" : "false", entry.diff.differentPixels,
+                entry.diff.differentFraction, entry.diff.maxDifference, entry.diff.meanDifference, psnr);
+            json += text;
+        }
+        json += imageDiffs.empty() ? "]" : "\n  ]";
+        return json;
+    }
+
+    bool BenchmarkReport::WriteJson(const std::string& fileName) const {
+
+        std::ofstream file(fileName.c_str());
+        if (!file) {
+            LOG_ERROR("could not create benchmark report %s", fileName.c_str());
+            return false;
+        }
+
+        file << "{\n";
+        for (size_t i = 0; i < info.size(); i++) {
+            file << "  \"" << Escape(info[i].first) << "\": \"" << Escape(info[i].second) << "\",\n";
+        }
+        file << "  \"frames\": " << frameTimes.size() << ",\n";
+        file << "  \"cpu_ms\": " << StatsJson(cpuTimes) << ",\n";
+        file << "  \"frame_ms\": " << StatsJson(frameTimes) << ",\n";
+        file << "  \"gpu_pass_ms\": " << PassesJson(gpuPassTimes) << ",\n";
+        file << "  \"cpu_pass_ms\": " << PassesJson(cpuPassTimes) << ",\n";
+        file << "  \"render_counters\": " << RenderStats::CountersJson(renderCounters, renderCounterFrames);
+        if (!imageDiffs.empty()) {
+            file << ",\n  \"image_diffs\": " << ImageDiffsJson();
+        }
+        file << "\n";
+        file << "}\n";
+
+        return (bool)file;
+    }
+
+    std::string BenchmarkReport::Summary() const {
+
+        char text[256];
+        snprintf(text, sizeof(text), "%d frames, frame time p50 %.3f ms, p95 %.3f ms, p99 %.3f ms, max %.3f ms",
+            (int)frameTimes.size(), Percentile(frameTimes, 50.0), Percentile(frameTimes, 95.0), Percentile(frameTimes, 99.0),
+            frameTimes.empty() ? 0.0 : *std::max_element(frameTimes.begin(), frameTimes.end()));
+        return text;
+    }
+}
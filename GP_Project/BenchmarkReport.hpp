@@ -0,0 +1,57 @@
+#ifndef BenchmarkReport_hpp
+#define BenchmarkReport_hpp
+
+#include "ImageDiff.hpp"
+#include "PassTimer.hpp"
+#include "RenderStats.hpp"
+
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace gps {
+
+    //Frame times collected by the benchmark mode, written as JSON with
+    //mean, p50, p95, p99 and max for the CPU time, the whole frame and every pass on the GPU and CPU,
+    //plus the mean render counters per frame and, for the golden image test, the image differences
+    class BenchmarkReport {
+
+    public:
+        //shown as "key": "value" at the top of the report (renderer, resolution, path...)
+        void SetInfo(const std::string& key, const std::string& value);
+        //cpuMilliseconds: update and command submission, frameMilliseconds: up to the finished swap
+        void AddFrame(double cpuMilliseconds, double frameMilliseconds);
+        void AddPassTimes(const std::vector<PassTime>& passTimes);
+        void AddRenderCounters(const RenderCounters& counters);
+        //a render compared with its golden image
+        void AddImageDiff(const std::string& name, const ImageDiffResult& diff, bool passed);
+        int GetFrameCount() const;
+        bool WriteJson(const std::string& fileName) const;
+        //mean, p50, p95, p99 and max of the frame times, for the log
+        std::string Summary() const;
+
+    private:
+        std::vector<std::pair<std::string, std::string> > info;
+        std::vector<double> cpuTimes;
+        std::vector<double> frameTimes;
+        std::vector<std::string> passNames;
+        std::vector<std::vector<double> > gpuPassTimes;
+        std::vector<std::vector<double> > cpuPassTimes;
+        RenderCounters renderCounters = {};
+        int renderCounterFrames = 0;
+        struct ImageDiffEntry {
+            std::string name;
+            ImageDiffResult diff;
+            bool passed;
+        };
+        std::vector<ImageDiffEntry> imageDiffs;
+
+        static double Percentile(std::vector<double> values, double percentile);
+        static std::string StatsJson(const std::vector<double>& values);
+        static std::string Escape(const std::string& text);
+        std::string PassesJson(const std::vector<std::vector<double> >& passTimes) const;
+        std::string ImageDiffsJson() const;
+    };
+}
+
+#endif /* BenchmarkReport_hpp */
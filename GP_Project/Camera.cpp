@@ -39,6 +39,10 @@ namespace gps {
         this->cameraUpDirection = glm::cross(cameraRightDirection, cameraFrontDirection);
     }
 
+    glm::vec3 Camera::getCameraFrontDirection() const {
+        return cameraFrontDirection;
+    }
+
     //update the camera internal parameters following a camera move event
     void Camera::move(MOVE_DIRECTION direction, float speed) {
         switch (direction)
@@ -20,6 +20,8 @@ namespace gps {
         void setCameraPosition(const glm::vec3& position);
         glm::vec3 getCameraTarget() const;
         void setCameraTarget(const glm::vec3& target);
+        //where the camera looks, also after rotate (which leaves the target as it was)
+        glm::vec3 getCameraFrontDirection() const;
         //update the camera internal parameters following a camera move event
         void move(MOVE_DIRECTION direction, float speed);
         //update the camera internal parameters following a camera rotate event
@@ -0,0 +1,140 @@
+#include "CameraPath.hpp"
+#include "Logger.hpp"
+
+#include <fstream>
+#include <sstream>
+
+namespace gps {
+
+    namespace {
+
+        glm::vec3 catmullRom(glm::vec3 p0, glm::vec3 p1, glm::vec3 p2, glm::vec3 p3, float u) {
+
+            float u2 = u * u;
+            float u3 = u2 * u;
+            return 0.5f * ((2.0f * p1) + (-p0 + p2) * u + (2.0f * p0 - 5.0f * p1 + 4.0f * p2 - p3) * u2 +
+                (-p0 + 3.0f * p1 - 3.0f * p2 + p3) * u3);
+        }
+    }
+
+    void CameraPath::AddKey(const CameraKey& key) {
+
+        keys.push_back(key);
+    }
+
+    void CameraPath::Clear() {
+
+        keys.clear();
+    }
+
+    bool CameraPath::IsEmpty() const {
+
+        return keys.empty();
+    }
+
+    float CameraPath::GetDuration() const {
+
+        return keys.empty() ? 0.0f : keys.back().time;
+    }
+
+    int CameraPath::GetKeyCount() const {
+
+        return (int)keys.size();
+    }
+
+    const CameraKey& CameraPath::GetKey(int index) const {
+
+        return keys[index];
+    }
+
+    CameraKey CameraPath::Evaluate(float time) const {
+
+        if (keys.empty()) {
+            CameraKey key = { time, glm::vec3(0.0f), glm::vec3(0.0f, 0.0f, -1.0f), 12.0f };
+            return key;
+        }
+        if (time <= keys.front().time) {
+            return keys.front();
+        }
+        if (time >= keys.back().time) {
+            return keys.back();
+        }
+
+        //segment [i, i + 1] containing the time, the end keys are repeated as tangent neighbours
+        size_t i = 0;
+        while (i + 1 < keys.size() - 1 && keys[i + 1].time <= time) {
+            i++;
+        }
+        const CameraKey& k0 = keys[i > 0 ? i - 1 : i];
+        const CameraKey& k1 = keys[i];
+        const CameraKey& k2 = keys[i + 1];
+        const CameraKey& k3 = keys[i + 2 < keys.size() ? i + 2 : i + 1];
+
+        float segment = k2.time - k1.time;
+        float u = segment > 0.0f ? (time - k1.time) / segment : 0.0f;
+
+        CameraKey result;
+        result.time = time;
+        result.position = catmullRom(k0.position, k1.position, k2.position, k3.position, u);
+        result.target = catmullRom(k0.target, k1.target, k2.target, k3.target, u);
+        result.timeOfDay = glm::mix(k1.timeOfDay, k2.timeOfDay, u);
+        return result;
+    }
+
+    bool CameraPath::Load(const std::string& fileName) {
+
+        std::ifstream file(fileName.c_str());
+        if (!file) {
+            LOG_ERROR("could not open camera path %s", fileName.c_str());
+            return false;
+        }
+
+        keys.clear();
+        std::string line;
+        int lineNumber = 0;
+        while (std::getline(file, line)) {
+            lineNumber++;
+            size_t comment = line.find('#');
+            if (comment != std::string::npos) {
+                line.erase(comment);
+            }
+            std::istringstream stream(line);
+            CameraKey key;
+            if (!(stream >> key.time)) {
+                continue;
+            }
+            if (!(stream >> key.position.x >> key.position.y >> key.position.z >>
+                key.target.x >> key.target.y >> key.target.z >> key.timeOfDay)) {
+                LOG_ERROR("%s:%d: expected time px py pz tx ty tz timeOfDay", fileName.c_str(), lineNumber);
+                keys.clear();
+                return false;
+            }
+            if (!keys.empty() && key.time < keys.back().time) {
+                LOG_ERROR("%s:%d: keys have to be in increasing time", fileName.c_str(), lineNumber);
+                keys.clear();
+                return false;
+            }
+            keys.push_back(key);
+        }
+
+        LOG_INFO("Loaded camera path %s: %d keys, %.1f s", fileName.c_str(), GetKeyCount(), GetDuration());
+        return !keys.empty();
+    }
+
+    bool CameraPath::Save(const std::string& fileName) const {
+
+        std::ofstream file(fileName.c_str());
+        if (!file) {
+            LOG_ERROR("could not create camera path %s", fileName.c_str());
+            return false;
+        }
+
+        file << "# time px py pz tx ty tz timeOfDay\n";
+        for (size_t i = 0; i < keys.size(); i++) {
+            const CameraKey& key = keys[i];
+            file << key.time << ' ' << key.position.x << ' ' << key.position.y << ' ' << key.position.z << ' '
+                << key.target.x << ' ' << key.target.y << ' ' << key.target.z << ' ' << key.timeOfDay << '\n';
+        }
+        return (bool)file;
+    }
+}
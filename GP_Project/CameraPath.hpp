@@ -0,0 +1,43 @@
+#ifndef CameraPath_hpp
+#define CameraPath_hpp
+
+#include <glm/glm.hpp>
+
+#include <string>
+#include <vector>
+
+namespace gps {
+
+    struct CameraKey {
+        //seconds from the start of the path
+        float time;
+        glm::vec3 position;
+        glm::vec3 target;
+        float timeOfDay;
+    };
+
+    //Camera spline and time of day schedule, replayed by the benchmark mode
+    //positions and targets are interpolated with Catmull-Rom splines through the keys,
+    //the time of day linearly; the text format has one key per line:
+    //time px py pz tx ty tz timeOfDay ('#' starts a comment)
+    class CameraPath {
+
+    public:
+        //keys have to be added in increasing time
+        void AddKey(const CameraKey& key);
+        void Clear();
+        bool IsEmpty() const;
+        float GetDuration() const;
+        int GetKeyCount() const;
+        const CameraKey& GetKey(int index) const;
+        CameraKey Evaluate(float time) const;
+
+        bool Load(const std::string& fileName);
+        bool Save(const std::string& fileName) const;
+
+    private:
+        std::vector<CameraKey> keys;
+    };
+}
+
+#endif /* CameraPath_hpp */
@@ -0,0 +1,253 @@
+#include "FrameCapture.hpp"
+#include "Logger.hpp"
+#include "PngWriter.hpp"
+#include "Profiler.hpp"
+
+#include <algorithm>
+#include <cstdio>
+#include <fstream>
+
+#if defined (_WIN32)
+    #include <direct.h>
+#else
+    #include <sys/stat.h>
+#endif
+
+namespace gps {
+
+    FrameCapture::FrameCapture() {
+
+        format = CAPTURE_PNG;
+        width = 0;
+        height = 0;
+        capturing = false;
+        frameNumber = 0;
+        capturedFrames = 0;
+        skippedFrames = 0;
+        stalls = 0;
+        stopping = false;
+        failedWrites = 0;
+    }
+
+    FrameCapture::~FrameCapture() {
+
+        //the GL objects are gone with the context by now, only the threads are left to join
+        if (!workers.empty()) {
+            {
+                std::lock_guard<std::mutex> lock(mutex);
+                stopping = true;
+            }
+            jobAvailable.notify_all();
+            for (size_t i = 0; i < workers.size(); i++) {
+                workers[i].join();
+            }
+        }
+    }
+
+    bool FrameCapture::Start(const std::string& directory, int width, int height, CaptureFormat format, int workers) {
+
+        if (capturing) {
+            Stop();
+        }
+        if (!readback.Create(width, height, READBACK_SLOTS)) {
+            LOG_ERROR("could not create the capture readback buffers for %dx%d", width, height);
+            readback.Delete();
+            return false;
+        }
+#if defined (_WIN32)
+        _mkdir(directory.c_str());
+#else
+        mkdir(directory.c_str(), 0755);
+#endif
+
+        this->directory = directory;
+        this->width = width;
+        this->height = height;
+        this->format = format;
+        capturing = true;
+        frameNumber = 0;
+        capturedFrames = 0;
+        skippedFrames = 0;
+        stalls = 0;
+        failedWrites = 0;
+        stopping = false;
+
+        buffers.assign(MAX_QUEUED_FRAMES, std::vector<unsigned char>((size_t)width * height * 4));
+        freeBuffers.clear();
+        for (int i = 0; i < MAX_QUEUED_FRAMES; i++) {
+            freeBuffers.push_back(i);
+        }
+        if (workers <= 0) {
+            workers = std::max((int)std::thread::hardware_concurrency() - 1, 1);
+        }
+        for (int i = 0; i < workers; i++) {
+            this->workers.push_back(std::thread(&FrameCapture::WorkerLoop, this, i));
+        }
+        LOG_INFO("Capturing %dx%d %s frames to %s with %d workers", width, height, format == CAPTURE_PNG ? "PNG" : "raw",
+            directory.c_str(), workers);
+        return true;
+    }
+
+    void FrameCapture::CaptureFrame(GLuint framebuffer, int width, int height) {
+
+        if (!capturing) {
+            return;
+        }
+        PROFILE_FUNCTION();
+        if (width != this->width || height != this->height) {
+            skippedFrames++;
+            return;
+        }
+
+        //whatever the GPU has finished so far, without waiting
+        while (CollectReadback(false)) {
+        }
+        //every slot in flight: the oldest read was queued several frames ago and is almost surely done
+        if (readback.GetPending() == readback.GetSlotCount()) {
+            CollectReadback(true);
+        }
+        readback.Request(framebuffer, frameNumber);
+        frameNumber++;
+    }
+
+    void FrameCapture::Stop() {
+
+        if (!capturing) {
+            return;
+        }
+        while (CollectReadback(true)) {
+        }
+        readback.Delete();
+
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            stopping = true;
+        }
+        jobAvailable.notify_all();
+        for (size_t i = 0; i < workers.size(); i++) {
+            workers[i].join();
+        }
+        workers.clear();
+        buffers.clear();
+        freeBuffers.clear();
+        capturing = false;
+
+        if (failedWrites > 0) {
+            LOG_ERROR("%d captured frames could not be written to %s", failedWrites, directory.c_str());
+        }
+        LOG_INFO("Captured %d frames to %s (%d skipped, %d waits for the encoders)", capturedFrames, directory.c_str(),
+            skippedFrames, stalls);
+    }
+
+    bool FrameCapture::CollectReadback(bool wait) {
+
+        if (readback.GetPending() == 0 || (!wait && !readback.IsReady())) {
+            return false;
+        }
+        int buffer = AcquireBuffer(wait);
+        if (buffer < 0) {
+            return false;
+        }
+        int frame;
+        if (!readback.Retrieve(buffers[buffer], frame, wait)) {
+            std::lock_guard<std::mutex> lock(mutex);
+            freeBuffers.push_back(buffer);
+            return false;
+        }
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            Job job = { frame, buffer };
+            jobs.push_back(job);
+        }
+        jobAvailable.notify_one();
+        capturedFrames++;
+        return true;
+    }
+
+    int FrameCapture::AcquireBuffer(bool wait) {
+
+        std::unique_lock<std::mutex> lock(mutex);
+        if (freeBuffers.empty()) {
+            //the encoders are behind, the read stays in flight until they catch up or every slot is taken
+            if (!wait) {
+                return -1;
+            }
+            PROFILE_ZONE("wait for encoders");
+            stalls++;
+            bufferAvailable.wait(lock, [this] { return !freeBuffers.empty(); });
+        }
+        int buffer = freeBuffers.back();
+        freeBuffers.pop_back();
+        return buffer;
+    }
+
+    void FrameCapture::WorkerLoop(int worker) {
+
+        std::string name = "capture " + std::to_string(worker);
+        Profiler::SetThreadName(name.c_str());
+        for (;;) {
+            Job job;
+            {
+                std::unique_lock<std::mutex> lock(mutex);
+                jobAvailable.wait(lock, [this] { return stopping || !jobs.empty(); });
+                //the queue is drained before the workers stop
+                if (jobs.empty()) {
+                    return;
+                }
+                job = jobs.front();
+                jobs.pop_front();
+            }
+
+            bool written = Encode(job.frame, buffers[job.buffer]);
+            {
+                std::lock_guard<std::mutex> lock(mutex);
+                failedWrites += written ? 0 : 1;
+                freeBuffers.push_back(job.buffer);
+            }
+            bufferAvailable.notify_one();
+        }
+    }
+
+    bool FrameCapture::Encode(int frame, std::vector<unsigned char>& pixels) {
+
+        PROFILE_ZONE("encode frame");
+        char fileName[64];
+        snprintf(fileName, sizeof(fileName), "/frame_%05d.%s", frame, format == CAPTURE_PNG ? "png" : "rgba");
+        std::string path = directory + fileName;
+
+        //nothing else in the frame is transparent
+        for (size_t i = 3; i < pixels.size(); i += 4) {
+            pixels[i] = 255;
+        }
+        if (format == CAPTURE_PNG) {
+            return PngWriter::Write(path, width, height, 4, pixels.data(), true);
+        }
+
+        std::ofstream file(path.c_str(), std::ios::binary);
+        size_t stride = (size_t)width * 4;
+        for (int y = height - 1; y >= 0 && file; y--) {
+            file.write((const char*)pixels.data() + stride * y, stride);
+        }
+        return (bool)file;
+    }
+
+    bool FrameCapture::IsCapturing() {
+
+        return capturing;
+    }
+
+    int FrameCapture::GetCapturedFrames() {
+
+        return capturedFrames;
+    }
+
+    int FrameCapture::GetSkippedFrames() {
+
+        return skippedFrames;
+    }
+
+    int FrameCapture::GetStalls() {
+
+        return stalls;
+    }
+}
@@ -0,0 +1,86 @@
+#ifndef FrameCapture_hpp
+#define FrameCapture_hpp
+
+#include "AsyncReadback.hpp"
+
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace gps {
+
+    enum CaptureFormat { CAPTURE_PNG, CAPTURE_RAW };
+
+    //Records the rendered frames to numbered image files (frame_00000.png, ...)
+    //every frame is read back through gps::AsyncReadback, so the GPU never stalls on the copy,
+    //and handed to a pool of worker threads that flip and encode it while the next frames render;
+    //raw frames are top-down RGBA8, width * height * 4 bytes, for
+    //    cat frame_*.rgba | ffmpeg -f rawvideo -pix_fmt rgba -s WxH -framerate 60 -i - out.mp4
+    //when the workers fall behind by more than MAX_QUEUED_FRAMES the finished reads stay on the GPU, and
+    //once every readback slot is in flight the render thread waits for them, so no frame is ever dropped from a recording
+    class FrameCapture {
+
+    public:
+        //reads in flight on the GPU
+        static const int READBACK_SLOTS = 4;
+        //frames read back and waiting to be encoded
+        static const int MAX_QUEUED_FRAMES = 8;
+
+        FrameCapture();
+        ~FrameCapture();
+        //workers: encoding threads, 0 for one per hardware thread minus the render thread
+        bool Start(const std::string& directory, int width, int height, CaptureFormat format, int workers);
+        //after a frame is rendered, before the swap: queues its readback and hands the finished reads to the workers;
+        //frames of another size than the capture are skipped
+        void CaptureFrame(GLuint framebuffer, int width, int height);
+        //reads back and encodes everything still in flight, then stops the workers
+        void Stop();
+        bool IsCapturing();
+        int GetCapturedFrames();
+        //frames whose size didn't match the capture
+        int GetSkippedFrames();
+        //times the render thread had to wait for a free buffer
+        int GetStalls();
+
+    private:
+        struct Job {
+            int frame;
+            int buffer;
+        };
+
+        AsyncReadback readback;
+        std::string directory;
+        CaptureFormat format;
+        int width;
+        int height;
+        bool capturing;
+        int frameNumber;
+        int capturedFrames;
+        int skippedFrames;
+        int stalls;
+
+        std::vector<std::thread> workers;
+        std::mutex mutex;
+        //jobs to encode, or buffers returned to the pool
+        std::condition_variable jobAvailable;
+        std::condition_variable bufferAvailable;
+        std::deque<Job> jobs;
+        std::vector<std::vector<unsigned char> > buffers;
+        std::vector<int> freeBuffers;
+        bool stopping;
+        int failedWrites;
+
+        //true when a finished read was handed over; wait blocks until the oldest one is done and a buffer is free,
+        //without it nothing blocks: a read that isn't done, or encoders with no free buffer, return false
+        bool CollectReadback(bool wait);
+        //-1 when no buffer is free and wait is false
+        int AcquireBuffer(bool wait);
+        void WorkerLoop(int worker);
+        bool Encode(int frame, std::vector<unsigned char>& pixels);
+    };
+}
+
+#endif /* FrameCapture_hpp */
@@ -0,0 +1,64 @@
+#ifndef FramePacket_hpp
+#define FramePacket_hpp
+
+#include <glm/glm.hpp>
+
+#include <vector>
+
+namespace gps {
+
+    //GL side work the simulation asks the render thread for, run before the packet is drawn
+    enum FrameRequest {
+        //writes the pass times and the render stats (U key)
+        FRAME_REQUEST_WRITE_STATS = 1 << 0,
+        //starts or stops the frame capture (G key)
+        FRAME_REQUEST_TOGGLE_CAPTURE = 1 << 1,
+        //records a GL trace of the next frames (O key)
+        FRAME_REQUEST_GL_TRACE = 1 << 2
+    };
+
+    //One object of the scene and where it is this frame
+    struct DrawItem {
+        //index into the models of the renderer
+        int object;
+        glm::mat4 model;
+    };
+
+    //Everything the render thread needs to draw one frame, produced by the simulation thread
+    //a packet is never changed once it is queued, so the simulation can go on with the next frame
+    //while this one is submitted; the settings are plain ints, their enums belong to the renderer
+    struct FramePacket {
+        //simulation iteration that built it, counted from 0
+        int frame;
+        //FrameRequest bits
+        unsigned int requests;
+
+        glm::mat4 view;
+        glm::mat4 projection;
+        glm::vec3 cameraPosition;
+
+        //world space direction towards the sun (or the moon), before lightRotation
+        glm::vec3 sunLightDir;
+        glm::vec3 sunLightColor;
+        glm::mat4 lightRotation;
+        bool isDay;
+        float lampIntensity;
+        //world space direction towards the sun (not the moon), before lightRotation
+        glm::vec3 skySunDirection;
+        float skyStarIntensity;
+        //0 for the day sky, 1 for the night sky
+        float skyNightBlend;
+
+        std::vector<DrawItem> drawList;
+
+        int shadowKernel;
+        int shadowTechnique;
+        float shadowFilterRadius;
+        int skyMode;
+        bool showDepthMap;
+        bool showPassTimes;
+        bool showRenderStats;
+    };
+}
+
+#endif /* FramePacket_hpp */
@@ -0,0 +1,76 @@
+#include "FrameQueue.hpp"
+#include "Profiler.hpp"
+
+#include <algorithm>
+#include <utility>
+
+namespace gps {
+
+    FrameQueue::FrameQueue() {
+
+        depth = 2;
+        closed = false;
+        stalls = 0;
+    }
+
+    void FrameQueue::SetDepth(int depth) {
+
+        std::lock_guard<std::mutex> lock(mutex);
+        this->depth = std::max(depth, 1);
+    }
+
+    int FrameQueue::GetDepth() {
+
+        std::lock_guard<std::mutex> lock(mutex);
+        return depth;
+    }
+
+    bool FrameQueue::Push(FramePacket&& packet) {
+
+        {
+            std::unique_lock<std::mutex> lock(mutex);
+            if (!closed && (int)packets.size() >= depth) {
+                PROFILE_ZONE("wait for render thread");
+                stalls++;
+                spaceAvailable.wait(lock, [this] { return closed || (int)packets.size() < depth; });
+            }
+            if (closed) {
+                return false;
+            }
+            packets.push_back(std::move(packet));
+        }
+        packetAvailable.notify_one();
+        return true;
+    }
+
+    bool FrameQueue::Pop(FramePacket& packet) {
+
+        {
+            std::unique_lock<std::mutex> lock(mutex);
+            packetAvailable.wait(lock, [this] { return closed || !packets.empty(); });
+            if (packets.empty()) {
+                return false;
+            }
+            packet = std::move(packets.front());
+            packets.pop_front();
+        }
+        spaceAvailable.notify_one();
+        return true;
+    }
+
+    void FrameQueue::Close() {
+
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            closed = true;
+        }
+        packetAvailable.notify_all();
+        spaceAvailable.notify_all();
+    }
+
+    int FrameQueue::GetStalls() {
+
+        std::lock_guard<std::mutex> lock(mutex);
+        return stalls;
+    }
+}
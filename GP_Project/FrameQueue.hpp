@@ -0,0 +1,42 @@
+#ifndef FrameQueue_hpp
+#define FrameQueue_hpp
+
+#include "FramePacket.hpp"
+
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+
+namespace gps {
+
+    //Hands the frame packets of the simulation thread to the render thread
+    //at most depth packets wait in the queue; past that the simulation blocks until the render
+    //thread takes one, so it is never more than depth frames ahead of the GPU submission
+    //(a held key shows on screen at most depth frames late)
+    class FrameQueue {
+
+    public:
+        FrameQueue();
+        void SetDepth(int depth);
+        int GetDepth();
+        //blocks while the queue is full; false when the queue is closed
+        bool Push(FramePacket&& packet);
+        //blocks while the queue is empty; false once it is closed and every packet was taken
+        bool Pop(FramePacket& packet);
+        //wakes both sides, the packets already queued are still handed out
+        void Close();
+        //times Push had to wait for the render thread
+        int GetStalls();
+
+    private:
+        std::mutex mutex;
+        std::condition_variable packetAvailable;
+        std::condition_variable spaceAvailable;
+        std::deque<FramePacket> packets;
+        int depth;
+        bool closed;
+        int stalls;
+    };
+}
+
+#endif /* FrameQueue_hpp */
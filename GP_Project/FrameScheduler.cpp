@@ -0,0 +1,60 @@
+#include "FrameScheduler.hpp"
+
+namespace gps {
+
+    FrameScheduler::FrameScheduler() {
+
+        //the first frame always renders
+        dirtyFlags = FRAME_DIRTY_WINDOW;
+        animating = false;
+        renderedFrames = 0;
+        skippedFrames = 0;
+    }
+
+    void FrameScheduler::MarkDirty(unsigned int flags) {
+
+        dirtyFlags |= flags;
+    }
+
+    void FrameScheduler::SetAnimating(bool animating) {
+
+        this->animating = animating;
+    }
+
+    void FrameScheduler::WaitForEvents() {
+
+        if (ShouldRender()) {
+            glfwPollEvents();
+        }
+        else {
+            glfwWaitEventsTimeout(IDLE_TIMEOUT);
+            skippedFrames++;
+        }
+    }
+
+    bool FrameScheduler::ShouldRender() {
+
+        return animating || dirtyFlags != 0;
+    }
+
+    void FrameScheduler::FrameRendered() {
+
+        dirtyFlags = 0;
+        renderedFrames++;
+    }
+
+    unsigned int FrameScheduler::GetDirtyFlags() {
+
+        return dirtyFlags;
+    }
+
+    int FrameScheduler::GetRenderedFrames() {
+
+        return renderedFrames;
+    }
+
+    int FrameScheduler::GetSkippedFrames() {
+
+        return skippedFrames;
+    }
+}
@@ -0,0 +1,58 @@
+#ifndef FrameScheduler_hpp
+#define FrameScheduler_hpp
+
+#if defined (__APPLE__)
+    #define GLFW_INCLUDE_GLCOREARB
+    #define GL_SILENCE_DEPRECATION
+#else
+    #define GLEW_STATIC
+    #include <GL/glew.h>
+#endif
+
+#include <GLFW/glfw3.h>
+
+namespace gps {
+
+    //Why a new frame is needed
+    enum FrameDirtyFlag {
+        FRAME_DIRTY_INPUT = 1 << 0,
+        FRAME_DIRTY_CAMERA = 1 << 1,
+        FRAME_DIRTY_TIME_OF_DAY = 1 << 2,
+        FRAME_DIRTY_TRANSFORMS = 1 << 3,
+        //a render target is still waiting for an update (e.g. a throttled shadow map)
+        FRAME_DIRTY_RESOURCES = 1 << 4,
+        FRAME_DIRTY_WINDOW = 1 << 5
+    };
+
+    //Renders only when something changed since the last frame
+    //while nothing is dirty and nothing animates, the main loop sleeps in
+    //glfwWaitEventsTimeout instead of redrawing the same image every vsync
+    class FrameScheduler {
+
+    public:
+        //longest sleep without events, so the loop still checks the window regularly
+        static constexpr double IDLE_TIMEOUT = 0.5;
+
+        FrameScheduler();
+        void MarkDirty(unsigned int flags);
+        //something changes every frame (held movement keys, the automatic day cycle)
+        void SetAnimating(bool animating);
+        //polls the events when a frame is due, otherwise blocks until one arrives
+        void WaitForEvents();
+        bool ShouldRender();
+        //clears the dirty flags
+        void FrameRendered();
+        unsigned int GetDirtyFlags();
+        int GetRenderedFrames();
+        //loop iterations that slept instead of rendering
+        int GetSkippedFrames();
+
+    private:
+        unsigned int dirtyFlags;
+        bool animating;
+        int renderedFrames;
+        int skippedFrames;
+    };
+}
+
+#endif /* FrameScheduler_hpp */
@@ -0,0 +1,36 @@
+#include "Frustum.hpp"
+
+namespace gps {
+
+    void Frustum::Update(const glm::mat4& viewProjection) {
+
+        glm::mat4 m = glm::transpose(viewProjection);
+        //left, right, bottom, top, near, far
+        planes[0] = m[3] + m[0];
+        planes[1] = m[3] - m[0];
+        planes[2] = m[3] + m[1];
+        planes[3] = m[3] - m[1];
+        planes[4] = m[3] + m[2];
+        planes[5] = m[3] - m[2];
+        for (int i = 0; i < 6; i++) {
+            planes[i] /= glm::length(glm::vec3(planes[i]));
+        }
+    }
+
+    bool Frustum::IntersectsSphere(glm::vec4 sphere) const {
+
+        for (int i = 0; i < 6; i++) {
+            if (glm::dot(glm::vec3(planes[i]), glm::vec3(sphere)) + planes[i].w < -sphere.w) {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    glm::vec4 transformBoundingSphere(const glm::mat4& transform, glm::vec4 sphere) {
+
+        glm::vec3 center = glm::vec3(transform * glm::vec4(glm::vec3(sphere), 1.0f));
+        float scale = glm::max(glm::length(glm::vec3(transform[0])), glm::max(glm::length(glm::vec3(transform[1])), glm::length(glm::vec3(transform[2]))));
+        return glm::vec4(center, sphere.w * scale);
+    }
+}
@@ -0,0 +1,26 @@
+#ifndef Frustum_hpp
+#define Frustum_hpp
+
+#include <glm/glm.hpp>
+
+namespace gps {
+
+    //View frustum as six planes taken from a view-projection matrix (Gribb-Hartmann),
+    //used to skip the objects whose bounding sphere is entirely outside the view
+    class Frustum {
+
+    public:
+        void Update(const glm::mat4& viewProjection);
+        //sphere: center and radius in the space of the view-projection matrix input (world space)
+        bool IntersectsSphere(glm::vec4 sphere) const;
+
+    private:
+        //xyz: inward normal, w: distance, normalized so w + dot(xyz, p) is the signed distance
+        glm::vec4 planes[6];
+    };
+
+    //object space bounding sphere (xyz center, w radius) moved by a transform, the radius grows with the largest scale
+    glm::vec4 transformBoundingSphere(const glm::mat4& transform, glm::vec4 sphere);
+}
+
+#endif /* Frustum_hpp */
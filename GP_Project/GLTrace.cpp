@@ -0,0 +1,946 @@
+#include "GLTrace.hpp"
+#include "Logger.hpp"
+
+#include <algorithm>
+#include <fstream>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+namespace gps {
+
+    namespace {
+
+        //units, uniform buffer bindings and attributes looked at when recording the starting state
+        const int MAX_TEXTURE_UNITS = 32;
+        const int MAX_UNIFORM_BUFFERS = 32;
+        const int MAX_ATTRIBUTES = 16;
+        const int MAX_COLOR_ATTACHMENTS = 4;
+        const int MAX_LEVELS = 16;
+
+        std::ofstream traceFile;
+        std::string traceFileName;
+        std::string pendingFileName;
+        int pendingFrames = 0;
+        GLuint pendingPresentedFramebuffer = 0;
+        int pendingWidth = 0;
+        int pendingHeight = 0;
+        int framesLeft = 0;
+        int frameNumber = 0;
+
+        //hash of the data and its id
+        std::unordered_map<uint64_t, uint32_t> blobIds;
+        uint64_t blobBytes = 0;
+        std::unordered_set<GLuint> buffers;
+        std::unordered_set<GLuint> textures;
+        std::unordered_set<GLuint> renderbuffers;
+        std::unordered_set<GLuint> framebuffers;
+        std::unordered_set<GLuint> vertexArrays;
+        std::unordered_set<GLuint> programs;
+
+        //the payload of a record, written with its header by Write
+        class Payload {
+
+        public:
+            void Put32(uint32_t value) {
+                Put(&value, sizeof(value));
+            }
+            void Put64(uint64_t value) {
+                Put(&value, sizeof(value));
+            }
+            void PutFloat(GLfloat value) {
+                Put(&value, sizeof(value));
+            }
+            void PutString(const std::string& text) {
+                Put32((uint32_t)text.size());
+                Put(text.data(), text.size());
+            }
+            void Append(const Payload& other) {
+                Put(other.data.data(), other.data.size());
+            }
+            void Write(GLTraceOp op) {
+                uint16_t code = (uint16_t)op;
+                uint32_t size = (uint32_t)data.size();
+                traceFile.write((const char*)&code, sizeof(code));
+                traceFile.write((const char*)&size, sizeof(size));
+                traceFile.write((const char*)data.data(), data.size());
+            }
+
+        private:
+            std::vector<unsigned char> data;
+
+            void Put(const void* bytes, size_t size) {
+                data.insert(data.end(), (const unsigned char*)bytes, (const unsigned char*)bytes + size);
+            }
+        };
+
+        uint64_t hashData(const void* data, size_t size) {
+
+            //FNV-1a
+            const unsigned char* bytes = (const unsigned char*)data;
+            uint64_t hash = 14695981039346656037ull;
+            for (size_t i = 0; i < size; i++) {
+                hash = (hash ^ bytes[i]) * 1099511628211ull;
+            }
+            return hash ^ (uint64_t)size;
+        }
+
+        //writes data the first time it is seen, returns its id
+        uint32_t blob(const void* data, size_t size) {
+
+            if (data == NULL || size == 0) {
+                return GLTRACE_NO_BLOB;
+            }
+            uint64_t hash = hashData(data, size);
+            std::unordered_map<uint64_t, uint32_t>::iterator found = blobIds.find(hash);
+            if (found != blobIds.end()) {
+                return found->second;
+            }
+            uint32_t id = (uint32_t)blobIds.size();
+            blobIds[hash] = id;
+            blobBytes += size;
+
+            uint16_t code = GLTRACE_BLOB;
+            uint32_t payloadSize = (uint32_t)(sizeof(id) + size);
+            traceFile.write((const char*)&code, sizeof(code));
+            traceFile.write((const char*)&payloadSize, sizeof(payloadSize));
+            traceFile.write((const char*)&id, sizeof(id));
+            traceFile.write((const char*)data, size);
+            return id;
+        }
+
+        GLint getInteger(GLenum pname) {
+
+            GLint value = 0;
+            glGetIntegerv(pname, &value);
+            return value;
+        }
+
+        GLenum textureBindingQuery(GLenum target) {
+
+            switch (target) {
+            case GL_TEXTURE_2D: return GL_TEXTURE_BINDING_2D;
+            case GL_TEXTURE_CUBE_MAP: return GL_TEXTURE_BINDING_CUBE_MAP;
+            case GL_TEXTURE_2D_ARRAY: return GL_TEXTURE_BINDING_2D_ARRAY;
+            case GL_TEXTURE_3D: return GL_TEXTURE_BINDING_3D;
+            default: return 0;
+            }
+        }
+
+        //GL 4.1 can't be asked the target of a texture, so the targets are tried in turn;
+        //binding to the wrong one fails with GL_INVALID_OPERATION (errors pending before are dropped)
+        GLenum probeTextureTarget(GLuint texture) {
+
+            const GLenum targets[] = { GL_TEXTURE_2D, GL_TEXTURE_CUBE_MAP, GL_TEXTURE_2D_ARRAY, GL_TEXTURE_3D };
+            while (glGetError() != GL_NO_ERROR) {
+            }
+            for (size_t i = 0; i < sizeof(targets) / sizeof(targets[0]); i++) {
+                GLint previous = getInteger(textureBindingQuery(targets[i]));
+                glBindTexture(targets[i], texture);
+                bool bound = glGetError() == GL_NO_ERROR;
+                glBindTexture(targets[i], previous);
+                if (bound) {
+                    return targets[i];
+                }
+            }
+            return 0;
+        }
+
+        //format and type a texture is read back and uploaded again with, and the bytes per texel
+        void readbackFormat(GLint internalFormat, GLenum& format, GLenum& type, int& texelBytes) {
+
+            switch (internalFormat) {
+            case GL_DEPTH_COMPONENT:
+            case GL_DEPTH_COMPONENT16:
+            case GL_DEPTH_COMPONENT24:
+            case GL_DEPTH_COMPONENT32:
+            case GL_DEPTH_COMPONENT32F:
+                format = GL_DEPTH_COMPONENT;
+                type = GL_FLOAT;
+                texelBytes = 4;
+                break;
+            case GL_DEPTH_STENCIL:
+            case GL_DEPTH24_STENCIL8:
+            case GL_DEPTH32F_STENCIL8:
+                format = GL_DEPTH_STENCIL;
+                type = GL_UNSIGNED_INT_24_8;
+                texelBytes = 4;
+                break;
+            case GL_R16F:
+            case GL_RG16F:
+            case GL_RGB16F:
+            case GL_RGBA16F:
+            case GL_R32F:
+            case GL_RG32F:
+            case GL_RGB32F:
+            case GL_RGBA32F:
+            case GL_R11F_G11F_B10F:
+                format = GL_RGBA;
+                type = GL_FLOAT;
+                texelBytes = 16;
+                break;
+            default:
+                format = GL_RGBA;
+                type = GL_UNSIGNED_BYTE;
+                texelBytes = 4;
+                break;
+            }
+        }
+
+        //bytes of an image passed to glTexImage2D, rows padded to the unpack alignment
+        size_t imageBytes(GLsizei width, GLsizei height, GLenum format, GLenum type) {
+
+            int components;
+            switch (format) {
+            case GL_RG: components = 2; break;
+            case GL_RGB: case GL_BGR: components = 3; break;
+            case GL_RGBA: case GL_BGRA: components = 4; break;
+            default: components = 1; break;
+            }
+            int componentBytes;
+            switch (type) {
+            case GL_UNSIGNED_BYTE: case GL_BYTE: componentBytes = 1; break;
+            case GL_UNSIGNED_SHORT: case GL_SHORT: case GL_HALF_FLOAT: componentBytes = 2; break;
+            default: componentBytes = 4; break;
+            }
+            if (type == GL_UNSIGNED_INT_24_8) {
+                components = 1;
+            }
+            size_t alignment = (size_t)std::max(1, getInteger(GL_UNPACK_ALIGNMENT));
+            size_t rowBytes = ((size_t)width * components * componentBytes + alignment - 1) / alignment * alignment;
+            return rowBytes * height;
+        }
+
+        int uniformWords(GLenum type) {
+
+            switch (type) {
+            case GL_FLOAT: case GL_INT: case GL_UNSIGNED_INT: case GL_BOOL: return 1;
+            case GL_FLOAT_VEC2: case GL_INT_VEC2: case GL_BOOL_VEC2: return 2;
+            case GL_FLOAT_VEC3: case GL_INT_VEC3: case GL_BOOL_VEC3: return 3;
+            case GL_FLOAT_VEC4: case GL_INT_VEC4: case GL_BOOL_VEC4: case GL_FLOAT_MAT2: return 4;
+            case GL_FLOAT_MAT3: return 9;
+            case GL_FLOAT_MAT4: return 16;
+            case GL_SAMPLER_2D: case GL_SAMPLER_3D: case GL_SAMPLER_CUBE: case GL_SAMPLER_2D_SHADOW:
+            case GL_SAMPLER_2D_ARRAY: case GL_SAMPLER_2D_ARRAY_SHADOW: case GL_SAMPLER_CUBE_SHADOW: return 1;
+            default: return 0;
+            }
+        }
+
+        bool isFloatUniform(GLenum type) {
+
+            return type == GL_FLOAT || type == GL_FLOAT_VEC2 || type == GL_FLOAT_VEC3 || type == GL_FLOAT_VEC4 ||
+                type == GL_FLOAT_MAT2 || type == GL_FLOAT_MAT3 || type == GL_FLOAT_MAT4;
+        }
+
+        void defineBuffer(GLuint buffer) {
+
+            if (buffer == 0 || buffers.count(buffer) != 0 || !glIsBuffer(buffer)) {
+                return;
+            }
+            buffers.insert(buffer);
+
+            GLint previous = getInteger(GL_COPY_READ_BUFFER_BINDING);
+            glBindBuffer(GL_COPY_READ_BUFFER, buffer);
+            GLint64 size = 0;
+            GLint usage = GL_STATIC_DRAW;
+            glGetBufferParameteri64v(GL_COPY_READ_BUFFER, GL_BUFFER_SIZE, &size);
+            glGetBufferParameteriv(GL_COPY_READ_BUFFER, GL_BUFFER_USAGE, &usage);
+            std::vector<unsigned char> contents((size_t)size);
+            if (size > 0) {
+                glGetBufferSubData(GL_COPY_READ_BUFFER, 0, (GLsizeiptr)size, contents.data());
+            }
+            glBindBuffer(GL_COPY_READ_BUFFER, previous);
+
+            Payload payload;
+            payload.Put32(buffer);
+            payload.Put64((uint64_t)size);
+            payload.Put32(usage);
+            payload.Put32(blob(contents.data(), contents.size()));
+            payload.Write(GLTRACE_DEFINE_BUFFER);
+        }
+
+        void defineTexture(GLuint texture, GLenum target) {
+
+            if (texture == 0 || textures.count(texture) != 0 || !glIsTexture(texture)) {
+                return;
+            }
+            if (target == 0) {
+                target = probeTextureTarget(texture);
+            }
+            GLenum bindingQuery = textureBindingQuery(target);
+            if (bindingQuery == 0) {
+                LOG_WARNING("GL trace: texture %u has an unsupported target, not recorded", texture);
+                return;
+            }
+            textures.insert(texture);
+
+            GLint previous = getInteger(bindingQuery);
+            GLint previousPackBuffer = getInteger(GL_PIXEL_PACK_BUFFER_BINDING);
+            glBindTexture(target, texture);
+            glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+
+            Payload payload;
+            payload.Put32(texture);
+            payload.Put32(target);
+            const GLenum intParameters[] = { GL_TEXTURE_MIN_FILTER, GL_TEXTURE_MAG_FILTER, GL_TEXTURE_WRAP_S, GL_TEXTURE_WRAP_T,
+                GL_TEXTURE_WRAP_R, GL_TEXTURE_COMPARE_MODE, GL_TEXTURE_COMPARE_FUNC, GL_TEXTURE_BASE_LEVEL, GL_TEXTURE_MAX_LEVEL };
+            for (size_t i = 0; i < sizeof(intParameters) / sizeof(intParameters[0]); i++) {
+                GLint value = 0;
+                glGetTexParameteriv(target, intParameters[i], &value);
+                payload.Put32((uint32_t)value);
+            }
+            GLfloat borderColor[4] = {};
+            glGetTexParameterfv(target, GL_TEXTURE_BORDER_COLOR, borderColor);
+            for (int i = 0; i < 4; i++) {
+                payload.PutFloat(borderColor[i]);
+            }
+
+            std::vector<GLenum> faces;
+            if (target == GL_TEXTURE_CUBE_MAP) {
+                for (int face = 0; face < 6; face++) {
+                    faces.push_back(GL_TEXTURE_CUBE_MAP_POSITIVE_X + face);
+                }
+            }
+            else {
+                faces.push_back(target);
+            }
+
+            //every defined level of every face
+            Payload images;
+            uint32_t imageCount = 0;
+            std::vector<unsigned char> pixels;
+            for (int level = 0; level < MAX_LEVELS; level++) {
+                GLint width = 0, height = 0, depth = 0, internalFormat = 0, compressed = 0;
+                glGetTexLevelParameteriv(faces[0], level, GL_TEXTURE_WIDTH, &width);
+                if (width == 0) {
+                    break;
+                }
+                glGetTexLevelParameteriv(faces[0], level, GL_TEXTURE_HEIGHT, &height);
+                glGetTexLevelParameteriv(faces[0], level, GL_TEXTURE_DEPTH, &depth);
+                glGetTexLevelParameteriv(faces[0], level, GL_TEXTURE_INTERNAL_FORMAT, &internalFormat);
+                glGetTexLevelParameteriv(faces[0], level, GL_TEXTURE_COMPRESSED, &compressed);
+                GLenum format, type;
+                int texelBytes;
+                readbackFormat(internalFormat, format, type, texelBytes);
+
+                for (size_t face = 0; face < faces.size(); face++) {
+                    if (compressed) {
+                        GLint size = 0;
+                        glGetTexLevelParameteriv(faces[face], level, GL_TEXTURE_COMPRESSED_IMAGE_SIZE, &size);
+                        pixels.resize(size);
+                        glGetCompressedTexImage(faces[face], level, pixels.data());
+                    }
+                    else {
+                        pixels.resize((size_t)width * height * std::max(depth, 1) * texelBytes);
+                        glGetTexImage(faces[face], level, format, type, pixels.data());
+                    }
+                    images.Put32(faces[face]);
+                    images.Put32(level);
+                    images.Put32(internalFormat);
+                    images.Put32(width);
+                    images.Put32(height);
+                    images.Put32(depth);
+                    images.Put32(compressed);
+                    images.Put32(format);
+                    images.Put32(type);
+                    images.Put32(blob(pixels.data(), pixels.size()));
+                    imageCount++;
+                }
+            }
+            glBindTexture(target, previous);
+            glBindBuffer(GL_PIXEL_PACK_BUFFER, previousPackBuffer);
+
+            //the blobs went out while the images were read, the record follows them
+            payload.Put32(imageCount);
+            payload.Append(images);
+            payload.Write(GLTRACE_DEFINE_TEXTURE);
+        }
+
+        void defineRenderbuffer(GLuint renderbuffer) {
+
+            if (renderbuffer == 0 || renderbuffers.count(renderbuffer) != 0 || !glIsRenderbuffer(renderbuffer)) {
+                return;
+            }
+            renderbuffers.insert(renderbuffer);
+
+            GLint previous = getInteger(GL_RENDERBUFFER_BINDING);
+            glBindRenderbuffer(GL_RENDERBUFFER, renderbuffer);
+            GLint internalFormat = 0, width = 0, height = 0, samples = 0;
+            glGetRenderbufferParameteriv(GL_RENDERBUFFER, GL_RENDERBUFFER_INTERNAL_FORMAT, &internalFormat);
+            glGetRenderbufferParameteriv(GL_RENDERBUFFER, GL_RENDERBUFFER_WIDTH, &width);
+            glGetRenderbufferParameteriv(GL_RENDERBUFFER, GL_RENDERBUFFER_HEIGHT, &height);
+            glGetRenderbufferParameteriv(GL_RENDERBUFFER, GL_RENDERBUFFER_SAMPLES, &samples);
+            glBindRenderbuffer(GL_RENDERBUFFER, previous);
+
+            Payload payload;
+            payload.Put32(renderbuffer);
+            payload.Put32(internalFormat);
+            payload.Put32(width);
+            payload.Put32(height);
+            payload.Put32(samples);
+            payload.Write(GLTRACE_DEFINE_RENDERBUFFER);
+        }
+
+        void defineFramebuffer(GLuint framebuffer) {
+
+            if (framebuffer == 0 || framebuffers.count(framebuffer) != 0 || !glIsFramebuffer(framebuffer)) {
+                return;
+            }
+            framebuffers.insert(framebuffer);
+
+            struct Attachment {
+                GLenum attachment;
+                GLint type;
+                GLint object;
+                GLint level;
+                GLint cubeFace;
+                GLint layer;
+                GLint layered;
+            };
+            std::vector<GLenum> points;
+            for (int i = 0; i < MAX_COLOR_ATTACHMENTS; i++) {
+                points.push_back(GL_COLOR_ATTACHMENT0 + i);
+            }
+            points.push_back(GL_DEPTH_ATTACHMENT);
+            points.push_back(GL_STENCIL_ATTACHMENT);
+
+            GLint previousDraw = getInteger(GL_DRAW_FRAMEBUFFER_BINDING);
+            GLint previousRead = getInteger(GL_READ_FRAMEBUFFER_BINDING);
+            glBindFramebuffer(GL_FRAMEBUFFER, framebuffer);
+            std::vector<Attachment> attachments;
+            for (size_t i = 0; i < points.size(); i++) {
+                Attachment attachment = { points[i], GL_NONE, 0, 0, 0, 0, 0 };
+                glGetFramebufferAttachmentParameteriv(GL_FRAMEBUFFER, points[i], GL_FRAMEBUFFER_ATTACHMENT_OBJECT_TYPE, &attachment.type);
+                if (attachment.type != GL_TEXTURE && attachment.type != GL_RENDERBUFFER) {
+                    continue;
+                }
+                glGetFramebufferAttachmentParameteriv(GL_FRAMEBUFFER, points[i], GL_FRAMEBUFFER_ATTACHMENT_OBJECT_NAME, &attachment.object);
+                if (attachment.type == GL_TEXTURE) {
+                    glGetFramebufferAttachmentParameteriv(GL_FRAMEBUFFER, points[i], GL_FRAMEBUFFER_ATTACHMENT_TEXTURE_LEVEL, &attachment.level);
+                    glGetFramebufferAttachmentParameteriv(GL_FRAMEBUFFER, points[i], GL_FRAMEBUFFER_ATTACHMENT_TEXTURE_CUBE_MAP_FACE, &attachment.cubeFace);
+                    glGetFramebufferAttachmentParameteriv(GL_FRAMEBUFFER, points[i], GL_FRAMEBUFFER_ATTACHMENT_TEXTURE_LAYER, &attachment.layer);
+                    glGetFramebufferAttachmentParameteriv(GL_FRAMEBUFFER, points[i], GL_FRAMEBUFFER_ATTACHMENT_LAYERED, &attachment.layered);
+                }
+                attachments.push_back(attachment);
+            }
+            GLint drawBuffers[MAX_COLOR_ATTACHMENTS];
+            for (int i = 0; i < MAX_COLOR_ATTACHMENTS; i++) {
+                drawBuffers[i] = getInteger(GL_DRAW_BUFFER0 + i);
+            }
+            GLint readBuffer = getInteger(GL_READ_BUFFER);
+            glBindFramebuffer(GL_DRAW_FRAMEBUFFER, previousDraw);
+            glBindFramebuffer(GL_READ_FRAMEBUFFER, previousRead);
+
+            for (size_t i = 0; i < attachments.size(); i++) {
+                if (attachments[i].type == GL_TEXTURE) {
+                    defineTexture(attachments[i].object, attachments[i].cubeFace != 0 ? GL_TEXTURE_CUBE_MAP : 0);
+                }
+                else {
+                    defineRenderbuffer(attachments[i].object);
+                }
+            }
+
+            Payload payload;
+            payload.Put32(framebuffer);
+            payload.Put32((uint32_t)attachments.size());
+            for (size_t i = 0; i < attachments.size(); i++) {
+                payload.Put32(attachments[i].attachment);
+                payload.Put32(attachments[i].type);
+                payload.Put32(attachments[i].object);
+                payload.Put32(attachments[i].level);
+                payload.Put32(attachments[i].cubeFace);
+                payload.Put32(attachments[i].layer);
+                payload.Put32(attachments[i].layered);
+            }
+            payload.Put32(MAX_COLOR_ATTACHMENTS);
+            for (int i = 0; i < MAX_COLOR_ATTACHMENTS; i++) {
+                payload.Put32(drawBuffers[i]);
+            }
+            payload.Put32(readBuffer);
+            payload.Write(GLTRACE_DEFINE_FRAMEBUFFER);
+        }
+
+        void defineVertexArray(GLuint vertexArray) {
+
+            if (vertexArray == 0 || vertexArrays.count(vertexArray) != 0 || !glIsVertexArray(vertexArray)) {
+                return;
+            }
+            vertexArrays.insert(vertexArray);
+
+            struct Attribute {
+                GLint enabled, size, type, normalized, integer, stride, buffer;
+                void* pointer;
+            };
+            std::vector<std::pair<GLuint, Attribute> > attributes;
+            GLint previous = getInteger(GL_VERTEX_ARRAY_BINDING);
+            glBindVertexArray(vertexArray);
+            GLint elementBuffer = getInteger(GL_ELEMENT_ARRAY_BUFFER_BINDING);
+            int attributeCount = std::min(getInteger(GL_MAX_VERTEX_ATTRIBS), MAX_ATTRIBUTES);
+            for (int i = 0; i < attributeCount; i++) {
+                Attribute attribute = {};
+                glGetVertexAttribiv(i, GL_VERTEX_ATTRIB_ARRAY_ENABLED, &attribute.enabled);
+                glGetVertexAttribiv(i, GL_VERTEX_ATTRIB_ARRAY_BUFFER_BINDING, &attribute.buffer);
+                if (!attribute.enabled && attribute.buffer == 0) {
+                    continue;
+                }
+                glGetVertexAttribiv(i, GL_VERTEX_ATTRIB_ARRAY_SIZE, &attribute.size);
+                glGetVertexAttribiv(i, GL_VERTEX_ATTRIB_ARRAY_TYPE, &attribute.type);
+                glGetVertexAttribiv(i, GL_VERTEX_ATTRIB_ARRAY_NORMALIZED, &attribute.normalized);
+                glGetVertexAttribiv(i, GL_VERTEX_ATTRIB_ARRAY_INTEGER, &attribute.integer);
+                glGetVertexAttribiv(i, GL_VERTEX_ATTRIB_ARRAY_STRIDE, &attribute.stride);
+                glGetVertexAttribPointerv(i, GL_VERTEX_ATTRIB_ARRAY_POINTER, &attribute.pointer);
+                attributes.push_back(std::make_pair((GLuint)i, attribute));
+            }
+            glBindVertexArray(previous);
+
+            defineBuffer(elementBuffer);
+            for (size_t i = 0; i < attributes.size(); i++) {
+                defineBuffer(attributes[i].second.buffer);
+            }
+
+            Payload payload;
+            payload.Put32(vertexArray);
+            payload.Put32(elementBuffer);
+            payload.Put32((uint32_t)attributes.size());
+            for (size_t i = 0; i < attributes.size(); i++) {
+                const Attribute& attribute = attributes[i].second;
+                payload.Put32(attributes[i].first);
+                payload.Put32(attribute.enabled);
+                payload.Put32(attribute.size);
+                payload.Put32(attribute.type);
+                payload.Put32(attribute.normalized);
+                payload.Put32(attribute.integer);
+                payload.Put32(attribute.stride);
+                payload.Put64((uint64_t)(uintptr_t)attribute.pointer);
+                payload.Put32(attribute.buffer);
+            }
+            payload.Write(GLTRACE_DEFINE_VERTEX_ARRAY);
+        }
+
+        //the binary replays on the same driver, the sources anywhere (programs loaded from the
+        //binary cache have none); the uniforms are recorded with their values and locations
+        void defineProgram(GLuint program) {
+
+            if (program == 0 || programs.count(program) != 0 || !glIsProgram(program)) {
+                return;
+            }
+            programs.insert(program);
+
+            Payload payload;
+            payload.Put32(program);
+            GLint binaryLength = 0;
+            glGetProgramiv(program, GL_PROGRAM_BINARY_LENGTH, &binaryLength);
+            std::vector<unsigned char> binary(binaryLength);
+            GLenum binaryFormat = 0;
+            if (binaryLength > 0) {
+                glGetProgramBinary(program, binaryLength, &binaryLength, &binaryFormat, binary.data());
+                binary.resize(binaryLength);
+            }
+            payload.Put32(binaryFormat);
+            payload.Put32(blob(binary.data(), binary.size()));
+
+            GLuint shaders[8];
+            GLsizei shaderCount = 0;
+            glGetAttachedShaders(program, 8, &shaderCount, shaders);
+            payload.Put32(shaderCount);
+            for (int i = 0; i < shaderCount; i++) {
+                GLint type = 0, sourceLength = 0;
+                glGetShaderiv(shaders[i], GL_SHADER_TYPE, &type);
+                glGetShaderiv(shaders[i], GL_SHADER_SOURCE_LENGTH, &sourceLength);
+                std::vector<char> source(std::max(sourceLength, 1));
+                glGetShaderSource(shaders[i], (GLsizei)source.size(), &sourceLength, source.data());
+                payload.Put32(type);
+                payload.PutString(std::string(source.data(), sourceLength));
+            }
+
+            GLint blockCount = 0, nameLength = 0;
+            glGetProgramiv(program, GL_ACTIVE_UNIFORM_BLOCKS, &blockCount);
+            glGetProgramiv(program, GL_ACTIVE_UNIFORM_BLOCK_MAX_NAME_LENGTH, &nameLength);
+            std::vector<char> name(std::max(nameLength, 1));
+            payload.Put32(blockCount);
+            for (int i = 0; i < blockCount; i++) {
+                GLsizei length = 0;
+                GLint binding = 0;
+                glGetActiveUniformBlockName(program, i, (GLsizei)name.size(), &length, name.data());
+                glGetActiveUniformBlockiv(program, i, GL_UNIFORM_BLOCK_BINDING, &binding);
+                payload.PutString(std::string(name.data(), length));
+                payload.Put32(binding);
+            }
+
+            //one entry per array element, blocks members (location -1) excluded
+            GLint uniformCount = 0;
+            glGetProgramiv(program, GL_ACTIVE_UNIFORMS, &uniformCount);
+            glGetProgramiv(program, GL_ACTIVE_UNIFORM_MAX_LENGTH, &nameLength);
+            name.resize(std::max(nameLength, 1));
+            Payload uniforms;
+            uint32_t entryCount = 0;
+            for (int i = 0; i < uniformCount; i++) {
+                GLsizei length = 0;
+                GLint size = 0;
+                GLenum type = 0;
+                glGetActiveUniform(program, i, (GLsizei)name.size(), &length, &size, &type, name.data());
+                int words = uniformWords(type);
+                if (words == 0) {
+                    continue;
+                }
+                std::string baseName(name.data(), length);
+                if (baseName.size() > 3 && baseName.compare(baseName.size() - 3, 3, "[0]") == 0) {
+                    baseName.resize(baseName.size() - 3);
+                }
+                for (int element = 0; element < size; element++) {
+                    std::string elementName = size > 1 ? baseName + "[" + std::to_string(element) + "]" : baseName;
+                    GLint location = glGetUniformLocation(program, elementName.c_str());
+                    if (location < 0) {
+                        continue;
+                    }
+                    uint32_t values[16];
+                    if (isFloatUniform(type)) {
+                        glGetUniformfv(program, location, (GLfloat*)values);
+                    }
+                    else {
+                        glGetUniformiv(program, location, (GLint*)values);
+                    }
+                    uniforms.PutString(elementName);
+                    uniforms.Put32(location);
+                    uniforms.Put32(type);
+                    uniforms.Put32(words);
+                    for (int word = 0; word < words; word++) {
+                        uniforms.Put32(values[word]);
+                    }
+                    entryCount++;
+                }
+            }
+            payload.Put32(entryCount);
+            payload.Append(uniforms);
+            payload.Write(GLTRACE_DEFINE_PROGRAM);
+        }
+
+        void writeEnable(GLenum cap) {
+
+            Payload payload;
+            payload.Put32(cap);
+            payload.Write(glIsEnabled(cap) ? GLTRACE_ENABLE : GLTRACE_DISABLE);
+        }
+
+        void writeWords(GLTraceOp op, const GLint* values, int count) {
+
+            Payload payload;
+            for (int i = 0; i < count; i++) {
+                payload.Put32(values[i]);
+            }
+            payload.Write(op);
+        }
+
+        void finishCapture() {
+
+            Payload().Write(GLTRACE_END);
+            bool written = (bool)traceFile;
+            traceFile.close();
+            if (written) {
+                LOG_INFO("GL trace written to %s: %d frames, %d buffers, %d textures, %d programs, %.1f MB of data",
+                    traceFileName.c_str(), frameNumber, (int)buffers.size(), (int)textures.size(), (int)programs.size(),
+                    blobBytes / (1024.0 * 1024.0));
+            }
+            else {
+                LOG_ERROR("could not write GL trace %s", traceFileName.c_str());
+            }
+            blobIds.clear();
+            buffers.clear();
+            textures.clear();
+            renderbuffers.clear();
+            framebuffers.clear();
+            vertexArrays.clear();
+            programs.clear();
+        }
+    }
+
+    bool GLTrace::recording = false;
+
+    void GLTrace::Capture(const std::string& fileName, int frames, GLuint presentedFramebuffer, int width, int height) {
+
+        if (recording || frames <= 0) {
+            return;
+        }
+        pendingFileName = fileName;
+        pendingFrames = frames;
+        pendingPresentedFramebuffer = presentedFramebuffer;
+        pendingWidth = width;
+        pendingHeight = height;
+        LOG_INFO("Recording the GL calls of the next %d frames into %s", frames, fileName.c_str());
+    }
+
+    void GLTrace::BeginFrame() {
+
+        if (recording && framesLeft == 0) {
+            recording = false;
+            finishCapture();
+        }
+        if (!recording && pendingFrames > 0) {
+            traceFile.open(pendingFileName.c_str(), std::ios::binary);
+            if (!traceFile) {
+                LOG_ERROR("could not create GL trace %s", pendingFileName.c_str());
+                pendingFrames = 0;
+                return;
+            }
+            traceFileName = pendingFileName;
+            framesLeft = pendingFrames;
+            pendingFrames = 0;
+            frameNumber = 0;
+            blobBytes = 0;
+            uint32_t header[] = { GLTRACE_MAGIC, GLTRACE_VERSION };
+            traceFile.write((const char*)header, sizeof(header));
+            uint32_t info[] = { (uint32_t)pendingWidth, (uint32_t)pendingHeight, pendingPresentedFramebuffer };
+            RecordWords(GLTRACE_INFO, info, 3);
+            recording = true;
+            RecordState();
+        }
+        if (recording) {
+            uint32_t frame = (uint32_t)frameNumber++;
+            RecordWords(GLTRACE_FRAME, &frame, 1);
+            framesLeft--;
+        }
+    }
+
+    void GLTrace::Stop() {
+
+        pendingFrames = 0;
+        if (recording) {
+            recording = false;
+            finishCapture();
+        }
+    }
+
+    void GLTrace::RecordState() {
+
+        const GLenum caps[] = { GL_DEPTH_TEST, GL_CULL_FACE, GL_BLEND, GL_SCISSOR_TEST, GL_STENCIL_TEST, GL_FRAMEBUFFER_SRGB,
+            GL_TEXTURE_CUBE_MAP_SEAMLESS, GL_POLYGON_OFFSET_FILL, GL_DEPTH_CLAMP, GL_MULTISAMPLE };
+        for (size_t i = 0; i < sizeof(caps) / sizeof(caps[0]); i++) {
+            writeEnable(caps[i]);
+        }
+        GLint values[4];
+        values[0] = getInteger(GL_DEPTH_FUNC);
+        writeWords(GLTRACE_DEPTH_FUNC, values, 1);
+        values[0] = getInteger(GL_DEPTH_WRITEMASK);
+        writeWords(GLTRACE_DEPTH_MASK, values, 1);
+        values[0] = getInteger(GL_CULL_FACE_MODE);
+        writeWords(GLTRACE_CULL_FACE, values, 1);
+        values[0] = getInteger(GL_FRONT_FACE);
+        writeWords(GLTRACE_FRONT_FACE, values, 1);
+        values[0] = getInteger(GL_BLEND_SRC_RGB);
+        values[1] = getInteger(GL_BLEND_DST_RGB);
+        values[2] = getInteger(GL_BLEND_SRC_ALPHA);
+        values[3] = getInteger(GL_BLEND_DST_ALPHA);
+        writeWords(GLTRACE_BLEND_FUNC_SEPARATE, values, 4);
+        glGetIntegerv(GL_VIEWPORT, values);
+        writeWords(GLTRACE_VIEWPORT, values, 4);
+        glGetIntegerv(GL_SCISSOR_BOX, values);
+        writeWords(GLTRACE_SCISSOR, values, 4);
+        GLfloat clearColor[4];
+        glGetFloatv(GL_COLOR_CLEAR_VALUE, clearColor);
+        memcpy(values, clearColor, sizeof(values));
+        writeWords(GLTRACE_CLEAR_COLOR, values, 4);
+        values[0] = GL_UNPACK_ALIGNMENT;
+        values[1] = getInteger(GL_UNPACK_ALIGNMENT);
+        writeWords(GLTRACE_PIXEL_STOREI, values, 2);
+
+        RecordBindFramebuffer(GL_DRAW_FRAMEBUFFER, getInteger(GL_DRAW_FRAMEBUFFER_BINDING));
+        RecordBindFramebuffer(GL_READ_FRAMEBUFFER, getInteger(GL_READ_FRAMEBUFFER_BINDING));
+        RecordBindRenderbuffer(GL_RENDERBUFFER, getInteger(GL_RENDERBUFFER_BINDING));
+        RecordUseProgram(getInteger(GL_CURRENT_PROGRAM));
+
+        //the textures bound on every unit, read back through their binding
+        const GLenum targets[] = { GL_TEXTURE_2D, GL_TEXTURE_CUBE_MAP, GL_TEXTURE_2D_ARRAY };
+        GLint activeTexture = getInteger(GL_ACTIVE_TEXTURE);
+        int units = std::min(getInteger(GL_MAX_COMBINED_TEXTURE_IMAGE_UNITS), MAX_TEXTURE_UNITS);
+        for (int unit = 0; unit < units; unit++) {
+            glActiveTexture(GL_TEXTURE0 + unit);
+            uint32_t unitEnum = GL_TEXTURE0 + unit;
+            RecordWords(GLTRACE_ACTIVE_TEXTURE, &unitEnum, 1);
+            for (size_t i = 0; i < sizeof(targets) / sizeof(targets[0]); i++) {
+                GLuint texture = getInteger(textureBindingQuery(targets[i]));
+                if (texture != 0) {
+                    RecordBindTexture(targets[i], texture);
+                }
+            }
+        }
+        glActiveTexture(activeTexture);
+        uint32_t activeTextureEnum = (uint32_t)activeTexture;
+        RecordWords(GLTRACE_ACTIVE_TEXTURE, &activeTextureEnum, 1);
+
+        int uniformBuffers = std::min(getInteger(GL_MAX_UNIFORM_BUFFER_BINDINGS), MAX_UNIFORM_BUFFERS);
+        for (int i = 0; i < uniformBuffers; i++) {
+            GLint buffer = 0;
+            GLint64 start = 0, size = 0;
+            glGetIntegeri_v(GL_UNIFORM_BUFFER_BINDING, i, &buffer);
+            if (buffer == 0) {
+                continue;
+            }
+            glGetInteger64i_v(GL_UNIFORM_BUFFER_START, i, &start);
+            glGetInteger64i_v(GL_UNIFORM_BUFFER_SIZE, i, &size);
+            RecordBindBufferRange(GL_UNIFORM_BUFFER, i, buffer, (GLintptr)start, (GLsizeiptr)size);
+        }
+        RecordBindBuffer(GL_UNIFORM_BUFFER, getInteger(GL_UNIFORM_BUFFER_BINDING));
+        RecordBindBuffer(GL_ARRAY_BUFFER, getInteger(GL_ARRAY_BUFFER_BINDING));
+        RecordBindVertexArray(getInteger(GL_VERTEX_ARRAY_BINDING));
+    }
+
+    void GLTrace::BeginGroup(const char* name) {
+
+        if (recording) {
+            Payload payload;
+            payload.PutString(name);
+            payload.Write(GLTRACE_GROUP_BEGIN);
+        }
+    }
+
+    void GLTrace::EndGroup() {
+
+        if (recording) {
+            Payload().Write(GLTRACE_GROUP_END);
+        }
+    }
+
+    void GLTrace::RecordWords(GLTraceOp op, const uint32_t* words, int count) {
+
+        Payload payload;
+        for (int i = 0; i < count; i++) {
+            payload.Put32(words[i]);
+        }
+        payload.Write(op);
+    }
+
+    void GLTrace::RecordBindTexture(GLenum target, GLuint texture) {
+
+        defineTexture(texture, target);
+        uint32_t words[] = { target, texture };
+        RecordWords(GLTRACE_BIND_TEXTURE, words, 2);
+    }
+
+    void GLTrace::RecordTexImage2D(GLenum target, GLint level, GLint internalformat, GLsizei width, GLsizei height,
+        GLenum format, GLenum type, const void* pixels) {
+
+        uint32_t data = blob(pixels, pixels != NULL ? imageBytes(width, height, format, type) : 0);
+        uint32_t words[] = { target, (uint32_t)level, (uint32_t)internalformat, (uint32_t)width, (uint32_t)height, format, type, data };
+        RecordWords(GLTRACE_TEX_IMAGE_2D, words, 8);
+    }
+
+    void GLTrace::RecordBindBuffer(GLenum target, GLuint buffer) {
+
+        defineBuffer(buffer);
+        uint32_t words[] = { target, buffer };
+        RecordWords(GLTRACE_BIND_BUFFER, words, 2);
+    }
+
+    void GLTrace::RecordBindBufferRange(GLenum target, GLuint index, GLuint buffer, GLintptr offset, GLsizeiptr size) {
+
+        defineBuffer(buffer);
+        Payload payload;
+        payload.Put32(target);
+        payload.Put32(index);
+        payload.Put32(buffer);
+        payload.Put64((uint64_t)offset);
+        payload.Put64((uint64_t)size);
+        payload.Write(size == 0 ? GLTRACE_BIND_BUFFER_BASE : GLTRACE_BIND_BUFFER_RANGE);
+    }
+
+    void GLTrace::RecordBufferData(GLenum target, GLsizeiptr size, const void* data, GLenum usage) {
+
+        uint32_t contents = blob(data, (size_t)size);
+        Payload payload;
+        payload.Put32(target);
+        payload.Put64((uint64_t)size);
+        payload.Put32(usage);
+        payload.Put32(contents);
+        payload.Write(GLTRACE_BUFFER_DATA);
+    }
+
+    void GLTrace::RecordBufferSubData(GLenum target, GLintptr offset, GLsizeiptr size, const void* data) {
+
+        uint32_t contents = blob(data, (size_t)size);
+        Payload payload;
+        payload.Put32(target);
+        payload.Put64((uint64_t)offset);
+        payload.Put64((uint64_t)size);
+        payload.Put32(contents);
+        payload.Write(GLTRACE_BUFFER_SUB_DATA);
+    }
+
+    void GLTrace::RecordBindVertexArray(GLuint array) {
+
+        defineVertexArray(array);
+        RecordWords(GLTRACE_BIND_VERTEX_ARRAY, &array, 1);
+    }
+
+    void GLTrace::RecordVertexAttribPointer(GLuint index, GLint size, GLenum type, GLboolean normalized, GLsizei stride, const void* pointer) {
+
+        Payload payload;
+        payload.Put32(index);
+        payload.Put32(size);
+        payload.Put32(type);
+        payload.Put32(normalized);
+        payload.Put32(stride);
+        payload.Put64((uint64_t)(uintptr_t)pointer);
+        payload.Write(GLTRACE_VERTEX_ATTRIB_POINTER);
+    }
+
+    void GLTrace::RecordUseProgram(GLuint program) {
+
+        defineProgram(program);
+        RecordWords(GLTRACE_USE_PROGRAM, &program, 1);
+    }
+
+    void GLTrace::RecordUniform(GLint location, GLenum type, GLsizei count, GLboolean transpose, const void* values, int words) {
+
+        if (location < 0) {
+            return;
+        }
+        Payload payload;
+        payload.Put32(location);
+        payload.Put32(type);
+        payload.Put32(count);
+        payload.Put32(transpose);
+        const uint32_t* valueWords = (const uint32_t*)values;
+        for (int i = 0; i < words; i++) {
+            payload.Put32(valueWords[i]);
+        }
+        payload.Write(GLTRACE_UNIFORM);
+    }
+
+    void GLTrace::RecordDrawElements(GLenum mode, GLsizei count, GLenum type, const void* indices) {
+
+        Payload payload;
+        payload.Put32(mode);
+        payload.Put32(count);
+        payload.Put32(type);
+        payload.Put64((uint64_t)(uintptr_t)indices);
+        payload.Write(GLTRACE_DRAW_ELEMENTS);
+    }
+
+    void GLTrace::RecordBindFramebuffer(GLenum target, GLuint framebuffer) {
+
+        defineFramebuffer(framebuffer);
+        uint32_t words[] = { target, framebuffer };
+        RecordWords(GLTRACE_BIND_FRAMEBUFFER, words, 2);
+    }
+
+    void GLTrace::RecordBindRenderbuffer(GLenum target, GLuint renderbuffer) {
+
+        defineRenderbuffer(renderbuffer);
+        uint32_t words[] = { target, renderbuffer };
+        RecordWords(GLTRACE_BIND_RENDERBUFFER, words, 2);
+    }
+
+    void GLTrace::RecordFramebufferTexture2D(GLenum target, GLenum attachment, GLenum textarget, GLuint texture, GLint level) {
+
+        defineTexture(texture, textarget == GL_TEXTURE_2D ? GL_TEXTURE_2D : GL_TEXTURE_CUBE_MAP);
+        uint32_t words[] = { target, attachment, textarget, texture, (uint32_t)level };
+        RecordWords(GLTRACE_FRAMEBUFFER_TEXTURE_2D, words, 5);
+    }
+
+    void GLTrace::RecordFramebufferRenderbuffer(GLenum target, GLenum attachment, GLenum renderbuffertarget, GLuint renderbuffer) {
+
+        defineRenderbuffer(renderbuffer);
+        uint32_t words[] = { target, attachment, renderbuffertarget, renderbuffer };
+        RecordWords(GLTRACE_FRAMEBUFFER_RENDERBUFFER, words, 4);
+    }
+}
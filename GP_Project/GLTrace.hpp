@@ -0,0 +1,359 @@
+#ifndef GLTrace_hpp
+#define GLTrace_hpp
+
+#if defined (__APPLE__)
+    #define GL_SILENCE_DEPRECATION
+    #include <OpenGL/gl3.h>
+#else
+    #define GLEW_STATIC
+    #include <GL/glew.h>
+#endif
+
+#include "GLTraceFormat.hpp"
+
+#include <cstdint>
+#include <cstring>
+#include <string>
+
+namespace gps {
+
+    //Records the GL calls of a few frames into a binary trace (GLTraceFormat.hpp) for GP_Replay
+    //the render path calls GL through the wrappers below (GLTraceHooks.hpp routes a whole file through them);
+    //outside a capture a wrapper costs one bool test. Objects are recorded with their contents the first
+    //time the capture refers to them, and the bindings and state the capture starts with are recorded up front,
+    //so a trace replays without the scene, the models or the window
+    //objects created or deleted by the recorded frames are not followed, only the ones they bind
+    class GLTrace {
+
+    public:
+        //records the next frames frames into fileName, from the next BeginFrame;
+        //presentedFramebuffer is the one the frame ends up in (0 for the window), width x height its size
+        static void Capture(const std::string& fileName, int frames, GLuint presentedFramebuffer, int width, int height);
+        //called at the start of every frame: starts, marks and finishes the capture
+        static void BeginFrame();
+        //finishes the trace, even if fewer frames than asked were rendered
+        static void Stop();
+        static bool IsRecording() {
+            return recording;
+        }
+        //the render passes, timed separately by the replayer; a group ends at the next BeginGroup
+        static void BeginGroup(const char* name);
+        static void EndGroup();
+
+        static void Viewport(GLint x, GLint y, GLsizei width, GLsizei height) {
+            if (recording) {
+                uint32_t words[] = { (uint32_t)x, (uint32_t)y, (uint32_t)width, (uint32_t)height };
+                RecordWords(GLTRACE_VIEWPORT, words, 4);
+            }
+            glViewport(x, y, width, height);
+        }
+        static void ViewportIndexedf(GLuint index, GLfloat x, GLfloat y, GLfloat width, GLfloat height) {
+            if (recording) {
+                uint32_t words[] = { index, Bits(x), Bits(y), Bits(width), Bits(height) };
+                RecordWords(GLTRACE_VIEWPORT_INDEXEDF, words, 5);
+            }
+            glViewportIndexedf(index, x, y, width, height);
+        }
+        static void Scissor(GLint x, GLint y, GLsizei width, GLsizei height) {
+            if (recording) {
+                uint32_t words[] = { (uint32_t)x, (uint32_t)y, (uint32_t)width, (uint32_t)height };
+                RecordWords(GLTRACE_SCISSOR, words, 4);
+            }
+            glScissor(x, y, width, height);
+        }
+        static void Clear(GLbitfield mask) {
+            if (recording) {
+                RecordWords(GLTRACE_CLEAR, &mask, 1);
+            }
+            glClear(mask);
+        }
+        static void ClearColor(GLfloat red, GLfloat green, GLfloat blue, GLfloat alpha) {
+            if (recording) {
+                uint32_t words[] = { Bits(red), Bits(green), Bits(blue), Bits(alpha) };
+                RecordWords(GLTRACE_CLEAR_COLOR, words, 4);
+            }
+            glClearColor(red, green, blue, alpha);
+        }
+        static void ClearBufferfv(GLenum buffer, GLint drawbuffer, const GLfloat* value) {
+            if (recording) {
+                //one value for the depth, four for a color
+                uint32_t words[] = { buffer, (uint32_t)drawbuffer, Bits(value[0]), 0, 0, 0 };
+                if (buffer == GL_COLOR) {
+                    memcpy(&words[2], value, 4 * sizeof(GLfloat));
+                }
+                RecordWords(GLTRACE_CLEAR_BUFFERFV, words, 6);
+            }
+            glClearBufferfv(buffer, drawbuffer, value);
+        }
+        static void Enable(GLenum cap) {
+            if (recording) {
+                RecordWords(GLTRACE_ENABLE, &cap, 1);
+            }
+            glEnable(cap);
+        }
+        static void Disable(GLenum cap) {
+            if (recording) {
+                RecordWords(GLTRACE_DISABLE, &cap, 1);
+            }
+            glDisable(cap);
+        }
+        static void DepthFunc(GLenum func) {
+            if (recording) {
+                RecordWords(GLTRACE_DEPTH_FUNC, &func, 1);
+            }
+            glDepthFunc(func);
+        }
+        static void CullFace(GLenum mode) {
+            if (recording) {
+                RecordWords(GLTRACE_CULL_FACE, &mode, 1);
+            }
+            glCullFace(mode);
+        }
+        static void FrontFace(GLenum mode) {
+            if (recording) {
+                RecordWords(GLTRACE_FRONT_FACE, &mode, 1);
+            }
+            glFrontFace(mode);
+        }
+        static void BlendFunc(GLenum sfactor, GLenum dfactor) {
+            if (recording) {
+                uint32_t words[] = { sfactor, dfactor, sfactor, dfactor };
+                RecordWords(GLTRACE_BLEND_FUNC_SEPARATE, words, 4);
+            }
+            glBlendFunc(sfactor, dfactor);
+        }
+        static void DrawBuffer(GLenum buf) {
+            if (recording) {
+                RecordWords(GLTRACE_DRAW_BUFFER, &buf, 1);
+            }
+            glDrawBuffer(buf);
+        }
+        static void ReadBuffer(GLenum src) {
+            if (recording) {
+                RecordWords(GLTRACE_READ_BUFFER, &src, 1);
+            }
+            glReadBuffer(src);
+        }
+        static void PixelStorei(GLenum pname, GLint param) {
+            if (recording) {
+                uint32_t words[] = { pname, (uint32_t)param };
+                RecordWords(GLTRACE_PIXEL_STOREI, words, 2);
+            }
+            glPixelStorei(pname, param);
+        }
+        static void ActiveTexture(GLenum texture) {
+            if (recording) {
+                RecordWords(GLTRACE_ACTIVE_TEXTURE, &texture, 1);
+            }
+            glActiveTexture(texture);
+        }
+        static void BindTexture(GLenum target, GLuint texture) {
+            glBindTexture(target, texture);
+            //after the bind, the texture is read back through its binding
+            if (recording) {
+                RecordBindTexture(target, texture);
+            }
+        }
+        static void TexParameteri(GLenum target, GLenum pname, GLint param) {
+            if (recording) {
+                uint32_t words[] = { target, pname, (uint32_t)param };
+                RecordWords(GLTRACE_TEX_PARAMETERI, words, 3);
+            }
+            glTexParameteri(target, pname, param);
+        }
+        static void TexParameterfv(GLenum target, GLenum pname, const GLfloat* params) {
+            if (recording) {
+                uint32_t words[] = { target, pname, Bits(params[0]), 0, 0, 0 };
+                if (pname == GL_TEXTURE_BORDER_COLOR) {
+                    memcpy(&words[2], params, 4 * sizeof(GLfloat));
+                }
+                RecordWords(GLTRACE_TEX_PARAMETERFV, words, 6);
+            }
+            glTexParameterfv(target, pname, params);
+        }
+        static void TexImage2D(GLenum target, GLint level, GLint internalformat, GLsizei width, GLsizei height,
+            GLint border, GLenum format, GLenum type, const void* pixels) {
+            if (recording) {
+                RecordTexImage2D(target, level, internalformat, width, height, format, type, pixels);
+            }
+            glTexImage2D(target, level, internalformat, width, height, border, format, type, pixels);
+        }
+        static void GenerateMipmap(GLenum target) {
+            if (recording) {
+                RecordWords(GLTRACE_GENERATE_MIPMAP, &target, 1);
+            }
+            glGenerateMipmap(target);
+        }
+        static void BindBuffer(GLenum target, GLuint buffer) {
+            if (recording) {
+                RecordBindBuffer(target, buffer);
+            }
+            glBindBuffer(target, buffer);
+        }
+        static void BindBufferBase(GLenum target, GLuint index, GLuint buffer) {
+            if (recording) {
+                RecordBindBufferRange(target, index, buffer, 0, 0);
+            }
+            glBindBufferBase(target, index, buffer);
+        }
+        static void BindBufferRange(GLenum target, GLuint index, GLuint buffer, GLintptr offset, GLsizeiptr size) {
+            if (recording) {
+                RecordBindBufferRange(target, index, buffer, offset, size);
+            }
+            glBindBufferRange(target, index, buffer, offset, size);
+        }
+        static void BufferData(GLenum target, GLsizeiptr size, const void* data, GLenum usage) {
+            if (recording) {
+                RecordBufferData(target, size, data, usage);
+            }
+            glBufferData(target, size, data, usage);
+        }
+        static void BufferSubData(GLenum target, GLintptr offset, GLsizeiptr size, const void* data) {
+            if (recording) {
+                RecordBufferSubData(target, offset, size, data);
+            }
+            glBufferSubData(target, offset, size, data);
+        }
+        static void BindVertexArray(GLuint array) {
+            if (recording) {
+                RecordBindVertexArray(array);
+            }
+            glBindVertexArray(array);
+        }
+        static void VertexAttribPointer(GLuint index, GLint size, GLenum type, GLboolean normalized, GLsizei stride, const void* pointer) {
+            if (recording) {
+                RecordVertexAttribPointer(index, size, type, normalized, stride, pointer);
+            }
+            glVertexAttribPointer(index, size, type, normalized, stride, pointer);
+        }
+        static void EnableVertexAttribArray(GLuint index) {
+            if (recording) {
+                RecordWords(GLTRACE_ENABLE_VERTEX_ATTRIB_ARRAY, &index, 1);
+            }
+            glEnableVertexAttribArray(index);
+        }
+        static void UseProgram(GLuint program) {
+            if (recording) {
+                RecordUseProgram(program);
+            }
+            glUseProgram(program);
+        }
+        static void Uniform1i(GLint location, GLint value) {
+            if (recording) {
+                RecordUniform(location, GL_INT, 1, GL_FALSE, &value, 1);
+            }
+            glUniform1i(location, value);
+        }
+        static void Uniform1f(GLint location, GLfloat value) {
+            if (recording) {
+                RecordUniform(location, GL_FLOAT, 1, GL_FALSE, &value, 1);
+            }
+            glUniform1f(location, value);
+        }
+        static void Uniform2f(GLint location, GLfloat v0, GLfloat v1) {
+            if (recording) {
+                GLfloat value[] = { v0, v1 };
+                RecordUniform(location, GL_FLOAT_VEC2, 1, GL_FALSE, value, 2);
+            }
+            glUniform2f(location, v0, v1);
+        }
+        static void Uniform2fv(GLint location, GLsizei count, const GLfloat* value) {
+            if (recording) {
+                RecordUniform(location, GL_FLOAT_VEC2, count, GL_FALSE, value, 2 * count);
+            }
+            glUniform2fv(location, count, value);
+        }
+        static void Uniform3fv(GLint location, GLsizei count, const GLfloat* value) {
+            if (recording) {
+                RecordUniform(location, GL_FLOAT_VEC3, count, GL_FALSE, value, 3 * count);
+            }
+            glUniform3fv(location, count, value);
+        }
+        static void Uniform4fv(GLint location, GLsizei count, const GLfloat* value) {
+            if (recording) {
+                RecordUniform(location, GL_FLOAT_VEC4, count, GL_FALSE, value, 4 * count);
+            }
+            glUniform4fv(location, count, value);
+        }
+        static void UniformMatrix4fv(GLint location, GLsizei count, GLboolean transpose, const GLfloat* value) {
+            if (recording) {
+                RecordUniform(location, GL_FLOAT_MAT4, count, transpose, value, 16 * count);
+            }
+            glUniformMatrix4fv(location, count, transpose, value);
+        }
+        static void DrawArrays(GLenum mode, GLint first, GLsizei count) {
+            if (recording) {
+                uint32_t words[] = { mode, (uint32_t)first, (uint32_t)count };
+                RecordWords(GLTRACE_DRAW_ARRAYS, words, 3);
+            }
+            glDrawArrays(mode, first, count);
+        }
+        static void DrawElements(GLenum mode, GLsizei count, GLenum type, const void* indices) {
+            if (recording) {
+                RecordDrawElements(mode, count, type, indices);
+            }
+            glDrawElements(mode, count, type, indices);
+        }
+        static void BindFramebuffer(GLenum target, GLuint framebuffer) {
+            if (recording) {
+                RecordBindFramebuffer(target, framebuffer);
+            }
+            glBindFramebuffer(target, framebuffer);
+        }
+        static void BindRenderbuffer(GLenum target, GLuint renderbuffer) {
+            if (recording) {
+                RecordBindRenderbuffer(target, renderbuffer);
+            }
+            glBindRenderbuffer(target, renderbuffer);
+        }
+        static void FramebufferTexture2D(GLenum target, GLenum attachment, GLenum textarget, GLuint texture, GLint level) {
+            if (recording) {
+                RecordFramebufferTexture2D(target, attachment, textarget, texture, level);
+            }
+            glFramebufferTexture2D(target, attachment, textarget, texture, level);
+        }
+        static void FramebufferRenderbuffer(GLenum target, GLenum attachment, GLenum renderbuffertarget, GLuint renderbuffer) {
+            if (recording) {
+                RecordFramebufferRenderbuffer(target, attachment, renderbuffertarget, renderbuffer);
+            }
+            glFramebufferRenderbuffer(target, attachment, renderbuffertarget, renderbuffer);
+        }
+        static void RenderbufferStorage(GLenum target, GLenum internalformat, GLsizei width, GLsizei height) {
+            if (recording) {
+                uint32_t words[] = { target, internalformat, (uint32_t)width, (uint32_t)height };
+                RecordWords(GLTRACE_RENDERBUFFER_STORAGE, words, 4);
+            }
+            glRenderbufferStorage(target, internalformat, width, height);
+        }
+
+    private:
+        static bool recording;
+
+        static uint32_t Bits(GLfloat value) {
+            uint32_t bits;
+            memcpy(&bits, &value, sizeof(bits));
+            return bits;
+        }
+        //the bindings and state the capture starts with
+        static void RecordState();
+        static void RecordWords(GLTraceOp op, const uint32_t* words, int count);
+        static void RecordBindTexture(GLenum target, GLuint texture);
+        static void RecordTexImage2D(GLenum target, GLint level, GLint internalformat, GLsizei width, GLsizei height,
+            GLenum format, GLenum type, const void* pixels);
+        static void RecordBindBuffer(GLenum target, GLuint buffer);
+        static void RecordBindBufferRange(GLenum target, GLuint index, GLuint buffer, GLintptr offset, GLsizeiptr size);
+        static void RecordBufferData(GLenum target, GLsizeiptr size, const void* data, GLenum usage);
+        static void RecordBufferSubData(GLenum target, GLintptr offset, GLsizeiptr size, const void* data);
+        static void RecordBindVertexArray(GLuint array);
+        static void RecordVertexAttribPointer(GLuint index, GLint size, GLenum type, GLboolean normalized, GLsizei stride, const void* pointer);
+        static void RecordUseProgram(GLuint program);
+        static void RecordUniform(GLint location, GLenum type, GLsizei count, GLboolean transpose, const void* values, int words);
+        static void RecordDrawElements(GLenum mode, GLsizei count, GLenum type, const void* indices);
+        static void RecordBindFramebuffer(GLenum target, GLuint framebuffer);
+        static void RecordBindRenderbuffer(GLenum target, GLuint renderbuffer);
+        static void RecordFramebufferTexture2D(GLenum target, GLenum attachment, GLenum textarget, GLuint texture, GLint level);
+        static void RecordFramebufferRenderbuffer(GLenum target, GLenum attachment, GLenum renderbuffertarget, GLuint renderbuffer);
+    };
+}
+
+#endif /* GLTrace_hpp */
@@ -0,0 +1,109 @@
+#ifndef GLTraceFormat_hpp
+#define GLTraceFormat_hpp
+
+#include <cstdint>
+
+namespace gps {
+
+    //Layout of the GL traces written by GLTrace and played back by GP_Replay
+    //the file is GLTRACE_MAGIC, GLTRACE_VERSION (uint32 each), then records of
+    //    uint16 op, uint32 payload size, payload
+    //payloads hold the values listed next to the ops, in native byte order; uint32 unless noted,
+    //strings are a uint32 length and the characters, blob is the id of an earlier BLOB record or GLTRACE_NO_BLOB
+    //object names are the ones of the recording, the replayer maps them to its own objects
+    //the records before the first FRAME set the state the capture started with
+    const uint32_t GLTRACE_MAGIC = 0x52544C47;
+    const uint32_t GLTRACE_VERSION = 1;
+    const uint32_t GLTRACE_NO_BLOB = 0xFFFFFFFF;
+
+    enum GLTraceOp {
+        //width, height, presented framebuffer (replayed into the replayer's own framebuffer)
+        GLTRACE_INFO = 1,
+        //id, the data; identical data is stored once
+        GLTRACE_BLOB,
+        //frame number
+        GLTRACE_FRAME,
+        //string name; a group of calls timed together (a render pass), ended by the next GROUP_BEGIN or GROUP_END
+        GLTRACE_GROUP_BEGIN,
+        GLTRACE_GROUP_END,
+        //the end of the trace
+        GLTRACE_END,
+
+        //objects, recorded the first time the capture refers to them, with their contents at that point
+        //name, int64 size, usage, blob
+        GLTRACE_DEFINE_BUFFER,
+        //name, target, min filter, mag filter, wrap s, wrap t, wrap r, compare mode, compare func,
+        //base level, max level, float border color[4], image count, then per image (level and cube face):
+        //image target, level, internal format, width, height, depth, compressed, format, type, blob
+        GLTRACE_DEFINE_TEXTURE,
+        //name, internal format, width, height, samples (the contents are not recorded)
+        GLTRACE_DEFINE_RENDERBUFFER,
+        //name, attachment count, then per attachment: attachment, object type (GL_TEXTURE, GL_RENDERBUFFER),
+        //object, level, cube face (0 if none), layer, layered; draw buffer count, draw buffers, read buffer
+        GLTRACE_DEFINE_FRAMEBUFFER,
+        //name, element buffer, attribute count, then per attribute:
+        //index, enabled, size, type, normalized, integer, stride, uint64 offset, buffer
+        GLTRACE_DEFINE_VERTEX_ARRAY,
+        //name, binary format, binary blob, shader count, per shader: type, string source;
+        //block count, per block: string name, binding; uniform count, per uniform (and array element):
+        //string name, location, type, value count, values (the raw 32 bit words)
+        GLTRACE_DEFINE_PROGRAM,
+
+        //GL calls, with their arguments
+        GLTRACE_VIEWPORT,
+        //index, float x, y, width, height
+        GLTRACE_VIEWPORT_INDEXEDF,
+        GLTRACE_SCISSOR,
+        GLTRACE_CLEAR,
+        //float red, green, blue, alpha
+        GLTRACE_CLEAR_COLOR,
+        //buffer, draw buffer, float value[4]
+        GLTRACE_CLEAR_BUFFERFV,
+        GLTRACE_ENABLE,
+        GLTRACE_DISABLE,
+        GLTRACE_DEPTH_FUNC,
+        GLTRACE_DEPTH_MASK,
+        GLTRACE_CULL_FACE,
+        GLTRACE_FRONT_FACE,
+        //source rgb, destination rgb, source alpha, destination alpha
+        GLTRACE_BLEND_FUNC_SEPARATE,
+        GLTRACE_DRAW_BUFFER,
+        GLTRACE_READ_BUFFER,
+        GLTRACE_PIXEL_STOREI,
+        GLTRACE_ACTIVE_TEXTURE,
+        GLTRACE_BIND_TEXTURE,
+        GLTRACE_TEX_PARAMETERI,
+        //target, pname, float value[4]
+        GLTRACE_TEX_PARAMETERFV,
+        //target, level, internal format, width, height, format, type, blob
+        GLTRACE_TEX_IMAGE_2D,
+        GLTRACE_GENERATE_MIPMAP,
+        GLTRACE_BIND_BUFFER,
+        GLTRACE_BIND_BUFFER_BASE,
+        //target, index, buffer, int64 offset, int64 size
+        GLTRACE_BIND_BUFFER_RANGE,
+        //target, int64 size, usage, blob
+        GLTRACE_BUFFER_DATA,
+        //target, int64 offset, int64 size, blob
+        GLTRACE_BUFFER_SUB_DATA,
+        GLTRACE_BIND_VERTEX_ARRAY,
+        //index, size, type, normalized, stride, uint64 offset
+        GLTRACE_VERTEX_ATTRIB_POINTER,
+        GLTRACE_ENABLE_VERTEX_ATTRIB_ARRAY,
+        GLTRACE_USE_PROGRAM,
+        //location, type (GL_INT, GL_FLOAT, GL_FLOAT_VEC2...), count, transpose, values;
+        //the location belongs to the program in use
+        GLTRACE_UNIFORM,
+        GLTRACE_DRAW_ARRAYS,
+        //mode, count, type, uint64 offset
+        GLTRACE_DRAW_ELEMENTS,
+        GLTRACE_BIND_FRAMEBUFFER,
+        GLTRACE_BIND_RENDERBUFFER,
+        //target, attachment, texture target, texture, level
+        GLTRACE_FRAMEBUFFER_TEXTURE_2D,
+        GLTRACE_FRAMEBUFFER_RENDERBUFFER,
+        GLTRACE_RENDERBUFFER_STORAGE
+    };
+}
+
+#endif /* GLTraceFormat_hpp */
@@ -0,0 +1,95 @@
+//Routes the GL calls of the file that includes it through gps::GLTrace, so a GL trace records them
+//include it last, after every other header, and only from .cpp files of the render path;
+//queries and the creation and deletion of objects are not recorded and go to GL untouched
+//(no include guard: it only redefines names)
+
+#include "GLTrace.hpp"
+
+#undef glViewport
+#define glViewport gps::GLTrace::Viewport
+#undef glViewportIndexedf
+#define glViewportIndexedf gps::GLTrace::ViewportIndexedf
+#undef glScissor
+#define glScissor gps::GLTrace::Scissor
+#undef glClear
+#define glClear gps::GLTrace::Clear
+#undef glClearColor
+#define glClearColor gps::GLTrace::ClearColor
+#undef glClearBufferfv
+#define glClearBufferfv gps::GLTrace::ClearBufferfv
+#undef glEnable
+#define glEnable gps::GLTrace::Enable
+#undef glDisable
+#define glDisable gps::GLTrace::Disable
+#undef glDepthFunc
+#define glDepthFunc gps::GLTrace::DepthFunc
+#undef glCullFace
+#define glCullFace gps::GLTrace::CullFace
+#undef glFrontFace
+#define glFrontFace gps::GLTrace::FrontFace
+#undef glBlendFunc
+#define glBlendFunc gps::GLTrace::BlendFunc
+#undef glDrawBuffer
+#define glDrawBuffer gps::GLTrace::DrawBuffer
+#undef glReadBuffer
+#define glReadBuffer gps::GLTrace::ReadBuffer
+#undef glPixelStorei
+#define glPixelStorei gps::GLTrace::PixelStorei
+#undef glActiveTexture
+#define glActiveTexture gps::GLTrace::ActiveTexture
+#undef glBindTexture
+#define glBindTexture gps::GLTrace::BindTexture
+#undef glTexParameteri
+#define glTexParameteri gps::GLTrace::TexParameteri
+#undef glTexParameterfv
+#define glTexParameterfv gps::GLTrace::TexParameterfv
+#undef glTexImage2D
+#define glTexImage2D gps::GLTrace::TexImage2D
+#undef glGenerateMipmap
+#define glGenerateMipmap gps::GLTrace::GenerateMipmap
+#undef glBindBuffer
+#define glBindBuffer gps::GLTrace::BindBuffer
+#undef glBindBufferBase
+#define glBindBufferBase gps::GLTrace::BindBufferBase
+#undef glBindBufferRange
+#define glBindBufferRange gps::GLTrace::BindBufferRange
+#undef glBufferData
+#define glBufferData gps::GLTrace::BufferData
+#undef glBufferSubData
+#define glBufferSubData gps::GLTrace::BufferSubData
+#undef glBindVertexArray
+#define glBindVertexArray gps::GLTrace::BindVertexArray
+#undef glVertexAttribPointer
+#define glVertexAttribPointer gps::GLTrace::VertexAttribPointer
+#undef glEnableVertexAttribArray
+#define glEnableVertexAttribArray gps::GLTrace::EnableVertexAttribArray
+#undef glUseProgram
+#define glUseProgram gps::GLTrace::UseProgram
+#undef glUniform1i
+#define glUniform1i gps::GLTrace::Uniform1i
+#undef glUniform1f
+#define glUniform1f gps::GLTrace::Uniform1f
+#undef glUniform2f
+#define glUniform2f gps::GLTrace::Uniform2f
+#undef glUniform2fv
+#define glUniform2fv gps::GLTrace::Uniform2fv
+#undef glUniform3fv
+#define glUniform3fv gps::GLTrace::Uniform3fv
+#undef glUniform4fv
+#define glUniform4fv gps::GLTrace::Uniform4fv
+#undef glUniformMatrix4fv
+#define glUniformMatrix4fv gps::GLTrace::UniformMatrix4fv
+#undef glDrawArrays
+#define glDrawArrays gps::GLTrace::DrawArrays
+#undef glDrawElements
+#define glDrawElements gps::GLTrace::DrawElements
+#undef glBindFramebuffer
+#define glBindFramebuffer gps::GLTrace::BindFramebuffer
+#undef glBindRenderbuffer
+#define glBindRenderbuffer gps::GLTrace::BindRenderbuffer
+#undef glFramebufferTexture2D
+#define glFramebufferTexture2D gps::GLTrace::FramebufferTexture2D
+#undef glFramebufferRenderbuffer
+#define glFramebufferRenderbuffer gps::GLTrace::FramebufferRenderbuffer
+#undef glRenderbufferStorage
+#define glRenderbufferStorage gps::GLTrace::RenderbufferStorage
@@ -0,0 +1,211 @@
+#include "HeadlessContext.hpp"
+#include "Logger.hpp"
+
+#if defined (__linux__)
+    #define EGL_NO_X11
+    #include <EGL/egl.h>
+    #include <EGL/eglext.h>
+#endif
+
+namespace gps {
+
+    HeadlessContext::HeadlessContext() {
+
+        width = 0;
+        height = 0;
+        framebuffer = 0;
+        colorRenderbuffer = 0;
+        depthRenderbuffer = 0;
+#if defined (__linux__)
+        display = EGL_NO_DISPLAY;
+        context = EGL_NO_CONTEXT;
+#else
+        hiddenWindow = NULL;
+#endif
+    }
+
+    bool HeadlessContext::Create(int width, int height) {
+
+        this->width = width;
+        this->height = height;
+
+        if (!CreateContext()) {
+            Delete();
+            return false;
+        }
+
+#if not defined (__APPLE__)
+        glewExperimental = GL_TRUE;
+        GLenum error = glewInit();
+        //GLEW built for GLX reports the missing X display, but has loaded the GL entry points by then
+        if (error != GLEW_OK && error != GLEW_ERROR_NO_GLX_DISPLAY) {
+            LOG_ERROR("could not initialize GLEW for the headless context (%d)", (int)error);
+            Delete();
+            return false;
+        }
+#endif
+
+        LOG_INFO("Headless renderer: %s", (const char*)glGetString(GL_RENDERER));
+        LOG_INFO("OpenGL version supported %s", (const char*)glGetString(GL_VERSION));
+
+        if (!CreateFramebuffer()) {
+            Delete();
+            return false;
+        }
+        return true;
+    }
+
+#if defined (__linux__)
+    bool HeadlessContext::CreateContext() {
+
+        //surfaceless platform first, so no X or Wayland server is needed
+        PFNEGLGETPLATFORMDISPLAYEXTPROC getPlatformDisplay =
+            (PFNEGLGETPLATFORMDISPLAYEXTPROC)eglGetProcAddress("eglGetPlatformDisplayEXT");
+        if (getPlatformDisplay != NULL) {
+            display = getPlatformDisplay(EGL_PLATFORM_SURFACELESS_MESA, EGL_DEFAULT_DISPLAY, NULL);
+        }
+        if (display == EGL_NO_DISPLAY) {
+            display = eglGetDisplay(EGL_DEFAULT_DISPLAY);
+        }
+
+        EGLint major, minor;
+        if (display == EGL_NO_DISPLAY || !eglInitialize(display, &major, &minor)) {
+            LOG_ERROR("could not initialize an EGL display");
+            display = EGL_NO_DISPLAY;
+            return false;
+        }
+        if (!eglBindAPI(EGL_OPENGL_API)) {
+            LOG_ERROR("EGL %d.%d can't create desktop OpenGL contexts", major, minor);
+            return false;
+        }
+
+        //eglChooseConfig asks for window surfaces by default, which surfaceless displays don't have
+        const EGLint configAttributes[] = {
+            EGL_SURFACE_TYPE, EGL_DONT_CARE,
+            EGL_RENDERABLE_TYPE, EGL_OPENGL_BIT,
+            EGL_NONE
+        };
+        EGLConfig config;
+        EGLint configCount = 0;
+        if (!eglChooseConfig(display, configAttributes, &config, 1, &configCount) || configCount == 0) {
+            LOG_ERROR("no EGL config supports desktop OpenGL");
+            return false;
+        }
+
+        const EGLint contextAttributes[] = {
+            EGL_CONTEXT_MAJOR_VERSION, 4,
+            EGL_CONTEXT_MINOR_VERSION, 1,
+            EGL_CONTEXT_OPENGL_PROFILE_MASK, EGL_CONTEXT_OPENGL_CORE_PROFILE_BIT,
+            EGL_NONE
+        };
+        context = eglCreateContext(display, config, EGL_NO_CONTEXT, contextAttributes);
+        if (context == EGL_NO_CONTEXT) {
+            LOG_ERROR("could not create an OpenGL 4.1 core context with EGL");
+            return false;
+        }
+
+        //everything is drawn into our own framebuffer, so the context needs no surface
+        if (!eglMakeCurrent(display, EGL_NO_SURFACE, EGL_NO_SURFACE, context)) {
+            LOG_ERROR("could not make the EGL context current (EGL_KHR_surfaceless_context missing?)");
+            return false;
+        }
+        return true;
+    }
+#else
+    bool HeadlessContext::CreateContext() {
+
+        if (!glfwInit()) {
+            LOG_ERROR("could not start GLFW3");
+            return false;
+        }
+
+        glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 4);
+        glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, 1);
+        glfwWindowHint(GLFW_OPENGL_FORWARD_COMPAT, GL_TRUE);
+        glfwWindowHint(GLFW_OPENGL_PROFILE, GLFW_OPENGL_CORE_PROFILE);
+        glfwWindowHint(GLFW_VISIBLE, GLFW_FALSE);
+
+        hiddenWindow = glfwCreateWindow(1, 1, "Headless", NULL, NULL);
+        if (!hiddenWindow) {
+            LOG_ERROR("could not open a hidden window with GLFW3");
+            return false;
+        }
+        glfwMakeContextCurrent(hiddenWindow);
+        return true;
+    }
+#endif
+
+    bool HeadlessContext::CreateFramebuffer() {
+
+        //sRGB like the window's default framebuffer, the scene relies on GL_FRAMEBUFFER_SRGB
+        glGenRenderbuffers(1, &colorRenderbuffer);
+        glBindRenderbuffer(GL_RENDERBUFFER, colorRenderbuffer);
+        glRenderbufferStorage(GL_RENDERBUFFER, GL_SRGB8_ALPHA8, width, height);
+
+        glGenRenderbuffers(1, &depthRenderbuffer);
+        glBindRenderbuffer(GL_RENDERBUFFER, depthRenderbuffer);
+        glRenderbufferStorage(GL_RENDERBUFFER, GL_DEPTH_COMPONENT24, width, height);
+        glBindRenderbuffer(GL_RENDERBUFFER, 0);
+
+        glGenFramebuffers(1, &framebuffer);
+        glBindFramebuffer(GL_FRAMEBUFFER, framebuffer);
+        glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_RENDERBUFFER, colorRenderbuffer);
+        glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, GL_RENDERBUFFER, depthRenderbuffer);
+        bool complete = glCheckFramebufferStatus(GL_FRAMEBUFFER) == GL_FRAMEBUFFER_COMPLETE;
+        if (!complete) {
+            LOG_ERROR("Headless framebuffer is incomplete");
+        }
+        return complete;
+    }
+
+    void HeadlessContext::Delete() {
+
+        if (framebuffer != 0) {
+            glBindFramebuffer(GL_FRAMEBUFFER, 0);
+            glDeleteFramebuffers(1, &framebuffer);
+            glDeleteRenderbuffers(1, &colorRenderbuffer);
+            glDeleteRenderbuffers(1, &depthRenderbuffer);
+            framebuffer = 0;
+            colorRenderbuffer = 0;
+            depthRenderbuffer = 0;
+        }
+
+#if defined (__linux__)
+        if (display != EGL_NO_DISPLAY) {
+            eglMakeCurrent(display, EGL_NO_SURFACE, EGL_NO_SURFACE, EGL_NO_CONTEXT);
+            if (context != EGL_NO_CONTEXT) {
+                eglDestroyContext(display, context);
+            }
+            eglTerminate(display);
+        }
+        display = EGL_NO_DISPLAY;
+        context = EGL_NO_CONTEXT;
+#else
+        if (hiddenWindow != NULL) {
+            glfwDestroyWindow(hiddenWindow);
+            hiddenWindow = NULL;
+        }
+        glfwTerminate();
+#endif
+    }
+
+    GLuint HeadlessContext::GetFramebuffer() {
+
+        return framebuffer;
+    }
+
+    int HeadlessContext::GetWidth() {
+
+        return width;
+    }
+
+    int HeadlessContext::GetHeight() {
+
+        return height;
+    }
+
+    void HeadlessContext::EndFrame() {
+
+        glFinish();
+    }
+}
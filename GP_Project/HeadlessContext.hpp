@@ -0,0 +1,52 @@
+#ifndef HeadlessContext_hpp
+#define HeadlessContext_hpp
+
+#if defined (__APPLE__)
+    #define GLFW_INCLUDE_GLCOREARB
+    #define GL_SILENCE_DEPRECATION
+#else
+    #define GLEW_STATIC
+    #include <GL/glew.h>
+#endif
+
+#include <GLFW/glfw3.h>
+
+namespace gps {
+
+    //OpenGL 4.1 core context without a visible window, rendering into an offscreen framebuffer
+    //on Linux it is an EGL surfaceless context (works on Mesa llvmpipe without a display
+    //server, link with -lEGL); elsewhere it falls back to a hidden GLFW window
+    class HeadlessContext {
+
+    public:
+        HeadlessContext();
+        //makes the context current and creates the framebuffer; also initializes GLEW
+        bool Create(int width, int height);
+        void Delete();
+        //the framebuffer to render the scene into, instead of the default one
+        GLuint GetFramebuffer();
+        int GetWidth();
+        int GetHeight();
+        //waits for the GPU to finish the frame, so frame times are measurable
+        void EndFrame();
+
+    private:
+        int width;
+        int height;
+        GLuint framebuffer;
+        GLuint colorRenderbuffer;
+        GLuint depthRenderbuffer;
+#if defined (__linux__)
+        //EGLDisplay and EGLContext, kept opaque so the EGL (and X11) headers stay out of this one
+        void* display;
+        void* context;
+#else
+        GLFWwindow* hiddenWindow;
+#endif
+
+        bool CreateContext();
+        bool CreateFramebuffer();
+    };
+}
+
+#endif /* HeadlessContext_hpp */
@@ -0,0 +1,70 @@
+#include "ImageDiff.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+namespace gps {
+
+    namespace {
+
+        //largest possible weighted YIQ distance between two colors
+        const double MAX_YIQ_DELTA = 35215.0;
+
+        double yiqDelta(const unsigned char* a, const unsigned char* b) {
+
+            double r1 = a[0], g1 = a[1], b1 = a[2];
+            double r2 = b[0], g2 = b[1], b2 = b[2];
+            double y = (r1 - r2) * 0.29889531 + (g1 - g2) * 0.58662247 + (b1 - b2) * 0.11448223;
+            double i = (r1 - r2) * 0.59597799 - (g1 - g2) * 0.27417610 - (b1 - b2) * 0.32180189;
+            double q = (r1 - r2) * 0.21147017 - (g1 - g2) * 0.52261711 + (b1 - b2) * 0.31114694;
+            return 0.5053 * y * y + 0.299 * i * i + 0.1957 * q * q;
+        }
+    }
+
+    ImageDiffResult ImageDiff::Compare(const unsigned char* expected, const unsigned char* actual, int width, int height,
+        double threshold, std::vector<unsigned char>* diffImage) {
+
+        ImageDiffResult result = {};
+        size_t pixelCount = (size_t)width * height;
+        if (diffImage != NULL) {
+            diffImage->resize(pixelCount * 4);
+        }
+
+        double differenceSum = 0.0;
+        double squaredErrorSum = 0.0;
+        for (size_t pixel = 0; pixel < pixelCount; pixel++) {
+            const unsigned char* a = expected + pixel * 4;
+            const unsigned char* b = actual + pixel * 4;
+            //compared as distances in [0, 1], like the threshold
+            double difference = std::sqrt(yiqDelta(a, b) / MAX_YIQ_DELTA);
+            bool different = difference > threshold;
+            result.differentPixels += different ? 1 : 0;
+            result.maxDifference = std::max(result.maxDifference, difference);
+            differenceSum += difference;
+            for (int c = 0; c < 3; c++) {
+                squaredErrorSum += (double)(a[c] - b[c]) * (a[c] - b[c]);
+            }
+
+            if (diffImage != NULL) {
+                unsigned char* out = diffImage->data() + pixel * 4;
+                if (different) {
+                    out[0] = 255;
+                    out[1] = 0;
+                    out[2] = 0;
+                }
+                else {
+                    unsigned char gray = (unsigned char)(255 - (255 - (0.299 * a[0] + 0.587 * a[1] + 0.114 * a[2])) * 0.1);
+                    out[0] = out[1] = out[2] = gray;
+                }
+                out[3] = 255;
+            }
+        }
+
+        result.differentFraction = pixelCount > 0 ? (double)result.differentPixels / pixelCount : 0.0;
+        result.meanDifference = pixelCount > 0 ? differenceSum / pixelCount : 0.0;
+        double meanSquaredError = pixelCount > 0 ? squaredErrorSum / (pixelCount * 3) : 0.0;
+        result.psnr = meanSquaredError > 0.0 ? 10.0 * std::log10(255.0 * 255.0 / meanSquaredError) : std::numeric_limits<double>::infinity();
+        return result;
+    }
+}
@@ -0,0 +1,34 @@
+#ifndef ImageDiff_hpp
+#define ImageDiff_hpp
+
+#include <vector>
+
+namespace gps {
+
+    struct ImageDiffResult {
+        //pixels whose perceptual difference is above the threshold
+        int differentPixels;
+        double differentFraction;
+        //perceptual difference, 0 (same color) to 1 (the largest possible YIQ distance)
+        double maxDifference;
+        double meanDifference;
+        //of the RGB channels, infinite for identical images
+        double psnr;
+    };
+
+    //Perceptual comparison of two renders of the same size (8 bit RGBA, alpha ignored)
+    //the difference of a pixel is the distance in YIQ space weighted as in pixelmatch
+    //(Kotsarenko and Ramos, "Measuring perceived color difference using YIQ NTSC
+    //transmission color space"), so brightness changes count more than hue shifts
+    //and small shading changes from reordered floating point math stay under the threshold
+    class ImageDiff {
+
+    public:
+        //threshold: perceptual difference above which a pixel counts as different;
+        //diffImage (optional): the expected image faded to gray with the different pixels in red
+        static ImageDiffResult Compare(const unsigned char* expected, const unsigned char* actual, int width, int height,
+            double threshold, std::vector<unsigned char>* diffImage);
+    };
+}
+
+#endif /* ImageDiff_hpp */
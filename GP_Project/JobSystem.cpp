@@ -0,0 +1,333 @@
+#include "JobSystem.hpp"
+#include "Profiler.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace gps {
+
+    struct Job {
+        JobSystem::Function function;
+        Job* parent;
+        //the job itself and its unfinished children
+        std::atomic<int> unfinished;
+        //the waiting handle, the execution and every child still running
+        std::atomic<int> references;
+    };
+
+    namespace {
+
+        struct WorkQueue {
+            std::mutex mutex;
+            std::deque<Job*> jobs;
+        };
+
+        //finished jobs kept by a thread for its next Create
+        struct JobCache {
+            std::vector<Job*> jobs;
+
+            ~JobCache() {
+                for (size_t i = 0; i < jobs.size(); i++) {
+                    delete jobs[i];
+                }
+            }
+        };
+
+        const size_t MAX_CACHED_JOBS = 1024;
+        //yields of an idle worker before it goes to sleep
+        const int IDLE_SPINS = 64;
+
+        //one deque per thread of the system, then one shared by the threads outside of it
+        std::vector<std::unique_ptr<WorkQueue> > queues;
+        std::vector<std::thread> workers;
+        bool running = false;
+        std::atomic<bool> stopping(false);
+        std::atomic<int> queuedJobs(0);
+        std::atomic<long long> steals(0);
+        std::mutex sleepMutex;
+        std::condition_variable workAvailable;
+        std::atomic<int> sleepingWorkers(0);
+
+        thread_local int threadIndex = -1;
+        thread_local Job* currentJob = nullptr;
+        thread_local JobCache jobCache;
+        thread_local unsigned int stealSeed = 0;
+
+        int ownQueue() {
+
+            return threadIndex >= 0 ? threadIndex : (int)queues.size() - 1;
+        }
+
+        void release(Job* job) {
+
+            if (job->references.fetch_sub(1, std::memory_order_acq_rel) != 1) {
+                return;
+            }
+            //the captures of the function are freed now, not when the job is reused
+            job->function = nullptr;
+            if (jobCache.jobs.size() < MAX_CACHED_JOBS) {
+                jobCache.jobs.push_back(job);
+            }
+            else {
+                delete job;
+            }
+        }
+
+        //the job itself or one of its children is done
+        void finish(Job* job) {
+
+            if (job->unfinished.fetch_sub(1, std::memory_order_acq_rel) == 1 && job->parent != nullptr) {
+                Job* parent = job->parent;
+                finish(parent);
+                release(parent);
+            }
+        }
+
+        void execute(Job* job) {
+
+            Job* previous = currentJob;
+            currentJob = job;
+            job->function();
+            currentJob = previous;
+            finish(job);
+            release(job);
+        }
+
+        Job* pop(int queue, bool stolen) {
+
+            WorkQueue& workQueue = *queues[queue];
+            std::lock_guard<std::mutex> lock(workQueue.mutex);
+            if (workQueue.jobs.empty()) {
+                return nullptr;
+            }
+            Job* job;
+            if (stolen) {
+                job = workQueue.jobs.front();
+                workQueue.jobs.pop_front();
+            }
+            else {
+                job = workQueue.jobs.back();
+                workQueue.jobs.pop_back();
+            }
+            queuedJobs.fetch_sub(1);
+            return job;
+        }
+
+        //runs one job, from the deque of the calling thread or stolen from another; false when there is none
+        bool runOne() {
+
+            if (queuedJobs.load() == 0) {
+                return false;
+            }
+            int own = ownQueue();
+            Job* job = pop(own, false);
+            if (job == nullptr) {
+                int count = (int)queues.size();
+                stealSeed = stealSeed * 1664525u + 1013904223u;
+                int first = (int)((stealSeed >> 8) % (unsigned int)count);
+                for (int i = 0; i < count && job == nullptr; i++) {
+                    int victim = (first + i) % count;
+                    if (victim != own) {
+                        job = pop(victim, true);
+                    }
+                }
+                if (job == nullptr) {
+                    return false;
+                }
+                steals.fetch_add(1, std::memory_order_relaxed);
+            }
+            execute(job);
+            return true;
+        }
+
+        void workerLoop(int index) {
+
+            threadIndex = index;
+            stealSeed = (unsigned int)index * 2654435761u;
+            std::string name = "job " + std::to_string(index);
+            Profiler::SetThreadName(name.c_str());
+            for (;;) {
+                if (runOne()) {
+                    continue;
+                }
+                if (stopping.load() && queuedJobs.load() == 0) {
+                    return;
+                }
+                int spins = 0;
+                while (spins < IDLE_SPINS && queuedJobs.load() == 0 && !stopping.load()) {
+                    std::this_thread::yield();
+                    spins++;
+                }
+                if (spins < IDLE_SPINS) {
+                    continue;
+                }
+                //a Run that misses the sleeper count takes the lock after it, so the notify can't be lost
+                std::unique_lock<std::mutex> lock(sleepMutex);
+                sleepingWorkers.fetch_add(1);
+                workAvailable.wait(lock, [] { return stopping.load() || queuedJobs.load() > 0; });
+                sleepingWorkers.fetch_sub(1);
+            }
+        }
+
+        void splitRange(int begin, int end, int grain, const JobSystem::RangeFunction& function) {
+
+            //the upper halves are queued, the last piece runs here
+            while (end - begin > grain) {
+                int middle = begin + (end - begin) / 2;
+                Job* half = JobSystem::Create([middle, end, grain, &function]() {
+                    splitRange(middle, end, grain, function);
+                }, currentJob);
+                JobSystem::Run(half);
+                end = middle;
+            }
+            function(begin, end);
+        }
+    }
+
+    void JobSystem::Start(int threads) {
+
+        if (running) {
+            return;
+        }
+        if (threads <= 0) {
+            threads = std::max((int)std::thread::hardware_concurrency(), 1);
+        }
+        queues.clear();
+        for (int i = 0; i < threads + 1; i++) {
+            queues.push_back(std::unique_ptr<WorkQueue>(new WorkQueue()));
+        }
+        stopping = false;
+        steals = 0;
+        running = true;
+        //the calling thread is the first one of the system
+        threadIndex = 0;
+        for (int i = 1; i < threads; i++) {
+            workers.push_back(std::thread(workerLoop, i));
+        }
+    }
+
+    void JobSystem::Stop() {
+
+        if (!running) {
+            return;
+        }
+        {
+            std::lock_guard<std::mutex> lock(sleepMutex);
+            stopping = true;
+        }
+        workAvailable.notify_all();
+        for (size_t i = 0; i < workers.size(); i++) {
+            workers[i].join();
+        }
+        workers.clear();
+        //without workers the jobs of this thread are still queued
+        while (runOne()) {
+        }
+        running = false;
+        threadIndex = -1;
+        queues.clear();
+    }
+
+    bool JobSystem::IsRunning() {
+
+        return running;
+    }
+
+    int JobSystem::GetThreadCount() {
+
+        return running ? (int)queues.size() - 1 : 1;
+    }
+
+    Job* JobSystem::Create(const Function& function, Job* parent) {
+
+        Job* job;
+        if (!jobCache.jobs.empty()) {
+            job = jobCache.jobs.back();
+            jobCache.jobs.pop_back();
+        }
+        else {
+            job = new Job();
+        }
+        job->function = function;
+        job->parent = parent;
+        job->unfinished.store(1, std::memory_order_relaxed);
+        job->references.store(parent != nullptr ? 1 : 2, std::memory_order_relaxed);
+        if (parent != nullptr) {
+            parent->unfinished.fetch_add(1, std::memory_order_relaxed);
+            parent->references.fetch_add(1, std::memory_order_relaxed);
+        }
+        return job;
+    }
+
+    Job* JobSystem::GetCurrentJob() {
+
+        return currentJob;
+    }
+
+    void JobSystem::Run(Job* job) {
+
+        if (!running) {
+            execute(job);
+            return;
+        }
+        WorkQueue& workQueue = *queues[ownQueue()];
+        {
+            std::lock_guard<std::mutex> lock(workQueue.mutex);
+            workQueue.jobs.push_back(job);
+            queuedJobs.fetch_add(1);
+        }
+        if (sleepingWorkers.load() > 0) {
+            {
+                std::lock_guard<std::mutex> lock(sleepMutex);
+            }
+            workAvailable.notify_one();
+        }
+    }
+
+    void JobSystem::Spawn(const Function& function) {
+
+        Job* job = Create(function);
+        //no waiting handle, the execution holds the only reference
+        job->references.store(1, std::memory_order_relaxed);
+        Run(job);
+    }
+
+    void JobSystem::Wait(Job* job) {
+
+        while (job->unfinished.load(std::memory_order_acquire) > 0) {
+            if (!runOne()) {
+                std::this_thread::yield();
+            }
+        }
+        release(job);
+    }
+
+    void JobSystem::ParallelFor(int count, int grain, const RangeFunction& function) {
+
+        if (count <= 0) {
+            return;
+        }
+        grain = std::max(grain, 1);
+        if (count <= grain) {
+            function(0, count);
+            return;
+        }
+        Job* root = Create([count, grain, &function]() {
+            splitRange(0, count, grain, function);
+        });
+        Run(root);
+        Wait(root);
+    }
+
+    long long JobSystem::GetSteals() {
+
+        return steals.load(std::memory_order_relaxed);
+    }
+}
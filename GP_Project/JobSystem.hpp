@@ -0,0 +1,50 @@
+#ifndef JobSystem_hpp
+#define JobSystem_hpp
+
+#include <functional>
+
+namespace gps {
+
+    //A unit of work of the job system, created by JobSystem::Create
+    struct Job;
+
+    //Work-stealing job system for the CPU work of the engine (asset parsing, texture decoding, ...)
+    //every thread has its own deque of jobs: it pushes and pops at the back, the newest job whose data is
+    //still in its caches, and once it runs dry it steals from the front of another deque, the oldest job and
+    //usually the largest piece of work left; idle workers sleep until a job is queued
+    //a job may have a parent, which only finishes once all its children have, so waiting on the root of a
+    //tree waits for all of it; a thread that waits runs jobs in the meantime instead of blocking
+    //without Start (tools, benchmarks) every job runs on the thread that queues it
+    class JobSystem {
+
+    public:
+        typedef std::function<void()> Function;
+        typedef std::function<void(int, int)> RangeFunction;
+
+        //threads: threads running jobs, the calling one included; 0 for one per hardware thread
+        static void Start(int threads);
+        //runs the jobs still queued and joins the workers
+        static void Stop();
+        static bool IsRunning();
+        static int GetThreadCount();
+        //a job running function; the children of parent have to be created before it finishes,
+        //from its own function or before it is queued
+        static Job* Create(const Function& function, Job* parent = nullptr);
+        //the job running on the calling thread, the parent of the jobs it splits off
+        static Job* GetCurrentJob();
+        //queues the job on the deque of the calling thread
+        static void Run(Job* job);
+        //queues a job nobody waits on, released once it ran (the coroutines of Task.hpp resume on them)
+        static void Spawn(const Function& function);
+        //runs jobs until job and all its children are done, then releases it;
+        //every job without a parent is waited on exactly once, jobs with a parent never are
+        static void Wait(Job* job);
+        //calls function(begin, end) over [0, count) in ranges of at most grain items and returns once all are done;
+        //the range is split in halves, so a thief takes a large part of what is left
+        static void ParallelFor(int count, int grain, const RangeFunction& function);
+        //jobs taken from the deque of another thread since Start
+        static long long GetSteals();
+    };
+}
+
+#endif /* JobSystem_hpp */
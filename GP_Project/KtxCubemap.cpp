@@ -0,0 +1,434 @@
+#include "KtxCubemap.hpp"
+#include "stb_image.h"
+
+#include <glm/glm.hpp>
+
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+
+//not every GL header has the compressed format tokens
+#ifndef GL_COMPRESSED_RGB_S3TC_DXT1_EXT
+#define GL_COMPRESSED_RGB_S3TC_DXT1_EXT 0x83F0
+#endif
+#ifndef GL_COMPRESSED_RGB_BPTC_UNSIGNED_FLOAT
+#define GL_COMPRESSED_RGB_BPTC_UNSIGNED_FLOAT 0x8E8F
+#endif
+#ifndef GL_COMPRESSED_RGB_BPTC_SIGNED_FLOAT
+#define GL_COMPRESSED_RGB_BPTC_SIGNED_FLOAT 0x8E8E
+#endif
+
+namespace gps {
+
+    namespace {
+
+        const unsigned char KTX2_IDENTIFIER[12] = { 0xAB, 'K', 'T', 'X', ' ', '2', '0', 0xBB, '\r', '\n', 0x1A, '\n' };
+
+        //VkFormat values used by the files we read and write
+        const uint32_t VK_FORMAT_R8G8B8A8_UNORM = 37;
+        const uint32_t VK_FORMAT_BC1_RGB_UNORM_BLOCK = 131;
+        const uint32_t VK_FORMAT_BC6H_UFLOAT_BLOCK = 143;
+        const uint32_t VK_FORMAT_BC6H_SFLOAT_BLOCK = 144;
+
+        //identifier, then the header, index and level index, all little endian
+        struct Ktx2Header {
+            uint32_t vkFormat;
+            uint32_t typeSize;
+            uint32_t pixelWidth;
+            uint32_t pixelHeight;
+            uint32_t pixelDepth;
+            uint32_t layerCount;
+            uint32_t faceCount;
+            uint32_t levelCount;
+            uint32_t supercompressionScheme;
+        };
+
+        struct Ktx2Index {
+            uint32_t dfdByteOffset;
+            uint32_t dfdByteLength;
+            uint32_t kvdByteOffset;
+            uint32_t kvdByteLength;
+            uint64_t sgdByteOffset;
+            uint64_t sgdByteLength;
+        };
+
+        struct Ktx2Level {
+            uint64_t byteOffset;
+            uint64_t byteLength;
+            uint64_t uncompressedByteLength;
+        };
+
+        static_assert(sizeof(Ktx2Header) == 36, "Ktx2Header has to match the file layout");
+        static_assert(sizeof(Ktx2Index) == 32, "Ktx2Index has to match the file layout");
+        static_assert(sizeof(Ktx2Level) == 24, "Ktx2Level has to match the file layout");
+
+        struct GLFormat {
+            GLenum internalFormat;
+            bool compressed;
+            bool supported;
+        };
+
+        GLFormat glFormatFor(uint32_t vkFormat) {
+
+            GLFormat format = { 0, true, false };
+            switch (vkFormat) {
+            case VK_FORMAT_BC1_RGB_UNORM_BLOCK:
+                format.internalFormat = GL_COMPRESSED_RGB_S3TC_DXT1_EXT;
+#if defined (__APPLE__)
+                format.supported = true;
+#else
+                format.supported = GLEW_EXT_texture_compression_s3tc != 0;
+#endif
+                break;
+            case VK_FORMAT_BC6H_UFLOAT_BLOCK:
+            case VK_FORMAT_BC6H_SFLOAT_BLOCK:
+                format.internalFormat = vkFormat == VK_FORMAT_BC6H_UFLOAT_BLOCK ?
+                    GL_COMPRESSED_RGB_BPTC_UNSIGNED_FLOAT : GL_COMPRESSED_RGB_BPTC_SIGNED_FLOAT;
+#if defined (__APPLE__)
+                format.supported = false;
+#else
+                format.supported = GLEW_ARB_texture_compression_bptc != 0;
+#endif
+                break;
+            case VK_FORMAT_R8G8B8A8_UNORM:
+                format.internalFormat = GL_RGBA8;
+                format.compressed = false;
+                format.supported = true;
+                break;
+            }
+            return format;
+        }
+
+        uint16_t packRGB565(glm::vec3 color) {
+
+            glm::vec3 c = glm::clamp(color, 0.0f, 255.0f);
+            return (uint16_t)(((int)(c.r * 31.0f / 255.0f + 0.5f) << 11) |
+                ((int)(c.g * 63.0f / 255.0f + 0.5f) << 5) |
+                (int)(c.b * 31.0f / 255.0f + 0.5f));
+        }
+
+        glm::vec3 unpackRGB565(uint16_t color) {
+
+            return glm::vec3((color >> 11) & 31, (color >> 5) & 63, color & 31) * glm::vec3(255.0f / 31.0f, 255.0f / 63.0f, 255.0f / 31.0f);
+        }
+
+        void writeUint32(std::vector<unsigned char>& out, uint32_t value) {
+
+            for (int i = 0; i < 4; i++) {
+                out.push_back((unsigned char)(value >> (8 * i)));
+            }
+        }
+    }
+
+    bool KtxCubemap::IsKtxFile(const std::string& fileName) {
+
+        return fileName.size() > 5 && fileName.compare(fileName.size() - 5, 5, ".ktx2") == 0;
+    }
+
+    GLuint KtxCubemap::Load(const std::string& fileName) {
+
+        std::ifstream file(fileName.c_str(), std::ios::binary);
+        if (!file) {
+            std::cout << "ERROR: could not open " << fileName << std::endl;
+            return 0;
+        }
+        std::vector<unsigned char> data((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+
+        Ktx2Header header;
+        if (data.size() < sizeof(KTX2_IDENTIFIER) + sizeof(Ktx2Header) + sizeof(Ktx2Index) ||
+            memcmp(data.data(), KTX2_IDENTIFIER, sizeof(KTX2_IDENTIFIER)) != 0) {
+            std::cout << "ERROR: " << fileName << " is not a KTX2 file" << std::endl;
+            return 0;
+        }
+        memcpy(&header, data.data() + sizeof(KTX2_IDENTIFIER), sizeof(header));
+
+        if (header.faceCount != 6 || header.layerCount > 1 || header.pixelDepth != 0 ||
+            header.pixelWidth != header.pixelHeight || header.pixelWidth == 0 || header.supercompressionScheme != 0) {
+            std::cout << "ERROR: " << fileName << " is not a square, single layer cubemap without supercompression" << std::endl;
+            return 0;
+        }
+
+        GLFormat format = glFormatFor(header.vkFormat);
+        if (!format.supported) {
+            std::cout << "ERROR: " << fileName << " uses a format this driver can't sample (VkFormat " << header.vkFormat << ")" << std::endl;
+            return 0;
+        }
+
+        //a level count of 0 asks the loader to generate the mips, which only works uncompressed
+        uint32_t levelCount = header.levelCount;
+        bool generateMipmaps = levelCount == 0;
+        if (generateMipmaps && format.compressed) {
+            std::cout << "ERROR: " << fileName << " has no mip levels" << std::endl;
+            return 0;
+        }
+        if (generateMipmaps) {
+            levelCount = 1;
+        }
+
+        size_t levelIndexOffset = sizeof(KTX2_IDENTIFIER) + sizeof(Ktx2Header) + sizeof(Ktx2Index);
+        if (data.size() < levelIndexOffset + levelCount * sizeof(Ktx2Level)) {
+            std::cout << "ERROR: " << fileName << " is truncated" << std::endl;
+            return 0;
+        }
+
+        GLuint textureID;
+        glGenTextures(1, &textureID);
+        glBindTexture(GL_TEXTURE_CUBE_MAP, textureID);
+        glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+
+        for (uint32_t level = 0; level < levelCount; level++) {
+            Ktx2Level levelInfo;
+            memcpy(&levelInfo, data.data() + levelIndexOffset + level * sizeof(Ktx2Level), sizeof(levelInfo));
+            if (levelInfo.byteOffset + levelInfo.byteLength > data.size() || levelInfo.byteLength % 6 != 0) {
+                std::cout << "ERROR: " << fileName << " has a bad level " << level << std::endl;
+                glBindTexture(GL_TEXTURE_CUBE_MAP, 0);
+                glDeleteTextures(1, &textureID);
+                return 0;
+            }
+
+            //the faces of a level are stored one after the other
+            GLsizei size = glm::max((GLsizei)header.pixelWidth >> level, 1);
+            GLsizei faceSize = (GLsizei)(levelInfo.byteLength / 6);
+            for (GLuint face = 0; face < 6; face++) {
+                const unsigned char* faceData = data.data() + levelInfo.byteOffset + face * faceSize;
+                if (format.compressed) {
+                    glCompressedTexImage2D(GL_TEXTURE_CUBE_MAP_POSITIVE_X + face, level, format.internalFormat,
+                        size, size, 0, faceSize, faceData);
+                }
+                else {
+                    glTexImage2D(GL_TEXTURE_CUBE_MAP_POSITIVE_X + face, level, format.internalFormat,
+                        size, size, 0, GL_RGBA, GL_UNSIGNED_BYTE, faceData);
+                }
+            }
+        }
+
+        if (generateMipmaps) {
+            glGenerateMipmap(GL_TEXTURE_CUBE_MAP);
+        }
+        else {
+            glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_MAX_LEVEL, levelCount - 1);
+        }
+        glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+        glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
+        glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+        glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+        glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_WRAP_R, GL_CLAMP_TO_EDGE);
+        glBindTexture(GL_TEXTURE_CUBE_MAP, 0);
+
+        return textureID;
+    }
+
+    bool KtxCubemap::Bake(const std::vector<std::string>& faceFileNames, const std::string& fileName) {
+
+        if (faceFileNames.size() != 6) {
+            std::cout << "ERROR: a cubemap needs 6 faces, got " << faceFileNames.size() << std::endl;
+            return false;
+        }
+
+        //levels[level][face]
+        std::vector<std::vector<Image> > levels(1);
+        for (size_t i = 0; i < faceFileNames.size(); i++) {
+            int width, height, n;
+            unsigned char* pixels = stbi_load(faceFileNames[i].c_str(), &width, &height, &n, 4);
+            if (!pixels) {
+                std::cout << "ERROR: could not load " << faceFileNames[i] << std::endl;
+                return false;
+            }
+            if (width != height || (i > 0 && width != levels[0][0].size)) {
+                std::cout << "ERROR: " << faceFileNames[i] << " is not a square face of the same size as the others" << std::endl;
+                stbi_image_free(pixels);
+                return false;
+            }
+            Image face;
+            face.size = width;
+            face.pixels.assign(pixels, pixels + width * height * 4);
+            stbi_image_free(pixels);
+            levels[0].push_back(face);
+        }
+
+        while (levels.back()[0].size > 1) {
+            std::vector<Image> next;
+            for (size_t i = 0; i < levels.back().size(); i++) {
+                next.push_back(Downsample(levels.back()[i]));
+            }
+            levels.push_back(next);
+        }
+
+        std::vector<std::vector<unsigned char> > levelData(levels.size());
+        for (size_t level = 0; level < levels.size(); level++) {
+            for (size_t face = 0; face < 6; face++) {
+                CompressBC1(levels[level][face], levelData[level]);
+            }
+        }
+
+        //basic data format descriptor: one BC1 sample, 4x4 blocks of 8 bytes
+        std::vector<unsigned char> dfd;
+        writeUint32(dfd, 44);                  //dfdTotalSize
+        writeUint32(dfd, 0);                   //vendorId, descriptorType
+        writeUint32(dfd, 2 | (40 << 16));      //versionNumber, descriptorBlockSize
+        writeUint32(dfd, 128 | (1 << 8) | (1 << 16));   //KHR_DF_MODEL_BC1A, BT709 primaries, linear transfer
+        writeUint32(dfd, 3 | (3 << 8));        //texel block dimensions - 1
+        writeUint32(dfd, 8);                   //bytesPlane0
+        writeUint32(dfd, 0);
+        writeUint32(dfd, 0 | (63 << 16));      //bitOffset, bitLength - 1, color channel
+        writeUint32(dfd, 0);                   //sample position
+        writeUint32(dfd, 0);                   //sampleLower
+        writeUint32(dfd, 0xFFFFFFFF);          //sampleUpper
+
+        Ktx2Header header;
+        memset(&header, 0, sizeof(header));
+        header.vkFormat = VK_FORMAT_BC1_RGB_UNORM_BLOCK;
+        header.typeSize = 1;
+        header.pixelWidth = levels[0][0].size;
+        header.pixelHeight = levels[0][0].size;
+        header.faceCount = 6;
+        header.levelCount = (uint32_t)levels.size();
+
+        Ktx2Index index;
+        memset(&index, 0, sizeof(index));
+        index.dfdByteOffset = (uint32_t)(sizeof(KTX2_IDENTIFIER) + sizeof(Ktx2Header) + sizeof(Ktx2Index) + levels.size() * sizeof(Ktx2Level));
+        index.dfdByteLength = (uint32_t)dfd.size();
+
+        //level data is 8 byte aligned and, as the format asks, stored from the smallest level up
+        std::vector<Ktx2Level> levelIndex(levels.size());
+        uint64_t offset = (index.dfdByteOffset + index.dfdByteLength + 7) & ~(uint64_t)7;
+        for (size_t level = levels.size(); level-- > 0;) {
+            levelIndex[level].byteOffset = offset;
+            levelIndex[level].byteLength = levelData[level].size();
+            levelIndex[level].uncompressedByteLength = levelData[level].size();
+            offset += levelData[level].size();
+        }
+
+        std::ofstream file(fileName.c_str(), std::ios::binary);
+        if (!file) {
+            std::cout << "ERROR: could not create " << fileName << std::endl;
+            return false;
+        }
+        file.write((const char*)KTX2_IDENTIFIER, sizeof(KTX2_IDENTIFIER));
+        file.write((const char*)&header, sizeof(header));
+        file.write((const char*)&index, sizeof(index));
+        file.write((const char*)levelIndex.data(), levelIndex.size() * sizeof(Ktx2Level));
+        file.write((const char*)dfd.data(), dfd.size());
+        const char padding[8] = {};
+        file.write(padding, levelIndex.back().byteOffset - (index.dfdByteOffset + index.dfdByteLength));
+        for (size_t level = levels.size(); level-- > 0;) {
+            file.write((const char*)levelData[level].data(), levelData[level].size());
+        }
+
+        if (!file) {
+            std::cout << "ERROR: could not write " << fileName << std::endl;
+            return false;
+        }
+        std::cout << "Baked " << fileName << ": " << header.pixelWidth << "px, " << header.levelCount << " levels, "
+            << offset / 1024 << " KB" << std::endl;
+        return true;
+    }
+
+    KtxCubemap::Image KtxCubemap::Downsample(const Image& image) {
+
+        Image result;
+        result.size = glm::max(image.size / 2, 1);
+        result.pixels.resize(result.size * result.size * 4);
+        for (int y = 0; y < result.size; y++) {
+            for (int x = 0; x < result.size; x++) {
+                for (int c = 0; c < 4; c++) {
+                    int x0 = glm::min(2 * x, image.size - 1), x1 = glm::min(2 * x + 1, image.size - 1);
+                    int y0 = glm::min(2 * y, image.size - 1), y1 = glm::min(2 * y + 1, image.size - 1);
+                    int sum = image.pixels[(y0 * image.size + x0) * 4 + c] + image.pixels[(y0 * image.size + x1) * 4 + c] +
+                        image.pixels[(y1 * image.size + x0) * 4 + c] + image.pixels[(y1 * image.size + x1) * 4 + c];
+                    result.pixels[(y * result.size + x) * 4 + c] = (unsigned char)((sum + 2) / 4);
+                }
+            }
+        }
+        return result;
+    }
+
+    void KtxCubemap::CompressBC1(const Image& image, std::vector<unsigned char>& blocks) {
+
+        //levels smaller than a block still take a whole block, the edge texels are repeated
+        int blockCount = (image.size + 3) / 4;
+        for (int by = 0; by < blockCount; by++) {
+            for (int bx = 0; bx < blockCount; bx++) {
+                unsigned char rgba[16][4];
+                for (int i = 0; i < 16; i++) {
+                    int x = glm::min(bx * 4 + i % 4, image.size - 1);
+                    int y = glm::min(by * 4 + i / 4, image.size - 1);
+                    memcpy(rgba[i], &image.pixels[(y * image.size + x) * 4], 4);
+                }
+                size_t offset = blocks.size();
+                blocks.resize(offset + 8);
+                CompressBC1Block(rgba, &blocks[offset]);
+            }
+        }
+    }
+
+    void KtxCubemap::CompressBC1Block(const unsigned char rgba[16][4], unsigned char* block) {
+
+        //endpoints at the extremes of the block's principal axis
+        glm::vec3 colors[16];
+        glm::vec3 mean(0.0f);
+        for (int i = 0; i < 16; i++) {
+            colors[i] = glm::vec3(rgba[i][0], rgba[i][1], rgba[i][2]);
+            mean += colors[i] / 16.0f;
+        }
+        glm::mat3 covariance(0.0f);
+        for (int i = 0; i < 16; i++) {
+            glm::vec3 d = colors[i] - mean;
+            covariance += glm::outerProduct(d, d);
+        }
+        glm::vec3 axis(1.0f, 1.0f, 1.0f);
+        for (int i = 0; i < 8; i++) {
+            axis = covariance * axis;
+            float length = glm::length(axis);
+            if (length < 1e-6f) {
+                axis = glm::vec3(0.0f);
+                break;
+            }
+            axis /= length;
+        }
+        float minT = 0.0f, maxT = 0.0f;
+        for (int i = 0; i < 16; i++) {
+            float t = glm::dot(colors[i] - mean, axis);
+            minT = glm::min(minT, t);
+            maxT = glm::max(maxT, t);
+        }
+
+        uint16_t color0 = packRGB565(mean + axis * maxT);
+        uint16_t color1 = packRGB565(mean + axis * minT);
+        //color0 > color1 selects the four color mode
+        if (color0 < color1) {
+            std::swap(color0, color1);
+        }
+
+        uint32_t indices = 0;
+        if (color0 != color1) {
+            glm::vec3 palette[4];
+            palette[0] = unpackRGB565(color0);
+            palette[1] = unpackRGB565(color1);
+            palette[2] = (2.0f * palette[0] + palette[1]) / 3.0f;
+            palette[3] = (palette[0] + 2.0f * palette[1]) / 3.0f;
+            for (int i = 0; i < 16; i++) {
+                int best = 0;
+                float bestDistance = glm::dot(colors[i] - palette[0], colors[i] - palette[0]);
+                for (int p = 1; p < 4; p++) {
+                    float distance = glm::dot(colors[i] - palette[p], colors[i] - palette[p]);
+                    if (distance < bestDistance) {
+                        bestDistance = distance;
+                        best = p;
+                    }
+                }
+                indices |= (uint32_t)best << (2 * i);
+            }
+        }
+
+        block[0] = (unsigned char)(color0 & 0xFF);
+        block[1] = (unsigned char)(color0 >> 8);
+        block[2] = (unsigned char)(color1 & 0xFF);
+        block[3] = (unsigned char)(color1 >> 8);
+        for (int i = 0; i < 4; i++) {
+            block[4 + i] = (unsigned char)(indices >> (8 * i));
+        }
+    }
+}
@@ -0,0 +1,42 @@
+#ifndef KtxCubemap_hpp
+#define KtxCubemap_hpp
+
+#if defined (__APPLE__)
+    #define GL_SILENCE_DEPRECATION
+    #include <OpenGL/gl3.h>
+#else
+    #define GLEW_STATIC
+    #include <GL/glew.h>
+#endif
+
+#include <string>
+#include <vector>
+
+namespace gps {
+
+    //Cubemaps stored as KTX2 files with their whole mip chain
+    //supported formats: BC1 and BC6H (uploaded as is, no decoding) and uncompressed RGBA8
+    class KtxCubemap {
+
+    public:
+        //returns 0 when the file is missing, malformed or in a format the driver can't sample
+        static GLuint Load(const std::string& fileName);
+        //CPU side converter: six face images (+x, -x, +y, -y, +z, -z) to a BC1 KTX2 file,
+        //with the mip chain box filtered down to 1x1; doesn't need a GL context
+        static bool Bake(const std::vector<std::string>& faceFileNames, const std::string& fileName);
+        static bool IsKtxFile(const std::string& fileName);
+
+    private:
+        struct Image {
+            int size;
+            //RGBA8
+            std::vector<unsigned char> pixels;
+        };
+
+        static Image Downsample(const Image& image);
+        static void CompressBC1(const Image& image, std::vector<unsigned char>& blocks);
+        static void CompressBC1Block(const unsigned char rgba[16][4], unsigned char* block);
+    };
+}
+
+#endif /* KtxCubemap_hpp */
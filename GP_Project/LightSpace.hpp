@@ -0,0 +1,22 @@
+#ifndef LightSpace_hpp
+#define LightSpace_hpp
+
+#include <glm/glm.hpp>
+#include <glm/gtc/matrix_transform.hpp>
+
+namespace gps {
+
+    //Light space matrix of the sun shadow map: an orthographic view looking at the origin
+    //from the rotated sun direction, large enough to cover the motorcycle and the parking lot
+    inline glm::mat4 computeSunLightSpaceMatrix(const glm::mat4& lightRotation, const glm::vec3& sunLightDir) {
+
+        glm::vec3 lightPosition = glm::vec3(lightRotation * glm::vec4(sunLightDir, 1.0f)) + glm::vec3(0.0f, 5.0f, 0.0f);
+        glm::mat4 lightView = glm::lookAt(lightPosition, glm::vec3(0.0f, 0.0f, 0.0f), glm::vec3(0.0f, 1.0f, 0.0f));
+        const float nearPlane = 0.1f;
+        const float farPlane = 100.0f;
+        glm::mat4 lightProjection = glm::ortho(-10.0f, 10.0f, -10.0f, 10.0f, nearPlane, farPlane);
+        return lightProjection * lightView;
+    }
+}
+
+#endif /* LightSpace_hpp */
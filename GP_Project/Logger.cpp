@@ -0,0 +1,170 @@
+#include "Logger.hpp"
+#include "Profiler.hpp"
+
+#include <cstdarg>
+#include <cstdio>
+#include <cstring>
+#include <thread>
+
+namespace gps {
+
+    namespace {
+
+        struct LogSlot {
+            //Vyukov's bounded queue: equals the position when free, position + 1 when written
+            std::atomic<size_t> sequence;
+            LogLevel level;
+            char text[Logger::MESSAGE_SIZE];
+        };
+
+        const size_t RING_MASK = Logger::CAPACITY - 1;
+        static_assert((Logger::CAPACITY & (Logger::CAPACITY - 1)) == 0, "the ring capacity has to be a power of two");
+
+        LogSlot ring[Logger::CAPACITY];
+        std::atomic<size_t> enqueuePosition(0);
+        //only the writer thread (or Stop) moves it
+        size_t dequeuePosition = 0;
+        std::atomic<int> droppedMessages(0);
+        std::atomic<bool> running(false);
+        std::thread writerThread;
+
+        struct RingInitializer {
+            RingInitializer() {
+                for (size_t i = 0; i < Logger::CAPACITY; i++) {
+                    ring[i].sequence.store(i, std::memory_order_relaxed);
+                }
+            }
+        } ringInitializer;
+
+        const char* levelName(LogLevel level) {
+
+            switch (level) {
+            case LOG_LEVEL_DEBUG: return "debug";
+            case LOG_LEVEL_INFO: return "info";
+            case LOG_LEVEL_WARNING: return "warning";
+            default: return "error";
+            }
+        }
+
+        //writes whatever is queued, returns the number of messages written
+        int drain() {
+
+            uint64_t start = Profiler::IsCapturing() ? Profiler::Now() : 0;
+            int written = 0;
+            bool wroteErrors = false;
+            for (;;) {
+                LogSlot& slot = ring[dequeuePosition & RING_MASK];
+                size_t sequence = slot.sequence.load(std::memory_order_acquire);
+                if (sequence != dequeuePosition + 1) {
+                    break;
+                }
+
+                FILE* stream = slot.level >= LOG_LEVEL_WARNING ? stderr : stdout;
+                wroteErrors = wroteErrors || stream == stderr;
+                fprintf(stream, "[%s] %s\n", levelName(slot.level), slot.text);
+
+                slot.sequence.store(dequeuePosition + Logger::CAPACITY, std::memory_order_release);
+                dequeuePosition++;
+                written++;
+            }
+
+            int dropped = droppedMessages.exchange(0);
+            if (dropped > 0) {
+                fprintf(stderr, "[warning] %d log messages dropped, the ring was full\n", dropped);
+                wroteErrors = true;
+            }
+            //one flush per batch instead of one per line
+            if (written > 0) {
+                fflush(stdout);
+            }
+            if (wroteErrors) {
+                fflush(stderr);
+            }
+            //the writer polls every few milliseconds, only the batches that wrote something show up
+            if (start != 0 && written > 0 && Profiler::IsCapturing()) {
+                Profiler::Record("log drain", start, Profiler::Now());
+            }
+            return written;
+        }
+
+        void writerLoop() {
+
+            Profiler::SetThreadName("logger");
+            while (running.load(std::memory_order_acquire)) {
+                if (drain() == 0) {
+                    std::this_thread::sleep_for(std::chrono::milliseconds(5));
+                }
+            }
+            drain();
+        }
+    }
+
+    std::atomic<int> Logger::minimumLevel(LOG_LEVEL_INFO);
+
+    void Logger::Start() {
+
+        if (running.exchange(true)) {
+            return;
+        }
+        writerThread = std::thread(writerLoop);
+    }
+
+    void Logger::Stop() {
+
+        //without a writer thread the caller drains the ring itself
+        if (!running.exchange(false)) {
+            drain();
+            return;
+        }
+        writerThread.join();
+    }
+
+    void Logger::SetLevel(LogLevel level) {
+
+        minimumLevel.store(level, std::memory_order_relaxed);
+    }
+
+    void Logger::Write(LogLevel level, const char* format, ...) {
+
+        //claim a slot, or give up right away when the writer is behind
+        size_t position = enqueuePosition.load(std::memory_order_relaxed);
+        LogSlot* slot;
+        for (;;) {
+            slot = &ring[position & RING_MASK];
+            size_t sequence = slot->sequence.load(std::memory_order_acquire);
+            intptr_t difference = (intptr_t)sequence - (intptr_t)position;
+            if (difference == 0) {
+                if (enqueuePosition.compare_exchange_weak(position, position + 1, std::memory_order_relaxed)) {
+                    break;
+                }
+            }
+            else if (difference < 0) {
+                droppedMessages.fetch_add(1, std::memory_order_relaxed);
+                return;
+            }
+            else {
+                position = enqueuePosition.load(std::memory_order_relaxed);
+            }
+        }
+
+        slot->level = level;
+        va_list arguments;
+        va_start(arguments, format);
+        vsnprintf(slot->text, sizeof(slot->text), format, arguments);
+        va_end(arguments);
+        slot->sequence.store(position + 1, std::memory_order_release);
+    }
+
+    bool Logger::RateLimit(std::atomic<int64_t>& lastTime, double seconds) {
+
+        int64_t now = std::chrono::duration_cast<std::chrono::microseconds>(
+            std::chrono::steady_clock::now().time_since_epoch()).count();
+        int64_t interval = (int64_t)(seconds * 1e6);
+        int64_t last = lastTime.load(std::memory_order_relaxed);
+        if (last != INT64_MIN && now - last < interval) {
+            return false;
+        }
+        //only one of several threads racing here gets to log
+        return lastTime.compare_exchange_strong(last, now, std::memory_order_relaxed);
+    }
+}
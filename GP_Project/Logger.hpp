@@ -0,0 +1,58 @@
+#ifndef Logger_hpp
+#define Logger_hpp
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+
+namespace gps {
+
+    enum LogLevel { LOG_LEVEL_DEBUG, LOG_LEVEL_INFO, LOG_LEVEL_WARNING, LOG_LEVEL_ERROR, LOG_LEVEL_OFF };
+
+    //Asynchronous logger
+    //messages are formatted on the calling thread into a fixed size lock-free ring
+    //(bounded multi-producer queue) and written to the console by a background thread,
+    //so logging never waits on the terminal; when the ring is full messages are dropped
+    //and counted instead of blocking the caller
+    class Logger {
+
+    public:
+        static const int CAPACITY = 1024;
+        //longer messages are truncated
+        static const int MESSAGE_SIZE = 512;
+
+        //starts the writer thread; messages logged before are kept in the ring
+        static void Start();
+        //writes everything still queued and stops the writer thread
+        static void Stop();
+        static void SetLevel(LogLevel level);
+        static bool IsEnabled(LogLevel level) {
+            return level >= minimumLevel.load(std::memory_order_relaxed);
+        }
+        //printf style
+        static void Write(LogLevel level, const char* format, ...);
+        //true at most once every interval for a given timestamp, used by LOG_EVERY
+        static bool RateLimit(std::atomic<int64_t>& lastTime, double seconds);
+
+    private:
+        static std::atomic<int> minimumLevel;
+    };
+}
+
+//the arguments are not evaluated when the level is disabled
+#define LOG_AT(level, ...) \
+    do { if (gps::Logger::IsEnabled(level)) gps::Logger::Write(level, __VA_ARGS__); } while (0)
+#define LOG_DEBUG(...) LOG_AT(gps::LOG_LEVEL_DEBUG, __VA_ARGS__)
+#define LOG_INFO(...) LOG_AT(gps::LOG_LEVEL_INFO, __VA_ARGS__)
+#define LOG_WARNING(...) LOG_AT(gps::LOG_LEVEL_WARNING, __VA_ARGS__)
+#define LOG_ERROR(...) LOG_AT(gps::LOG_LEVEL_ERROR, __VA_ARGS__)
+
+//for per-frame messages: logs from this call site at most once every `seconds`
+#define LOG_EVERY(level, seconds, ...) \
+    do { \
+        static std::atomic<int64_t> logLastTime(INT64_MIN); \
+        if (gps::Logger::IsEnabled(level) && gps::Logger::RateLimit(logLastTime, seconds)) \
+            gps::Logger::Write(level, __VA_ARGS__); \
+    } while (0)
+
+#endif /* Logger_hpp */
@@ -1,12 +1,49 @@
 #include "Mesh.hpp"
+#include "RenderStats.hpp"
+#include "GLTraceHooks.hpp"
+
 namespace gps {
 
 	/* Mesh Constructor */
 	Mesh::Mesh(std::vector<Vertex> vertices, std::vector<GLuint> indices, std::vector<Texture> textures) {
 
+		Material material;
+		material.ambient = glm::vec3(1.0f);
+		material.diffuse = glm::vec3(1.0f);
+		material.specular = glm::vec3(1.0f);
+
+		this->vertices = vertices;
+		this->indices = indices;
+		this->textures = textures;
+		this->material = material;
+		this->hasTexCoords = true;
+		this->buffers.VBO = 0;
+		this->buffers.EBO = 0;
+
+		this->setupMesh();
+	}
+
+	Mesh::Mesh(std::vector<Vertex> vertices, std::vector<GLuint> indices, std::vector<Texture> textures, Material material, bool hasTexCoords) {
+
 		this->vertices = vertices;
 		this->indices = indices;
 		this->textures = textures;
+		this->material = material;
+		this->hasTexCoords = hasTexCoords;
+		this->buffers.VBO = 0;
+		this->buffers.EBO = 0;
+
+		this->setupMesh();
+	}
+
+	Mesh::Mesh(std::vector<Vertex> vertices, std::vector<GLuint> indices, std::vector<Texture> textures, Material material, bool hasTexCoords, Buffers buffers) {
+
+		this->vertices = vertices;
+		this->indices = indices;
+		this->textures = textures;
+		this->material = material;
+		this->hasTexCoords = hasTexCoords;
+		this->buffers = buffers;
 
 		this->setupMesh();
 	}
@@ -18,43 +55,73 @@ namespace gps {
 	/* Mesh drawing function - also applies associated textures */
 	void Mesh::Draw(gps::Shader shader)	{
 
+		// the smallest permutation that covers this mesh, dead texture lookups are compiled out
+		if (shader.hasPermutations()) {
+			shader = shader.getMaterialPermutation(this->materialFeatures);
+		}
 		shader.useShaderProgram();
+		RenderStats::Uniform3fv(glGetUniformLocation(shader.shaderProgram, "materialDiffuse"), 1, &this->material.diffuse[0]);
 
 		//set textures
 		for (GLuint i = 0; i < textures.size(); i++) {
 
 			glActiveTexture(GL_TEXTURE0 + i);
-			glUniform1i(glGetUniformLocation(shader.shaderProgram, this->textures[i].type.c_str()), i);
-			glBindTexture(GL_TEXTURE_2D, this->textures[i].id);
+			RenderStats::Uniform1i(glGetUniformLocation(shader.shaderProgram, this->textures[i].type.c_str()), i);
+			RenderStats::BindTexture(GL_TEXTURE_2D, this->textures[i].id);
 		}
 
-		glBindVertexArray(this->buffers.VAO);
-		glDrawElements(GL_TRIANGLES, (GLsizei)this->indices.size(), GL_UNSIGNED_INT, 0);
-		glBindVertexArray(0);
+		RenderStats::BindVertexArray(this->buffers.VAO);
+		RenderStats::DrawElements(GL_TRIANGLES, (GLsizei)this->indices.size(), GL_UNSIGNED_INT, 0);
+		RenderStats::BindVertexArray(0);
 
         for(GLuint i = 0; i < this->textures.size(); i++) {
 
             glActiveTexture(GL_TEXTURE0 + i);
-            glBindTexture(GL_TEXTURE_2D, 0);
+            RenderStats::BindTexture(GL_TEXTURE_2D, 0);
         }
 
     }
 
+	unsigned int Mesh::getMaterialFeatures() {
+		return this->materialFeatures;
+	}
+
 	// Initializes all the buffer objects/arrays
 	void Mesh::setupMesh() {
 
-		// Create buffers/arrays
-		glGenVertexArrays(1, &this->buffers.VAO);
-		glGenBuffers(1, &this->buffers.VBO);
-		glGenBuffers(1, &this->buffers.EBO);
+		// Textures can only be sampled when the mesh has texture coordinates
+		this->materialFeatures = 0;
+		if (this->hasTexCoords) {
+			this->materialFeatures |= FEATURE_TEXCOORDS;
+			for (size_t i = 0; i < this->textures.size(); i++) {
+				if (this->textures[i].type == "diffuseTexture") {
+					this->materialFeatures |= FEATURE_DIFFUSE_TEXTURE;
+				}
+				else if (this->textures[i].type == "specularTexture") {
+					this->materialFeatures |= FEATURE_SPECULAR_TEXTURE;
+				}
+			}
+		}
 
+		// Create buffers/arrays, the buffers only when nobody filled them yet
+		glGenVertexArrays(1, &this->buffers.VAO);
 		glBindVertexArray(this->buffers.VAO);
-		// Load data into vertex buffers
-		glBindBuffer(GL_ARRAY_BUFFER, this->buffers.VBO);
-		glBufferData(GL_ARRAY_BUFFER, this->vertices.size() * sizeof(Vertex), &this->vertices[0], GL_STATIC_DRAW);
 
-		glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, this->buffers.EBO);
-		glBufferData(GL_ELEMENT_ARRAY_BUFFER, this->indices.size() * sizeof(GLuint), &this->indices[0], GL_STATIC_DRAW);
+		if (this->buffers.VBO == 0) {
+			glGenBuffers(1, &this->buffers.VBO);
+			glGenBuffers(1, &this->buffers.EBO);
+
+			// Load data into vertex buffers
+			glBindBuffer(GL_ARRAY_BUFFER, this->buffers.VBO);
+			glBufferData(GL_ARRAY_BUFFER, this->vertices.size() * sizeof(Vertex), &this->vertices[0], GL_STATIC_DRAW);
+
+			glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, this->buffers.EBO);
+			glBufferData(GL_ELEMENT_ARRAY_BUFFER, this->indices.size() * sizeof(GLuint), &this->indices[0], GL_STATIC_DRAW);
+		}
+		else {
+			glBindBuffer(GL_ARRAY_BUFFER, this->buffers.VBO);
+			glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, this->buffers.EBO);
+		}
 
 		// Set the vertex attribute pointers
 		// Vertex Positions
@@ -63,9 +130,11 @@ namespace gps {
 		// Vertex Normals
 		glEnableVertexAttribArray(1);
 		glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, sizeof(Vertex), (GLvoid*)offsetof(Vertex, Normal));
-		// Vertex Texture Coords
-		glEnableVertexAttribArray(2);
-		glVertexAttribPointer(2, 2, GL_FLOAT, GL_FALSE, sizeof(Vertex), (GLvoid*)offsetof(Vertex, TexCoords));
+		// Vertex Texture Coords, left disabled when the model has none
+		if (this->hasTexCoords) {
+			glEnableVertexAttribArray(2);
+			glVertexAttribPointer(2, 2, GL_FLOAT, GL_FALSE, sizeof(Vertex), (GLvoid*)offsetof(Vertex, TexCoords));
+		}
 
 		glBindVertexArray(0);
 	}
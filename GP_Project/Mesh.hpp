@@ -56,13 +56,25 @@ namespace gps {
 
 	    Mesh(std::vector<Vertex> vertices, std::vector<GLuint> indices, std::vector<Texture> textures);
 
+	    Mesh(std::vector<Vertex> vertices, std::vector<GLuint> indices, std::vector<Texture> textures, Material material, bool hasTexCoords);
+
+	    // The vertex and index buffers are already filled (by the upload thread), only the vertex array is created
+	    Mesh(std::vector<Vertex> vertices, std::vector<GLuint> indices, std::vector<Texture> textures, Material material, bool hasTexCoords, Buffers buffers);
+
 	    Buffers getBuffers();
 
+	    // Shaders with permutations are switched to the one matching this mesh's material
 	    void Draw(gps::Shader shader);
 
+	    // gps::MaterialFeature bits describing the textures and the vertex format
+	    unsigned int getMaterialFeatures();
+
     private:
         /*  Render data  */
         Buffers buffers;
+        Material material;
+        bool hasTexCoords;
+        unsigned int materialFeatures;
 
 	    // 
         // ializes all the buffer objects/arrays
@@ -1,16 +1,136 @@
 #include "Model3D.hpp"
+#include "JobSystem.hpp"
+#include "Logger.hpp"
+#include "Profiler.hpp"
+#include "UploadThread.hpp"
 
 namespace gps {
 
+	Model3D::Model3D() : ready(false) {
+	}
+
 	void Model3D::LoadModel(std::string fileName) {
 
         std::string basePath = fileName.substr(0, fileName.find_last_of('/')) + "/";
-		ReadOBJ(fileName, basePath);
+		LoadModel(fileName, basePath);
 	}
 
     void Model3D::LoadModel(std::string fileName, std::string basePath)	{
 
-		ReadOBJ(fileName, basePath);
+		if (!ParseModel(fileName, basePath)) {
+
+			// the message above is still queued
+			gps::Logger::Stop();
+			exit(1);
+		}
+		UploadModel();
+	}
+
+	bool Model3D::ParseModel(std::string fileName) {
+
+        std::string basePath = fileName.substr(0, fileName.find_last_of('/')) + "/";
+		return ParseModel(fileName, basePath);
+	}
+
+	bool Model3D::ParseModel(std::string fileName, std::string basePath) {
+
+		if (!ReadOBJ(fileName, basePath)) {
+
+			return false;
+		}
+
+		// Every image on its own job, the large ones take far longer than the parsing
+		JobSystem::ParallelFor((int)parsedTextures.size(), 1, [this](int begin, int end) {
+
+			for (int i = begin; i < end; i++)
+				DecodeTexture(parsedTextures[i]);
+		});
+		return true;
+	}
+
+	void Model3D::UploadModel() {
+
+		PROFILE_FUNCTION();
+		UploadData();
+		CreateMeshes();
+	}
+
+	gps::Task<bool> Model3D::LoadModelAsync(std::string fileName, gps::UploadThread& uploader, gps::LoadToken token) {
+
+		const int parseStep = 1;
+		const int uploadStep = 1;
+		token.AddSteps(parseStep + uploadStep);
+		co_await gps::ResumeOnJobs();
+		if (token.IsCancelled() || !ParseModel(fileName)) {
+
+			token.FinishSteps(parseStep + uploadStep);
+			co_return false;
+		}
+		token.FinishSteps(parseStep);
+		if (token.IsCancelled()) {
+
+			std::vector<ParsedMesh>().swap(parsedMeshes);
+			std::vector<ParsedTexture>().swap(parsedTextures);
+			token.FinishSteps(uploadStep);
+			co_return false;
+		}
+
+		co_await uploader.Upload([this]() { UploadData(); });
+		CreateMeshes();
+		token.FinishSteps(uploadStep);
+		co_return true;
+	}
+
+	bool Model3D::IsReady() const {
+
+		return ready;
+	}
+
+	void Model3D::UploadData() {
+
+		PROFILE_FUNCTION();
+		for (size_t i = 0; i < parsedTextures.size(); i++) {
+
+			gps::Texture texture;
+			texture.id = UploadTexture(parsedTextures[i]);
+			texture.type = parsedTextures[i].type;
+			texture.path = parsedTextures[i].path;
+			loadedTextures.push_back(texture);
+		}
+
+		// Bound to a target no vertex array state refers to, there is none on the upload context
+		for (size_t m = 0; m < parsedMeshes.size(); m++) {
+
+			ParsedMesh& parsed = parsedMeshes[m];
+			gps::Buffers buffers;
+			buffers.VAO = 0;
+			glGenBuffers(1, &buffers.VBO);
+			glBindBuffer(GL_COPY_WRITE_BUFFER, buffers.VBO);
+			glBufferData(GL_COPY_WRITE_BUFFER, parsed.vertices.size() * sizeof(gps::Vertex), parsed.vertices.data(), GL_STATIC_DRAW);
+			glGenBuffers(1, &buffers.EBO);
+			glBindBuffer(GL_COPY_WRITE_BUFFER, buffers.EBO);
+			glBufferData(GL_COPY_WRITE_BUFFER, parsed.indices.size() * sizeof(GLuint), parsed.indices.data(), GL_STATIC_DRAW);
+			uploadedBuffers.push_back(buffers);
+		}
+		glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+	}
+
+	void Model3D::CreateMeshes() {
+
+		PROFILE_FUNCTION();
+		for (size_t m = 0; m < parsedMeshes.size(); m++) {
+
+			ParsedMesh& parsed = parsedMeshes[m];
+			std::vector<gps::Texture> textures;
+			for (size_t t = 0; t < parsed.textures.size(); t++)
+				textures.push_back(loadedTextures[parsed.textures[t]]);
+			meshes.push_back(gps::Mesh(parsed.vertices, parsed.indices, textures, parsed.material, parsed.hasTexCoords, uploadedBuffers[m]));
+		}
+
+		std::vector<ParsedMesh>().swap(parsedMeshes);
+		std::vector<ParsedTexture>().swap(parsedTextures);
+		std::vector<gps::Buffers>().swap(uploadedBuffers);
+		ready = true;
 	}
 
 	// Draw each mesh from the model
@@ -20,10 +140,16 @@ namespace gps {
 			meshes[i].Draw(shaderProgram);
 	}
 
-	// Does the parsing of the .obj file and fills in the data structure
-	void Model3D::ReadOBJ(std::string fileName, std::string basePath) {
+	glm::vec4 Model3D::GetBoundingSphere() {
+
+		return boundingSphere;
+	}
 
-        std::cout << "Loading : " << fileName << std::endl;
+	// Does the parsing of the .obj file and fills in the parsed meshes
+	bool Model3D::ReadOBJ(std::string fileName, std::string basePath) {
+
+		PROFILE_FUNCTION();
+        LOG_INFO("Loading : %s", fileName.c_str());
 		tinyobj::attrib_t attrib;
 		std::vector<tinyobj::shape_t> shapes;
 		std::vector<tinyobj::material_t> materials;
@@ -35,70 +161,43 @@ namespace gps {
 		if (!err.empty()) {
 
 			// `err` may contain warning message.
-			std::cerr << err << std::endl;
+			LOG_WARNING("%s", err.c_str());
 		}
 
 		if (!ret) {
 
-			exit(1);
+			LOG_ERROR("could not load %s", fileName.c_str());
+			return false;
 		}
 
-		std::cout << "# of shapes    : " << shapes.size() << std::endl;
-		std::cout << "# of materials : " << materials.size() << std::endl;
-
-		// Loop over shapes
-		for (size_t s = 0; s < shapes.size(); s++) {
-
-			std::vector<gps::Vertex> vertices;
-			std::vector<GLuint> indices;
-			std::vector<gps::Texture> textures;
+		LOG_INFO("# of shapes    : %d", (int)shapes.size());
+		LOG_INFO("# of materials : %d", (int)materials.size());
 
-			// Loop over faces(polygon)
-			size_t index_offset = 0;
-			for (size_t f = 0; f < shapes[s].mesh.num_face_vertices.size(); f++) {
+		// Sphere around the axis aligned bounding box of all the positions
+		glm::vec3 minBounds(0.0f);
+		glm::vec3 maxBounds(0.0f);
 
-				int fv = shapes[s].mesh.num_face_vertices[f];
-
-				//gps::Texture currentTexture = LoadTexture("index1.png", "ambientTexture");
-				//textures.push_back(currentTexture);
-
-				// Loop over vertices in the face.
-				for (size_t v = 0; v < fv; v++) {
-
-					// access to vertex
-					tinyobj::index_t idx = shapes[s].mesh.indices[index_offset + v];
-
-					float vx = attrib.vertices[3 * idx.vertex_index + 0];
-					float vy = attrib.vertices[3 * idx.vertex_index + 1];
-					float vz = attrib.vertices[3 * idx.vertex_index + 2];
-					float nx = attrib.normals[3 * idx.normal_index + 0];
-					float ny = attrib.normals[3 * idx.normal_index + 1];
-					float nz = attrib.normals[3 * idx.normal_index + 2];
-					float tx = 0.0f;
-					float ty = 0.0f;
-
-					if (idx.texcoord_index != -1) {
-
-						tx = attrib.texcoords[2 * idx.texcoord_index + 0];
-						ty = attrib.texcoords[2 * idx.texcoord_index + 1];
-					}
+		for (size_t i = 0; i + 2 < attrib.vertices.size(); i += 3) {
 
-					glm::vec3 vertexPosition(vx, vy, vz);
-					glm::vec3 vertexNormal(nx, ny, nz);
-					glm::vec2 vertexTexCoords(tx, ty);
+			glm::vec3 position(attrib.vertices[i], attrib.vertices[i + 1], attrib.vertices[i + 2]);
+			minBounds = i == 0 ? position : glm::min(minBounds, position);
+			maxBounds = i == 0 ? position : glm::max(maxBounds, position);
+		}
 
-					gps::Vertex currentVertex;
-					currentVertex.Position = vertexPosition;
-					currentVertex.Normal = vertexNormal;
-					currentVertex.TexCoords = vertexTexCoords;
+		glm::vec3 center = (minBounds + maxBounds) * 0.5f;
+		boundingSphere = glm::vec4(center, glm::length(maxBounds - center));
 
-					vertices.push_back(currentVertex);
+		// Loop over shapes
+		for (size_t s = 0; s < shapes.size(); s++) {
 
-					indices.push_back((GLuint)(index_offset + v));
-				}
+			ParsedMesh parsed;
+			parsed.hasTexCoords = AssembleShape(attrib, shapes[s], parsed.vertices, parsed.indices);
 
-				index_offset += fv;
-			}
+			// Material used when the .mtl file does not provide one
+			gps::Material currentMaterial;
+			currentMaterial.ambient = glm::vec3(1.0f);
+			currentMaterial.diffuse = glm::vec3(1.0f);
+			currentMaterial.specular = glm::vec3(1.0f);
 
 			// get material id
 			// Only try to read materials if the .mtl file is present
@@ -109,7 +208,6 @@ namespace gps {
 				materialId = shapes[s].mesh.material_ids[0];
 				if (materialId != -1) {
 
-					gps::Material currentMaterial;
 					currentMaterial.ambient = glm::vec3(materials[materialId].ambient[0], materials[materialId].ambient[1], materials[materialId].ambient[2]);
 					currentMaterial.diffuse = glm::vec3(materials[materialId].diffuse[0], materials[materialId].diffuse[1], materials[materialId].diffuse[2]);
 					currentMaterial.specular = glm::vec3(materials[materialId].specular[0], materials[materialId].specular[1], materials[materialId].specular[2]);
@@ -119,9 +217,7 @@ namespace gps {
 
 					if (!ambientTexturePath.empty()) {
 
-						gps::Texture currentTexture;
-						currentTexture = LoadTexture(basePath + ambientTexturePath, "ambientTexture");
-						textures.push_back(currentTexture);
+						parsed.textures.push_back(LoadTexture(basePath + ambientTexturePath, "ambientTexture"));
 					}
 
 					//diffuse texture
@@ -129,9 +225,7 @@ namespace gps {
 
 					if (!diffuseTexturePath.empty()) {
 
-						gps::Texture currentTexture;
-						currentTexture = LoadTexture(basePath + diffuseTexturePath, "diffuseTexture");
-						textures.push_back(currentTexture);
+						parsed.textures.push_back(LoadTexture(basePath + diffuseTexturePath, "diffuseTexture"));
 					}
 
 					//specular texture
@@ -139,76 +233,129 @@ namespace gps {
 
 					if (!specularTexturePath.empty()) {
 
-						gps::Texture currentTexture;
-						currentTexture = LoadTexture(basePath + specularTexturePath, "specularTexture");
-						textures.push_back(currentTexture);
+						parsed.textures.push_back(LoadTexture(basePath + specularTexturePath, "specularTexture"));
 					}
 				}
 			}
 
-			meshes.push_back(gps::Mesh(vertices, indices, textures));
+			parsed.material = currentMaterial;
+			parsedMeshes.push_back(parsed);
 		}
+
+		return true;
 	}
 
-	// Retrieves a texture associated with the object - by its name and type
-	gps::Texture Model3D::LoadTexture(std::string path, std::string type) {
+	// Unindexed vertices of a shape, one per face corner, in the order of the faces
+	bool Model3D::AssembleShape(const tinyobj::attrib_t& attrib, const tinyobj::shape_t& shape, std::vector<gps::Vertex>& vertices, std::vector<GLuint>& indices) {
+
+		bool hasTexCoords = false;
+
+		// Loop over faces(polygon)
+		size_t index_offset = 0;
+		for (size_t f = 0; f < shape.mesh.num_face_vertices.size(); f++) {
+
+			int fv = shape.mesh.num_face_vertices[f];
+
+			//gps::Texture currentTexture = LoadTexture("index1.png", "ambientTexture");
+			//textures.push_back(currentTexture);
+
+			// Loop over vertices in the face.
+			for (size_t v = 0; v < fv; v++) {
+
+				// access to vertex
+				tinyobj::index_t idx = shape.mesh.indices[index_offset + v];
+
+				float vx = attrib.vertices[3 * idx.vertex_index + 0];
+				float vy = attrib.vertices[3 * idx.vertex_index + 1];
+				float vz = attrib.vertices[3 * idx.vertex_index + 2];
+				float nx = attrib.normals[3 * idx.normal_index + 0];
+				float ny = attrib.normals[3 * idx.normal_index + 1];
+				float nz = attrib.normals[3 * idx.normal_index + 2];
+				float tx = 0.0f;
+				float ty = 0.0f;
+
+				if (idx.texcoord_index != -1) {
+
+					hasTexCoords = true;
+					tx = attrib.texcoords[2 * idx.texcoord_index + 0];
+					ty = attrib.texcoords[2 * idx.texcoord_index + 1];
+				}
 
-			for (int i = 0; i < loadedTextures.size(); i++) {
+				glm::vec3 vertexPosition(vx, vy, vz);
+				glm::vec3 vertexNormal(nx, ny, nz);
+				glm::vec2 vertexTexCoords(tx, ty);
 
-				if (loadedTextures[i].path == path)	{
+				gps::Vertex currentVertex;
+				currentVertex.Position = vertexPosition;
+				currentVertex.Normal = vertexNormal;
+				currentVertex.TexCoords = vertexTexCoords;
+
+				vertices.push_back(currentVertex);
+
+				indices.push_back((GLuint)(index_offset + v));
+			}
+
+			index_offset += fv;
+		}
+
+		return hasTexCoords;
+	}
+
+	// Retrieves a texture associated with the object - by its name and type; decoded later, in ParseModel
+	int Model3D::LoadTexture(std::string path, std::string type) {
+
+			for (int i = 0; i < parsedTextures.size(); i++) {
+
+				if (parsedTextures[i].path == path)	{
 
 					//already loaded texture
-					return loadedTextures[i];
+					return i;
 				}
 			}
 
-			gps::Texture currentTexture;
-			currentTexture.id = ReadTextureFromFile(path.c_str());
-			currentTexture.type = std::string(type);
+			ParsedTexture currentTexture;
 			currentTexture.path = path;
+			currentTexture.type = std::string(type);
+			currentTexture.width = 0;
+			currentTexture.height = 0;
 
-			loadedTextures.push_back(currentTexture);
+			parsedTextures.push_back(currentTexture);
 
-			return currentTexture;
+			return (int)parsedTextures.size() - 1;
 		}
 
-	// Reads the pixel data from an image file and loads it into the video memory
-	GLuint Model3D::ReadTextureFromFile(const char* file_name) {
+	// Reads the pixel data from an image file, bottom row first
+	void Model3D::DecodeTexture(ParsedTexture& texture) {
 
+		PROFILE_FUNCTION();
+		const char* file_name = texture.path.c_str();
 		int x, y, n;
 		int force_channels = 4;
 		unsigned char* image_data = stbi_load(file_name, &x, &y, &n, force_channels);
 
 		if (!image_data) {
-			fprintf(stderr, "ERROR: could not load %s\n", file_name);
-			return false;
+			LOG_ERROR("could not load %s", file_name);
+			return;
 		}
 		// NPOT check
 		if ((x & (x - 1)) != 0 || (y & (y - 1)) != 0) {
-			fprintf(
-				stderr, "WARNING: texture %s is not power-of-2 dimensions\n", file_name
-			);
+			LOG_WARNING("texture %s is not power-of-2 dimensions", file_name);
 		}
 
-		int width_in_bytes = x * 4;
-		unsigned char *top = NULL;
-		unsigned char *bottom = NULL;
-		unsigned char temp = 0;
-		int half_height = y / 2;
-
-		for (int row = 0; row < half_height; row++) {
+		FlipRows(image_data, x, y, force_channels);
 
-			top = image_data + row * width_in_bytes;
-			bottom = image_data + (y - row - 1) * width_in_bytes;
+		texture.width = x;
+		texture.height = y;
+		texture.pixels.assign(image_data, image_data + (size_t)x * y * force_channels);
+		stbi_image_free(image_data);
+	}
 
-			for (int col = 0; col < width_in_bytes; col++) {
+	// Loads the pixel data into the video memory
+	GLuint Model3D::UploadTexture(const ParsedTexture& texture) {
 
-				temp = *top;
-				*top = *bottom;
-				*bottom = temp;
-				top++;
-				bottom++;
-			}
+		PROFILE_FUNCTION();
+		if (texture.pixels.empty()) {
+			return 0;
 		}
 
 		GLuint textureID;
@@ -218,12 +365,12 @@ namespace gps {
 			GL_TEXTURE_2D,
 			0,
 			GL_SRGB, //GL_SRGB,//GL_RGBA,
-			x,
-			y,
+			texture.width,
+			texture.height,
 			0,
 			GL_RGBA,
 			GL_UNSIGNED_BYTE,
-			image_data
+			texture.pixels.data()
 		);
 		glGenerateMipmap(GL_TEXTURE_2D);
 
@@ -253,4 +400,29 @@ namespace gps {
             glDeleteVertexArrays(1, &VAO);
         }
 	}
+
+	// Swaps the rows of an image in place, images are stored top row first and OpenGL expects the bottom one
+	void Model3D::FlipRows(unsigned char* pixels, int width, int height, int channels) {
+
+		int width_in_bytes = width * channels;
+		unsigned char *top = NULL;
+		unsigned char *bottom = NULL;
+		unsigned char temp = 0;
+		int half_height = height / 2;
+
+		for (int row = 0; row < half_height; row++) {
+
+			top = pixels + row * width_in_bytes;
+			bottom = pixels + (height - row - 1) * width_in_bytes;
+
+			for (int col = 0; col < width_in_bytes; col++) {
+
+				temp = *top;
+				*top = *bottom;
+				*bottom = temp;
+				top++;
+				bottom++;
+			}
+		}
+	}
 }
@@ -2,41 +2,111 @@
 #define Model3D_hpp
 
 #include "Mesh.hpp"
+#include "Task.hpp"
 
 #include "tiny_obj_loader.h"
 #include "stb_image.h"
 
+#include <atomic>
 #include <iostream>
 #include <string>
 #include <vector>
 
 namespace gps {
 
+    class UploadThread;
+
     class Model3D {
 
     public:
+        Model3D();
+
         ~Model3D();
 
 		void LoadModel(std::string fileName);
 
 		void LoadModel(std::string fileName, std::string basePath);
 
+		// The CPU half of LoadModel: parses the .obj file and decodes the textures, without touching GL,
+		// so it can run on any thread (the textures are decoded on the job system); false when the file can't be read
+		bool ParseModel(std::string fileName);
+
+		bool ParseModel(std::string fileName, std::string basePath);
+
+		// The GL half of LoadModel, on the thread of the context: creates the meshes and the textures of the parsed model
+		void UploadModel();
+
+		// LoadModel as a coroutine: the file is parsed and its textures decoded on the job system, the buffers and
+		// the textures are filled on the upload thread, and the meshes are created on the render thread, in
+		// UploadThread::Collect, once the GPU has them; the model is ready from then on
+		// false when the file can't be read or token was cancelled first - nothing exits. Two steps of token's progress
+		gps::Task<bool> LoadModelAsync(std::string fileName, gps::UploadThread& uploader, gps::LoadToken token);
+
+		// Whether the meshes can be drawn; read on any thread
+		bool IsReady() const;
+
 		void Draw(gps::Shader shaderProgram);
 
+		// Bounding sphere in object space - xyz is the center, w the radius
+		glm::vec4 GetBoundingSphere();
+
+		// Unindexed vertices of a shape, one per face corner; returns whether it has texture coordinates
+		static bool AssembleShape(const tinyobj::attrib_t& attrib, const tinyobj::shape_t& shape, std::vector<gps::Vertex>& vertices, std::vector<GLuint>& indices);
+
+		// Turns an image stored top row first into the bottom row first order OpenGL expects
+		static void FlipRows(unsigned char* pixels, int width, int height, int channels);
+
     private:
+		// A mesh read from the .obj file, waiting for UploadModel
+		struct ParsedMesh {
+			std::vector<gps::Vertex> vertices;
+			std::vector<GLuint> indices;
+			// Indices into parsedTextures
+			std::vector<int> textures;
+			gps::Material material;
+			bool hasTexCoords;
+		};
+
+		// A decoded image, bottom row first, waiting for UploadModel
+		struct ParsedTexture {
+			std::string path;
+			std::string type;
+			int width;
+			int height;
+			// Empty when the file could not be decoded
+			std::vector<unsigned char> pixels;
+		};
+
 		// Component meshes - group of objects
         std::vector<gps::Mesh> meshes;
 		// Associated textures
         std::vector<gps::Texture> loadedTextures;
+		// Bounds of all the vertices read from the .obj file
+		glm::vec4 boundingSphere;
+
+		std::vector<ParsedMesh> parsedMeshes;
+		std::vector<ParsedTexture> parsedTextures;
+		// Vertex and index buffers of the parsed meshes, filled before their vertex arrays exist
+		std::vector<gps::Buffers> uploadedBuffers;
+		std::atomic<bool> ready;
+
+		// Does the parsing of the .obj file and fills in the parsed meshes
+		bool ReadOBJ(std::string fileName, std::string basePath);
+
+		// Retrieves a texture associated with the object - by its name and type; returns its index in parsedTextures
+		int LoadTexture(std::string path, std::string type);
+
+		// Reads the pixel data from an image file
+		static void DecodeTexture(ParsedTexture& texture);
 
-		// Does the parsing of the .obj file and fills in the data structure
-		void ReadOBJ(std::string fileName, std::string basePath);
+		// Loads the pixel data into the video memory
+		static GLuint UploadTexture(const ParsedTexture& texture);
 
-		// Retrieves a texture associated with the object - by its name and type
-		gps::Texture LoadTexture(std::string path, std::string type);
+		// The GL objects of the parsed model that contexts share: textures and buffers
+		void UploadData();
 
-		// Reads the pixel data from an image file and loads it into the video memory
-		GLuint ReadTextureFromFile(const char* file_name);
+		// The meshes of the uploaded data, on the thread that draws them (vertex arrays are not shared)
+		void CreateMeshes();
     };
 }
 
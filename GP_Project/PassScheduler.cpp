@@ -0,0 +1,86 @@
+#include "PassScheduler.hpp"
+
+namespace gps {
+
+    PassScheduler::PassScheduler() {
+
+        sunContribution = 1.0f;
+        lampContribution = 1.0f;
+        sunLevel = PASS_FULL;
+        lampLevel = PASS_FULL;
+        levelsChanged = true;
+        framesSinceSunShadows = DEGRADED_SHADOW_INTERVAL;
+    }
+
+    void PassScheduler::Update(glm::vec3 sunLightColor, glm::vec3 sunLightDir, float lampIntensity) {
+
+        //perceived brightness of the light times how directly it shines on the ground
+        float sunLuminance = glm::dot(sunLightColor, glm::vec3(0.2126f, 0.7152f, 0.0722f));
+        float sunElevation = glm::max(glm::normalize(sunLightDir).y, 0.0f);
+        sunContribution = sunLuminance * sunElevation;
+        lampContribution = glm::clamp(lampIntensity, 0.0f, 1.0f);
+
+        PassLevel newSunLevel = Classify(sunContribution);
+        PassLevel newLampLevel = Classify(lampContribution);
+        levelsChanged = newSunLevel != sunLevel || newLampLevel != lampLevel;
+        sunLevel = newSunLevel;
+        lampLevel = newLampLevel;
+
+        framesSinceSunShadows++;
+    }
+
+    PassLevel PassScheduler::GetSunLevel() {
+
+        return sunLevel;
+    }
+
+    PassLevel PassScheduler::GetLampLevel() {
+
+        return lampLevel;
+    }
+
+    float PassScheduler::GetSunContribution() {
+
+        return sunContribution;
+    }
+
+    float PassScheduler::GetLampContribution() {
+
+        return lampContribution;
+    }
+
+    bool PassScheduler::LevelsChanged() {
+
+        return levelsChanged;
+    }
+
+    bool PassScheduler::ShouldRenderSunShadows(bool shadowMapDirty) {
+
+        if (!shadowMapDirty || sunLevel == PASS_SKIPPED) {
+            return false;
+        }
+        if (sunLevel == PASS_DEGRADED && framesSinceSunShadows < DEGRADED_SHADOW_INTERVAL) {
+            return false;
+        }
+
+        framesSinceSunShadows = 0;
+        return true;
+    }
+
+    bool PassScheduler::ShouldRenderLampShadows() {
+
+        //degraded lamps still light the scene, but without shadow lookups
+        return lampLevel == PASS_FULL;
+    }
+
+    PassLevel PassScheduler::Classify(float contribution) {
+
+        if (contribution < SKIP_THRESHOLD) {
+            return PASS_SKIPPED;
+        }
+        if (contribution < DEGRADE_THRESHOLD) {
+            return PASS_DEGRADED;
+        }
+        return PASS_FULL;
+    }
+}
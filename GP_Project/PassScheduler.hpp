@@ -0,0 +1,50 @@
+#ifndef PassScheduler_hpp
+#define PassScheduler_hpp
+
+#include <glm/glm.hpp>
+
+namespace gps {
+
+    //How much work a light source gets this frame
+    enum PassLevel { PASS_SKIPPED, PASS_DEGRADED, PASS_FULL };
+
+    //Decides every frame which lighting passes are worth running
+    //the contribution of the sun (or the moon at night) and of the street lamps is
+    //estimated from their current color and position; lights that add (almost) nothing
+    //lose their shadow passes and get a cheaper basic.frag variant
+    class PassScheduler {
+
+    public:
+        //below these contributions a light is skipped / degraded
+        static constexpr float SKIP_THRESHOLD = 0.02f;
+        static constexpr float DEGRADE_THRESHOLD = 0.25f;
+        //a degraded sun refreshes its shadow map at most once every this many frames
+        static const int DEGRADED_SHADOW_INTERVAL = 8;
+
+        PassScheduler();
+        //sunLightDir is the world space direction towards the sun, lampIntensity in [0, 1]
+        void Update(glm::vec3 sunLightColor, glm::vec3 sunLightDir, float lampIntensity);
+        PassLevel GetSunLevel();
+        PassLevel GetLampLevel();
+        float GetSunContribution();
+        float GetLampContribution();
+        //true when the levels differ from the previous frame
+        bool LevelsChanged();
+        //whether a dirty sun shadow map should be redrawn this frame
+        bool ShouldRenderSunShadows(bool shadowMapDirty);
+        //whether the lamp shadow atlas is sampled (and therefore kept up to date)
+        bool ShouldRenderLampShadows();
+
+    private:
+        float sunContribution;
+        float lampContribution;
+        PassLevel sunLevel;
+        PassLevel lampLevel;
+        bool levelsChanged;
+        int framesSinceSunShadows;
+
+        PassLevel Classify(float contribution);
+    };
+}
+
+#endif /* PassScheduler_hpp */
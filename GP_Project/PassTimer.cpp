@@ -0,0 +1,267 @@
+#include "PassTimer.hpp"
+#include "GLTrace.hpp"
+#include "Logger.hpp"
+
+#include <fstream>
+
+namespace gps {
+
+    namespace {
+
+        double millisecondsSince(std::chrono::steady_clock::time_point start) {
+
+            return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+        }
+    }
+
+    PassTimer::PassTimer() {
+
+        for (int i = 0; i < FRAMES_IN_FLIGHT; i++) {
+            frames[i].frame = -1;
+        }
+        frameNumber = -1;
+        openPass = -1;
+        resultsFrame = -1;
+        droppedFrames = 0;
+    }
+
+    void PassTimer::Delete() {
+
+        for (int i = 0; i < FRAMES_IN_FLIGHT; i++) {
+            if (!frames[i].queryPool.empty()) {
+                glDeleteQueries((GLsizei)frames[i].queryPool.size(), frames[i].queryPool.data());
+            }
+            frames[i].queryPool.clear();
+            frames[i].entries.clear();
+            frames[i].frame = -1;
+        }
+    }
+
+    PassTimer::FrameQueries& PassTimer::CurrentFrame() {
+
+        return frames[frameNumber % FRAMES_IN_FLIGHT];
+    }
+
+    void PassTimer::BeginFrame() {
+
+        if (frameNumber >= 0) {
+            EndPass();
+            while (!openCpuScopes.empty()) {
+                EndCpuScope();
+            }
+        }
+
+        frameNumber++;
+        //the slot of this frame still holds the entries of FRAMES_IN_FLIGHT frames ago
+        FrameQueries& frameQueries = CurrentFrame();
+        if (frameQueries.frame >= 0 && !frameQueries.entries.empty()) {
+            Collect(frameQueries);
+        }
+        frameQueries.entries.clear();
+        frameQueries.frame = frameNumber;
+    }
+
+    void PassTimer::BeginPass(const char* name) {
+
+        if (frameNumber < 0) {
+            return;
+        }
+        EndPass();
+
+        FrameQueries& frameQueries = CurrentFrame();
+        int gpuPasses = 0;
+        for (size_t i = 0; i < frameQueries.entries.size(); i++) {
+            gpuPasses += frameQueries.entries[i].query != 0 ? 1 : 0;
+        }
+        if (gpuPasses == (int)frameQueries.queryPool.size()) {
+            GLuint query;
+            glGenQueries(1, &query);
+            frameQueries.queryPool.push_back(query);
+        }
+
+        Entry entry;
+        entry.name = name;
+        entry.query = frameQueries.queryPool[gpuPasses];
+        entry.cpuMilliseconds = 0.0;
+        glBeginQuery(GL_TIME_ELAPSED, entry.query);
+        entry.cpuStart = std::chrono::steady_clock::now();
+        frameQueries.entries.push_back(entry);
+        openPass = (int)frameQueries.entries.size() - 1;
+        //the passes are the call groups of a GL trace
+        GLTrace::BeginGroup(name);
+    }
+
+    void PassTimer::EndPass() {
+
+        if (openPass < 0) {
+            return;
+        }
+        Entry& entry = CurrentFrame().entries[openPass];
+        entry.cpuMilliseconds = millisecondsSince(entry.cpuStart);
+        glEndQuery(GL_TIME_ELAPSED);
+        openPass = -1;
+        GLTrace::EndGroup();
+    }
+
+    void PassTimer::BeginCpuScope(const char* name) {
+
+        if (frameNumber < 0) {
+            return;
+        }
+        Entry entry;
+        entry.name = name;
+        entry.query = 0;
+        entry.cpuMilliseconds = 0.0;
+        entry.cpuStart = std::chrono::steady_clock::now();
+        CurrentFrame().entries.push_back(entry);
+        openCpuScopes.push_back((int)CurrentFrame().entries.size() - 1);
+    }
+
+    void PassTimer::EndCpuScope() {
+
+        if (openCpuScopes.empty()) {
+            return;
+        }
+        Entry& entry = CurrentFrame().entries[openCpuScopes.back()];
+        entry.cpuMilliseconds = millisecondsSince(entry.cpuStart);
+        openCpuScopes.pop_back();
+    }
+
+    void PassTimer::Collect(FrameQueries& frameQueries) {
+
+        //queries finish in order, so the last one being ready means they all are
+        for (size_t i = frameQueries.entries.size(); i-- > 0;) {
+            if (frameQueries.entries[i].query == 0) {
+                continue;
+            }
+            GLint available = 0;
+            glGetQueryObjectiv(frameQueries.entries[i].query, GL_QUERY_RESULT_AVAILABLE, &available);
+            if (!available) {
+                droppedFrames++;
+                return;
+            }
+            break;
+        }
+
+        results.clear();
+        for (size_t i = 0; i < frameQueries.entries.size(); i++) {
+            const Entry& entry = frameQueries.entries[i];
+            GLuint64 nanoseconds = 0;
+            if (entry.query != 0) {
+                glGetQueryObjectui64v(entry.query, GL_QUERY_RESULT, &nanoseconds);
+            }
+            //a pass that runs several times a frame adds up
+            bool found = false;
+            for (size_t j = 0; j < results.size(); j++) {
+                if (results[j].name == entry.name) {
+                    results[j].gpuMilliseconds += nanoseconds / 1.0e6;
+                    results[j].cpuMilliseconds += entry.cpuMilliseconds;
+                    found = true;
+                    break;
+                }
+            }
+            if (!found) {
+                PassTime passTime = { entry.name, nanoseconds / 1.0e6, entry.cpuMilliseconds, entry.query != 0 };
+                results.push_back(passTime);
+            }
+        }
+        resultsFrame = frameQueries.frame;
+
+        UpdateAverages();
+        history.push_back(std::make_pair(resultsFrame, results));
+        if ((int)history.size() > HISTORY_FRAMES) {
+            history.pop_front();
+        }
+    }
+
+    void PassTimer::UpdateAverages() {
+
+        for (size_t i = 0; i < results.size(); i++) {
+            size_t j = 0;
+            while (j < averages.size() && averages[j].name != results[i].name) {
+                j++;
+            }
+            if (j == averages.size()) {
+                averages.push_back(results[i]);
+                continue;
+            }
+            averages[j].gpuMilliseconds += (results[i].gpuMilliseconds - averages[j].gpuMilliseconds) * AVERAGE_WEIGHT;
+            averages[j].cpuMilliseconds += (results[i].cpuMilliseconds - averages[j].cpuMilliseconds) * AVERAGE_WEIGHT;
+        }
+    }
+
+    const std::vector<PassTime>& PassTimer::GetResults() {
+
+        return results;
+    }
+
+    int PassTimer::GetResultsFrame() {
+
+        return resultsFrame;
+    }
+
+    int PassTimer::GetFrame() {
+
+        return frameNumber;
+    }
+
+    int PassTimer::GetDroppedFrames() {
+
+        return droppedFrames;
+    }
+
+    const std::vector<PassTime>& PassTimer::GetAverages() {
+
+        return averages;
+    }
+
+    bool PassTimer::WriteCsv(const std::string& fileName) {
+
+        std::ofstream file(fileName.c_str());
+        if (!file) {
+            LOG_ERROR("could not create %s", fileName.c_str());
+            return false;
+        }
+        file << "frame,pass,gpu_ms,cpu_ms\n";
+        for (size_t i = 0; i < history.size(); i++) {
+            const std::vector<PassTime>& passTimes = history[i].second;
+            for (size_t j = 0; j < passTimes.size(); j++) {
+                file << history[i].first << ',' << passTimes[j].name << ',';
+                if (passTimes[j].gpuTimed) {
+                    file << passTimes[j].gpuMilliseconds;
+                }
+                file << ',' << passTimes[j].cpuMilliseconds << '\n';
+            }
+        }
+        return (bool)file;
+    }
+
+    bool PassTimer::WriteJson(const std::string& fileName) {
+
+        std::ofstream file(fileName.c_str());
+        if (!file) {
+            LOG_ERROR("could not create %s", fileName.c_str());
+            return false;
+        }
+        file << "{\n  \"frame\": " << resultsFrame << ",\n  \"dropped_frames\": " << droppedFrames << ",\n  \"passes\": [";
+        for (size_t i = 0; i < averages.size(); i++) {
+            file << (i == 0 ? "\n" : ",\n") << "    { \"name\": \"" << averages[i].name << "\", ";
+            if (averages[i].gpuTimed) {
+                file << "\"gpu_ms\": " << averages[i].gpuMilliseconds << ", ";
+            }
+            file << "\"cpu_ms\": " << averages[i].cpuMilliseconds << " }";
+        }
+        file << (averages.empty() ? "]\n}\n" : "\n  ]\n}\n");
+        return (bool)file;
+    }
+
+    ScopedCpuTimer::ScopedCpuTimer(PassTimer& timer, const char* name) : timer(timer) {
+
+        timer.BeginCpuScope(name);
+    }
+
+    ScopedCpuTimer::~ScopedCpuTimer() {
+
+        timer.EndCpuScope();
+    }
+}
@@ -0,0 +1,110 @@
+#ifndef PassTimer_hpp
+#define PassTimer_hpp
+
+#if defined (__APPLE__)
+    #define GL_SILENCE_DEPRECATION
+    #include <OpenGL/gl3.h>
+#else
+    #define GLEW_STATIC
+    #include <GL/glew.h>
+#endif
+
+#include <chrono>
+#include <deque>
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace gps {
+
+    struct PassTime {
+        std::string name;
+        double gpuMilliseconds;
+        //time spent submitting the pass, or running the CPU scope
+        double cpuMilliseconds;
+        //false for CPU only scopes
+        bool gpuTimed;
+    };
+
+    //Time of the render passes on the GPU (GL_TIME_ELAPSED queries) and on the CPU,
+    //plus CPU only scopes, all reported per frame in the same timeline
+    //the queries of a frame are read FRAMES_IN_FLIGHT frames later, when the GPU is done
+    //with them, so reading the results never waits; passes can't be nested, CPU scopes can
+    class PassTimer {
+
+    public:
+        static const int FRAMES_IN_FLIGHT = 4;
+        //weight of the newest frame in the rolling averages (about the last 30 frames)
+        static constexpr double AVERAGE_WEIGHT = 1.0 / 30.0;
+        //frames kept for WriteCsv
+        static const int HISTORY_FRAMES = 1000;
+
+        PassTimer();
+        void Delete();
+        //collects the results of the oldest frame in flight
+        void BeginFrame();
+        void BeginPass(const char* name);
+        void EndPass();
+        void BeginCpuScope(const char* name);
+        void EndCpuScope();
+
+        //times of the latest frame whose results came back
+        const std::vector<PassTime>& GetResults();
+        //frame number (counted by BeginFrame) the results belong to, -1 before the first one
+        int GetResultsFrame();
+        //number of the frame being recorded, -1 before the first BeginFrame
+        int GetFrame();
+        //frames whose queries were not ready in time and were skipped
+        int GetDroppedFrames();
+        //exponential rolling averages, in the order the passes first appeared
+        const std::vector<PassTime>& GetAverages();
+
+        //one row per frame and pass from the history: frame,pass,gpu_ms,cpu_ms
+        bool WriteCsv(const std::string& fileName);
+        //the rolling averages
+        bool WriteJson(const std::string& fileName);
+
+    private:
+        struct Entry {
+            std::string name;
+            //0 for CPU only scopes
+            GLuint query;
+            std::chrono::steady_clock::time_point cpuStart;
+            double cpuMilliseconds;
+        };
+
+        struct FrameQueries {
+            std::vector<GLuint> queryPool;
+            std::vector<Entry> entries;
+            int frame;
+        };
+
+        FrameQueries frames[FRAMES_IN_FLIGHT];
+        int frameNumber;
+        //entry of the open pass, -1 when there is none
+        int openPass;
+        std::vector<int> openCpuScopes;
+        std::vector<PassTime> results;
+        int resultsFrame;
+        int droppedFrames;
+        std::vector<PassTime> averages;
+        std::deque<std::pair<int, std::vector<PassTime> > > history;
+
+        FrameQueries& CurrentFrame();
+        void Collect(FrameQueries& frameQueries);
+        void UpdateAverages();
+    };
+
+    //times the enclosing block as a CPU scope
+    class ScopedCpuTimer {
+
+    public:
+        ScopedCpuTimer(PassTimer& timer, const char* name);
+        ~ScopedCpuTimer();
+
+    private:
+        PassTimer& timer;
+    };
+}
+
+#endif /* PassTimer_hpp */
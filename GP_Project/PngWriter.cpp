@@ -0,0 +1,331 @@
+#include "PngWriter.hpp"
+#include "Logger.hpp"
+
+#include <algorithm>
+#include <cstdint>
+#include <cstdlib>
+#include <fstream>
+#include <vector>
+
+namespace gps {
+
+    namespace {
+
+        //matches searched per position, more compresses slightly better and slower
+        const int MAX_CHAIN = 32;
+        const int WINDOW_SIZE = 32768;
+        const int HASH_BITS = 15;
+        const int MIN_MATCH = 3;
+        const int MAX_MATCH = 258;
+
+        const int LENGTH_BASE[29] = { 3, 4, 5, 6, 7, 8, 9, 10, 11, 13, 15, 17, 19, 23, 27, 31,
+            35, 43, 51, 59, 67, 83, 99, 115, 131, 163, 195, 227, 258 };
+        const int LENGTH_EXTRA[29] = { 0, 0, 0, 0, 0, 0, 0, 0, 1, 1, 1, 1, 2, 2, 2, 2,
+            3, 3, 3, 3, 4, 4, 4, 4, 5, 5, 5, 5, 0 };
+        const int DISTANCE_BASE[30] = { 1, 2, 3, 4, 5, 7, 9, 13, 17, 25, 33, 49, 65, 97, 129, 193,
+            257, 385, 513, 769, 1025, 1537, 2049, 3073, 4097, 6145, 8193, 12289, 16385, 24577 };
+        const int DISTANCE_EXTRA[30] = { 0, 0, 0, 0, 1, 1, 2, 2, 3, 3, 4, 4, 5, 5, 6, 6,
+            7, 7, 8, 8, 9, 9, 10, 10, 11, 11, 12, 12, 13, 13 };
+
+        //deflate packs bits from the least significant end
+        class BitWriter {
+
+        public:
+            explicit BitWriter(std::vector<unsigned char>& output) : output(output), bits(0), count(0) {
+            }
+
+            void Write(uint32_t value, int length) {
+                bits |= value << count;
+                count += length;
+                while (count >= 8) {
+                    output.push_back((unsigned char)bits);
+                    bits >>= 8;
+                    count -= 8;
+                }
+            }
+
+            void Flush() {
+                if (count > 0) {
+                    output.push_back((unsigned char)bits);
+                }
+                bits = 0;
+                count = 0;
+            }
+
+        private:
+            std::vector<unsigned char>& output;
+            uint32_t bits;
+            int count;
+        };
+
+        uint32_t reverseBits(uint32_t code, int length) {
+
+            uint32_t reversed = 0;
+            for (int i = 0; i < length; i++) {
+                reversed = (reversed << 1) | ((code >> i) & 1);
+            }
+            return reversed;
+        }
+
+        //fixed literal/length codes of RFC 1951 3.2.6, already reversed for the bit writer
+        struct FixedCodes {
+            uint32_t code[288];
+            int length[288];
+            uint32_t distanceCode[30];
+
+            FixedCodes() {
+                for (int symbol = 0; symbol < 288; symbol++) {
+                    uint32_t value = symbol < 144 ? 0x30 + symbol : symbol < 256 ? 0x190 + symbol - 144 : symbol < 280 ? symbol - 256 : 0xC0 + symbol - 280;
+                    length[symbol] = symbol < 144 ? 8 : symbol < 256 ? 9 : symbol < 280 ? 7 : 8;
+                    code[symbol] = reverseBits(value, length[symbol]);
+                }
+                for (int symbol = 0; symbol < 30; symbol++) {
+                    distanceCode[symbol] = reverseBits(symbol, 5);
+                }
+            }
+        };
+
+        const FixedCodes& fixedCodes() {
+
+            static const FixedCodes codes;
+            return codes;
+        }
+
+        void writeSymbol(BitWriter& writer, int symbol) {
+
+            writer.Write(fixedCodes().code[symbol], fixedCodes().length[symbol]);
+        }
+
+        void writeMatch(BitWriter& writer, int length, int distance) {
+
+            int lengthCode = 28;
+            while (LENGTH_BASE[lengthCode] > length) {
+                lengthCode--;
+            }
+            writeSymbol(writer, 257 + lengthCode);
+            writer.Write(length - LENGTH_BASE[lengthCode], LENGTH_EXTRA[lengthCode]);
+
+            int distanceCode = 29;
+            while (DISTANCE_BASE[distanceCode] > distance) {
+                distanceCode--;
+            }
+            writer.Write(fixedCodes().distanceCode[distanceCode], 5);
+            writer.Write(distance - DISTANCE_BASE[distanceCode], DISTANCE_EXTRA[distanceCode]);
+        }
+
+        uint32_t hash3(const unsigned char* data) {
+
+            return ((data[0] << 16 | data[1] << 8 | data[2]) * 2654435761u) >> (32 - HASH_BITS);
+        }
+
+        //zlib stream of a single fixed Huffman block, greedy LZ77 matching over hash chains
+        std::vector<unsigned char> zlibCompress(const std::vector<unsigned char>& data) {
+
+            std::vector<unsigned char> output;
+            output.push_back(0x78);
+            output.push_back(0x01);
+            BitWriter writer(output);
+            writer.Write(1, 1);  // last block
+            writer.Write(1, 2);  // fixed Huffman codes
+
+            std::vector<int> head(1 << HASH_BITS, -1);
+            std::vector<int> previous(WINDOW_SIZE, -1);
+            int size = (int)data.size();
+            int position = 0;
+            while (position < size) {
+                int bestLength = 0;
+                int bestDistance = 0;
+                if (position + MIN_MATCH <= size) {
+                    uint32_t hash = hash3(&data[position]);
+                    int maxLength = std::min(MAX_MATCH, size - position);
+                    int candidate = head[hash];
+                    for (int chain = 0; chain < MAX_CHAIN && candidate >= 0 && position - candidate <= WINDOW_SIZE; chain++) {
+                        //can't be longer than the best match unless it also matches at its end
+                        if (bestLength > 0 && data[candidate + bestLength] != data[position + bestLength]) {
+                            candidate = previous[candidate % WINDOW_SIZE];
+                            continue;
+                        }
+                        int length = 0;
+                        while (length < maxLength && data[candidate + length] == data[position + length]) {
+                            length++;
+                        }
+                        if (length > bestLength) {
+                            bestLength = length;
+                            bestDistance = position - candidate;
+                            if (length == maxLength) {
+                                break;
+                            }
+                        }
+                        candidate = previous[candidate % WINDOW_SIZE];
+                    }
+                }
+
+                int advance = bestLength >= MIN_MATCH ? bestLength : 1;
+                if (bestLength >= MIN_MATCH) {
+                    writeMatch(writer, bestLength, bestDistance);
+                }
+                else {
+                    writeSymbol(writer, data[position]);
+                }
+                for (int i = 0; i < advance; i++, position++) {
+                    if (position + MIN_MATCH <= size) {
+                        uint32_t hash = hash3(&data[position]);
+                        previous[position % WINDOW_SIZE] = head[hash];
+                        head[hash] = position;
+                    }
+                }
+            }
+            writeSymbol(writer, 256);
+            writer.Flush();
+
+            //Adler-32, reduced once per 5552 bytes (the most that can't overflow)
+            uint32_t a = 1, b = 0;
+            for (size_t block = 0; block < data.size(); block += 5552) {
+                size_t end = std::min(block + 5552, data.size());
+                for (size_t i = block; i < end; i++) {
+                    a += data[i];
+                    b += a;
+                }
+                a %= 65521;
+                b %= 65521;
+            }
+            uint32_t adler = b << 16 | a;
+            for (int shift = 24; shift >= 0; shift -= 8) {
+                output.push_back((unsigned char)(adler >> shift));
+            }
+            return output;
+        }
+
+        int paeth(int a, int b, int c) {
+
+            int p = a + b - c;
+            int pa = std::abs(p - a), pb = std::abs(p - b), pc = std::abs(p - c);
+            return pa <= pb && pa <= pc ? a : (pb <= pc ? b : c);
+        }
+
+        //one row filtered with PNG filter type filter (0 none, 1 sub, 2 up, 3 average, 4 Paeth)
+        void filterRow(int filter, const unsigned char* row, const unsigned char* above, size_t stride, int channels, unsigned char* out) {
+
+            for (size_t x = 0; x < stride; x++) {
+                int left = x >= (size_t)channels ? row[x - channels] : 0;
+                int up = above != NULL ? above[x] : 0;
+                int upLeft = above != NULL && x >= (size_t)channels ? above[x - channels] : 0;
+                int predicted = 0;
+                switch (filter) {
+                case 1: predicted = left; break;
+                case 2: predicted = up; break;
+                case 3: predicted = (left + up) / 2; break;
+                case 4: predicted = paeth(left, up, upLeft); break;
+                }
+                out[x] = (unsigned char)(row[x] - predicted);
+            }
+        }
+
+        //every row prefixed with the filter whose output has the smallest sum of absolute values
+        std::vector<unsigned char> filterRows(int width, int height, int channels, const unsigned char* pixels, bool bottomUp) {
+
+            size_t stride = (size_t)width * channels;
+            std::vector<unsigned char> filtered;
+            filtered.reserve((stride + 1) * height);
+            std::vector<unsigned char> candidate(stride);
+            std::vector<unsigned char> best(stride);
+            for (int y = 0; y < height; y++) {
+                const unsigned char* row = pixels + stride * (bottomUp ? height - 1 - y : y);
+                const unsigned char* above = y == 0 ? NULL : pixels + stride * (bottomUp ? height - y : y - 1);
+                long bestSum = -1;
+                int bestFilter = 0;
+                for (int filter = 0; filter < 5; filter++) {
+                    filterRow(filter, row, above, stride, channels, candidate.data());
+                    long sum = 0;
+                    for (size_t x = 0; x < stride; x++) {
+                        sum += std::abs((signed char)candidate[x]);
+                    }
+                    if (bestSum < 0 || sum < bestSum) {
+                        bestSum = sum;
+                        bestFilter = filter;
+                        best.swap(candidate);
+                    }
+                }
+                filtered.push_back((unsigned char)bestFilter);
+                filtered.insert(filtered.end(), best.begin(), best.end());
+            }
+            return filtered;
+        }
+
+        struct CrcTable {
+            uint32_t entries[256];
+
+            CrcTable() {
+                for (uint32_t n = 0; n < 256; n++) {
+                    uint32_t c = n;
+                    for (int k = 0; k < 8; k++) {
+                        c = c & 1 ? 0xEDB88320u ^ (c >> 1) : c >> 1;
+                    }
+                    entries[n] = c;
+                }
+            }
+        };
+
+        uint32_t crc32(const unsigned char* data, size_t size, uint32_t crc) {
+
+            //initialized once even when several threads write images
+            static const CrcTable table;
+            for (size_t i = 0; i < size; i++) {
+                crc = table.entries[(crc ^ data[i]) & 0xFF] ^ (crc >> 8);
+            }
+            return crc;
+        }
+
+        void writeUint32(std::ofstream& file, uint32_t value) {
+
+            unsigned char bytes[4] = { (unsigned char)(value >> 24), (unsigned char)(value >> 16), (unsigned char)(value >> 8), (unsigned char)value };
+            file.write((const char*)bytes, 4);
+        }
+
+        void writeChunk(std::ofstream& file, const char* type, const std::vector<unsigned char>& data) {
+
+            writeUint32(file, (uint32_t)data.size());
+            file.write(type, 4);
+            if (!data.empty()) {
+                file.write((const char*)data.data(), data.size());
+            }
+            uint32_t crc = crc32((const unsigned char*)type, 4, 0xFFFFFFFFu);
+            crc = data.empty() ? crc : crc32(data.data(), data.size(), crc);
+            writeUint32(file, crc ^ 0xFFFFFFFFu);
+        }
+    }
+
+    bool PngWriter::Write(const std::string& fileName, int width, int height, int channels,
+        const unsigned char* pixels, bool bottomUp) {
+
+        if (width <= 0 || height <= 0 || (channels != 3 && channels != 4)) {
+            LOG_ERROR("could not write %s: unsupported %dx%d image with %d channels", fileName.c_str(), width, height, channels);
+            return false;
+        }
+        std::ofstream file(fileName.c_str(), std::ios::binary);
+        if (!file) {
+            LOG_ERROR("could not create %s", fileName.c_str());
+            return false;
+        }
+
+        const unsigned char signature[8] = { 0x89, 'P', 'N', 'G', '\r', '\n', 0x1A, '\n' };
+        file.write((const char*)signature, 8);
+
+        std::vector<unsigned char> header;
+        for (int shift = 24; shift >= 0; shift -= 8) {
+            header.push_back((unsigned char)(width >> shift));
+        }
+        for (int shift = 24; shift >= 0; shift -= 8) {
+            header.push_back((unsigned char)(height >> shift));
+        }
+        header.push_back(8);  // bits per channel
+        header.push_back(channels == 4 ? 6 : 2);  // RGBA or RGB
+        header.push_back(0);  // deflate
+        header.push_back(0);  // adaptive filtering
+        header.push_back(0);  // not interlaced
+        writeChunk(file, "IHDR", header);
+        writeChunk(file, "IDAT", zlibCompress(filterRows(width, height, channels, pixels, bottomUp)));
+        writeChunk(file, "IEND", std::vector<unsigned char>());
+        return (bool)file;
+    }
+}
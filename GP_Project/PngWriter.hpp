@@ -0,0 +1,22 @@
+#ifndef PngWriter_hpp
+#define PngWriter_hpp
+
+#include <string>
+
+namespace gps {
+
+    //Minimal PNG encoder for screenshots and golden images (8 bit RGB or RGBA)
+    //rows are filtered with the usual minimum-sum heuristic and compressed with
+    //fixed Huffman deflate, which keeps rendered images small without a zlib dependency;
+    //PNGs are read back with stb_image
+    class PngWriter {
+
+    public:
+        //pixels: width * height * channels bytes, channels 3 or 4;
+        //bottomUp for rows in OpenGL order (glReadPixels), which are flipped on the way out
+        static bool Write(const std::string& fileName, int width, int height, int channels,
+            const unsigned char* pixels, bool bottomUp);
+    };
+}
+
+#endif /* PngWriter_hpp */
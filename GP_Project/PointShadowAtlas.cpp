@@ -0,0 +1,278 @@
+#include "PointShadowAtlas.hpp"
+
+#include <glm/gtc/matrix_transform.hpp>
+
+#include <algorithm>
+#include <cmath>
+
+#include "GLTraceHooks.hpp"
+
+namespace gps {
+
+    //cube face directions in OpenGL cubemap order, mirrored in basic.frag
+    static const glm::vec3 faceDirections[6] = {
+        glm::vec3(1.0f, 0.0f, 0.0f), glm::vec3(-1.0f, 0.0f, 0.0f),
+        glm::vec3(0.0f, 1.0f, 0.0f), glm::vec3(0.0f, -1.0f, 0.0f),
+        glm::vec3(0.0f, 0.0f, 1.0f), glm::vec3(0.0f, 0.0f, -1.0f)
+    };
+    static const glm::vec3 faceUps[6] = {
+        glm::vec3(0.0f, -1.0f, 0.0f), glm::vec3(0.0f, -1.0f, 0.0f),
+        glm::vec3(0.0f, 0.0f, 1.0f), glm::vec3(0.0f, 0.0f, -1.0f),
+        glm::vec3(0.0f, -1.0f, 0.0f), glm::vec3(0.0f, -1.0f, 0.0f)
+    };
+    static const float shadowNearPlane = 0.05f;
+
+    void PointShadowAtlas::Create(const std::vector<PointShadowLight>& lights) {
+
+        this->lights = lights;
+        this->tiles.assign(lights.size(), Tile());
+        for (size_t i = 0; i < tiles.size(); i++) {
+            tiles[i].x = 0;
+            tiles[i].y = 0;
+            tiles[i].size = MAX_TILE_SIZE;
+            tiles[i].dirty = true;
+        }
+
+        //worst case: every light at full resolution, one strip per row
+        atlasWidth = 6 * MAX_TILE_SIZE;
+        atlasHeight = std::max((int)lights.size(), 1) * MAX_TILE_SIZE;
+        PackTiles();
+
+        glGetIntegerv(GL_MAX_VIEWPORTS, &maxViewports);
+        maxViewports = std::max(1, std::min(maxViewports, (GLint)MAX_FACES_PER_PASS));
+
+        glGenTextures(1, &atlasTexture);
+        glBindTexture(GL_TEXTURE_2D, atlasTexture);
+        glTexImage2D(GL_TEXTURE_2D, 0, GL_DEPTH_COMPONENT24, atlasWidth, atlasHeight, 0, GL_DEPTH_COMPONENT, GL_FLOAT, NULL);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_COMPARE_MODE, GL_COMPARE_REF_TO_TEXTURE);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_COMPARE_FUNC, GL_LEQUAL);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+        glBindTexture(GL_TEXTURE_2D, 0);
+
+        glGenFramebuffers(1, &atlasFBO);
+        glBindFramebuffer(GL_FRAMEBUFFER, atlasFBO);
+        glFramebufferTexture2D(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, GL_TEXTURE_2D, atlasTexture, 0);
+        glDrawBuffer(GL_NONE);
+        glReadBuffer(GL_NONE);
+        if (glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE) {
+            std::cout << "Point shadow atlas framebuffer is incomplete" << std::endl;
+        }
+        glBindFramebuffer(GL_FRAMEBUFFER, 0);
+    }
+
+    void PointShadowAtlas::Delete() {
+
+        glDeleteFramebuffers(1, &atlasFBO);
+        glDeleteTextures(1, &atlasTexture);
+    }
+
+    void PointShadowAtlas::UpdateImportance(glm::vec3 cameraPosition, float fieldOfViewY, int screenHeight) {
+
+        float focalLength = screenHeight * 0.5f / std::tan(fieldOfViewY * 0.5f);
+        bool resized = false;
+
+        for (size_t i = 0; i < lights.size(); i++) {
+
+            //projected radius of the brightly lit area, in pixels
+            float distance = glm::length(lights[i].position - cameraPosition);
+            float projectedRadius = lights[i].detailRadius / std::max(distance, lights[i].detailRadius) * focalLength;
+
+            int size = MIN_TILE_SIZE;
+            if (projectedRadius >= 0.5f * screenHeight) {
+                size = MAX_TILE_SIZE;
+            }
+            else if (projectedRadius >= 0.2f * screenHeight) {
+                size = MAX_TILE_SIZE / 2;
+            }
+
+            if (size != tiles[i].size) {
+                tiles[i].size = size;
+                tiles[i].dirty = true;
+                resized = true;
+            }
+        }
+
+        if (resized) {
+            PackTiles();
+        }
+    }
+
+    void PointShadowAtlas::UpdateDynamicObject(int objectId, glm::vec4 boundingSphere) {
+
+        if (objectId >= (int)dynamicObjects.size()) {
+            //a negative radius marks an object that has not been seen yet
+            dynamicObjects.resize(objectId + 1, glm::vec4(0.0f, 0.0f, 0.0f, -1.0f));
+        }
+
+        glm::vec4 previous = dynamicObjects[objectId];
+        dynamicObjects[objectId] = boundingSphere;
+        if (previous.w < 0.0f || previous == boundingSphere) {
+            return;
+        }
+
+        //the old and the new position both change what the light sees
+        for (size_t i = 0; i < lights.size(); i++) {
+
+            float oldDistance = glm::length(glm::vec3(previous) - lights[i].position);
+            float newDistance = glm::length(glm::vec3(boundingSphere) - lights[i].position);
+            if (oldDistance < lights[i].radius + previous.w || newDistance < lights[i].radius + boundingSphere.w) {
+                tiles[i].dirty = true;
+            }
+        }
+    }
+
+    void PointShadowAtlas::Invalidate() {
+
+        for (size_t i = 0; i < tiles.size(); i++) {
+            tiles[i].dirty = true;
+        }
+    }
+
+    bool PointShadowAtlas::NeedsUpdate() {
+
+        for (size_t i = 0; i < tiles.size(); i++) {
+            if (tiles[i].dirty) {
+                return true;
+            }
+        }
+        return false;
+    }
+
+    void PointShadowAtlas::Render(gps::Shader shader, void (*drawCasters)(gps::Shader shader, bool depthPass)) {
+
+        //every (light, face) pair that has to be redrawn
+        std::vector<glm::ivec2> faces;
+        for (size_t i = 0; i < tiles.size(); i++) {
+            if (tiles[i].dirty) {
+                for (int face = 0; face < 6; face++) {
+                    faces.push_back(glm::ivec2((int)i, face));
+                }
+            }
+        }
+        if (faces.empty()) {
+            return;
+        }
+
+        glBindFramebuffer(GL_FRAMEBUFFER, atlasFBO);
+
+        //only the strips being redrawn are cleared, the rest of the atlas stays cached
+        glEnable(GL_SCISSOR_TEST);
+        for (size_t i = 0; i < tiles.size(); i++) {
+            if (tiles[i].dirty) {
+                glScissor(tiles[i].x, tiles[i].y, 6 * tiles[i].size, tiles[i].size);
+                glClear(GL_DEPTH_BUFFER_BIT);
+            }
+        }
+        glDisable(GL_SCISSOR_TEST);
+
+        shader.useShaderProgram();
+        GLint faceMatricesLoc = glGetUniformLocation(shader.shaderProgram, "faceMatrices");
+        GLint faceLightsLoc = glGetUniformLocation(shader.shaderProgram, "faceLights");
+        GLint faceCountLoc = glGetUniformLocation(shader.shaderProgram, "faceCount");
+
+        glm::mat4 faceMatrices[MAX_FACES_PER_PASS];
+        glm::vec4 faceLights[MAX_FACES_PER_PASS];
+
+        //layered rendering: each draw fans the casters out to up to maxViewports tiles
+        for (size_t first = 0; first < faces.size(); first += maxViewports) {
+
+            int count = (int)std::min(faces.size() - first, (size_t)maxViewports);
+            for (int i = 0; i < count; i++) {
+
+                int light = faces[first + i].x;
+                int face = faces[first + i].y;
+                const Tile& tile = tiles[light];
+                glViewportIndexedf(i, (GLfloat)(tile.x + face * tile.size), (GLfloat)tile.y, (GLfloat)tile.size, (GLfloat)tile.size);
+                faceMatrices[i] = ComputeFaceMatrix(light, face);
+                faceLights[i] = glm::vec4(lights[light].position, lights[light].radius);
+            }
+
+            shader.useShaderProgram();
+            glUniformMatrix4fv(faceMatricesLoc, count, GL_FALSE, glm::value_ptr(faceMatrices[0]));
+            glUniform4fv(faceLightsLoc, count, glm::value_ptr(faceLights[0]));
+            glUniform1i(faceCountLoc, count);
+
+            drawCasters(shader, true);
+        }
+
+        glBindFramebuffer(GL_FRAMEBUFFER, 0);
+
+        for (size_t i = 0; i < tiles.size(); i++) {
+            tiles[i].dirty = false;
+        }
+    }
+
+    void PointShadowAtlas::BindTexture(GLint textureUnit) {
+
+        glActiveTexture(GL_TEXTURE0 + textureUnit);
+        glBindTexture(GL_TEXTURE_2D, atlasTexture);
+    }
+
+    glm::vec4 PointShadowAtlas::GetTileRect(int light) {
+
+        return glm::vec4(
+            (float)tiles[light].x / atlasWidth,
+            (float)tiles[light].y / atlasHeight,
+            (float)tiles[light].size / atlasWidth,
+            (float)tiles[light].size / atlasHeight);
+    }
+
+    float PointShadowAtlas::GetLightRadius(int light) {
+
+        return lights[light].radius;
+    }
+
+    GLuint PointShadowAtlas::GetTextureId() {
+
+        return atlasTexture;
+    }
+
+    void PointShadowAtlas::PackTiles() {
+
+        //shelf packing, largest strips first; sizes are powers of two, so the rows fill up exactly
+        //strips that move have to be redrawn, resized ones were already invalidated
+        std::vector<int> order(tiles.size());
+        for (size_t i = 0; i < order.size(); i++) {
+            order[i] = (int)i;
+        }
+        std::stable_sort(order.begin(), order.end(), [this](int a, int b) {
+            return tiles[a].size > tiles[b].size;
+        });
+
+        int shelfY = 0;
+        int shelfHeight = 0;
+        int cursorX = 0;
+
+        for (size_t i = 0; i < order.size(); i++) {
+
+            Tile& tile = tiles[order[i]];
+            int stripWidth = 6 * tile.size;
+            if (cursorX + stripWidth > atlasWidth) {
+                shelfY += shelfHeight;
+                shelfHeight = 0;
+                cursorX = 0;
+            }
+            if (shelfHeight == 0) {
+                shelfHeight = tile.size;
+            }
+
+            if (tile.x != cursorX || tile.y != shelfY) {
+                tile.x = cursorX;
+                tile.y = shelfY;
+                tile.dirty = true;
+            }
+            cursorX += stripWidth;
+        }
+    }
+
+    glm::mat4 PointShadowAtlas::ComputeFaceMatrix(int light, int face) {
+
+        glm::vec3 position = lights[light].position;
+        glm::mat4 faceView = glm::lookAt(position, position + faceDirections[face], faceUps[face]);
+        glm::mat4 faceProjection = glm::perspective(glm::radians(90.0f), 1.0f, shadowNearPlane, lights[light].radius);
+        return faceProjection * faceView;
+    }
+}
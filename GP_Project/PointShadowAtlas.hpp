@@ -0,0 +1,73 @@
+#ifndef PointShadowAtlas_hpp
+#define PointShadowAtlas_hpp
+
+#include "Shader.hpp"
+
+#include <glm/glm.hpp>
+#include <glm/gtc/type_ptr.hpp>
+
+#include <vector>
+
+namespace gps {
+
+    //Omnidirectional light whose shadows are kept in the atlas
+    struct PointShadowLight {
+        glm::vec3 position;
+        //distance at which the light's contribution becomes negligible
+        float radius;
+        //extent of the brightly lit area, used to judge how much of the screen the light affects
+        float detailRadius;
+    };
+
+    //Cube shadow maps of all the point lights packed into a single depth texture
+    //every light owns a strip of 6 square tiles (+X -X +Y -Y +Z -Z) whose size is picked
+    //from the light's importance on screen; a geometry shader routes each triangle to
+    //the tiles through gl_ViewportIndex, so one draw renders up to GL_MAX_VIEWPORTS faces
+    class PointShadowAtlas {
+
+    public:
+        static const int MAX_TILE_SIZE = 512;
+        static const int MIN_TILE_SIZE = 128;
+        //has to match MAX_SHADOW_VIEWPORTS in pointShadow.geom
+        static const int MAX_FACES_PER_PASS = 16;
+
+        void Create(const std::vector<PointShadowLight>& lights);
+        void Delete();
+        //pick tile sizes from the projected size of every light; a new size invalidates the light
+        void UpdateImportance(glm::vec3 cameraPosition, float fieldOfViewY, int screenHeight);
+        //static lights only need new maps when a dynamic object moves inside their radius
+        void UpdateDynamicObject(int objectId, glm::vec4 boundingSphere);
+        void Invalidate();
+        bool NeedsUpdate();
+        //render the dirty lights; drawCasters draws every shadow caster with the given shader
+        void Render(gps::Shader shader, void (*drawCasters)(gps::Shader shader, bool depthPass));
+        void BindTexture(GLint textureUnit);
+        //strip origin and tile size of a light, in atlas texture coordinates
+        glm::vec4 GetTileRect(int light);
+        float GetLightRadius(int light);
+        GLuint GetTextureId();
+
+    private:
+        struct Tile {
+            //strip origin in atlas texels
+            int x;
+            int y;
+            int size;
+            bool dirty;
+        };
+
+        std::vector<PointShadowLight> lights;
+        std::vector<Tile> tiles;
+        std::vector<glm::vec4> dynamicObjects;
+        int atlasWidth;
+        int atlasHeight;
+        GLint maxViewports;
+        GLuint atlasFBO;
+        GLuint atlasTexture;
+
+        void PackTiles();
+        glm::mat4 ComputeFaceMatrix(int light, int face);
+    };
+}
+
+#endif /* PointShadowAtlas_hpp */
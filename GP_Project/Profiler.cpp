@@ -0,0 +1,171 @@
+#include "Profiler.hpp"
+#include "Logger.hpp"
+
+#include <chrono>
+#include <cstdio>
+#include <fstream>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+#if defined(_MSC_VER) && (defined(_M_X64) || defined(_M_IX86))
+    #include <intrin.h>
+    #define GPS_PROFILER_RDTSC
+#elif defined(__x86_64__) || defined(__i386__)
+    #include <x86intrin.h>
+    #define GPS_PROFILER_RDTSC
+#endif
+
+namespace gps {
+
+    namespace {
+
+        struct ProfileEvent {
+            const char* name;
+            uint64_t begin;
+            uint64_t end;
+        };
+
+        struct ThreadBuffer {
+            //only contended while a trace is written or a capture starts
+            std::mutex mutex;
+            std::vector<ProfileEvent> events;
+            int threadId;
+            std::string name;
+            int droppedEvents;
+        };
+
+        std::mutex registryMutex;
+        //never freed, the zones of a thread outlive it
+        std::vector<std::unique_ptr<ThreadBuffer> > threadBuffers;
+        thread_local ThreadBuffer* threadBuffer = NULL;
+
+        uint64_t captureStartTicks = 0;
+        uint64_t captureEndTicks = 0;
+        std::chrono::steady_clock::time_point captureStartTime;
+        std::chrono::steady_clock::time_point captureEndTime;
+
+        ThreadBuffer& getThreadBuffer() {
+
+            if (threadBuffer == NULL) {
+                std::lock_guard<std::mutex> lock(registryMutex);
+                threadBuffers.push_back(std::unique_ptr<ThreadBuffer>(new ThreadBuffer()));
+                threadBuffer = threadBuffers.back().get();
+                threadBuffer->threadId = (int)threadBuffers.size();
+                threadBuffer->name = "thread " + std::to_string(threadBuffer->threadId);
+                threadBuffer->droppedEvents = 0;
+            }
+            return *threadBuffer;
+        }
+    }
+
+    std::atomic<bool> Profiler::capturing(false);
+
+    uint64_t Profiler::Now() {
+
+#if defined(GPS_PROFILER_RDTSC)
+        return __rdtsc();
+#else
+        return (uint64_t)std::chrono::duration_cast<std::chrono::nanoseconds>(
+            std::chrono::steady_clock::now().time_since_epoch()).count();
+#endif
+    }
+
+    void Profiler::StartCapture() {
+
+        std::lock_guard<std::mutex> registryLock(registryMutex);
+        for (size_t i = 0; i < threadBuffers.size(); i++) {
+            std::lock_guard<std::mutex> lock(threadBuffers[i]->mutex);
+            threadBuffers[i]->events.clear();
+            threadBuffers[i]->droppedEvents = 0;
+        }
+        captureStartTime = std::chrono::steady_clock::now();
+        captureStartTicks = Now();
+        capturing.store(true, std::memory_order_relaxed);
+    }
+
+    void Profiler::StopCapture() {
+
+        if (!capturing.exchange(false, std::memory_order_relaxed)) {
+            return;
+        }
+        captureEndTicks = Now();
+        captureEndTime = std::chrono::steady_clock::now();
+    }
+
+    void Profiler::SetThreadName(const char* name) {
+
+        ThreadBuffer& buffer = getThreadBuffer();
+        std::lock_guard<std::mutex> lock(buffer.mutex);
+        buffer.name = name;
+    }
+
+    void Profiler::Record(const char* name, uint64_t begin, uint64_t end) {
+
+        ThreadBuffer& buffer = getThreadBuffer();
+        std::lock_guard<std::mutex> lock(buffer.mutex);
+        if ((int)buffer.events.size() >= MAX_EVENTS_PER_THREAD) {
+            buffer.droppedEvents++;
+            return;
+        }
+        ProfileEvent event = { name, begin, end };
+        buffer.events.push_back(event);
+    }
+
+    bool Profiler::WriteTrace(const std::string& fileName) {
+
+        StopCapture();
+
+        //rdtsc ticks at a constant rate, measured over the whole capture
+        double ticksPerMicrosecond = 1000.0;
+#if defined(GPS_PROFILER_RDTSC)
+        double captureMicroseconds = std::chrono::duration<double, std::micro>(captureEndTime - captureStartTime).count();
+        if (captureMicroseconds > 0.0 && captureEndTicks > captureStartTicks) {
+            ticksPerMicrosecond = (captureEndTicks - captureStartTicks) / captureMicroseconds;
+        }
+#endif
+
+        std::ofstream file(fileName.c_str());
+        if (!file) {
+            LOG_ERROR("could not create trace %s", fileName.c_str());
+            return false;
+        }
+
+        int eventCount = 0;
+        int droppedEvents = 0;
+        char line[512];
+        bool first = true;
+        file << "{\"displayTimeUnit\": \"ms\", \"traceEvents\": [";
+        std::unique_lock<std::mutex> registryLock(registryMutex);
+        for (size_t i = 0; i < threadBuffers.size(); i++) {
+            ThreadBuffer& buffer = *threadBuffers[i];
+            std::lock_guard<std::mutex> lock(buffer.mutex);
+            snprintf(line, sizeof(line), "%s\n{\"name\": \"thread_name\", \"ph\": \"M\", \"pid\": 1, \"tid\": %d, \"args\": {\"name\": \"%s\"}}",
+                first ? "" : ",", buffer.threadId, buffer.name.c_str());
+            file << line;
+            first = false;
+
+            for (size_t j = 0; j < buffer.events.size(); j++) {
+                const ProfileEvent& event = buffer.events[j];
+                //started before the capture, by a zone that was open when it began
+                if (event.begin < captureStartTicks) {
+                    continue;
+                }
+                snprintf(line, sizeof(line), ",\n{\"name\": \"%s\", \"ph\": \"X\", \"ts\": %.3f, \"dur\": %.3f, \"pid\": 1, \"tid\": %d}",
+                    event.name, (event.begin - captureStartTicks) / ticksPerMicrosecond,
+                    (event.end - event.begin) / ticksPerMicrosecond, buffer.threadId);
+                file << line;
+                eventCount++;
+            }
+            droppedEvents += buffer.droppedEvents;
+        }
+        registryLock.unlock();
+        file << "\n]}\n";
+
+        if (droppedEvents > 0) {
+            LOG_WARNING("%d profiler zones dropped, more than %d in a thread", droppedEvents, MAX_EVENTS_PER_THREAD);
+        }
+        LOG_INFO("Trace written to %s: %d zones", fileName.c_str(), eventCount);
+        return (bool)file;
+    }
+}
@@ -0,0 +1,68 @@
+#ifndef Profiler_hpp
+#define Profiler_hpp
+
+#include <atomic>
+#include <cstdint>
+#include <string>
+
+namespace gps {
+
+    //CPU profiler for scoped zones, exported as Chrome trace events (chrome://tracing, Perfetto)
+    //every thread records into its own buffer, so zones on different threads never contend;
+    //outside a capture a zone costs one relaxed atomic load
+    //timestamps come from rdtsc on x86 (calibrated against steady_clock over the capture)
+    //and from steady_clock elsewhere
+    class Profiler {
+
+    public:
+        //zones after this many in a thread during one capture are dropped
+        static const int MAX_EVENTS_PER_THREAD = 1 << 20;
+
+        //starts a capture, forgetting the zones of the previous one
+        static void StartCapture();
+        static void StopCapture();
+        static bool IsCapturing() {
+            return capturing.load(std::memory_order_relaxed);
+        }
+        //name of the calling thread in the trace
+        static void SetThreadName(const char* name);
+        //the zones of the last capture, as {"traceEvents": [...]}
+        static bool WriteTrace(const std::string& fileName);
+
+        static uint64_t Now();
+        //name has to outlive the capture (a string literal)
+        static void Record(const char* name, uint64_t begin, uint64_t end);
+
+    private:
+        static std::atomic<bool> capturing;
+    };
+
+    class ProfileZone {
+
+    public:
+        explicit ProfileZone(const char* name) : name(name), begin(Profiler::IsCapturing() ? Profiler::Now() : 0) {
+        }
+        ~ProfileZone() {
+            if (begin != 0 && Profiler::IsCapturing()) {
+                Profiler::Record(name, begin, Profiler::Now());
+            }
+        }
+
+    private:
+        const char* name;
+        uint64_t begin;
+    };
+}
+
+//GPS_PROFILER_DISABLED compiles the zones out entirely
+#if defined(GPS_PROFILER_DISABLED)
+    #define PROFILE_ZONE(name) do { } while (0)
+#else
+    #define PROFILE_ZONE_CONCAT(a, b) a##b
+    #define PROFILE_ZONE_NAME(line) PROFILE_ZONE_CONCAT(profileZone, line)
+    //times the rest of the enclosing block
+    #define PROFILE_ZONE(name) gps::ProfileZone PROFILE_ZONE_NAME(__LINE__)(name)
+#endif
+#define PROFILE_FUNCTION() PROFILE_ZONE(__FUNCTION__)
+
+#endif /* Profiler_hpp */
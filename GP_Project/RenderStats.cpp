@@ -0,0 +1,122 @@
+#include "RenderStats.hpp"
+#include "Logger.hpp"
+
+#include <cstdio>
+#include <fstream>
+
+namespace gps {
+
+    namespace {
+
+        //in the order of RenderCounters
+        const char* COUNTER_NAMES[] = { "draw_calls", "triangles", "program_binds", "texture_binds",
+            "vao_binds", "uniform_uploads", "buffer_bytes", "culled_objects" };
+        const int COUNTER_COUNT = sizeof(COUNTER_NAMES) / sizeof(COUNTER_NAMES[0]);
+        static_assert(sizeof(RenderCounters) == COUNTER_COUNT * sizeof(long long), "a counter is missing a name");
+
+        void counterValues(const RenderCounters& counters, long long values[COUNTER_COUNT]) {
+
+            values[0] = counters.drawCalls;
+            values[1] = counters.triangles;
+            values[2] = counters.programBinds;
+            values[3] = counters.textureBinds;
+            values[4] = counters.vaoBinds;
+            values[5] = counters.uniformUploads;
+            values[6] = counters.bufferBytes;
+            values[7] = counters.culledObjects;
+        }
+    }
+
+    RenderCounters RenderStats::current = {};
+    RenderCounters RenderStats::lastFrame = {};
+    std::deque<RenderCounters> RenderStats::history;
+    bool RenderStats::started = false;
+
+    void RenderStats::BeginFrame() {
+
+        //the first call only drops what the startup counted (the binds of the init path);
+        //later frames are closed even when they drew nothing
+        if (!started) {
+            started = true;
+            current = RenderCounters();
+            return;
+        }
+        lastFrame = current;
+        current = RenderCounters();
+        history.push_back(lastFrame);
+        if ((int)history.size() > HISTORY_FRAMES) {
+            history.pop_front();
+        }
+    }
+
+    const RenderCounters& RenderStats::GetLastFrame() {
+
+        return lastFrame;
+    }
+
+    std::string RenderStats::CountersJson(const RenderCounters& counters, int frames) {
+
+        long long values[COUNTER_COUNT];
+        counterValues(counters, values);
+        std::string json = "{ ";
+        for (int i = 0; i < COUNTER_COUNT; i++) {
+            char value[64];
+            snprintf(value, sizeof(value), frames == 1 ? "%.0f" : "%.2f", frames > 0 ? (double)values[i] / frames : 0.0);
+            json += std::string(i == 0 ? "" : ", ") + "\"" + COUNTER_NAMES[i] + "\": " + value;
+        }
+        return json + " }";
+    }
+
+    void RenderStats::Add(RenderCounters& sum, const RenderCounters& counters) {
+
+        sum.drawCalls += counters.drawCalls;
+        sum.triangles += counters.triangles;
+        sum.programBinds += counters.programBinds;
+        sum.textureBinds += counters.textureBinds;
+        sum.vaoBinds += counters.vaoBinds;
+        sum.uniformUploads += counters.uniformUploads;
+        sum.bufferBytes += counters.bufferBytes;
+        sum.culledObjects += counters.culledObjects;
+    }
+
+    bool RenderStats::WriteCsv(const std::string& fileName) {
+
+        std::ofstream file(fileName.c_str());
+        if (!file) {
+            LOG_ERROR("could not create %s", fileName.c_str());
+            return false;
+        }
+        file << "frame";
+        for (int i = 0; i < COUNTER_COUNT; i++) {
+            file << ',' << COUNTER_NAMES[i];
+        }
+        file << '\n';
+        for (size_t frame = 0; frame < history.size(); frame++) {
+            long long values[COUNTER_COUNT];
+            counterValues(history[frame], values);
+            file << frame;
+            for (int i = 0; i < COUNTER_COUNT; i++) {
+                file << ',' << values[i];
+            }
+            file << '\n';
+        }
+        return (bool)file;
+    }
+
+    bool RenderStats::WriteJson(const std::string& fileName) {
+
+        std::ofstream file(fileName.c_str());
+        if (!file) {
+            LOG_ERROR("could not create %s", fileName.c_str());
+            return false;
+        }
+
+        RenderCounters sum = {};
+        for (size_t frame = 0; frame < history.size(); frame++) {
+            Add(sum, history[frame]);
+        }
+        file << "{\n  \"frames\": " << history.size() << ",\n  \"last_frame\": " << CountersJson(lastFrame, 1)
+            << ",\n  \"mean\": " << CountersJson(sum, (int)history.size()) << "\n}\n";
+        return (bool)file;
+    }
+}
@@ -0,0 +1,118 @@
+#ifndef RenderStats_hpp
+#define RenderStats_hpp
+
+#if defined (__APPLE__)
+    #define GL_SILENCE_DEPRECATION
+    #include <OpenGL/gl3.h>
+#else
+    #define GLEW_STATIC
+    #include <GL/glew.h>
+#endif
+
+#include "GLTrace.hpp"
+
+#include <deque>
+#include <string>
+
+namespace gps {
+
+    struct RenderCounters {
+        long long drawCalls;
+        long long triangles;
+        long long programBinds;
+        long long textureBinds;
+        long long vaoBinds;
+        long long uniformUploads;
+        long long bufferBytes;
+        long long culledObjects;
+    };
+
+    //Per-frame counters of the driver work done by the renderer
+    //the counted GL calls go through the wrappers below, which count and forward to GL (through GLTrace);
+    //calls made straight to GL (debug overlays, setup) are not counted
+    class RenderStats {
+
+    public:
+        //frames kept for WriteCsv and the averages of WriteJson
+        static const int HISTORY_FRAMES = 1000;
+
+        //closes the counters of the previous frame
+        static void BeginFrame();
+        //counters of the last finished frame
+        static const RenderCounters& GetLastFrame();
+        //one row per frame from the history
+        static bool WriteCsv(const std::string& fileName);
+        //the last frame and the mean over the history
+        static bool WriteJson(const std::string& fileName);
+        //the counters as a JSON object, divided by frames (a sum over several frames gives the mean)
+        static std::string CountersJson(const RenderCounters& counters, int frames);
+        static void Add(RenderCounters& sum, const RenderCounters& counters);
+
+        static void DrawArrays(GLenum mode, GLint first, GLsizei count) {
+            CountDraw(mode, count);
+            GLTrace::DrawArrays(mode, first, count);
+        }
+        static void DrawElements(GLenum mode, GLsizei count, GLenum type, const void* indices) {
+            CountDraw(mode, count);
+            GLTrace::DrawElements(mode, count, type, indices);
+        }
+        static void UseProgram(GLuint program) {
+            current.programBinds++;
+            GLTrace::UseProgram(program);
+        }
+        static void BindTexture(GLenum target, GLuint texture) {
+            current.textureBinds++;
+            GLTrace::BindTexture(target, texture);
+        }
+        static void BindVertexArray(GLuint array) {
+            current.vaoBinds += array != 0 ? 1 : 0;
+            GLTrace::BindVertexArray(array);
+        }
+        static void Uniform1i(GLint location, GLint value) {
+            current.uniformUploads++;
+            GLTrace::Uniform1i(location, value);
+        }
+        static void Uniform1f(GLint location, GLfloat value) {
+            current.uniformUploads++;
+            GLTrace::Uniform1f(location, value);
+        }
+        static void Uniform2fv(GLint location, GLsizei count, const GLfloat* value) {
+            current.uniformUploads++;
+            GLTrace::Uniform2fv(location, count, value);
+        }
+        static void Uniform3fv(GLint location, GLsizei count, const GLfloat* value) {
+            current.uniformUploads++;
+            GLTrace::Uniform3fv(location, count, value);
+        }
+        static void UniformMatrix4fv(GLint location, GLsizei count, GLboolean transpose, const GLfloat* value) {
+            current.uniformUploads++;
+            GLTrace::UniformMatrix4fv(location, count, transpose, value);
+        }
+        static void BufferData(GLenum target, GLsizeiptr size, const void* data, GLenum usage) {
+            current.bufferBytes += data != NULL ? size : 0;
+            GLTrace::BufferData(target, size, data, usage);
+        }
+        static void BufferSubData(GLenum target, GLintptr offset, GLsizeiptr size, const void* data) {
+            current.bufferBytes += size;
+            GLTrace::BufferSubData(target, offset, size, data);
+        }
+        //objects skipped by the culling, which never reach GL
+        static void CountCulled(int objects) {
+            current.culledObjects += objects;
+        }
+
+    private:
+        static RenderCounters current;
+        static RenderCounters lastFrame;
+        static std::deque<RenderCounters> history;
+        //a frame is being counted: BeginFrame was called before
+        static bool started;
+
+        static void CountDraw(GLenum mode, GLsizei count) {
+            current.drawCalls++;
+            current.triangles += mode == GL_TRIANGLES ? count / 3 : (mode == GL_TRIANGLE_STRIP || mode == GL_TRIANGLE_FAN) ? count - 2 : 0;
+        }
+    };
+}
+
+#endif /* RenderStats_hpp */
@@ -0,0 +1,65 @@
+#ifndef SceneUniforms_hpp
+#define SceneUniforms_hpp
+
+#if defined (__APPLE__)
+    #define GL_SILENCE_DEPRECATION
+    #include <OpenGL/gl3.h>
+#else
+    #define GLEW_STATIC
+    #include <GL/glew.h>
+#endif
+
+#include <glm/glm.hpp>
+
+namespace gps {
+
+    //Uniform blocks shared by every permutation of basic.vert / basic.frag
+    //the structs mirror the std140 layout of the blocks, so any change has to be made in both shaders
+    const GLuint FRAME_DATA_BINDING = 0;
+    const GLuint OBJECT_DATA_BINDING = 1;
+    //size of the light arrays in the blocks (NUM_POINT_LIGHTS in basic.frag)
+    const int MAX_SCENE_POINT_LIGHTS = 3;
+
+    struct PointLightData {
+        glm::vec4 position;
+        //already scaled by the lamp intensity
+        glm::vec4 color;
+        //constant, linear, quadratic, shadow radius
+        glm::vec4 attenuation;
+    };
+
+    //Everything that changes at most once per frame
+    struct FrameData {
+        glm::mat4 view;
+        glm::mat4 projection;
+        glm::mat4 lightSpaceTrMatrix;
+        //eye space direction towards the sun
+        glm::vec4 sunLightDir;
+        glm::vec4 sunLightColor;
+        PointLightData pointLights[MAX_SCENE_POINT_LIGHTS];
+        //point shadow strip origin and tile size, in atlas coordinates
+        glm::vec4 pointShadowRects[MAX_SCENE_POINT_LIGHTS];
+        glm::vec2 evsmExponents;
+        GLint shadowKernel;
+        GLint shadowSamples;
+        GLfloat shadowFilterRadius;
+        GLfloat shadowMinBias;
+        GLfloat shadowSlopeBias;
+        GLfloat vsmMinVariance;
+        GLfloat lightBleedReduction;
+        GLint pointShadowsEnabled;
+        GLint padding[2];
+    };
+
+    //Per draw transforms
+    struct ObjectData {
+        glm::mat4 model;
+        //the upper 3x3 is the normal matrix
+        glm::mat4 normalMatrix;
+    };
+
+    static_assert(sizeof(FrameData) == 464, "FrameData has to match the std140 layout of basic.frag");
+    static_assert(sizeof(ObjectData) == 128, "ObjectData has to match the std140 layout of basic.vert");
+}
+
+#endif /* SceneUniforms_hpp */
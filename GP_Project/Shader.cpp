@@ -7,8 +7,28 @@
 //
 
 #include "Shader.hpp"
+#include "Logger.hpp"
+#include "RenderStats.hpp"
+
+#include <chrono>
+#include <cstdio>
+
+#if defined (_WIN32)
+    #include <direct.h>
+#else
+    #include <sys/stat.h>
+#endif
 
 namespace gps {
+
+    std::string Shader::binaryCacheDirectory;
+    Shader::SetupStats Shader::setupStats = { 0, 0, 0.0 };
+    std::map<GLuint, Shader::PendingProgram> Shader::pendingPrograms;
+    bool Shader::parallelCompile = false;
+
+    //tag at the start of every cached program binary
+    static const GLuint programBinaryMagic = 0x42535047;
+
     std::string Shader::readShaderFile(std::string fileName) {
 
         std::ifstream shaderFile;
@@ -41,7 +61,7 @@ namespace gps {
         if(!success) {
 
             glGetShaderInfoLog(shaderId, 512, NULL, infoLog);
-            std::cout << "Shader compilation error\n" << infoLog << std::endl;
+            LOG_ERROR("Shader compilation error\n%s", infoLog);
         }
     }
     
@@ -53,47 +73,369 @@ namespace gps {
         //check linking info
         glGetProgramiv(shaderProgramId, GL_LINK_STATUS, &success);
         if(!success) {
-            glGetProgramInfoLog(shaderProgram, 512, NULL, infoLog);
-            std::cout << "Shader linking error\n" << infoLog << std::endl;
+            glGetProgramInfoLog(shaderProgramId, 512, NULL, infoLog);
+            LOG_ERROR("Shader linking error\n%s", infoLog);
         }
     }
     
-    void Shader::loadShader(std::string vertexShaderFileName, std::string fragmentShaderFileName) {
+    std::string Shader::injectDefines(std::string source, const std::vector<std::string>& defines) {
 
-        //read, parse and compile the vertex shader
-        std::string v = readShaderFile(vertexShaderFileName);
-        const GLchar* vertexShaderString = v.c_str();
-        GLuint vertexShader;
-        vertexShader = glCreateShader(GL_VERTEX_SHADER);
-        glShaderSource(vertexShader, 1, &vertexShaderString, NULL);
-        glCompileShader(vertexShader);
-        //check compilation status
-        shaderCompileLog(vertexShader);
-        
-        //read, parse and compile the vertex shader
-        std::string f = readShaderFile(fragmentShaderFileName);
-        const GLchar* fragmentShaderString = f.c_str();
-        GLuint fragmentShader;
-        fragmentShader = glCreateShader(GL_FRAGMENT_SHADER);
-        glShaderSource(fragmentShader, 1, &fragmentShaderString, NULL);
-        glCompileShader(fragmentShader);
+        if (defines.empty()) {
+            return source;
+        }
+
+        std::string defineBlock;
+        for (size_t i = 0; i < defines.size(); i++) {
+            defineBlock += "#define " + defines[i] + "\n";
+        }
+
+        //#version has to stay the first statement of the shader
+        size_t insertAt = 0;
+        if (source.compare(0, 8, "#version") == 0) {
+            size_t lineEnd = source.find('\n');
+            insertAt = lineEnd == std::string::npos ? source.size() : lineEnd + 1;
+            //keep the compiler's line numbers matching the file
+            defineBlock += "#line 2\n";
+        }
+        return source.insert(insertAt, defineBlock);
+    }
+
+    GLuint Shader::compileShader(GLenum shaderType, const std::string& source) {
+
+        //parse and compile the shader
+        const GLchar* shaderString = source.c_str();
+        GLuint shader;
+        shader = glCreateShader(shaderType);
+        glShaderSource(shader, 1, &shaderString, NULL);
+        glCompileShader(shader);
         //check compilation status
-        shaderCompileLog(fragmentShader);
-        
-        //attach and link the shader programs
-        this->shaderProgram = glCreateProgram();
-        glAttachShader(this->shaderProgram, vertexShader);
-        glAttachShader(this->shaderProgram, fragmentShader);
-        glLinkProgram(this->shaderProgram);
-        glDeleteShader(vertexShader);
-        glDeleteShader(fragmentShader);
+        shaderCompileLog(shader);
+
+        return shader;
+    }
+
+    void Shader::loadShader(std::string vertexShaderFileName, std::string fragmentShaderFileName) {
+
+        loadShader(vertexShaderFileName, fragmentShaderFileName, std::vector<std::string>());
+    }
+
+    void Shader::loadShader(std::string vertexShaderFileName, std::string fragmentShaderFileName, const std::vector<std::string>& defines) {
+
+        std::vector<GLenum> stages;
+        std::vector<std::string> sources;
+        stages.push_back(GL_VERTEX_SHADER);
+        sources.push_back(injectDefines(readShaderFile(vertexShaderFileName), defines));
+        stages.push_back(GL_FRAGMENT_SHADER);
+        sources.push_back(injectDefines(readShaderFile(fragmentShaderFileName), defines));
+
+        this->shaderProgram = buildProgram(stages, sources);
+    }
+
+    void Shader::loadShader(std::string vertexShaderFileName, std::string geometryShaderFileName, std::string fragmentShaderFileName) {
+
+        std::vector<GLenum> stages;
+        std::vector<std::string> sources;
+        stages.push_back(GL_VERTEX_SHADER);
+        sources.push_back(readShaderFile(vertexShaderFileName));
+        stages.push_back(GL_GEOMETRY_SHADER);
+        sources.push_back(readShaderFile(geometryShaderFileName));
+        stages.push_back(GL_FRAGMENT_SHADER);
+        sources.push_back(readShaderFile(fragmentShaderFileName));
+
+        this->shaderProgram = buildProgram(stages, sources);
+    }
+
+    GLuint Shader::buildProgram(const std::vector<GLenum>& stages, const std::vector<std::string>& sources) {
+
+        std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+
+        std::string cacheFileName = programBinaryFileName(stages, sources);
+        GLuint program = loadProgramBinary(cacheFileName);
+
+        if (program != 0) {
+            setupStats.cachedPrograms++;
+        }
+        else {
+            std::vector<GLuint> shaders;
+            for (size_t i = 0; i < stages.size(); i++) {
+                shaders.push_back(compileShader(stages[i], sources[i]));
+            }
+
+            //attach and link the shader programs
+            program = glCreateProgram();
+            for (size_t i = 0; i < shaders.size(); i++) {
+                glAttachShader(program, shaders[i]);
+            }
+            if (!cacheFileName.empty()) {
+                glProgramParameteri(program, GL_PROGRAM_BINARY_RETRIEVABLE_HINT, GL_TRUE);
+            }
+            glLinkProgram(program);
+
+            //status, logs and the binary cache wait until the program is first needed,
+            //so the driver can keep compiling while the caller moves on
+            PendingProgram pending;
+            pending.shaders = shaders;
+            pending.cacheFileName = cacheFileName;
+            pendingPrograms[program] = pending;
+            setupStats.compiledPrograms++;
+        }
+
+        setupStats.seconds += std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+        return program;
+    }
+
+    void Shader::finishProgram(GLuint program) {
+
+        std::map<GLuint, PendingProgram>::iterator pending = pendingPrograms.find(program);
+        if (pending == pendingPrograms.end()) {
+            return;
+        }
+
+        //blocks until the driver is done with the program
+        std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+        for (size_t i = 0; i < pending->second.shaders.size(); i++) {
+            shaderCompileLog(pending->second.shaders[i]);
+            glDeleteShader(pending->second.shaders[i]);
+        }
         //check linking info
-        shaderLinkLog(this->shaderProgram);
+        shaderLinkLog(program);
+        saveProgramBinary(program, pending->second.cacheFileName);
+        pendingPrograms.erase(pending);
+        setupStats.seconds += std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    }
+
+    void Shader::enableParallelCompile() {
+
+#if !defined (__APPLE__)
+        if (GLEW_KHR_parallel_shader_compile) {
+            //let the driver pick the number of compiler threads
+            glMaxShaderCompilerThreadsKHR(0xFFFFFFFF);
+            parallelCompile = true;
+        }
+#endif
+        LOG_INFO("Parallel shader compilation %s", parallelCompile ? "enabled" : "not supported");
+    }
+
+    bool Shader::programsReady() {
+
+        if (!parallelCompile) {
+            //without the extension any status query would just block
+            return pendingPrograms.empty();
+        }
+
+        for (std::map<GLuint, PendingProgram>::iterator pending = pendingPrograms.begin(); pending != pendingPrograms.end(); ++pending) {
+            GLint completed = GL_FALSE;
+            glGetProgramiv(pending->first, GL_COMPLETION_STATUS_KHR, &completed);
+            if (!completed) {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    void Shader::finishPrograms() {
+
+        while (!pendingPrograms.empty()) {
+            finishProgram(pendingPrograms.begin()->first);
+        }
+    }
+
+    void Shader::setBinaryCacheDirectory(std::string directory) {
+
+        binaryCacheDirectory = directory;
+        if (!directory.empty()) {
+#if defined (_WIN32)
+            _mkdir(directory.c_str());
+#else
+            mkdir(directory.c_str(), 0755);
+#endif
+        }
+    }
+
+    Shader::SetupStats Shader::getSetupStats() {
+
+        return setupStats;
+    }
+
+    std::string Shader::programBinaryFileName(const std::vector<GLenum>& stages, const std::vector<std::string>& sources) {
+
+        if (binaryCacheDirectory.empty()) {
+            return "";
+        }
+
+        //drivers without any binary format can't cache anything
+        GLint formatCount = 0;
+        glGetIntegerv(GL_NUM_PROGRAM_BINARY_FORMATS, &formatCount);
+        if (formatCount <= 0) {
+            return "";
+        }
+
+        //a binary is only valid for the exact sources on the exact driver that produced it
+        std::string key;
+        const GLenum driverStrings[3] = { GL_VENDOR, GL_RENDERER, GL_VERSION };
+        for (int i = 0; i < 3; i++) {
+            const GLubyte* value = glGetString(driverStrings[i]);
+            key += value != NULL ? (const char*)value : "";
+            key += '\n';
+        }
+        for (size_t i = 0; i < stages.size(); i++) {
+            key += std::to_string(stages[i]) + '\n' + sources[i];
+        }
+
+        //64 bit FNV-1a
+        unsigned long long hash = 14695981039346656037ull;
+        for (size_t i = 0; i < key.size(); i++) {
+            hash ^= (unsigned char)key[i];
+            hash *= 1099511628211ull;
+        }
+
+        char name[17];
+        snprintf(name, sizeof(name), "%016llx", hash);
+        return binaryCacheDirectory + "/" + name + ".bin";
+    }
+
+    GLuint Shader::loadProgramBinary(const std::string& fileName) {
+
+        if (fileName.empty()) {
+            return 0;
+        }
+
+        std::ifstream file(fileName, std::ios::binary);
+        GLuint magic = 0;
+        GLenum format = 0;
+        GLint length = 0;
+        file.read((char*)&magic, sizeof(magic));
+        file.read((char*)&format, sizeof(format));
+        file.read((char*)&length, sizeof(length));
+        if (!file || magic != programBinaryMagic || length <= 0) {
+            return 0;
+        }
+
+        std::vector<char> binary(length);
+        file.read(binary.data(), length);
+        if (!file) {
+            return 0;
+        }
+
+        //a driver update can reject the binary, the caller then compiles from source
+        GLuint program = glCreateProgram();
+        glProgramBinary(program, format, binary.data(), length);
+        GLint success = GL_FALSE;
+        glGetProgramiv(program, GL_LINK_STATUS, &success);
+        if (!success) {
+            glDeleteProgram(program);
+            return 0;
+        }
+        return program;
+    }
+
+    void Shader::saveProgramBinary(GLuint program, const std::string& fileName) {
+
+        GLint success = GL_FALSE;
+        GLint length = 0;
+        glGetProgramiv(program, GL_LINK_STATUS, &success);
+        glGetProgramiv(program, GL_PROGRAM_BINARY_LENGTH, &length);
+        if (fileName.empty() || !success || length <= 0) {
+            return;
+        }
+
+        std::vector<char> binary(length);
+        GLenum format = 0;
+        glGetProgramBinary(program, length, &length, &format, binary.data());
+
+        std::ofstream file(fileName, std::ios::binary | std::ios::trunc);
+        file.write((const char*)&programBinaryMagic, sizeof(programBinaryMagic));
+        file.write((const char*)&format, sizeof(format));
+        file.write((const char*)&length, sizeof(length));
+        file.write(binary.data(), length);
     }
     
     void Shader::useShaderProgram() {
 
-        glUseProgram(this->shaderProgram);
+        if (this->shaderProgram == 0 && this->permutations) {
+            this->shaderProgram = compilePermutation(this->permutationKey);
+        }
+        if (!pendingPrograms.empty()) {
+            finishProgram(this->shaderProgram);
+        }
+        RenderStats::UseProgram(this->shaderProgram);
+    }
+
+    void Shader::loadPermutations(std::string vertexShaderFileName, std::string fragmentShaderFileName) {
+
+        this->permutations = std::make_shared<PermutationCache>();
+        this->permutations->vertexShaderFileName = vertexShaderFileName;
+        this->permutations->fragmentShaderFileName = fragmentShaderFileName;
+        this->permutations->setup = NULL;
+        this->permutationKey = 0;
+        this->shaderProgram = 0;
+    }
+
+    void Shader::addPermutationOption(std::string name, int firstBit, int bitCount) {
+
+        PermutationOption option;
+        option.name = name;
+        option.firstBit = firstBit;
+        option.bitCount = bitCount;
+        this->permutations->options.push_back(option);
+    }
+
+    void Shader::setPermutationSetup(void (*setup)(gps::Shader permutation)) {
+
+        this->permutations->setup = setup;
+    }
+
+    gps::Shader Shader::getPermutation(unsigned int key) {
+
+        gps::Shader permutation = *this;
+        permutation.permutationKey = key;
+
+        //not compiled yet: useShaderProgram does it on first use
+        std::map<unsigned int, GLuint>::iterator program = this->permutations->programs.find(key);
+        permutation.shaderProgram = program != this->permutations->programs.end() ? program->second : 0;
+        return permutation;
+    }
+
+    gps::Shader Shader::getMaterialPermutation(unsigned int materialFeatures) {
+
+        return getPermutation((this->permutationKey & ~MATERIAL_FEATURE_MASK) | (materialFeatures & MATERIAL_FEATURE_MASK));
+    }
+
+    bool Shader::hasPermutations() {
+
+        return this->permutations != NULL;
+    }
+
+    GLuint Shader::compilePermutation(unsigned int key) {
+
+        std::map<unsigned int, GLuint>::iterator cached = this->permutations->programs.find(key);
+        if (cached != this->permutations->programs.end()) {
+            return cached->second;
+        }
+
+        std::vector<std::string> defines;
+        defines.push_back("HAS_TEXCOORDS " + std::to_string((key & FEATURE_TEXCOORDS) ? 1 : 0));
+        defines.push_back("HAS_DIFFUSE_TEXTURE " + std::to_string((key & FEATURE_DIFFUSE_TEXTURE) ? 1 : 0));
+        defines.push_back("HAS_SPECULAR_TEXTURE " + std::to_string((key & FEATURE_SPECULAR_TEXTURE) ? 1 : 0));
+        for (size_t i = 0; i < this->permutations->options.size(); i++) {
+            const PermutationOption& option = this->permutations->options[i];
+            unsigned int value = (key >> option.firstBit) & ((1u << option.bitCount) - 1);
+            defines.push_back(option.name + " " + std::to_string(value));
+        }
+
+        gps::Shader permutation = *this;
+        permutation.loadShader(this->permutations->vertexShaderFileName, this->permutations->fragmentShaderFileName, defines);
+        permutation.permutationKey = key;
+        //needed right away by the draw that asked for it
+        finishProgram(permutation.shaderProgram);
+        this->permutations->programs[key] = permutation.shaderProgram;
+
+        LOG_INFO("Compiled permutation %u of %s", key, this->permutations->fragmentShaderFileName.c_str());
+
+        if (this->permutations->setup != NULL) {
+            this->permutations->setup(permutation);
+        }
+        return permutation.shaderProgram;
     }
 
 }
@@ -20,21 +20,112 @@
 #include <fstream>
 #include <sstream>
 #include <iostream>
+#include <map>
+#include <memory>
+#include <string>
+#include <vector>
 
 
 namespace gps {
+
+    //Low bits of a permutation key, describing the mesh being drawn (see Mesh::Draw);
+    //they become HAS_TEXCOORDS, HAS_DIFFUSE_TEXTURE and HAS_SPECULAR_TEXTURE
+    enum MaterialFeature {
+        FEATURE_TEXCOORDS = 1 << 0,
+        FEATURE_DIFFUSE_TEXTURE = 1 << 1,
+        FEATURE_SPECULAR_TEXTURE = 1 << 2
+    };
+    const int MATERIAL_FEATURE_BITS = 3;
+    const unsigned int MATERIAL_FEATURE_MASK = (1u << MATERIAL_FEATURE_BITS) - 1;
     
     class Shader {
 
     public:
-        GLuint shaderProgram;
+        GLuint shaderProgram = 0;
         void loadShader(std::string vertexShaderFileName, std::string fragmentShaderFileName);
+        void loadShader(std::string vertexShaderFileName, std::string geometryShaderFileName, std::string fragmentShaderFileName);
+        //same as above, with "NAME VALUE" macros defined in every stage right after the #version line
+        void loadShader(std::string vertexShaderFileName, std::string fragmentShaderFileName, const std::vector<std::string>& defines);
+        //compiles a pending permutation first
         void useShaderProgram();
+
+        //Permutations: one vertex/fragment pair compiled with different #defines
+        //every permutation is compiled the first time it is used and cached by its key;
+        //copies of the shader share the cache
+        void loadPermutations(std::string vertexShaderFileName, std::string fragmentShaderFileName);
+        //key bits [firstBit, firstBit + bitCount) are defined as "name value"
+        void addPermutationOption(std::string name, int firstBit, int bitCount);
+        //called once for every newly compiled permutation, e.g. to bind uniform blocks and samplers
+        void setPermutationSetup(void (*setup)(gps::Shader permutation));
+        gps::Shader getPermutation(unsigned int key);
+        //this permutation with its material bits replaced
+        gps::Shader getMaterialPermutation(unsigned int materialFeatures);
+        bool hasPermutations();
+
+        //Program binary cache: linked programs are saved to the directory and reloaded
+        //on the next run instead of being compiled; an empty directory disables it
+        static void setBinaryCacheDirectory(std::string directory);
+
+        struct SetupStats {
+            int cachedPrograms;
+            int compiledPrograms;
+            //time spent creating programs, cached or not
+            double seconds;
+        };
+        static SetupStats getSetupStats();
+
+        //Deferred status checks: loadShader only submits the program, its compile and link
+        //status is checked (and errors reported) when it is first used or on finishPrograms;
+        //loading all the programs up front lets the driver compile them while assets load
+        //uses GL_KHR_parallel_shader_compile when the driver has it
+        static void enableParallelCompile();
+        //true when no submitted program would block on a status query
+        static bool programsReady();
+        //checks every program that is still pending
+        static void finishPrograms();
     
     private:
+        struct PendingProgram {
+            std::vector<GLuint> shaders;
+            std::string cacheFileName;
+        };
+
+        static std::string binaryCacheDirectory;
+        static SetupStats setupStats;
+        //submitted programs whose status was not checked yet, by program id
+        static std::map<GLuint, PendingProgram> pendingPrograms;
+        static bool parallelCompile;
+
+        static void finishProgram(GLuint program);
+
+        struct PermutationOption {
+            std::string name;
+            int firstBit;
+            int bitCount;
+        };
+
+        struct PermutationCache {
+            std::string vertexShaderFileName;
+            std::string fragmentShaderFileName;
+            std::vector<PermutationOption> options;
+            void (*setup)(gps::Shader permutation);
+            std::map<unsigned int, GLuint> programs;
+        };
+
+        std::shared_ptr<PermutationCache> permutations;
+        unsigned int permutationKey = 0;
+
+        GLuint compilePermutation(unsigned int key);
+
         std::string readShaderFile(std::string fileName);
-        void shaderCompileLog(GLuint shaderId);
-        void shaderLinkLog(GLuint shaderProgramId);
+        std::string injectDefines(std::string source, const std::vector<std::string>& defines);
+        GLuint compileShader(GLenum shaderType, const std::string& source);
+        GLuint buildProgram(const std::vector<GLenum>& stages, const std::vector<std::string>& sources);
+        std::string programBinaryFileName(const std::vector<GLenum>& stages, const std::vector<std::string>& sources);
+        GLuint loadProgramBinary(const std::string& fileName);
+        static void saveProgramBinary(GLuint program, const std::string& fileName);
+        static void shaderCompileLog(GLuint shaderId);
+        static void shaderLinkLog(GLuint shaderProgramId);
     };
     
 }
@@ -7,66 +7,195 @@
 //
 
 #include "SkyBox.hpp"
+#include "RenderStats.hpp"
+#include "GLTraceHooks.hpp"
 
 namespace gps {
     
     SkyBox::SkyBox()
     {
-        
+        skyboxVAO = 0;
+        skyboxVBO = 0;
+        cubemapTexture = 0;
+        nightCubemapTexture = 0;
+        blendFactor = 0.0f;
+        texturesLoaded = false;
+        proceduralCubemap = 0;
+        proceduralFBO = 0;
+        proceduralSize = 0;
     }
     
     void SkyBox::Load(std::vector<const GLchar*> cubeMapFaces)
     {
-        cubemapTexture = LoadSkyBoxTextures(cubeMapFaces);
+        Load(cubeMapFaces, cubeMapFaces);
+    }
+
+    void SkyBox::Load(std::vector<const GLchar*> dayCubeMapFaces, std::vector<const GLchar*> nightCubeMapFaces)
+    {
+        dayFaces.assign(dayCubeMapFaces.begin(), dayCubeMapFaces.end());
+        nightFaces.assign(nightCubeMapFaces.begin(), nightCubeMapFaces.end());
+        texturesLoaded = false;
         InitSkyBox();
     }
+
+    void SkyBox::Delete()
+    {
+        if (nightCubemapTexture != cubemapTexture) {
+            glDeleteTextures(1, &nightCubemapTexture);
+        }
+        glDeleteTextures(1, &cubemapTexture);
+        glDeleteTextures(1, &proceduralCubemap);
+        glDeleteFramebuffers(1, &proceduralFBO);
+        glDeleteBuffers(1, &skyboxVBO);
+        glDeleteVertexArrays(1, &skyboxVAO);
+        cubemapTexture = 0;
+        nightCubemapTexture = 0;
+        proceduralCubemap = 0;
+        proceduralFBO = 0;
+        texturesLoaded = false;
+    }
+
+    void SkyBox::SetBlendFactor(float blendFactor)
+    {
+        this->blendFactor = glm::clamp(blendFactor, 0.0f, 1.0f);
+    }
     
     void SkyBox::Draw(gps::Shader shader, glm::mat4 viewMatrix, glm::mat4 projectionMatrix)
+    {
+        LoadTexturesIfNeeded();
+        DrawCube(shader, viewMatrix, projectionMatrix, cubemapTexture, nightCubemapTexture, blendFactor);
+    }
+
+    void SkyBox::DrawProcedural(gps::Shader proceduralShader, glm::mat4 viewMatrix, glm::mat4 projectionMatrix)
+    {
+        DrawCube(proceduralShader, viewMatrix, projectionMatrix, 0, 0, 0.0f);
+    }
+
+    void SkyBox::DrawCached(gps::Shader shader, glm::mat4 viewMatrix, glm::mat4 projectionMatrix)
+    {
+        DrawCube(shader, viewMatrix, projectionMatrix, proceduralCubemap, proceduralCubemap, 0.0f);
+    }
+
+    void SkyBox::RenderProceduralCubemap(gps::Shader proceduralShader, int size)
+    {
+        if (proceduralCubemap == 0 || size != proceduralSize) {
+            glDeleteTextures(1, &proceduralCubemap);
+            glGenTextures(1, &proceduralCubemap);
+            glBindTexture(GL_TEXTURE_CUBE_MAP, proceduralCubemap);
+            for (GLuint i = 0; i < 6; i++) {
+                glTexImage2D(GL_TEXTURE_CUBE_MAP_POSITIVE_X + i, 0, GL_RGBA16F, size, size, 0, GL_RGBA, GL_HALF_FLOAT, NULL);
+            }
+            glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+            glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+            glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+            glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+            glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_WRAP_R, GL_CLAMP_TO_EDGE);
+            glBindTexture(GL_TEXTURE_CUBE_MAP, 0);
+            proceduralSize = size;
+
+            if (proceduralFBO == 0) {
+                glGenFramebuffers(1, &proceduralFBO);
+            }
+        }
+
+        //same face orientation as the cubemap lookups expect
+        static const glm::vec3 faceDirections[6] = {
+            glm::vec3(1.0f, 0.0f, 0.0f), glm::vec3(-1.0f, 0.0f, 0.0f),
+            glm::vec3(0.0f, 1.0f, 0.0f), glm::vec3(0.0f, -1.0f, 0.0f),
+            glm::vec3(0.0f, 0.0f, 1.0f), glm::vec3(0.0f, 0.0f, -1.0f)
+        };
+        static const glm::vec3 faceUps[6] = {
+            glm::vec3(0.0f, -1.0f, 0.0f), glm::vec3(0.0f, -1.0f, 0.0f),
+            glm::vec3(0.0f, 0.0f, 1.0f), glm::vec3(0.0f, 0.0f, -1.0f),
+            glm::vec3(0.0f, -1.0f, 0.0f), glm::vec3(0.0f, -1.0f, 0.0f)
+        };
+        glm::mat4 faceProjection = glm::perspective(glm::radians(90.0f), 1.0f, 0.1f, 10.0f);
+
+        glBindFramebuffer(GL_FRAMEBUFFER, proceduralFBO);
+        glViewport(0, 0, size, size);
+        glDisable(GL_DEPTH_TEST);
+        for (GLuint i = 0; i < 6; i++) {
+            glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_CUBE_MAP_POSITIVE_X + i, proceduralCubemap, 0);
+            glm::mat4 faceView = glm::lookAt(glm::vec3(0.0f), faceDirections[i], faceUps[i]);
+            DrawCube(proceduralShader, faceView, faceProjection, 0, 0, 0.0f);
+        }
+        glEnable(GL_DEPTH_TEST);
+        glBindFramebuffer(GL_FRAMEBUFFER, 0);
+    }
+
+    void SkyBox::DrawCube(gps::Shader shader, glm::mat4 viewMatrix, glm::mat4 projectionMatrix, GLuint dayTexture, GLuint nightTexture, float blend)
     {
         shader.useShaderProgram();
         
         //set the view and projection matrices
         glm::mat4 transformedView = glm::mat4(glm::mat3(viewMatrix));
-        glUniformMatrix4fv(glGetUniformLocation(shader.shaderProgram, "view"), 1, GL_FALSE, glm::value_ptr(transformedView));
-        glUniformMatrix4fv(glGetUniformLocation(shader.shaderProgram, "projection"), 1, GL_FALSE, glm::value_ptr(projectionMatrix));
+        RenderStats::UniformMatrix4fv(glGetUniformLocation(shader.shaderProgram, "view"), 1, GL_FALSE, glm::value_ptr(transformedView));
+        RenderStats::UniformMatrix4fv(glGetUniformLocation(shader.shaderProgram, "projection"), 1, GL_FALSE, glm::value_ptr(projectionMatrix));
         
         glDepthFunc(GL_LEQUAL);
         
-        glBindVertexArray(skyboxVAO);
-        glActiveTexture(GL_TEXTURE0);
-        glUniform1i(glGetUniformLocation(shader.shaderProgram, "skybox"), 0);
-        glBindTexture(GL_TEXTURE_CUBE_MAP, cubemapTexture);
-        glDrawArrays(GL_TRIANGLES, 0, 36);
-        glBindVertexArray(0);
+        RenderStats::BindVertexArray(skyboxVAO);
+        if (dayTexture != 0) {
+            glActiveTexture(GL_TEXTURE0);
+            RenderStats::Uniform1i(glGetUniformLocation(shader.shaderProgram, "skybox"), 0);
+            RenderStats::BindTexture(GL_TEXTURE_CUBE_MAP, dayTexture);
+            glActiveTexture(GL_TEXTURE1);
+            RenderStats::Uniform1i(glGetUniformLocation(shader.shaderProgram, "nightSkybox"), 1);
+            RenderStats::BindTexture(GL_TEXTURE_CUBE_MAP, nightTexture);
+            RenderStats::Uniform1f(glGetUniformLocation(shader.shaderProgram, "blendFactor"), blend);
+        }
+        RenderStats::DrawArrays(GL_TRIANGLES, 0, 36);
+        RenderStats::BindVertexArray(0);
         
         glDepthFunc(GL_LESS);
     }
+
+    void SkyBox::LoadTexturesIfNeeded()
+    {
+        if (texturesLoaded) {
+            return;
+        }
+
+        cubemapTexture = LoadSkyBoxTextures(dayFaces);
+        nightCubemapTexture = nightFaces == dayFaces ? cubemapTexture : LoadSkyBoxTextures(nightFaces);
+        texturesLoaded = true;
+    }
     
-    GLuint SkyBox::LoadSkyBoxTextures(std::vector<const GLchar*> skyBoxFaces)
+    GLuint SkyBox::LoadSkyBoxTextures(const std::vector<std::string>& skyBoxFaces)
     {
+        //a baked cubemap replaces the six face images
+        if (skyBoxFaces.size() == 1 && KtxCubemap::IsKtxFile(skyBoxFaces[0])) {
+            return KtxCubemap::Load(skyBoxFaces[0]);
+        }
+
         GLuint textureID;
         glGenTextures(1, &textureID);
         glActiveTexture(GL_TEXTURE0);
         
         int width,height, n;
         unsigned char* image;
-        int force_channels = 3;
+        //four channels keep every row aligned for the upload
+        int force_channels = 4;
         
         glBindTexture(GL_TEXTURE_CUBE_MAP, textureID);
         for(GLuint i = 0; i < skyBoxFaces.size(); i++)
         {
-            image = stbi_load(skyBoxFaces[i], &width, &height, &n, force_channels);
+            image = stbi_load(skyBoxFaces[i].c_str(), &width, &height, &n, force_channels);
             if (!image) {
-                fprintf(stderr, "ERROR: could not load %s\n", skyBoxFaces[i]);
-                return false;
+                fprintf(stderr, "ERROR: could not load %s\n", skyBoxFaces[i].c_str());
+                glBindTexture(GL_TEXTURE_CUBE_MAP, 0);
+                glDeleteTextures(1, &textureID);
+                return 0;
             }
             glTexImage2D(
                          GL_TEXTURE_CUBE_MAP_POSITIVE_X + i, 0,
-                         GL_RGB, width, height, 0, GL_RGB, GL_UNSIGNED_BYTE, image
+                         GL_RGBA8, width, height, 0, GL_RGBA, GL_UNSIGNED_BYTE, image
                          );
+            stbi_image_free(image);
         }
+        glGenerateMipmap(GL_TEXTURE_CUBE_MAP);
         glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
-        glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+        glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
         glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
         glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
         glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_WRAP_R, GL_CLAMP_TO_EDGE);
@@ -136,6 +265,7 @@ namespace gps {
     
     GLuint SkyBox::GetTextureId()
     {
+        LoadTexturesIfNeeded();
         return cubemapTexture;
     }
 }
@@ -11,11 +11,14 @@
 
 
 #include "Shader.hpp"
+#include "KtxCubemap.hpp"
 #include "stb_image.h"
 
 #include <glm/glm.hpp>
 #include <glm/gtc/type_ptr.hpp>
+#include <glm/gtc/matrix_transform.hpp>
 
+#include <string>
 #include <vector>
 #include <stdio.h>
 
@@ -24,14 +27,37 @@ namespace gps {
     {
     public:
         SkyBox();
+        //either the six face images (+x, -x, +y, -y, +z, -z) or a single baked .ktx2 cubemap
         void Load(std::vector<const GLchar*> cubeMapFaces);
+        //both cubemaps stay resident, Draw crossfades between them
+        //the images are only read the first time Draw needs them
+        void Load(std::vector<const GLchar*> dayCubeMapFaces, std::vector<const GLchar*> nightCubeMapFaces);
+        void Delete();
+        //0 shows the day cubemap, 1 the night one
+        void SetBlendFactor(float blendFactor);
         void Draw(gps::Shader shader, glm::mat4 viewMatrix, glm::mat4 projectionMatrix);
+        //draws the cube with a shader that computes the sky itself (no textures)
+        void DrawProcedural(gps::Shader proceduralShader, glm::mat4 viewMatrix, glm::mat4 projectionMatrix);
+        //renders proceduralShader into a small cubemap, to be drawn by DrawCached
+        void RenderProceduralCubemap(gps::Shader proceduralShader, int size);
+        //draws the last RenderProceduralCubemap result through the regular cubemap shader
+        void DrawCached(gps::Shader shader, glm::mat4 viewMatrix, glm::mat4 projectionMatrix);
         GLuint GetTextureId();
     private:
         GLuint skyboxVAO;
         GLuint skyboxVBO;
         GLuint cubemapTexture;
-        GLuint LoadSkyBoxTextures(std::vector<const GLchar*> cubeMapFaces);
+        GLuint nightCubemapTexture;
+        float blendFactor;
+        std::vector<std::string> dayFaces;
+        std::vector<std::string> nightFaces;
+        bool texturesLoaded;
+        GLuint proceduralCubemap;
+        GLuint proceduralFBO;
+        int proceduralSize;
+        GLuint LoadSkyBoxTextures(const std::vector<std::string>& cubeMapFaces);
+        void LoadTexturesIfNeeded();
+        void DrawCube(gps::Shader shader, glm::mat4 viewMatrix, glm::mat4 projectionMatrix, GLuint dayTexture, GLuint nightTexture, float blend);
         void InitSkyBox();
     };
 }
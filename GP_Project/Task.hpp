@@ -0,0 +1,254 @@
+#ifndef Task_hpp
+#define Task_hpp
+
+#include "JobSystem.hpp"
+
+#include <atomic>
+#include <coroutine>
+#include <exception>
+#include <memory>
+#include <utility>
+#include <vector>
+
+namespace gps {
+
+    //Result of a coroutine, for asset loading: co_awaited by another coroutine, or started and polled by plain code
+    //a task only starts when it is first awaited (or started), so its awaiter is known before it can finish;
+    //it resumes the awaiter on the thread it finished on, which the awaitables below choose: ResumeOnJobs
+    //moves a coroutine to the job system, UploadThread::Upload to the render thread
+    //T is a value (a task of nothing returns a bool); the engine does not use exceptions, one escaping a coroutine terminates
+    template <typename T>
+    class Task {
+
+    public:
+        struct promise_type;
+        typedef std::coroutine_handle<promise_type> Handle;
+
+        struct FinalAwaiter {
+            bool await_ready() const noexcept {
+                return false;
+            }
+            std::coroutine_handle<> await_suspend(Handle coroutine) noexcept {
+                //read before done is set: a poller may destroy the frame right after
+                std::coroutine_handle<> continuation = coroutine.promise().continuation;
+                coroutine.promise().done.store(true, std::memory_order_release);
+                if (continuation) {
+                    return continuation;
+                }
+                return std::noop_coroutine();
+            }
+            void await_resume() const noexcept {
+            }
+        };
+
+        struct promise_type {
+            T value{};
+            std::coroutine_handle<> continuation;
+            std::atomic<bool> done{ false };
+
+            Task get_return_object() {
+                return Task(Handle::from_promise(*this));
+            }
+            std::suspend_always initial_suspend() const noexcept {
+                return {};
+            }
+            FinalAwaiter final_suspend() const noexcept {
+                return {};
+            }
+            void return_value(T result) {
+                value = std::move(result);
+            }
+            void unhandled_exception() {
+                std::terminate();
+            }
+        };
+
+        //starts the task in await_suspend, and hands its value to the awaiter
+        struct Awaiter {
+            Handle coroutine;
+
+            bool await_ready() const noexcept {
+                return false;
+            }
+            std::coroutine_handle<> await_suspend(std::coroutine_handle<> awaiting) noexcept {
+                coroutine.promise().continuation = awaiting;
+                return coroutine;
+            }
+            T await_resume() {
+                return std::move(coroutine.promise().value);
+            }
+        };
+
+        Task() : coroutine(nullptr) {
+        }
+        Task(Task&& other) noexcept : coroutine(other.coroutine) {
+            other.coroutine = nullptr;
+        }
+        Task& operator=(Task&& other) noexcept {
+            if (this != &other) {
+                Destroy();
+                coroutine = other.coroutine;
+                other.coroutine = nullptr;
+            }
+            return *this;
+        }
+        Task(const Task&) = delete;
+        Task& operator=(const Task&) = delete;
+        //a task still running must not be dropped: wait for IsDone first
+        ~Task() {
+            Destroy();
+        }
+
+        Awaiter operator co_await() && noexcept {
+            return Awaiter{ coroutine };
+        }
+        //runs the task on the calling thread up to its first suspension, for a task nobody awaits
+        void Start() {
+            coroutine.resume();
+        }
+        bool IsValid() const {
+            return coroutine != nullptr;
+        }
+        //any thread
+        bool IsDone() const {
+            return coroutine != nullptr && coroutine.promise().done.load(std::memory_order_acquire);
+        }
+        //once IsDone
+        T& GetResult() {
+            return coroutine.promise().value;
+        }
+
+    private:
+        Handle coroutine;
+
+        explicit Task(Handle coroutine) : coroutine(coroutine) {
+        }
+        void Destroy() {
+            if (coroutine) {
+                coroutine.destroy();
+                coroutine = nullptr;
+            }
+        }
+    };
+
+    //co_await ResumeOnJobs() continues the coroutine on a job; the thread that awaited goes on with its work
+    //without a started job system, or with the calling thread as its only one, the coroutine just goes on
+    struct ResumeOnJobs {
+        bool await_ready() const noexcept {
+            return !JobSystem::IsRunning() || JobSystem::GetThreadCount() == 1;
+        }
+        void await_suspend(std::coroutine_handle<> coroutine) const {
+            JobSystem::Spawn([coroutine]() { coroutine.resume(); });
+        }
+        void await_resume() const noexcept {
+        }
+    };
+
+    //Cancels a group of loads (the ones of a scene) and counts how far they got
+    //copies share the state; a load checks it between its steps, a step already running completes
+    class LoadToken {
+
+    public:
+        LoadToken() : state(std::make_shared<State>()) {
+        }
+        void Cancel() {
+            state->cancelled.store(true);
+        }
+        bool IsCancelled() const {
+            return state->cancelled.load();
+        }
+        //a load announces its steps when it starts and finishes every one of them, the skipped ones included
+        void AddSteps(int steps) {
+            state->steps.fetch_add(steps);
+        }
+        void FinishSteps(int steps) {
+            state->finishedSteps.fetch_add(steps);
+        }
+        //finished steps over the announced ones, 1 before any load started
+        float GetProgress() const {
+            int steps = state->steps.load();
+            return steps > 0 ? (float)state->finishedSteps.load() / steps : 1.0f;
+        }
+
+    private:
+        struct State {
+            std::atomic<bool> cancelled{ false };
+            std::atomic<int> steps{ 0 };
+            std::atomic<int> finishedSteps{ 0 };
+        };
+
+        std::shared_ptr<State> state;
+    };
+
+    namespace detail {
+
+        //a coroutine nobody awaits and that frees itself, runs WhenAll's tasks side by side
+        struct DetachedTask {
+            struct promise_type {
+                DetachedTask get_return_object() const noexcept {
+                    return {};
+                }
+                std::suspend_never initial_suspend() const noexcept {
+                    return {};
+                }
+                std::suspend_never final_suspend() const noexcept {
+                    return {};
+                }
+                void return_void() const noexcept {
+                }
+                void unhandled_exception() const {
+                    std::terminate();
+                }
+            };
+        };
+
+        template <typename T>
+        struct WhenAllSlot {
+            T value{};
+        };
+
+        template <typename T>
+        struct WhenAllAwaiter {
+            std::vector<Task<T> >& tasks;
+            std::vector<WhenAllSlot<T> >& results;
+            //the tasks still running, and one for await_suspend itself
+            std::atomic<int> remaining{ 0 };
+
+            static DetachedTask Run(Task<T> task, WhenAllSlot<T>& result, std::atomic<int>& remaining, std::coroutine_handle<> whenAll) {
+                result.value = co_await std::move(task);
+                if (remaining.fetch_sub(1, std::memory_order_acq_rel) == 1) {
+                    whenAll.resume();
+                }
+            }
+
+            bool await_ready() const noexcept {
+                return tasks.empty();
+            }
+            bool await_suspend(std::coroutine_handle<> whenAll) {
+                remaining.store((int)tasks.size() + 1, std::memory_order_relaxed);
+                for (size_t i = 0; i < tasks.size(); i++) {
+                    Run(std::move(tasks[i]), results[i], remaining, whenAll);
+                }
+                //every task finished on this thread: no suspension
+                return remaining.fetch_sub(1, std::memory_order_acq_rel) != 1;
+            }
+            void await_resume() const noexcept {
+            }
+        };
+    }
+
+    //runs the tasks side by side, the result of each in the same order once all of them are done
+    template <typename T>
+    Task<std::vector<T> > WhenAll(std::vector<Task<T> > tasks) {
+
+        std::vector<detail::WhenAllSlot<T> > slots(tasks.size());
+        co_await detail::WhenAllAwaiter<T>{ tasks, slots };
+        std::vector<T> results;
+        for (size_t i = 0; i < slots.size(); i++) {
+            results.push_back(std::move(slots[i].value));
+        }
+        co_return results;
+    }
+}
+
+#endif /* Task_hpp */
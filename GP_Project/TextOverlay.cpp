@@ -0,0 +1,229 @@
+#include "TextOverlay.hpp"
+
+#include <cctype>
+#include <cstddef>
+
+#include "GLTraceHooks.hpp"
+
+namespace gps {
+
+    namespace {
+
+        struct Glyph {
+            char character;
+            //5 pixels per row, the most significant bit is the leftmost pixel
+            unsigned char rows[7];
+        };
+
+        const Glyph FONT[] = {
+            { ' ', { 0b00000, 0b00000, 0b00000, 0b00000, 0b00000, 0b00000, 0b00000 } },
+            { '?', { 0b01110, 0b10001, 0b00001, 0b00010, 0b00100, 0b00000, 0b00100 } },
+            { '0', { 0b01110, 0b10001, 0b10011, 0b10101, 0b11001, 0b10001, 0b01110 } },
+            { '1', { 0b00100, 0b01100, 0b00100, 0b00100, 0b00100, 0b00100, 0b01110 } },
+            { '2', { 0b01110, 0b10001, 0b00001, 0b00010, 0b00100, 0b01000, 0b11111 } },
+            { '3', { 0b11111, 0b00010, 0b00100, 0b00010, 0b00001, 0b10001, 0b01110 } },
+            { '4', { 0b00010, 0b00110, 0b01010, 0b10010, 0b11111, 0b00010, 0b00010 } },
+            { '5', { 0b11111, 0b10000, 0b11110, 0b00001, 0b00001, 0b10001, 0b01110 } },
+            { '6', { 0b00110, 0b01000, 0b10000, 0b11110, 0b10001, 0b10001, 0b01110 } },
+            { '7', { 0b11111, 0b00001, 0b00010, 0b00100, 0b01000, 0b01000, 0b01000 } },
+            { '8', { 0b01110, 0b10001, 0b10001, 0b01110, 0b10001, 0b10001, 0b01110 } },
+            { '9', { 0b01110, 0b10001, 0b10001, 0b01111, 0b00001, 0b00010, 0b01100 } },
+            { 'A', { 0b01110, 0b10001, 0b10001, 0b11111, 0b10001, 0b10001, 0b10001 } },
+            { 'B', { 0b11110, 0b10001, 0b10001, 0b11110, 0b10001, 0b10001, 0b11110 } },
+            { 'C', { 0b01110, 0b10001, 0b10000, 0b10000, 0b10000, 0b10001, 0b01110 } },
+            { 'D', { 0b11100, 0b10010, 0b10001, 0b10001, 0b10001, 0b10010, 0b11100 } },
+            { 'E', { 0b11111, 0b10000, 0b10000, 0b11110, 0b10000, 0b10000, 0b11111 } },
+            { 'F', { 0b11111, 0b10000, 0b10000, 0b11110, 0b10000, 0b10000, 0b10000 } },
+            { 'G', { 0b01110, 0b10001, 0b10000, 0b10111, 0b10001, 0b10001, 0b01111 } },
+            { 'H', { 0b10001, 0b10001, 0b10001, 0b11111, 0b10001, 0b10001, 0b10001 } },
+            { 'I', { 0b01110, 0b00100, 0b00100, 0b00100, 0b00100, 0b00100, 0b01110 } },
+            { 'J', { 0b00111, 0b00010, 0b00010, 0b00010, 0b00010, 0b10010, 0b01100 } },
+            { 'K', { 0b10001, 0b10010, 0b10100, 0b11000, 0b10100, 0b10010, 0b10001 } },
+            { 'L', { 0b10000, 0b10000, 0b10000, 0b10000, 0b10000, 0b10000, 0b11111 } },
+            { 'M', { 0b10001, 0b11011, 0b10101, 0b10101, 0b10001, 0b10001, 0b10001 } },
+            { 'N', { 0b10001, 0b10001, 0b11001, 0b10101, 0b10011, 0b10001, 0b10001 } },
+            { 'O', { 0b01110, 0b10001, 0b10001, 0b10001, 0b10001, 0b10001, 0b01110 } },
+            { 'P', { 0b11110, 0b10001, 0b10001, 0b11110, 0b10000, 0b10000, 0b10000 } },
+            { 'Q', { 0b01110, 0b10001, 0b10001, 0b10001, 0b10101, 0b10010, 0b01101 } },
+            { 'R', { 0b11110, 0b10001, 0b10001, 0b11110, 0b10100, 0b10010, 0b10001 } },
+            { 'S', { 0b01111, 0b10000, 0b10000, 0b01110, 0b00001, 0b00001, 0b11110 } },
+            { 'T', { 0b11111, 0b00100, 0b00100, 0b00100, 0b00100, 0b00100, 0b00100 } },
+            { 'U', { 0b10001, 0b10001, 0b10001, 0b10001, 0b10001, 0b10001, 0b01110 } },
+            { 'V', { 0b10001, 0b10001, 0b10001, 0b10001, 0b10001, 0b01010, 0b00100 } },
+            { 'W', { 0b10001, 0b10001, 0b10001, 0b10101, 0b10101, 0b10101, 0b01010 } },
+            { 'X', { 0b10001, 0b10001, 0b01010, 0b00100, 0b01010, 0b10001, 0b10001 } },
+            { 'Y', { 0b10001, 0b10001, 0b10001, 0b01010, 0b00100, 0b00100, 0b00100 } },
+            { 'Z', { 0b11111, 0b00001, 0b00010, 0b00100, 0b01000, 0b10000, 0b11111 } },
+            { '.', { 0b00000, 0b00000, 0b00000, 0b00000, 0b00000, 0b01100, 0b01100 } },
+            { ',', { 0b00000, 0b00000, 0b00000, 0b00000, 0b01100, 0b00100, 0b01000 } },
+            { ':', { 0b00000, 0b01100, 0b01100, 0b00000, 0b01100, 0b01100, 0b00000 } },
+            { '-', { 0b00000, 0b00000, 0b00000, 0b11111, 0b00000, 0b00000, 0b00000 } },
+            { '+', { 0b00000, 0b00100, 0b00100, 0b11111, 0b00100, 0b00100, 0b00000 } },
+            { '=', { 0b00000, 0b00000, 0b11111, 0b00000, 0b11111, 0b00000, 0b00000 } },
+            { '_', { 0b00000, 0b00000, 0b00000, 0b00000, 0b00000, 0b00000, 0b11111 } },
+            { '/', { 0b00000, 0b00001, 0b00010, 0b00100, 0b01000, 0b10000, 0b00000 } },
+            { '%', { 0b11000, 0b11001, 0b00010, 0b00100, 0b01000, 0b10011, 0b00011 } },
+            { '(', { 0b00010, 0b00100, 0b01000, 0b01000, 0b01000, 0b00100, 0b00010 } },
+            { ')', { 0b01000, 0b00100, 0b00010, 0b00010, 0b00010, 0b00100, 0b01000 } },
+            { '[', { 0b01110, 0b01000, 0b01000, 0b01000, 0b01000, 0b01000, 0b01110 } },
+            { ']', { 0b01110, 0b00010, 0b00010, 0b00010, 0b00010, 0b00010, 0b01110 } },
+            { '#', { 0b01010, 0b01010, 0b11111, 0b01010, 0b11111, 0b01010, 0b01010 } },
+        };
+        const int GLYPH_COUNT = sizeof(FONT) / sizeof(FONT[0]);
+        //one more cell after the glyphs, filled, for the boxes
+        const int SOLID_CELL = GLYPH_COUNT;
+        const int ATLAS_WIDTH = (GLYPH_COUNT + 1) * TextOverlay::CHARACTER_WIDTH;
+        const int ATLAS_HEIGHT = TextOverlay::CHARACTER_HEIGHT;
+
+        int glyphIndex(char character) {
+
+            char upper = (char)std::toupper((unsigned char)character);
+            for (int i = 0; i < GLYPH_COUNT; i++) {
+                if (FONT[i].character == upper) {
+                    return i;
+                }
+            }
+            return 1;
+        }
+    }
+
+    TextOverlay::TextOverlay() {
+
+        fontTexture = 0;
+        VAO = 0;
+        VBO = 0;
+        bufferSize = 0;
+    }
+
+    void TextOverlay::Create() {
+
+        std::vector<unsigned char> pixels(ATLAS_WIDTH * ATLAS_HEIGHT, 0);
+        for (int i = 0; i < GLYPH_COUNT; i++) {
+            for (int row = 0; row < 7; row++) {
+                for (int column = 0; column < 5; column++) {
+                    if (FONT[i].rows[row] & (0x10 >> column)) {
+                        pixels[row * ATLAS_WIDTH + i * CHARACTER_WIDTH + column] = 255;
+                    }
+                }
+            }
+        }
+        for (int row = 0; row < ATLAS_HEIGHT; row++) {
+            for (int column = 0; column < CHARACTER_WIDTH; column++) {
+                pixels[row * ATLAS_WIDTH + SOLID_CELL * CHARACTER_WIDTH + column] = 255;
+            }
+        }
+
+        glGenTextures(1, &fontTexture);
+        glBindTexture(GL_TEXTURE_2D, fontTexture);
+        glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+        glTexImage2D(GL_TEXTURE_2D, 0, GL_R8, ATLAS_WIDTH, ATLAS_HEIGHT, 0, GL_RED, GL_UNSIGNED_BYTE, pixels.data());
+        glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+        //pixel font, no smoothing
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+        glBindTexture(GL_TEXTURE_2D, 0);
+
+        glGenVertexArrays(1, &VAO);
+        glGenBuffers(1, &VBO);
+        glBindVertexArray(VAO);
+        glBindBuffer(GL_ARRAY_BUFFER, VBO);
+        glEnableVertexAttribArray(0);
+        glVertexAttribPointer(0, 2, GL_FLOAT, GL_FALSE, sizeof(Vertex), (GLvoid*)offsetof(Vertex, position));
+        glEnableVertexAttribArray(1);
+        glVertexAttribPointer(1, 2, GL_FLOAT, GL_FALSE, sizeof(Vertex), (GLvoid*)offsetof(Vertex, texCoords));
+        glEnableVertexAttribArray(2);
+        glVertexAttribPointer(2, 4, GL_FLOAT, GL_FALSE, sizeof(Vertex), (GLvoid*)offsetof(Vertex, color));
+        glBindVertexArray(0);
+    }
+
+    void TextOverlay::Delete() {
+
+        glDeleteTextures(1, &fontTexture);
+        glDeleteBuffers(1, &VBO);
+        glDeleteVertexArrays(1, &VAO);
+        fontTexture = 0;
+        VBO = 0;
+        VAO = 0;
+        bufferSize = 0;
+    }
+
+    void TextOverlay::AddQuad(glm::vec2 position, glm::vec2 size, glm::vec2 uvMin, glm::vec2 uvMax, glm::vec4 color) {
+
+        Vertex topLeft = { position, uvMin, color };
+        Vertex topRight = { glm::vec2(position.x + size.x, position.y), glm::vec2(uvMax.x, uvMin.y), color };
+        Vertex bottomLeft = { glm::vec2(position.x, position.y + size.y), glm::vec2(uvMin.x, uvMax.y), color };
+        Vertex bottomRight = { position + size, uvMax, color };
+        vertices.push_back(topLeft);
+        vertices.push_back(bottomLeft);
+        vertices.push_back(topRight);
+        vertices.push_back(topRight);
+        vertices.push_back(bottomLeft);
+        vertices.push_back(bottomRight);
+    }
+
+    void TextOverlay::AddText(float x, float y, const std::string& text, glm::vec4 color, float scale) {
+
+        glm::vec2 cellSize = glm::vec2(CHARACTER_WIDTH, CHARACTER_HEIGHT) * scale;
+        glm::vec2 cellUV = glm::vec2((float)CHARACTER_WIDTH / ATLAS_WIDTH, 1.0f);
+        glm::vec2 pen = glm::vec2(x, y);
+        for (size_t i = 0; i < text.size(); i++) {
+            if (text[i] == '\n') {
+                pen = glm::vec2(x, pen.y + cellSize.y);
+                continue;
+            }
+            if (text[i] != ' ') {
+                glm::vec2 uvMin = glm::vec2(glyphIndex(text[i]) * cellUV.x, 0.0f);
+                AddQuad(pen, cellSize, uvMin, uvMin + cellUV, color);
+            }
+            pen.x += cellSize.x;
+        }
+    }
+
+    void TextOverlay::AddBox(float x, float y, float width, float height, glm::vec4 color) {
+
+        //every texel of the solid cell is 1, its center is enough
+        glm::vec2 uv = glm::vec2((SOLID_CELL + 0.5f) * CHARACTER_WIDTH / ATLAS_WIDTH, 0.5f);
+        AddQuad(glm::vec2(x, y), glm::vec2(width, height), uv, uv, color);
+    }
+
+    void TextOverlay::Draw(gps::Shader shader, int screenWidth, int screenHeight) {
+
+        if (vertices.empty()) {
+            return;
+        }
+
+        glBindBuffer(GL_ARRAY_BUFFER, VBO);
+        if (vertices.size() > bufferSize) {
+            bufferSize = vertices.size() * 2;
+            glBufferData(GL_ARRAY_BUFFER, bufferSize * sizeof(Vertex), NULL, GL_STREAM_DRAW);
+        }
+        glBufferSubData(GL_ARRAY_BUFFER, 0, vertices.size() * sizeof(Vertex), vertices.data());
+        glBindBuffer(GL_ARRAY_BUFFER, 0);
+
+        shader.useShaderProgram();
+        glUniform2f(glGetUniformLocation(shader.shaderProgram, "screenSize"), (float)screenWidth, (float)screenHeight);
+        glActiveTexture(GL_TEXTURE0);
+        glBindTexture(GL_TEXTURE_2D, fontTexture);
+        glUniform1i(glGetUniformLocation(shader.shaderProgram, "fontTexture"), 0);
+
+        GLboolean depthTest = glIsEnabled(GL_DEPTH_TEST);
+        GLboolean blend = glIsEnabled(GL_BLEND);
+        glDisable(GL_DEPTH_TEST);
+        glEnable(GL_BLEND);
+        glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+
+        glBindVertexArray(VAO);
+        glDrawArrays(GL_TRIANGLES, 0, (GLsizei)vertices.size());
+        glBindVertexArray(0);
+
+        if (depthTest) {
+            glEnable(GL_DEPTH_TEST);
+        }
+        if (!blend) {
+            glDisable(GL_BLEND);
+        }
+        vertices.clear();
+    }
+}
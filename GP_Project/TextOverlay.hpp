@@ -0,0 +1,50 @@
+#ifndef TextOverlay_hpp
+#define TextOverlay_hpp
+
+#include "Shader.hpp"
+
+#include <glm/glm.hpp>
+
+#include <string>
+#include <vector>
+
+namespace gps {
+
+    //Screen space text drawn with a built in 5x7 bitmap font, for debug overlays
+    //text and boxes are queued in pixels (origin at the top left corner) and
+    //drawn together in a single call by Draw
+    class TextOverlay {
+
+    public:
+        //size of a character on screen at scale 1, spacing included
+        static const int CHARACTER_WIDTH = 6;
+        static const int CHARACTER_HEIGHT = 8;
+
+        TextOverlay();
+        void Create();
+        void Delete();
+        //lower case letters are drawn upper case, unknown characters as '?'
+        void AddText(float x, float y, const std::string& text, glm::vec4 color, float scale = 1.0f);
+        void AddBox(float x, float y, float width, float height, glm::vec4 color);
+        //draws over the bound framebuffer and empties the queue
+        void Draw(gps::Shader shader, int screenWidth, int screenHeight);
+
+    private:
+        struct Vertex {
+            glm::vec2 position;
+            glm::vec2 texCoords;
+            glm::vec4 color;
+        };
+
+        GLuint fontTexture;
+        GLuint VAO;
+        GLuint VBO;
+        //capacity of the VBO, in vertices
+        size_t bufferSize;
+        std::vector<Vertex> vertices;
+
+        void AddQuad(glm::vec2 position, glm::vec2 size, glm::vec2 uvMin, glm::vec2 uvMax, glm::vec4 color);
+    };
+}
+
+#endif /* TextOverlay_hpp */
@@ -0,0 +1,181 @@
+#include "UploadThread.hpp"
+#include "Logger.hpp"
+#include "Profiler.hpp"
+
+#include <chrono>
+#include <utility>
+
+namespace gps {
+
+    UploadThread::UploadThread() : ringHead(0), ringTail(0), pending(0) {
+
+        window = NULL;
+        running = false;
+        stopping = false;
+        for (unsigned int i = 0; i < RING_SIZE; i++) {
+            ring[i].fence = NULL;
+        }
+    }
+
+    bool UploadThread::Start(GLFWwindow* shareWith) {
+
+        //the hints of the shared window are still set: same version and profile
+        glfwWindowHint(GLFW_VISIBLE, GLFW_FALSE);
+        window = glfwCreateWindow(1, 1, "upload", NULL, shareWith);
+        glfwWindowHint(GLFW_VISIBLE, GLFW_TRUE);
+        if (!window) {
+            LOG_WARNING("could not create the upload context, the uploads run on the render thread");
+            return false;
+        }
+
+        stopping = false;
+        running = true;
+        thread = std::thread(&UploadThread::Run, this);
+        return true;
+    }
+
+    void UploadThread::Stop() {
+
+        if (!running) {
+            return;
+        }
+        //the upload thread may be waiting for room in the ring
+        Finish();
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            stopping = true;
+        }
+        requestAvailable.notify_one();
+        thread.join();
+        running = false;
+        //anything submitted while stopping ran on the upload thread
+        Finish();
+        glfwDestroyWindow(window);
+        window = NULL;
+    }
+
+    bool UploadThread::IsRunning() const {
+
+        return running;
+    }
+
+    void UploadThread::Submit(const UploadFunction& upload, const ReadyFunction& ready) {
+
+        pending++;
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            requests.push_back(Request{ upload, ready });
+        }
+        requestAvailable.notify_one();
+        //the main loop may be idle in glfwWaitEvents, with nothing drawing frames to collect the upload
+        if (running) {
+            glfwPostEmptyEvent();
+        }
+    }
+
+    int UploadThread::Collect() {
+
+        PROFILE_FUNCTION();
+        int collected = 0;
+        if (!running) {
+            //same context: the draws after the upload see its objects, no fence needed
+            std::deque<Request> queued;
+            {
+                std::lock_guard<std::mutex> lock(mutex);
+                queued.swap(requests);
+            }
+            for (size_t i = 0; i < queued.size(); i++) {
+                queued[i].upload();
+                queued[i].ready();
+                pending--;
+                collected++;
+            }
+        }
+        while (CollectOne(0)) {
+            collected++;
+        }
+        return collected;
+    }
+
+    void UploadThread::Finish() {
+
+        PROFILE_FUNCTION();
+        Collect();
+        while (pending > 0) {
+            //an empty ring means the upload thread is still busy with the next one
+            if (!CollectOne(1000000) && ringHead == ringTail) {
+                std::this_thread::sleep_for(std::chrono::milliseconds(1));
+            }
+        }
+    }
+
+    int UploadThread::GetPending() const {
+
+        return pending;
+    }
+
+    void UploadThread::Run() {
+
+        Profiler::SetThreadName("upload");
+        glfwMakeContextCurrent(window);
+        while (true) {
+            Request request;
+            {
+                std::unique_lock<std::mutex> lock(mutex);
+                requestAvailable.wait(lock, [this] { return stopping || !requests.empty(); });
+                if (requests.empty()) {
+                    break;
+                }
+                request = std::move(requests.front());
+                requests.pop_front();
+            }
+
+            PROFILE_ZONE("upload");
+            request.upload();
+            GLsync fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+            //the render context can only see the fence signal once the commands before it were sent
+            glFlush();
+            Publish(fence, std::move(request.ready));
+        }
+        glfwMakeContextCurrent(NULL);
+    }
+
+    void UploadThread::Publish(GLsync fence, ReadyFunction&& ready) {
+
+        unsigned int tail = ringTail.load(std::memory_order_relaxed);
+        while (tail - ringHead.load(std::memory_order_acquire) == RING_SIZE) {
+            PROFILE_ZONE("wait for render thread");
+            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+        }
+        Completion& completion = ring[tail & (RING_SIZE - 1)];
+        completion.fence = fence;
+        completion.ready = std::move(ready);
+        ringTail.store(tail + 1, std::memory_order_release);
+    }
+
+    bool UploadThread::CollectOne(GLuint64 timeout) {
+
+        unsigned int head = ringHead.load(std::memory_order_relaxed);
+        if (head == ringTail.load(std::memory_order_acquire)) {
+            return false;
+        }
+        Completion& completion = ring[head & (RING_SIZE - 1)];
+        //the uploads finish in order on the upload context, the oldest one is the first to signal
+        GLenum status = glClientWaitSync(completion.fence, 0, timeout);
+        if (status == GL_TIMEOUT_EXPIRED) {
+            return false;
+        }
+        if (status == GL_WAIT_FAILED) {
+            LOG_WARNING("waiting for an upload fence failed, using the objects anyway");
+        }
+        glDeleteSync(completion.fence);
+        completion.fence = NULL;
+        ReadyFunction ready = std::move(completion.ready);
+        completion.ready = nullptr;
+        ringHead.store(head + 1, std::memory_order_release);
+
+        ready();
+        pending--;
+        return true;
+    }
+}
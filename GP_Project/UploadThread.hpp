@@ -0,0 +1,112 @@
+#ifndef UploadThread_hpp
+#define UploadThread_hpp
+
+#if defined (__APPLE__)
+    #define GLFW_INCLUDE_GLCOREARB
+    #define GL_SILENCE_DEPRECATION
+#else
+    #define GLEW_STATIC
+    #include <GL/glew.h>
+#endif
+
+#include <GLFW/glfw3.h>
+
+#include <atomic>
+#include <condition_variable>
+#include <coroutine>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <thread>
+
+namespace gps {
+
+    //Creates and fills GL objects on a thread of its own, so a model loading while the scene runs
+    //never stalls the render thread in glBufferData or glTexImage2D
+    //the thread owns a second context sharing the objects of the window's one; buffers and textures
+    //are shared, vertex arrays are not, so an upload stops at the data and the render thread finishes
+    //the objects once the GPU has it. Every upload ends with a fence; the fence and the ready function go
+    //through a single producer, single consumer ring the render thread polls each frame, without a lock
+    //and without waiting on the GPU
+    class UploadThread {
+
+    public:
+        //creates and fills the GL objects, with the upload context current
+        typedef std::function<void()> UploadFunction;
+        //on the render thread, once the GPU has the objects of the upload
+        typedef std::function<void()> ReadyFunction;
+
+        //co_await uploader.Upload(upload): upload runs like a submitted one, and the coroutine resumes
+        //on the render thread (in Collect or Finish) once the GPU has its objects
+        struct UploadAwaitable {
+            UploadThread* uploader;
+            UploadFunction upload;
+
+            bool await_ready() const noexcept {
+                return false;
+            }
+            void await_suspend(std::coroutine_handle<> coroutine) {
+                uploader->Submit(upload, [coroutine]() { coroutine.resume(); });
+            }
+            void await_resume() const noexcept {
+            }
+        };
+
+        UploadThread();
+        //on the main thread (GLFW creates the windows there): a hidden window sharing the objects of
+        //shareWith, and the thread; false when the window can't be created, the uploads then run in Collect
+        bool Start(GLFWwindow* shareWith);
+        //on the render thread, before the context goes away: the uploads already submitted are finished first
+        void Stop();
+        bool IsRunning() const;
+        //any thread; wakes the event loop of the window, which has to keep drawing frames while uploads are pending
+        void Submit(const UploadFunction& upload, const ReadyFunction& ready);
+        UploadAwaitable Upload(const UploadFunction& upload) {
+            return UploadAwaitable{ this, upload };
+        }
+        //on the render thread, every frame: runs the ready functions of the uploads the GPU finished,
+        //in submission order, and returns how many; without the thread it runs the uploads themselves
+        int Collect();
+        //on the render thread: waits for every submitted upload and runs its ready function
+        void Finish();
+        //submitted uploads whose ready function did not run yet
+        int GetPending() const;
+
+    private:
+        struct Request {
+            UploadFunction upload;
+            ReadyFunction ready;
+        };
+
+        struct Completion {
+            GLsync fence;
+            ReadyFunction ready;
+        };
+
+        //a power of two; the upload thread waits when the render thread is this many uploads behind
+        static const unsigned int RING_SIZE = 64;
+
+        GLFWwindow* window;
+        std::thread thread;
+        bool running;
+
+        std::mutex mutex;
+        std::condition_variable requestAvailable;
+        std::deque<Request> requests;
+        bool stopping;
+
+        Completion ring[RING_SIZE];
+        //next completion to collect, only written by the render thread
+        std::atomic<unsigned int> ringHead;
+        //next free slot, only written by the upload thread
+        std::atomic<unsigned int> ringTail;
+        std::atomic<int> pending;
+
+        void Run();
+        void Publish(GLsync fence, ReadyFunction&& ready);
+        //collects the oldest completion, waiting up to timeout nanoseconds for its fence
+        bool CollectOne(GLuint64 timeout);
+    };
+}
+
+#endif /* UploadThread_hpp */
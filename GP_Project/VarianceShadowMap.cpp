@@ -0,0 +1,138 @@
+#include "VarianceShadowMap.hpp"
+
+#include <cmath>
+
+#include "GLTraceHooks.hpp"
+
+namespace gps {
+
+    void VarianceShadowMap::Create(GLsizei width, GLsizei height) {
+
+        this->width = width;
+        this->height = height;
+
+        //moments are rendered into a mipmapped texture, the blur ping-pongs through a second one
+        momentsTexture = CreateMomentsTexture(true);
+        blurTexture = CreateMomentsTexture(false);
+
+        glGenRenderbuffers(1, &depthRenderbuffer);
+        glBindRenderbuffer(GL_RENDERBUFFER, depthRenderbuffer);
+        glRenderbufferStorage(GL_RENDERBUFFER, GL_DEPTH_COMPONENT24, width, height);
+        glBindRenderbuffer(GL_RENDERBUFFER, 0);
+
+        glGenFramebuffers(1, &momentsFBO);
+        glBindFramebuffer(GL_FRAMEBUFFER, momentsFBO);
+        glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, momentsTexture, 0);
+        glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, GL_RENDERBUFFER, depthRenderbuffer);
+        if (glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE) {
+            std::cout << "Variance shadow map framebuffer is incomplete" << std::endl;
+        }
+
+        glGenFramebuffers(1, &blurFBO);
+        glBindFramebuffer(GL_FRAMEBUFFER, blurFBO);
+        glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, blurTexture, 0);
+        if (glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE) {
+            std::cout << "Variance shadow blur framebuffer is incomplete" << std::endl;
+        }
+        glBindFramebuffer(GL_FRAMEBUFFER, 0);
+
+        glGenVertexArrays(1, &screenVAO);
+    }
+
+    void VarianceShadowMap::Delete() {
+
+        glDeleteFramebuffers(1, &momentsFBO);
+        glDeleteFramebuffers(1, &blurFBO);
+        glDeleteTextures(1, &momentsTexture);
+        glDeleteTextures(1, &blurTexture);
+        glDeleteRenderbuffers(1, &depthRenderbuffer);
+        glDeleteVertexArrays(1, &screenVAO);
+    }
+
+    void VarianceShadowMap::BeginRender(bool exponential, glm::vec2 exponents) {
+
+        glViewport(0, 0, width, height);
+        glBindFramebuffer(GL_FRAMEBUFFER, momentsFBO);
+
+        //moments of a fragment lying on the far plane (depth 1)
+        GLfloat farMoments[4] = { 1.0f, 1.0f, 0.0f, 0.0f };
+        if (exponential) {
+            float positive = std::exp(exponents.x);
+            float negative = -std::exp(-exponents.y);
+            farMoments[0] = positive;
+            farMoments[1] = positive * positive;
+            farMoments[2] = negative;
+            farMoments[3] = negative * negative;
+        }
+        glClearBufferfv(GL_COLOR, 0, farMoments);
+        glClear(GL_DEPTH_BUFFER_BIT);
+    }
+
+    void VarianceShadowMap::EndRender() {
+
+        glBindFramebuffer(GL_FRAMEBUFFER, 0);
+    }
+
+    void VarianceShadowMap::Filter(gps::Shader blurShader, int radius) {
+
+        if (radius > 0) {
+            glViewport(0, 0, width, height);
+            glDisable(GL_DEPTH_TEST);
+
+            blurShader.useShaderProgram();
+            glBindVertexArray(screenVAO);
+
+            //horizontal pass into the blur texture, vertical pass back into the moments
+            BlurPass(blurShader, momentsTexture, blurFBO, glm::vec2(1.0f / width, 0.0f), radius);
+            BlurPass(blurShader, blurTexture, momentsFBO, glm::vec2(0.0f, 1.0f / height), radius);
+
+            glBindVertexArray(0);
+            glEnable(GL_DEPTH_TEST);
+            glBindFramebuffer(GL_FRAMEBUFFER, 0);
+        }
+
+        //prefiltered mips let distant and minified lookups stay a single tap
+        glBindTexture(GL_TEXTURE_2D, momentsTexture);
+        glGenerateMipmap(GL_TEXTURE_2D);
+        glBindTexture(GL_TEXTURE_2D, 0);
+    }
+
+    GLuint VarianceShadowMap::GetTextureId() {
+
+        return momentsTexture;
+    }
+
+    GLuint VarianceShadowMap::CreateMomentsTexture(bool mipmapped) {
+
+        GLuint textureID;
+        glGenTextures(1, &textureID);
+        glBindTexture(GL_TEXTURE_2D, textureID);
+        //32 bit floats are needed for the exponentially warped moments
+        glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA32F, width, height, 0, GL_RGBA, GL_FLOAT, NULL);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, mipmapped ? GL_LINEAR_MIPMAP_LINEAR : GL_LINEAR);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+        if (mipmapped) {
+            //allocate the whole mip chain up front
+            glGenerateMipmap(GL_TEXTURE_2D);
+        }
+        glBindTexture(GL_TEXTURE_2D, 0);
+
+        return textureID;
+    }
+
+    void VarianceShadowMap::BlurPass(gps::Shader blurShader, GLuint source, GLuint targetFBO, glm::vec2 direction, int radius) {
+
+        glBindFramebuffer(GL_FRAMEBUFFER, targetFBO);
+
+        glActiveTexture(GL_TEXTURE0);
+        glBindTexture(GL_TEXTURE_2D, source);
+        glUniform1i(glGetUniformLocation(blurShader.shaderProgram, "sourceTexture"), 0);
+        glUniform2fv(glGetUniformLocation(blurShader.shaderProgram, "blurDirection"), 1, glm::value_ptr(direction));
+        glUniform1i(glGetUniformLocation(blurShader.shaderProgram, "blurRadius"), radius);
+
+        glDrawArrays(GL_TRIANGLES, 0, 3);
+        glBindTexture(GL_TEXTURE_2D, 0);
+    }
+}
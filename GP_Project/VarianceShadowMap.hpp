@@ -0,0 +1,43 @@
+#ifndef VarianceShadowMap_hpp
+#define VarianceShadowMap_hpp
+
+#include "Shader.hpp"
+
+#include <glm/glm.hpp>
+#include <glm/gtc/type_ptr.hpp>
+
+namespace gps {
+
+    //Moment based shadow map (VSM / EVSM)
+    //the depth pass writes depth moments into a float color target, which is then
+    //blurred with a separable filter and mipmapped, so the lighting pass needs a
+    //single filtered lookup per fragment
+    class VarianceShadowMap {
+
+    public:
+        void Create(GLsizei width, GLsizei height);
+        void Delete();
+        //bind the moments framebuffer and clear it to the moments of the far plane
+        void BeginRender(bool exponential, glm::vec2 exponents);
+        void EndRender();
+        //separable gaussian blur of the moments followed by mipmap generation
+        void Filter(gps::Shader blurShader, int radius);
+        GLuint GetTextureId();
+
+    private:
+        GLsizei width;
+        GLsizei height;
+        GLuint momentsFBO;
+        GLuint momentsTexture;
+        GLuint depthRenderbuffer;
+        GLuint blurFBO;
+        GLuint blurTexture;
+        //attribute-less VAO for the fullscreen blur triangle
+        GLuint screenVAO;
+
+        GLuint CreateMomentsTexture(bool mipmapped);
+        void BlurPass(gps::Shader blurShader, GLuint source, GLuint targetFBO, glm::vec2 direction, int radius);
+    };
+}
+
+#endif /* VarianceShadowMap_hpp */
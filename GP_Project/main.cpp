@@ -12,42 +12,181 @@
 #include <glm/gtc/matrix_transform.hpp>
 #include <glm/gtc/matrix_inverse.hpp>
 #include <glm/gtc/type_ptr.hpp>
+#include <glm/gtc/constants.hpp>
 
 #include "Shader.hpp"
 #include "Model3D.hpp"
 #include "Camera.hpp"
 #include "SkyBox.hpp"
+#include "KtxCubemap.hpp"
+#include "VarianceShadowMap.hpp"
+#include "PointShadowAtlas.hpp"
+#include "PassScheduler.hpp"
+#include "FrameScheduler.hpp"
+#include "SceneUniforms.hpp"
+#include "Logger.hpp"
+#include "HeadlessContext.hpp"
+#include "CameraPath.hpp"
+#include "PassTimer.hpp"
+#include "BenchmarkReport.hpp"
+#include "TextOverlay.hpp"
+#include "Profiler.hpp"
+#include "RenderStats.hpp"
+#include "Frustum.hpp"
+#include "LightSpace.hpp"
+#include "AsyncReadback.hpp"
+#include "ImageDiff.hpp"
+#include "PngWriter.hpp"
+#include "FrameCapture.hpp"
+#include "GLTrace.hpp"
+#include "FrameQueue.hpp"
+#include "JobSystem.hpp"
+#include "UploadThread.hpp"
+#include "Task.hpp"
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
 #include <iostream>
+#include <thread>
+//last, the GL calls of this file are recorded by GL traces
+#include "GLTraceHooks.hpp"
 
+const char* WINDOW_TITLE = "OpenGL Shader Example";
 int glWindowWidth = 1024;
 int glWindowHeight = 768;
 int retina_width, retina_height;
 GLFWwindow* glWindow = NULL;
 
+// --headless renders --frames frames of --width x --height offscreen and exits
+bool headless = false;
+int headlessFrames = 100;
+gps::HeadlessContext headlessContext;
+// what the final pass renders into: the window, or the headless framebuffer
+GLuint sceneFramebuffer = 0;
+
+// --benchmark [path] replays a camera path at fixed steps and writes the frame times to --benchmark-output
+bool benchmark = false;
+std::string benchmarkPathFile;
+std::string benchmarkOutput = "benchmark.json";
+const float BENCHMARK_STEP = 1.0f / 60.0f;
+// rendered at the start of the path before measuring, to fill the caches and the timer ring
+const int BENCHMARK_WARMUP_FRAMES = 30;
+
+// --golden dir renders fixed views offscreen (the keys of --golden-views, a camera path file, or defaultGoldenViews)
+// and compares them with dir/view_N.png; the differences and the frame times go to dir/golden_report.json
+// and the exit code is 1 when a view differs; --golden-update saves the renders as the new golden images
+bool goldenTest = false;
+bool goldenUpdate = false;
+std::string goldenDirectory;
+std::string goldenViewsFile;
+// perceptual difference (0 to 1) above which a pixel counts as changed, see gps::ImageDiff
+double goldenThreshold = 0.1;
+// fraction of the pixels allowed to change before a view fails
+double goldenTolerance = 0.001;
+// frames rendered per view before it is read back, so a degraded sun has redrawn its shadow map
+const int GOLDEN_SETTLE_FRAMES = gps::PassScheduler::DEGRADED_SHADOW_INTERVAL + 2;
+
+// GPU and CPU time of every pass in renderScene, T shows the rolling averages on screen,
+// U (or --pass-times, on exit) writes them to PASS_TIMES_JSON and the per-frame history to PASS_TIMES_CSV
+gps::PassTimer passTimer;
+gps::TextOverlay textOverlay;
+bool showPassTimes = false;
+bool writePassTimesOnExit = false;
+const char* PASS_TIMES_CSV = "pass_times.csv";
+const char* PASS_TIMES_JSON = "pass_times.json";
+
+// GL calls of the frame (see gps::RenderStats), Y shows them on screen,
+// U (or --render-stats, on exit) writes them to RENDER_STATS_JSON and RENDER_STATS_CSV
+bool showRenderStats = false;
+bool writeRenderStatsOnExit = false;
+const char* RENDER_STATS_CSV = "render_stats.csv";
+const char* RENDER_STATS_JSON = "render_stats.json";
+// objects entirely outside it are left out of the main pass
+gps::Frustum viewFrustum;
+
+// CPU zones as Chrome traces: --profile-startup captures everything up to the first frame,
+// F (or --profile-frames N) the next PROFILE_FRAMES (or N) rendered frames
+bool profileStartup = false;
+int profileFramesLeft = 0;
+bool profilingFrames = false;
+const int PROFILE_FRAMES = 60;
+// the simulation counts the packets it builds; with the render thread the last profiled packet is drawn
+// up to frameQueueDepth iterations later, the trace is written once it has been
+int simulationFrame = 0;
+int lastProfiledFrame = -1;
+std::atomic<int> lastRenderedFrame(-1);
+const char* PROFILE_STARTUP_FILE = "profile_startup.json";
+const char* PROFILE_FRAMES_FILE = "profile_frames.json";
+
+// R starts/stops recording the live camera, saved for --benchmark
+bool recording = false;
+gps::CameraPath recordedPath;
+double recordingStart;
+const double RECORDING_INTERVAL = 0.1;
+const char* RECORDING_FILE = "camera_path.txt";
+
+// G starts/stops recording the rendered frames to captureDirectory, --capture [dir] records from the first frame
+// (with --benchmark, the camera path at fixed steps); --capture-format raw writes RGBA frames instead of PNGs
+gps::FrameCapture frameCapture;
+bool captureOnStart = false;
+std::string captureDirectory = "capture";
+gps::CaptureFormat captureFormat = gps::CAPTURE_PNG;
+
+// O records the GL calls of the next GL_TRACE_FRAMES rendered frames into glTraceFile for GP_Replay,
+// --gl-trace file [frames] the first frames
+std::string glTraceFile = "frames.gltrace";
+int glTraceFrames = 0;
+const int GL_TRACE_FRAMES = 3;
+
+// the main loop runs the simulation (input, camera, day cycle) and describes every frame in a gps::FramePacket,
+// the render thread owns the GL context and draws the packets, so the next frame is simulated while this one
+// is submitted; --frame-queue n packets may wait (the simulation is at most n frames ahead), 0 renders on the main thread
+gps::FrameQueue frameQueue;
+int frameQueueDepth = 2;
+std::thread renderThread;
+// the packet being drawn, only used by the thread that owns the GL context
+gps::FramePacket renderPacket;
+// GL side work asked for by the keys, sent with the next packet (gps::FrameRequest bits)
+unsigned int frameRequests = 0;
+// set by the render thread while it needs more frames than the scene asks for (a recording, a late shadow map)
+std::atomic<bool> renderWantsFrames(false);
+
+// threads of the job system (the main thread included), --jobs n, 0 for one per hardware thread
+int jobThreads = 0;
+
+// the scene models stream in while the scene runs (Model3D::LoadModelAsync): parsed on the job system, their
+// buffers and textures filled on the context of uploadThread (a window only, headless the uploads run on the
+// rendering thread), finished by the render thread in renderScene; a model joins the draw lists once it is ready
+gps::UploadThread uploadThread;
+// loadScene, waited for at the exit (cancelled) or before the first frame of the offline modes
+gps::Task<bool> sceneLoading;
+gps::LoadToken sceneLoad;
+// percentage of sceneLoad shown in the window title
+int shownLoadProgress = -1;
+// ready scene models the main loop last saw
+int readySceneModels = 0;
+// drawn by the last frame, a bit per SceneObject; an object that appears invalidates the shadow maps
+unsigned int renderedObjects = 0;
+
 const unsigned int SHADOW_WIDTH = 2048;
 const unsigned int SHADOW_HEIGHT = 2048;
+const unsigned int MOMENTS_SHADOW_WIDTH = 1024;
+const unsigned int MOMENTS_SHADOW_HEIGHT = 1024;
 
 glm::mat4 model;
-GLuint modelLoc;
 glm::mat4 view;
-GLuint viewLoc;
 glm::mat4 projection;
-GLuint projectionLoc;
 glm::mat3 normalMatrix;
-GLuint normalMatrixLoc;
 glm::mat4 lightRotation;
 
 glm::mat4 hondaModel;
-GLuint hondaModelLoc;
 
 glm::mat3 honda_normalMatrix;
-GLuint honda_normalMatrixLoc;
 
 glm::mat4 parking_lotModel;
-GLuint parking_lotModelLoc;
 
 glm::mat3 parking_lot_normalMatrix;
-GLuint parking_lot_normalMatrixLoc;
 
 struct PointLight {
 	glm::vec3 position;
@@ -85,28 +224,103 @@ gps::Model3D parking_lot;
 gps::Model3D lightCube;
 gps::Model3D screenQuad;
 
-gps::Shader myCustomShader;
+// what the draw lists of the frame packets refer to
+enum SceneObject { SCENE_HONDA, SCENE_PARKING_LOT, SCENE_OBJECT_COUNT };
+gps::Model3D* sceneModels[SCENE_OBJECT_COUNT] = { &honda, &parking_lot };
+const char* sceneModelFiles[SCENE_OBJECT_COUNT] = {
+	"models/Honda/ImageToStl.com_honda_nr750_1994.obj",
+	"models/parking_lot/ImageToStl.com_parking_lot.obj",
+};
+
+gps::Shader sceneShader;     // every permutation of basic.vert/basic.frag
+gps::Shader myCustomShader;  // permutation for the current frame, meshes add their material bits
 gps::Shader lightShader;
 gps::Shader screenQuadShader;
 gps::Shader depthMapShader;
+// the programs loaded at startup compile while the scene loads, see finishStartupShaders
+bool shaderStatusPending = true;
 
 GLuint shadowMapFBO;
 GLuint depthMapTexture;
 
+// shadow filtering (see computeShadow in basic.frag)
+enum ShadowKernel { SHADOW_KERNEL_HARDWARE, SHADOW_KERNEL_POISSON, SHADOW_KERNEL_ROTATED_GRID, SHADOW_KERNEL_COUNT };
+ShadowKernel shadowKernel = SHADOW_KERNEL_POISSON;
+int shadowSamples = 16;           // Poisson taps, at most 16
+float shadowFilterRadius = 1.5f;  // kernel radius in shadow map texels
+float shadowMinBias = 0.0005f;
+float shadowSlopeBias = 0.0025f;
+
+// shadow technique, selectable at runtime (V key)
+enum ShadowTechnique { SHADOW_TECHNIQUE_PCF, SHADOW_TECHNIQUE_VSM, SHADOW_TECHNIQUE_EVSM, SHADOW_TECHNIQUE_COUNT };
+ShadowTechnique shadowTechnique = SHADOW_TECHNIQUE_PCF;
+gps::VarianceShadowMap varianceShadowMap;
+gps::Shader shadowMomentsShader;
+gps::Shader shadowBlurShader;
+glm::vec2 evsmExponents = glm::vec2(40.0f, 5.0f);  // positive / negative warp, safe for 32 bit floats
+float vsmMinVariance = 0.00002f;
+float lightBleedReduction = 0.3f;
+int shadowBlurRadius = 4;
+
+// the scene geometry is static, so the sun shadow map (and its blur) is only
+// redrawn when the light moves or the technique changes
+bool shadowMapDirty = true;
+glm::mat4 cachedLightSpaceTrMatrix;
+// technique and sky mode of the last packet drawn, a change invalidates the shadow map or the cached sky
+int renderedShadowTechnique = SHADOW_TECHNIQUE_PCF;
+int renderedSkyMode = -1;
+
+// omnidirectional shadows of the street lamps, rendered once and cached in an atlas
+gps::PointShadowAtlas pointShadowAtlas;
+gps::Shader pointShadowShader;
+bool pointShadowsEnabled = true;
+
+// lights that barely contribute lose their shadow passes and get a cheaper basic.frag permutation
+gps::PassScheduler passScheduler;
+float lampIntensity = 1.0f;  // street lamps fade out during the day
+glm::mat4 shadowMapLightSpaceTrMatrix;  // light matrix the sun shadow map was last rendered with
+
+// permutation key bits of sceneShader, above the material bits chosen by every mesh
+const int PERMUTATION_SHADOW_TECHNIQUE_BIT = gps::MATERIAL_FEATURE_BITS;   // 2 bits
+const int PERMUTATION_SUN_LIGHTING_BIT = PERMUTATION_SHADOW_TECHNIQUE_BIT + 2;  // 2 bits
+const int PERMUTATION_POINT_LIGHTING_BIT = PERMUTATION_SUN_LIGHTING_BIT + 2;    // 2 bits
+const int PERMUTATION_POINT_LIGHT_COUNT_BIT = PERMUTATION_POINT_LIGHTING_BIT + 2;  // 2 bits
+
+// uniform blocks shared by all the permutations, so switching programs needs no uniform uploads
+gps::FrameData frameData;
+gps::ObjectData objectData;
+GLuint frameDataBuffer;
+GLuint objectDataBuffer;
+
 bool showDepthMap;
 bool isDay = true;
 bool cameraLock = false;
 
 gps::SkyBox skyBox;
 
+// only renders when something changed since the last frame
+gps::FrameScheduler frameScheduler;
+
 gps::Shader skyboxShader;
+gps::Shader proceduralSkyShader;
+gps::Shader overlayTextShader;
+
+// cubemap textures, the analytic sky every frame, or the analytic sky cached in a small cubemap (toggle with P key)
+enum SkyMode { SKY_CUBEMAP, SKY_PROCEDURAL, SKY_PROCEDURAL_CACHED, SKY_MODE_COUNT };
+SkyMode skyMode = SKY_CUBEMAP;
+const int SKY_CACHE_SIZE = 128;
+// world space direction towards the sun (not the moon), before lightRotation
+glm::vec3 skySunDirection = glm::vec3(0.0f, 1.0f, 0.0f);
+float skyStarIntensity = 0.0f;
+float skyNightBlend = 0.0f;
+// what the cached cubemap was rendered with
+bool skyCacheDirty = true;
+glm::vec3 skyCacheSunDirection;
+float skyCacheStarIntensity;
 
 glm::vec3 sunLightPosition;
 glm::vec3 sunLightDir;
 glm::vec3 sunLightColor;
-GLint sunLightPositionLoc;
-GLint sunLightDirLoc;
-GLint sunLightColorLoc;
 
 using namespace std;
 
@@ -123,40 +337,84 @@ GLenum glCheckError_(const char* file, int line) {
 		case GL_OUT_OF_MEMORY:                 error = "OUT_OF_MEMORY"; break;
 		case GL_INVALID_FRAMEBUFFER_OPERATION: error = "INVALID_FRAMEBUFFER_OPERATION"; break;
 		}
-		std::cout << error << " | " << file << " (" << line << ")" << std::endl;
+		LOG_ERROR("%s | %s (%d)", error.c_str(), file, line);
 	}
 	return errorCode;
 }
 #define glCheckError() glCheckError_(__FILE__, __LINE__)
 
 void windowResizeCallback(GLFWwindow* window, int width, int height) {
-	fprintf(stdout, "window resized to width: %d , and height: %d\n", width, height);
+	LOG_INFO("window resized to width: %d , and height: %d", width, height);
 	//TODO	
+	frameScheduler.MarkDirty(gps::FRAME_DIRTY_WINDOW);
 }
 
-void initSkyBox(bool isDay) {
-	std::vector<const GLchar*> faces;
+// the window was uncovered or restored while the loop was sleeping
+void windowRefreshCallback(GLFWwindow* window) {
+	frameScheduler.MarkDirty(gps::FRAME_DIRTY_WINDOW);
+}
+
+// baked with --bake-cubemaps; when present they replace the face images below
+const char* DAY_SKYBOX_KTX = "skybox/skyboxDay.ktx2";
+const char* NIGHT_SKYBOX_KTX = "skybox/skyboxNight.ktx2";
+
+void getSkyBoxFaces(std::vector<const GLchar*>& dayFaces, std::vector<const GLchar*>& nightFaces) {
+	// Night skybox
+	nightFaces.push_back("skybox/skyboxNight/posx.png"); // right
+	nightFaces.push_back("skybox/skyboxNight/negx.png"); // left
+	nightFaces.push_back("skybox/skyboxNight/posy.png"); // top
+	nightFaces.push_back("skybox/skyboxNight/negy.png"); // bottom
+	nightFaces.push_back("skybox/skyboxNight/posz.png"); // front
+	nightFaces.push_back("skybox/skyboxNight/negz.png"); // back
+
+	// Day skybox
+	dayFaces.push_back("skybox/skyboxDay/px.png"); // right
+	dayFaces.push_back("skybox/skyboxDay/nx.png"); // left
+	dayFaces.push_back("skybox/skyboxDay/py.png"); // top
+	dayFaces.push_back("skybox/skyboxDay/ny.png"); // bottom
+	dayFaces.push_back("skybox/skyboxDay/pz.png"); // front
+	dayFaces.push_back("skybox/skyboxDay/nz.png"); // back
+}
 
-	if (!isDay) {
-		// Night skybox
-		faces.push_back("skybox/skyboxNight/posx.png"); // right
-		faces.push_back("skybox/skyboxNight/negx.png"); // left
-		faces.push_back("skybox/skyboxNight/posy.png"); // top
-		faces.push_back("skybox/skyboxNight/negy.png"); // bottom
-		faces.push_back("skybox/skyboxNight/posz.png"); // front
-		faces.push_back("skybox/skyboxNight/negz.png"); // back
+// both skyboxes are loaded once and crossfaded by the sky shader
+void initSkyBox() {
+	PROFILE_FUNCTION();
+	std::vector<const GLchar*> dayFaces;
+	std::vector<const GLchar*> nightFaces;
+	getSkyBoxFaces(dayFaces, nightFaces);
+
+	// compressed, mipmapped cubemaps load several times faster than the PNGs
+	if (std::ifstream(DAY_SKYBOX_KTX)) {
+		dayFaces.assign(1, DAY_SKYBOX_KTX);
 	}
-	else {
-		// Day skybox
-		faces.push_back("skybox/skyboxDay/px.png"); // right
-		faces.push_back("skybox/skyboxDay/nx.png"); // left
-		faces.push_back("skybox/skyboxDay/py.png"); // top
-		faces.push_back("skybox/skyboxDay/ny.png"); // bottom
-		faces.push_back("skybox/skyboxDay/pz.png"); // front
-		faces.push_back("skybox/skyboxDay/nz.png"); // back
+	if (std::ifstream(NIGHT_SKYBOX_KTX)) {
+		nightFaces.assign(1, NIGHT_SKYBOX_KTX);
 	}
 
-	skyBox.Load(faces);
+	skyBox.Load(dayFaces, nightFaces);
+}
+
+// converts the skybox face images to BC1 .ktx2 cubemaps, no window needed
+bool bakeSkyBoxes() {
+	std::vector<const GLchar*> dayFaces;
+	std::vector<const GLchar*> nightFaces;
+	getSkyBoxFaces(dayFaces, nightFaces);
+
+	bool baked = gps::KtxCubemap::Bake(std::vector<std::string>(dayFaces.begin(), dayFaces.end()), DAY_SKYBOX_KTX);
+	baked = gps::KtxCubemap::Bake(std::vector<std::string>(nightFaces.begin(), nightFaces.end()), NIGHT_SKYBOX_KTX) && baked;
+	return baked;
+}
+
+void writePassTimes() {
+	if (passTimer.WriteCsv(PASS_TIMES_CSV) && passTimer.WriteJson(PASS_TIMES_JSON)) {
+		LOG_INFO("Pass times written to %s and %s", PASS_TIMES_CSV, PASS_TIMES_JSON);
+	}
+}
+
+void writeRenderStats() {
+	if (gps::RenderStats::WriteCsv(RENDER_STATS_CSV) && gps::RenderStats::WriteJson(RENDER_STATS_JSON)) {
+		LOG_INFO("Render stats written to %s and %s", RENDER_STATS_CSV, RENDER_STATS_JSON);
+	}
 }
 
 void keyboardCallback(GLFWwindow* window, int key, int scancode, int action, int mode) {
@@ -164,6 +422,8 @@ void keyboardCallback(GLFWwindow* window, int key, int scancode, int action, int
 		glfwSetWindowShouldClose(window, GL_TRUE);
 	}
 
+	frameScheduler.MarkDirty(gps::FRAME_DIRTY_INPUT);
+
 	if (key >= 0 && key < 1024) {
 		if (action == GLFW_PRESS) {
 			pressedKeys[key] = true;
@@ -184,14 +444,87 @@ void keyboardCallback(GLFWwindow* window, int key, int scancode, int action, int
 		if (autoDayCycle) timeOfDay = 12.0f;  // Reset time to noon
 		autoDayCycle = !autoDayCycle;  // Toggle automatic cycle
 	}
+	if (pressedKeys[GLFW_KEY_K] && action == GLFW_PRESS) {
+		shadowKernel = (ShadowKernel)((shadowKernel + 1) % SHADOW_KERNEL_COUNT);  // Cycle shadow filter
+	}
+	if (pressedKeys[GLFW_KEY_V] && action == GLFW_PRESS) {
+		shadowTechnique = (ShadowTechnique)((shadowTechnique + 1) % SHADOW_TECHNIQUE_COUNT);  // Cycle shadow technique
+	}
+	if (pressedKeys[GLFW_KEY_LEFT_BRACKET] && action == GLFW_PRESS) {
+		shadowFilterRadius = glm::max(shadowFilterRadius - 0.5f, 0.5f);
+	}
+	if (pressedKeys[GLFW_KEY_RIGHT_BRACKET] && action == GLFW_PRESS) {
+		shadowFilterRadius = glm::min(shadowFilterRadius + 0.5f, 6.0f);
+	}
+	if (pressedKeys[GLFW_KEY_P] && action == GLFW_PRESS) {
+		skyMode = (SkyMode)((skyMode + 1) % SKY_MODE_COUNT);  // Cycle sky mode
+	}
+	if (pressedKeys[GLFW_KEY_R] && action == GLFW_PRESS) {
+		if (!recording) {
+			recordedPath.Clear();
+			recordingStart = glfwGetTime();
+			LOG_INFO("Recording the camera path");
+		}
+		else if (recordedPath.Save(RECORDING_FILE)) {
+			LOG_INFO("Saved %d camera keys (%.1f s) to %s", recordedPath.GetKeyCount(), recordedPath.GetDuration(), RECORDING_FILE);
+		}
+		recording = !recording;
+	}
+	if (pressedKeys[GLFW_KEY_T] && action == GLFW_PRESS) {
+		showPassTimes = !showPassTimes;
+	}
+	if (pressedKeys[GLFW_KEY_Y] && action == GLFW_PRESS) {
+		showRenderStats = !showRenderStats;
+	}
+	if (pressedKeys[GLFW_KEY_U] && action == GLFW_PRESS) {
+		frameRequests |= gps::FRAME_REQUEST_WRITE_STATS;
+	}
+	if (pressedKeys[GLFW_KEY_F] && action == GLFW_PRESS && !profilingFrames) {
+		profileFramesLeft = PROFILE_FRAMES;
+	}
+	if (pressedKeys[GLFW_KEY_G] && action == GLFW_PRESS) {
+		frameRequests |= gps::FRAME_REQUEST_TOGGLE_CAPTURE;
+	}
+	if (pressedKeys[GLFW_KEY_O] && action == GLFW_PRESS) {
+		frameRequests |= gps::FRAME_REQUEST_GL_TRACE;
+	}
+}
+
+// one key every RECORDING_INTERVAL while recording
+void recordCameraKey() {
+	float time = (float)(glfwGetTime() - recordingStart);
+	if (!recordedPath.IsEmpty() && time - recordedPath.GetDuration() < RECORDING_INTERVAL) {
+		return;
+	}
+	gps::CameraKey key;
+	key.time = time;
+	key.position = myCamera.getCameraPosition();
+	key.target = myCamera.getCameraPosition() + myCamera.getCameraFrontDirection();
+	key.timeOfDay = timeOfDay;
+	recordedPath.AddKey(key);
 }
 
 void mouseCallback(GLFWwindow* window, double xpos, double ypos) {
 
 }
 
+// keys that move the camera every frame while they are held
+bool movementKeyHeld() {
+	const int keys[] = { GLFW_KEY_W, GLFW_KEY_S, GLFW_KEY_A, GLFW_KEY_D, GLFW_KEY_UP, GLFW_KEY_DOWN,
+		GLFW_KEY_LEFT, GLFW_KEY_RIGHT, GLFW_KEY_Q, GLFW_KEY_E };
+	for (int key : keys) {
+		if (pressedKeys[key]) {
+			return true;
+		}
+	}
+	return false;
+}
+
 void processMovement() {
-	cout << "Camera position: " << myCamera.getCameraPosition().x << " " << myCamera.getCameraPosition().y << " " << myCamera.getCameraPosition().z << endl;
+	PROFILE_FUNCTION();
+	glm::mat4 previousView = view;
+	LOG_EVERY(gps::LOG_LEVEL_DEBUG, 1.0, "Camera position: %f %f %f",
+		myCamera.getCameraPosition().x, myCamera.getCameraPosition().y, myCamera.getCameraPosition().z);
 	if (!cameraLock) {
 		if (pressedKeys[GLFW_KEY_W]) {
 			myCamera.move(gps::MOVE_FORWARD, cameraSpeed);
@@ -237,22 +570,30 @@ void processMovement() {
 		myCamera.setCameraTarget(glm::vec3(0.0f, 1.0f, 0.0f)); // Focus on motorcycle
 	}
 
-	// **🔹 Always update the view matrix**
+	// **🔹 Always update the view matrix** (uploaded in renderScene, to the variant in use)
 	view = myCamera.getViewMatrix();
-	myCustomShader.useShaderProgram();
-	glUniformMatrix4fv(viewLoc, 1, GL_FALSE, glm::value_ptr(view));
-
-	// **🔹 Update normal matrix**
-	normalMatrix = glm::mat3(glm::inverseTranspose(view * model));
-	glUniformMatrix3fv(normalMatrixLoc, 1, GL_FALSE, glm::value_ptr(normalMatrix));
+	if (view != previousView) {
+		frameScheduler.MarkDirty(gps::FRAME_DIRTY_CAMERA);
+	}
 }
 
 void updateDayNightCycle() {
+	static float previousTimeOfDay = -1.0f;
+
 	if (autoDayCycle) {
 		timeOfDay += daySpeed;
 		if (timeOfDay >= 24.0f) timeOfDay = 0.0f;  // Reset at midnight
 	}
 
+	// the lights and the sky only change with the time of day
+	if (timeOfDay == previousTimeOfDay) {
+		return;
+	}
+	previousTimeOfDay = timeOfDay;
+	frameScheduler.MarkDirty(gps::FRAME_DIRTY_TIME_OF_DAY);
+	// decided before it is used, this function only runs again once the time changes
+	isDay = !(timeOfDay < 6.0f || timeOfDay > 18.0f);
+
 	// Compute sun's position angle in a full cycle (0 to 2π radians)
 	float sun_angle = glm::radians(((timeOfDay - 6.0f) / 24.0f) * 360.0f);
 
@@ -274,31 +615,60 @@ void updateDayNightCycle() {
 	glm::vec3 nightColor = glm::vec3(0.05f, 0.05f, 0.15f); // Almost black with a slight blue tint
 	sunLightColor = glm::mix(nightColor, dayColor, lightIntensity);
 
-	// Update shaders
-	myCustomShader.useShaderProgram();
-	glUniform3fv(sunLightDirLoc, 1, glm::value_ptr(glm::normalize(sunLightDir)));
-	glUniform3fv(sunLightColorLoc, 1, glm::value_ptr(sunLightColor));
+	// Street lamps switch on as the sun sets and are off in broad daylight
+	lampIntensity = 1.0f - glm::smoothstep(0.0f, 0.3f, (float)sin(sun_angle));
 
-	// **Change skybox when transitioning between day/night**
-	if (timeOfDay < 6.0f || timeOfDay > 18.0f) {
-		if (isDay) {
-			isDay = false;
-			initSkyBox(false);  // Load night skybox
-		}
+	// **Fade the sky between day and night around sunrise and sunset**
+	float nightBlend = 1.0f - glm::smoothstep(-0.2f, 0.2f, (float)sin(sun_angle));
+	skyNightBlend = nightBlend;
+	skySunDirection = glm::normalize(glm::vec3(0.0f, sin(sun_angle), cos(sun_angle)));
+	skyStarIntensity = nightBlend;
+}
+
+// the state of the simulation the renderer draws, see gps::FramePacket
+void buildFramePacket(gps::FramePacket& packet) {
+	PROFILE_FUNCTION();
+	packet.frame = simulationFrame++;
+	packet.requests = frameRequests;
+	frameRequests = 0;
+
+	packet.view = view;
+	packet.projection = projection;
+	packet.cameraPosition = myCamera.getCameraPosition();
+
+	lightRotation = glm::rotate(glm::mat4(1.0f), glm::radians(lightAngle), glm::vec3(0.0f, 1.0f, 0.0f));
+	packet.sunLightDir = sunLightDir;
+	packet.sunLightColor = sunLightColor;
+	packet.lightRotation = lightRotation;
+	packet.isDay = isDay;
+	packet.lampIntensity = lampIntensity;
+	packet.skySunDirection = skySunDirection;
+	packet.skyStarIntensity = skyStarIntensity;
+	packet.skyNightBlend = skyNightBlend;
+
+	// the models still loading are left out
+	packet.drawList.clear();
+	if (honda.IsReady()) {
+		packet.drawList.push_back(gps::DrawItem{ SCENE_HONDA, hondaModel });
 	}
-	else {
-		if (!isDay) {
-			isDay = true;
-			initSkyBox(true);  // Load day skybox
-		}
+	if (parking_lot.IsReady()) {
+		packet.drawList.push_back(gps::DrawItem{ SCENE_PARKING_LOT, parking_lotModel });
 	}
+
+	packet.shadowKernel = shadowKernel;
+	packet.shadowTechnique = shadowTechnique;
+	packet.shadowFilterRadius = shadowFilterRadius;
+	packet.skyMode = skyMode;
+	packet.showDepthMap = showDepthMap;
+	packet.showPassTimes = showPassTimes;
+	packet.showRenderStats = showRenderStats;
 }
 
 
 bool initOpenGLWindow()
 {
 	if (!glfwInit()) {
-		fprintf(stderr, "ERROR: could not start GLFW3\n");
+		LOG_ERROR("could not start GLFW3");
 		return false;
 	}
 
@@ -317,14 +687,15 @@ bool initOpenGLWindow()
 	//for antialising
 	glfwWindowHint(GLFW_SAMPLES, 4);
 
-	glWindow = glfwCreateWindow(glWindowWidth, glWindowHeight, "OpenGL Shader Example", NULL, NULL);
+	glWindow = glfwCreateWindow(glWindowWidth, glWindowHeight, WINDOW_TITLE, NULL, NULL);
 	if (!glWindow) {
-		fprintf(stderr, "ERROR: could not open window with GLFW3\n");
+		LOG_ERROR("could not open window with GLFW3");
 		glfwTerminate();
 		return false;
 	}
 
 	glfwSetWindowSizeCallback(glWindow, windowResizeCallback);
+	glfwSetWindowRefreshCallback(glWindow, windowRefreshCallback);
 	glfwSetKeyCallback(glWindow, keyboardCallback);
 	glfwSetCursorPosCallback(glWindow, mouseCallback);
 	//glfwSetInputMode(glWindow, GLFW_CURSOR, GLFW_CURSOR_DISABLED);
@@ -342,8 +713,8 @@ bool initOpenGLWindow()
 	// get version info
 	const GLubyte* renderer = glGetString(GL_RENDERER); // get renderer string
 	const GLubyte* version = glGetString(GL_VERSION); // version as a string
-	printf("Renderer: %s\n", renderer);
-	printf("OpenGL version supported %s\n", version);
+	LOG_INFO("Renderer: %s", (const char*)renderer);
+	LOG_INFO("OpenGL version supported %s", (const char*)version);
 
 	//for RETINA display
 	glfwGetFramebufferSize(glWindow, &retina_width, &retina_height);
@@ -363,84 +734,164 @@ void initOpenGLState()
 	glFrontFace(GL_CCW); // GL_CCW for counter clock-wise
 
 	glEnable(GL_FRAMEBUFFER_SRGB);
+	glEnable(GL_TEXTURE_CUBE_MAP_SEAMLESS); // filter across cubemap face edges, mostly visible on the small mips
+}
+
+// every scene model, loaded side by side; true when all of them could be read
+gps::Task<bool> loadScene(gps::LoadToken token) {
+	std::vector<gps::Task<bool> > loads;
+	for (int i = 0; i < SCENE_OBJECT_COUNT; i++) {
+		loads.push_back(sceneModels[i]->LoadModelAsync(sceneModelFiles[i], uploadThread, token));
+	}
+	std::vector<bool> loaded = co_await gps::WhenAll(std::move(loads));
+	bool complete = true;
+	for (int i = 0; i < SCENE_OBJECT_COUNT; i++) {
+		complete = complete && loaded[i];
+	}
+	co_return complete;
+}
+
+// waits for loadScene, on the thread that owns the GL context: the models finish in uploadThread.Finish;
+// false when one of the files could not be read
+bool finishSceneLoading() {
+	PROFILE_FUNCTION();
+	if (!sceneLoading.IsValid()) {
+		return true;
+	}
+	while (!sceneLoading.IsDone()) {
+		uploadThread.Finish();
+		// the rest is still being parsed
+		if (!sceneLoading.IsDone()) {
+			std::this_thread::sleep_for(std::chrono::milliseconds(1));
+		}
+	}
+	return sceneLoading.GetResult();
 }
 
 void initObjects() {
-	honda.LoadModel("models/honda/ImageToStl.com_honda_nr750_1994.obj");
-	parking_lot.LoadModel("models/parking_lot/ImageToStl.com_parking_lot.obj");
-	lightCube.LoadModel("models/cube/cube.obj");
-	screenQuad.LoadModel("models/quad/quad.obj");
+	PROFILE_FUNCTION();
+	// the files are parsed and their textures decoded on the job system; the small models the passes
+	// draw directly are uploaded here, before the first frame
+	struct ModelFile {
+		gps::Model3D* model;
+		const char* fileName;
+		bool parsed;
+	};
+	ModelFile files[] = {
+		{ &lightCube, "models/cube/cube.obj", false },
+		{ &screenQuad, "models/quad/quad.obj", false },
+	};
+	const int fileCount = (int)(sizeof(files) / sizeof(files[0]));
+	gps::JobSystem::ParallelFor(fileCount, 1, [&files](int begin, int end) {
+		for (int i = begin; i < end; i++) {
+			files[i].parsed = files[i].model->ParseModel(files[i].fileName);
+		}
+	});
+	for (int i = 0; i < fileCount; i++) {
+		if (!files[i].parsed) {
+			gps::Logger::Stop();
+			exit(1);
+		}
+		files[i].model->UploadModel();
+	}
+	textOverlay.Create();
+
+	// the scene models load in the background, a file that can't be read leaves its model out of the scene
+	sceneLoading = loadScene(sceneLoad);
+	sceneLoading.Start();
+
+	// the offline modes render a fixed set of frames and start with the whole scene
+	if (headless || benchmark) {
+		if (!finishSceneLoading()) {
+			gps::Logger::Stop();
+			exit(1);
+		}
+	}
+}
+
+// binds the uniform blocks and the sampler units of a newly compiled basic.frag permutation
+void setupScenePermutation(gps::Shader permutation) {
+	GLuint frameDataIndex = glGetUniformBlockIndex(permutation.shaderProgram, "FrameData");
+	if (frameDataIndex != GL_INVALID_INDEX) {
+		glUniformBlockBinding(permutation.shaderProgram, frameDataIndex, gps::FRAME_DATA_BINDING);
+	}
+	GLuint objectDataIndex = glGetUniformBlockIndex(permutation.shaderProgram, "ObjectData");
+	if (objectDataIndex != GL_INVALID_INDEX) {
+		glUniformBlockBinding(permutation.shaderProgram, objectDataIndex, gps::OBJECT_DATA_BINDING);
+	}
+
+	// units 0-2 belong to the mesh textures
+	permutation.useShaderProgram();
+	glUniform1i(glGetUniformLocation(permutation.shaderProgram, "shadowMap"), 3);
+	glUniform1i(glGetUniformLocation(permutation.shaderProgram, "shadowMoments"), 4);
+	glUniform1i(glGetUniformLocation(permutation.shaderProgram, "pointShadowAtlas"), 5);
+}
+
+// frame-wide part of the sceneShader permutation key
+unsigned int computeSceneKey(gps::PassLevel sunLevel, gps::PassLevel lampLevel) {
+	unsigned int key = 0;
+	key |= (unsigned int)renderPacket.shadowTechnique << PERMUTATION_SHADOW_TECHNIQUE_BIT;
+	key |= (unsigned int)sunLevel << PERMUTATION_SUN_LIGHTING_BIT;
+	key |= (unsigned int)lampLevel << PERMUTATION_POINT_LIGHTING_BIT;
+	key |= (unsigned int)glm::min((int)pointLights.size(), gps::MAX_SCENE_POINT_LIGHTS) << PERMUTATION_POINT_LIGHT_COUNT_BIT;
+	return key;
 }
 
 void initShaders() {
-	myCustomShader.loadShader("shaders/basic.vert", "shaders/basic.frag");
-	myCustomShader.useShaderProgram();
+	PROFILE_FUNCTION();
+	// the permutations are compiled the first time a mesh draws with them
+	sceneShader.loadPermutations("shaders/basic.vert", "shaders/basic.frag");
+	sceneShader.addPermutationOption("SHADOW_TECHNIQUE", PERMUTATION_SHADOW_TECHNIQUE_BIT, 2);
+	sceneShader.addPermutationOption("SUN_LIGHTING", PERMUTATION_SUN_LIGHTING_BIT, 2);
+	sceneShader.addPermutationOption("POINT_LIGHTING", PERMUTATION_POINT_LIGHTING_BIT, 2);
+	sceneShader.addPermutationOption("POINT_LIGHT_COUNT", PERMUTATION_POINT_LIGHT_COUNT_BIT, 2);
+	sceneShader.setPermutationSetup(setupScenePermutation);
+
+	// only submitted here, their status is checked once they are used (see finishStartupShaders)
 	lightShader.loadShader("shaders/lightCube.vert", "shaders/lightCube.frag");
-	lightShader.useShaderProgram();
 	screenQuadShader.loadShader("shaders/screenQuad.vert", "shaders/screenQuad.frag");
-	screenQuadShader.useShaderProgram();
 	depthMapShader.loadShader("shaders/depthMap.vert", "shaders/depthMap.frag");
-	depthMapShader.useShaderProgram();
+	shadowMomentsShader.loadShader("shaders/depthMap.vert", "shaders/shadowMoments.frag");
+	shadowBlurShader.loadShader("shaders/shadowBlur.vert", "shaders/shadowBlur.frag");
+	pointShadowShader.loadShader("shaders/pointShadow.vert", "shaders/pointShadow.geom", "shaders/pointShadow.frag");
 	skyboxShader.loadShader("shaders/skyboxShader.vert", "shaders/skyboxShader.frag");
-	skyboxShader.useShaderProgram();
+	proceduralSkyShader.loadShader("shaders/skyboxShader.vert", "shaders/proceduralSky.frag");
+	overlayTextShader.loadShader("shaders/overlayText.vert", "shaders/overlayText.frag");
 }
 
 
 
 void initUniforms() {
-	myCustomShader.useShaderProgram();
-
 	model = glm::mat4(1.0f);
-	modelLoc = glGetUniformLocation(myCustomShader.shaderProgram, "model");
-	glUniformMatrix4fv(modelLoc, 1, GL_FALSE, glm::value_ptr(model));
-
 	hondaModel = glm::mat4(1.0f);
-	hondaModelLoc = glGetUniformLocation(myCustomShader.shaderProgram, "model");
-	glUniformMatrix4fv(hondaModelLoc, 1, GL_FALSE, glm::value_ptr(hondaModel));
-
 	parking_lotModel = glm::mat4(1.0f);
-	parking_lotModelLoc = glGetUniformLocation(myCustomShader.shaderProgram, "model");
-	glUniformMatrix4fv(parking_lotModelLoc, 1, GL_FALSE, glm::value_ptr(parking_lotModel));
 
 	view = myCamera.getViewMatrix();
-	viewLoc = glGetUniformLocation(myCustomShader.shaderProgram, "view");
-	glUniformMatrix4fv(viewLoc, 1, GL_FALSE, glm::value_ptr(view));
-
 	normalMatrix = glm::mat3(glm::inverseTranspose(view * model));
-	normalMatrixLoc = glGetUniformLocation(myCustomShader.shaderProgram, "normalMatrix");
-	glUniformMatrix3fv(normalMatrixLoc, 1, GL_FALSE, glm::value_ptr(normalMatrix));
-
 	honda_normalMatrix = glm::mat3(glm::inverseTranspose(view * hondaModel));
-	honda_normalMatrixLoc = glGetUniformLocation(myCustomShader.shaderProgram, "normalMatrix");
-	glUniformMatrix3fv(honda_normalMatrixLoc, 1, GL_FALSE, glm::value_ptr(honda_normalMatrix));
-
 	parking_lot_normalMatrix = glm::mat3(glm::inverseTranspose(view * parking_lotModel));
-	parking_lot_normalMatrixLoc = glGetUniformLocation(myCustomShader.shaderProgram, "normalMatrix");
-	glUniformMatrix3fv(parking_lot_normalMatrixLoc, 1, GL_FALSE, glm::value_ptr(parking_lot_normalMatrix));
 
 	projection = glm::perspective(glm::radians(45.0f), (float)retina_width / (float)retina_height, 0.1f, 1000.0f);
-	projectionLoc = glGetUniformLocation(myCustomShader.shaderProgram, "projection");
-	glUniformMatrix4fv(projectionLoc, 1, GL_FALSE, glm::value_ptr(projection));
 
 	//set the light direction (direction towards the light)
 	sunLightDir = glm::vec3(0.0f, 10.0f, 1.0f);
 	lightRotation = glm::rotate(glm::mat4(1.0f), glm::radians(lightAngle), glm::vec3(0.0f, 1.0f, 0.0f));
-	sunLightDirLoc = glGetUniformLocation(myCustomShader.shaderProgram, "sunLightDir");
-	glUniform3fv(sunLightDirLoc, 1, glm::value_ptr(glm::inverseTranspose(glm::mat3(view * lightRotation)) * sunLightDir));
 
 	//set light color
 	sunLightColor = glm::vec3(1.0f, 1.0f, 1.0f); //white light
-	sunLightColorLoc = glGetUniformLocation(myCustomShader.shaderProgram, "sunLightColor");
-	glUniform3fv(sunLightColorLoc, 1, glm::value_ptr(sunLightColor));
 
-	for (int i = 0; i < pointLights.size(); i++) {
-		std::string base = "pointLights[" + std::to_string(i) + "]";
-		glUniform3fv(glGetUniformLocation(myCustomShader.shaderProgram, (base + ".position").c_str()), 1, glm::value_ptr(pointLights[i].position));
-		glUniform3fv(glGetUniformLocation(myCustomShader.shaderProgram, (base + ".color").c_str()), 1, glm::value_ptr(pointLights[i].color));
-		glUniform1f(glGetUniformLocation(myCustomShader.shaderProgram, (base + ".constant").c_str()), pointLights[i].constant);
-		glUniform1f(glGetUniformLocation(myCustomShader.shaderProgram, (base + ".linear").c_str()), pointLights[i].linear);
-		glUniform1f(glGetUniformLocation(myCustomShader.shaderProgram, (base + ".quadratic").c_str()), pointLights[i].quadratic);
-	}
+	glGenBuffers(1, &frameDataBuffer);
+	glBindBuffer(GL_UNIFORM_BUFFER, frameDataBuffer);
+	glBufferData(GL_UNIFORM_BUFFER, sizeof(gps::FrameData), NULL, GL_DYNAMIC_DRAW);
+	glBindBufferBase(GL_UNIFORM_BUFFER, gps::FRAME_DATA_BINDING, frameDataBuffer);
+
+	glGenBuffers(1, &objectDataBuffer);
+	glBindBuffer(GL_UNIFORM_BUFFER, objectDataBuffer);
+	glBufferData(GL_UNIFORM_BUFFER, sizeof(gps::ObjectData), NULL, GL_DYNAMIC_DRAW);
+	glBindBufferBase(GL_UNIFORM_BUFFER, gps::OBJECT_DATA_BINDING, objectDataBuffer);
+	glBindBuffer(GL_UNIFORM_BUFFER, 0);
+
+	myCustomShader = sceneShader.getPermutation(computeSceneKey(gps::PASS_FULL, gps::PASS_FULL));
 
 	lightShader.useShaderProgram();
 	glUniformMatrix4fv(glGetUniformLocation(lightShader.shaderProgram, "projection"), 1, GL_FALSE, glm::value_ptr(projection));
@@ -448,14 +899,28 @@ void initUniforms() {
 	
 }
 
+// distance at which the light's attenuation drops to the given factor
+float computeLightRadius(const PointLight& light, float attenuation) {
+	float c = light.constant - 1.0f / attenuation;
+	if (light.quadratic <= 0.0f) {
+		return -c / light.linear;
+	}
+	return (-light.linear + sqrt(light.linear * light.linear - 4.0f * light.quadratic * c)) / (2.0f * light.quadratic);
+}
+
 void initFBO() {
+	PROFILE_FUNCTION();
 	//TODO - Create the FBO, the depth texture and attach the depth texture to the FBO
 	glGenFramebuffers(1, &shadowMapFBO);
 	glGenTextures(1, &depthMapTexture);
 	glBindTexture(GL_TEXTURE_2D, depthMapTexture);
-	glTexImage2D(GL_TEXTURE_2D, 0, GL_DEPTH_COMPONENT, SHADOW_HEIGHT, SHADOW_HEIGHT, 0, GL_DEPTH_COMPONENT, GL_FLOAT, NULL);
-	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
-	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+	glTexImage2D(GL_TEXTURE_2D, 0, GL_DEPTH_COMPONENT24, SHADOW_WIDTH, SHADOW_HEIGHT, 0, GL_DEPTH_COMPONENT, GL_FLOAT, NULL);
+	// linear filtering + compare mode: every texture() on the sampler2DShadow
+	// returns a bilinearly weighted result of 4 depth comparisons (hardware PCF)
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_COMPARE_MODE, GL_COMPARE_REF_TO_TEXTURE);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_COMPARE_FUNC, GL_LEQUAL);
 	float borderColor[] = { 1.0f, 1.0f, 1.0f, 1.0f };
 	glTexParameterfv(GL_TEXTURE_2D, GL_TEXTURE_BORDER_COLOR, borderColor);
 	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_BORDER);
@@ -469,168 +934,990 @@ void initFBO() {
 
 	glBindFramebuffer(GL_FRAMEBUFFER, 0);
 
+	varianceShadowMap.Create(MOMENTS_SHADOW_WIDTH, MOMENTS_SHADOW_HEIGHT);
+
+	std::vector<gps::PointShadowLight> shadowLights;
+	for (int i = 0; i < pointLights.size(); i++) {
+		gps::PointShadowLight shadowLight;
+		shadowLight.position = pointLights[i].position;
+		shadowLight.radius = computeLightRadius(pointLights[i], 5.0f / 256.0f);  // dimmer than one 8 bit step
+		shadowLight.detailRadius = computeLightRadius(pointLights[i], 0.25f);
+		shadowLights.push_back(shadowLight);
+	}
+	pointShadowAtlas.Create(shadowLights);
 }
 
 glm::mat4 computeLightSpaceTrMatrix() {
-	lightRotation = glm::rotate(glm::mat4(1.0f), glm::radians(lightAngle), glm::vec3(0.0f, 1.0f, 0.0f));
+	return gps::computeSunLightSpaceMatrix(renderPacket.lightRotation, renderPacket.sunLightDir);
+}
 
-	// Adjust the light position to cover both objects
-	glm::vec3 lightPosition = glm::vec3(lightRotation * glm::vec4(sunLightDir, 1.0f)) + glm::vec3(0.0f, 5.0f, 0.0f);
 
-	// Ensure shadows are computed for both objects by adjusting light projection
-	glm::mat4 lightView = glm::lookAt(lightPosition, glm::vec3(0.0f, 0.0f, 0.0f), glm::vec3(0.0f, 1.0f, 0.0f));
-	const GLfloat near_plane = 0.1f, far_plane = 100.0f; // Increased far_plane to cover parking lot
-	glm::mat4 lightProjection = glm::ortho(-10.0f, 10.0f, -10.0f, 10.0f, near_plane, far_plane);
+// shadow passes take the model matrix as a plain uniform, the scene permutations through ObjectData
+void setObjectTransform(gps::Shader shader, bool depthPass) {
+	if (depthPass) {
+		gps::RenderStats::UniformMatrix4fv(glGetUniformLocation(shader.shaderProgram, "model"), 1, GL_FALSE, glm::value_ptr(model));
+		return;
+	}
 
-	glm::mat4 lightSpaceTrMatrix = lightProjection * lightView;
-	return lightSpaceTrMatrix;
+	// Compute normal matrix for accurate lighting and shadow calculations
+	normalMatrix = glm::mat3(glm::inverseTranspose(renderPacket.view * model));
+	objectData.model = model;
+	objectData.normalMatrix = glm::mat4(normalMatrix);
+	glBindBuffer(GL_UNIFORM_BUFFER, objectDataBuffer);
+	gps::RenderStats::BufferSubData(GL_UNIFORM_BUFFER, 0, sizeof(gps::ObjectData), &objectData);
+	glBindBuffer(GL_UNIFORM_BUFFER, 0);
 }
 
+void setProceduralSkyUniforms() {
+	proceduralSkyShader.useShaderProgram();
+	glm::vec3 sunDirection = glm::mat3(renderPacket.lightRotation) * renderPacket.skySunDirection;
+	gps::RenderStats::Uniform3fv(glGetUniformLocation(proceduralSkyShader.shaderProgram, "sunDirection"), 1, glm::value_ptr(sunDirection));
+	gps::RenderStats::Uniform1f(glGetUniformLocation(proceduralSkyShader.shaderProgram, "starIntensity"), renderPacket.skyStarIntensity);
+}
 
-void drawObjects(gps::Shader shader, bool depthPass) {
+// the cached sky only changes when the sun has moved by more than a fraction of a degree
+void updateSkyCache() {
+	if (renderPacket.skyMode != SKY_PROCEDURAL_CACHED) {
+		return;
+	}
+	if (!skyCacheDirty && glm::dot(renderPacket.skySunDirection, skyCacheSunDirection) > 0.99998f
+		&& glm::abs(renderPacket.skyStarIntensity - skyCacheStarIntensity) < 0.01f) {
+		return;
+	}
 
-	shader.useShaderProgram();
+	setProceduralSkyUniforms();
+	skyBox.RenderProceduralCubemap(proceduralSkyShader, SKY_CACHE_SIZE);
+	skyCacheSunDirection = renderPacket.skySunDirection;
+	skyCacheStarIntensity = renderPacket.skyStarIntensity;
+	skyCacheDirty = false;
+}
 
-	skyBox.Draw(skyboxShader, view, projection);
+void drawSky() {
+	switch (renderPacket.skyMode) {
+	case SKY_PROCEDURAL:
+		setProceduralSkyUniforms();
+		skyBox.DrawProcedural(proceduralSkyShader, renderPacket.view, renderPacket.projection);
+		break;
+	case SKY_PROCEDURAL_CACHED:
+		skyBox.DrawCached(skyboxShader, renderPacket.view, renderPacket.projection);
+		break;
+	default:
+		skyBox.Draw(skyboxShader, renderPacket.view, renderPacket.projection);
+		break;
+	}
+}
 
-	model = hondaModel;
-	glUniformMatrix4fv(glGetUniformLocation(shader.shaderProgram, "model"), 1, GL_FALSE, glm::value_ptr(model));
+// bounding sphere against the camera frustum, objects out of view still cast shadows
+bool isVisible(glm::mat4 transform, glm::vec4 boundingSphere) {
+	if (viewFrustum.IntersectsSphere(gps::transformBoundingSphere(transform, boundingSphere))) {
+		return true;
+	}
+	gps::RenderStats::CountCulled(1);
+	return false;
+}
+
+void drawObjects(gps::Shader shader, bool depthPass) {
+
+	// the sky never casts shadows, and would overwrite the moments in the shadow pass
+	if (depthPass) {
+		shader.useShaderProgram();
+	}
+	else {
+		passTimer.BeginPass("sky");
+		drawSky();
+		passTimer.BeginPass("objects");
+	}
+
+	// the honda and the parking lot, every object is part of the shadow passes
+	for (const gps::DrawItem& item : renderPacket.drawList) {
+		gps::Model3D* object = sceneModels[item.object];
+		model = item.model;
+		if (depthPass || isVisible(item.model, object->GetBoundingSphere())) {
+			setObjectTransform(shader, depthPass);
+			object->Draw(shader);
+		}
+	}
 
-	// Compute normal matrix for accurate lighting and shadow calculations
 	if (!depthPass) {
-		normalMatrix = glm::mat3(glm::inverseTranspose(view * model));
-		glUniformMatrix3fv(normalMatrixLoc, 1, GL_FALSE, glm::value_ptr(normalMatrix));
+		passTimer.EndPass();
 	}
+}
 
-	// Draw the honda
-	honda.Draw(shader);
 
-	// Draw the parking lot (Ensure it's part of the shadow pass)
-	model = parking_lotModel;
-	glUniformMatrix4fv(glGetUniformLocation(shader.shaderProgram, "model"), 1, GL_FALSE, glm::value_ptr(model));
+// a box of text in the top left corner, below the previous panel; returns where the next one goes
+float addOverlayPanel(float y, const std::string& text) {
+	const float scale = 2.0f;
+	const float margin = 8.0f;
+	int lines = 1;
+	int columns = 0;
+	int column = 0;
+	for (size_t i = 0; i < text.size(); i++) {
+		column = text[i] == '\n' ? 0 : column + 1;
+		lines += text[i] == '\n' ? 1 : 0;
+		columns = glm::max(columns, column);
+	}
+	float width = columns * gps::TextOverlay::CHARACTER_WIDTH * scale;
+	float height = lines * gps::TextOverlay::CHARACTER_HEIGHT * scale;
+	textOverlay.AddBox(margin, y, width + 2.0f * margin, height + 2.0f * margin, glm::vec4(0.0f, 0.0f, 0.0f, 0.6f));
+	textOverlay.AddText(2.0f * margin, y + margin, text, glm::vec4(1.0f, 1.0f, 0.8f, 1.0f), scale);
+	return y + height + 3.0f * margin;
+}
 
-	if (!depthPass) {
-		normalMatrix = glm::mat3(glm::inverseTranspose(view * model));
-		glUniformMatrix3fv(normalMatrixLoc, 1, GL_FALSE, glm::value_ptr(normalMatrix));
+// rolling averages of the pass times, CPU only scopes have no GPU column
+std::string passTimesText() {
+	const std::vector<gps::PassTime>& averages = passTimer.GetAverages();
+	char line[64];
+	std::string text = "PASS              GPU MS  CPU MS";
+	double gpuTotal = 0.0;
+	for (size_t i = 0; i < averages.size(); i++) {
+		if (averages[i].gpuTimed) {
+			snprintf(line, sizeof(line), "\n%-16s %7.2f %7.2f", averages[i].name.c_str(), averages[i].gpuMilliseconds, averages[i].cpuMilliseconds);
+			gpuTotal += averages[i].gpuMilliseconds;
+		}
+		else {
+			snprintf(line, sizeof(line), "\n%-16s %7s %7.2f", averages[i].name.c_str(), "-", averages[i].cpuMilliseconds);
+		}
+		text += line;
+	}
+	snprintf(line, sizeof(line), "\n%-16s %7.2f", "GPU TOTAL", gpuTotal);
+	text += line;
+	snprintf(line, sizeof(line), "\nDROPPED FRAMES %d", passTimer.GetDroppedFrames());
+	text += line;
+	return text;
+}
+
+std::string renderStatsText() {
+	const gps::RenderCounters& counters = gps::RenderStats::GetLastFrame();
+	char text[512];
+	snprintf(text, sizeof(text), "LAST FRAME\nDRAW CALLS      %10lld\nTRIANGLES       %10lld\nPROGRAM BINDS   %10lld\n"
+		"TEXTURE BINDS   %10lld\nVAO BINDS       %10lld\nUNIFORM UPLOADS %10lld\nBUFFER BYTES    %10lld\nCULLED OBJECTS  %10lld",
+		counters.drawCalls, counters.triangles, counters.programBinds, counters.textureBinds, counters.vaoBinds,
+		counters.uniformUploads, counters.bufferBytes, counters.culledObjects);
+	return text;
+}
+
+void drawStatsOverlay() {
+	gps::ScopedCpuTimer timer(passTimer, "overlay text");
+	float y = 8.0f;
+	if (renderPacket.showPassTimes) {
+		y = addOverlayPanel(y, passTimesText());
+	}
+	if (renderPacket.showRenderStats) {
+		y = addOverlayPanel(y, renderStatsText());
+	}
+	textOverlay.Draw(overlayTextShader, retina_width, retina_height);
+}
+
+// what the keys asked for that needs the GL context, before the packet that carries it is drawn
+void runFrameRequests() {
+	if (renderPacket.requests & gps::FRAME_REQUEST_WRITE_STATS) {
+		writePassTimes();
+		writeRenderStats();
+	}
+	if (renderPacket.requests & gps::FRAME_REQUEST_TOGGLE_CAPTURE) {
+		if (frameCapture.IsCapturing()) {
+			frameCapture.Stop();
+		}
+		else {
+			frameCapture.Start(captureDirectory, retina_width, retina_height, captureFormat, 0);
+		}
+	}
+	if (renderPacket.requests & gps::FRAME_REQUEST_GL_TRACE) {
+		gps::GLTrace::Capture(glTraceFile, GL_TRACE_FRAMES, sceneFramebuffer, retina_width, retina_height);
 	}
+}
 
-	parking_lot.Draw(shader);
+void printShaderSetupStats(const char* label) {
+	gps::Shader::SetupStats stats = gps::Shader::getSetupStats();
+	LOG_INFO("%s: %.1f ms, %d programs from the binary cache, %d compiled (%s)", label, stats.seconds * 1000.0,
+		stats.cachedPrograms, stats.compiledPrograms, stats.compiledPrograms == 0 ? "warm" : "cold");
 }
 
+// checks the programs loaded at startup once none of them would block, or once the scene has loaded
+// (the driver may not report its progress); a program drawn before that is finished by useShaderProgram
+void finishStartupShaders() {
+	if (!shaderStatusPending || !(gps::Shader::programsReady() || sceneLoading.IsDone())) {
+		return;
+	}
+	gps::Shader::finishPrograms();
+	printShaderSetupStats("Shader setup");
+	shaderStatusPending = false;
+}
 
+// draws renderPacket, on the thread that owns the GL context
 void renderScene() {
-	// depth maps creation pass
-	depthMapShader.useShaderProgram();
-	glUniformMatrix4fv(glGetUniformLocation(depthMapShader.shaderProgram, "lightSpaceTrMatrix"),
-		1, GL_FALSE, glm::value_ptr(computeLightSpaceTrMatrix()));
+	PROFILE_FUNCTION();
+	runFrameRequests();
+	// the models the upload thread finished; the main loop only sees them in its next iteration
+	if (uploadThread.Collect() > 0 && !headless) {
+		glfwPostEmptyEvent();
+	}
+	finishStartupShaders();
+	passTimer.BeginFrame();
+	gps::RenderStats::BeginFrame();
+	gps::GLTrace::BeginFrame();
+
+	passTimer.BeginCpuScope("scheduling");
+	if (renderPacket.shadowTechnique != renderedShadowTechnique) {
+		renderedShadowTechnique = renderPacket.shadowTechnique;
+		shadowMapDirty = true;
+	}
+	unsigned int drawnObjects = 0;
+	for (const gps::DrawItem& item : renderPacket.drawList) {
+		drawnObjects |= 1u << item.object;
+	}
+	if (drawnObjects != renderedObjects) {
+		renderedObjects = drawnObjects;
+		shadowMapDirty = true;
+		pointShadowAtlas.Invalidate();
+	}
+	if (renderPacket.skyMode != renderedSkyMode) {
+		renderedSkyMode = renderPacket.skyMode;
+		skyCacheDirty = true;
+	}
+	skyBox.SetBlendFactor(renderPacket.skyNightBlend);
+	glm::mat4 lightSpaceTrMatrix = computeLightSpaceTrMatrix();
+	if (lightSpaceTrMatrix != cachedLightSpaceTrMatrix) {
+		cachedLightSpaceTrMatrix = lightSpaceTrMatrix;
+		shadowMapDirty = true;
+	}
 
-	glViewport(0, 0, SHADOW_WIDTH, SHADOW_HEIGHT);
-	glBindFramebuffer(GL_FRAMEBUFFER, shadowMapFBO);
-	glClear(GL_DEPTH_BUFFER_BIT);
-	drawObjects(depthMapShader, true);
-	glBindFramebuffer(GL_FRAMEBUFFER, 0);
+	// pick the passes and the shader variant from how much each light contributes
+	passScheduler.Update(renderPacket.sunLightColor, renderPacket.sunLightDir, renderPacket.lampIntensity);
+	if (passScheduler.LevelsChanged()) {
+		LOG_INFO("Lighting passes: sun %d (%.3f), lamps %d (%.3f)", passScheduler.GetSunLevel(), passScheduler.GetSunContribution(),
+			passScheduler.GetLampLevel(), passScheduler.GetLampContribution());
+	}
+	myCustomShader = sceneShader.getPermutation(computeSceneKey(passScheduler.GetSunLevel(), passScheduler.GetLampLevel()));
+	bool renderSunShadows = passScheduler.ShouldRenderSunShadows(shadowMapDirty);
+	passTimer.EndCpuScope();
+
+	// lamp shadows: static lights, only redrawn when a moving object enters their radius
+	// or when their on-screen importance asks for a different resolution
+	if (pointShadowsEnabled && passScheduler.ShouldRenderLampShadows()) {
+		pointShadowAtlas.UpdateImportance(renderPacket.cameraPosition, glm::radians(45.0f), retina_height);
+		for (const gps::DrawItem& item : renderPacket.drawList) {
+			if (item.object == SCENE_HONDA) {
+				pointShadowAtlas.UpdateDynamicObject(0, gps::transformBoundingSphere(item.model, honda.GetBoundingSphere()));
+			}
+		}
+		if (pointShadowAtlas.NeedsUpdate()) {
+			passTimer.BeginPass("point shadows");
+			pointShadowAtlas.Render(pointShadowShader, drawObjects);
+			passTimer.EndPass();
+		}
+	}
+
+	// depth maps creation pass
+	if (renderSunShadows && renderPacket.shadowTechnique == SHADOW_TECHNIQUE_PCF) {
+		passTimer.BeginPass("sun shadows");
+		depthMapShader.useShaderProgram();
+		gps::RenderStats::UniformMatrix4fv(glGetUniformLocation(depthMapShader.shaderProgram, "lightSpaceTrMatrix"),
+			1, GL_FALSE, glm::value_ptr(lightSpaceTrMatrix));
+
+		glViewport(0, 0, SHADOW_WIDTH, SHADOW_HEIGHT);
+		glBindFramebuffer(GL_FRAMEBUFFER, shadowMapFBO);
+		glClear(GL_DEPTH_BUFFER_BIT);
+		drawObjects(depthMapShader, true);
+		glBindFramebuffer(GL_FRAMEBUFFER, 0);
+		shadowMapLightSpaceTrMatrix = lightSpaceTrMatrix;
+		shadowMapDirty = false;
+		passTimer.EndPass();
+	}
+	// moments pass, prefiltered once per shadow map change
+	else if (renderSunShadows) {
+		passTimer.BeginPass("sun shadows");
+		bool exponential = renderPacket.shadowTechnique == SHADOW_TECHNIQUE_EVSM;
+		shadowMomentsShader.useShaderProgram();
+		gps::RenderStats::UniformMatrix4fv(glGetUniformLocation(shadowMomentsShader.shaderProgram, "lightSpaceTrMatrix"),
+			1, GL_FALSE, glm::value_ptr(lightSpaceTrMatrix));
+		gps::RenderStats::Uniform1i(glGetUniformLocation(shadowMomentsShader.shaderProgram, "shadowTechnique"), renderPacket.shadowTechnique);
+		gps::RenderStats::Uniform2fv(glGetUniformLocation(shadowMomentsShader.shaderProgram, "evsmExponents"), 1, glm::value_ptr(evsmExponents));
+
+		varianceShadowMap.BeginRender(exponential, evsmExponents);
+		drawObjects(shadowMomentsShader, true);
+		varianceShadowMap.EndRender();
+		varianceShadowMap.Filter(shadowBlurShader, shadowBlurRadius);
+		shadowMapLightSpaceTrMatrix = lightSpaceTrMatrix;
+		shadowMapDirty = false;
+		passTimer.EndPass();
+	}
 
 	// Render depth map on screen (toggle with M key)
-	if (showDepthMap) {
+	if (renderPacket.showDepthMap) {
+		glBindFramebuffer(GL_FRAMEBUFFER, sceneFramebuffer);
 		glViewport(0, 0, retina_width, retina_height);
 		glClear(GL_COLOR_BUFFER_BIT);
 		screenQuadShader.useShaderProgram();
 		glActiveTexture(GL_TEXTURE0);
-		glBindTexture(GL_TEXTURE_2D, depthMapTexture);
-		glUniform1i(glGetUniformLocation(screenQuadShader.shaderProgram, "depthMap"), 0);
+		gps::RenderStats::BindTexture(GL_TEXTURE_2D, depthMapTexture);
+		// the debug view reads raw depth, so comparison has to be off while it samples
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_COMPARE_MODE, GL_NONE);
+		gps::RenderStats::Uniform1i(glGetUniformLocation(screenQuadShader.shaderProgram, "depthMap"), 0);
 		glDisable(GL_DEPTH_TEST);
 		screenQuad.Draw(screenQuadShader);
 		glEnable(GL_DEPTH_TEST);
+		gps::RenderStats::BindTexture(GL_TEXTURE_2D, depthMapTexture);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_COMPARE_MODE, GL_COMPARE_REF_TO_TEXTURE);
 	}
 	else {
+		viewFrustum.Update(renderPacket.projection * renderPacket.view);
+		// renders into its own framebuffer, so it goes before the main pass sets up the viewport
+		passTimer.BeginPass("sky cache");
+		updateSkyCache();
+		passTimer.EndPass();
+
 		// Final scene rendering pass (with shadows)
+		glBindFramebuffer(GL_FRAMEBUFFER, sceneFramebuffer);
 		glViewport(0, 0, retina_width, retina_height);
 		glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
 
-		myCustomShader.useShaderProgram();
-
-		view = myCamera.getViewMatrix();
-		glUniformMatrix4fv(viewLoc, 1, GL_FALSE, glm::value_ptr(view));
-
-		lightRotation = glm::rotate(glm::mat4(1.0f), glm::radians(lightAngle), glm::vec3(0.0f, 1.0f, 0.0f));
-		glUniform3fv(sunLightDirLoc, 1, glm::value_ptr(glm::inverseTranspose(glm::mat3(view * lightRotation)) * sunLightDir));
+		// everything the permutations read per frame, in a single upload
+		passTimer.BeginCpuScope("frame data");
+		frameData.view = renderPacket.view;
+		frameData.projection = renderPacket.projection;
+		// a degraded sun may be a few frames behind, so the lookup uses the matrix the map was drawn with
+		frameData.lightSpaceTrMatrix = shadowMapLightSpaceTrMatrix;
+		frameData.sunLightDir = glm::vec4(glm::inverseTranspose(glm::mat3(renderPacket.view * renderPacket.lightRotation)) * renderPacket.sunLightDir, 0.0f);
+		frameData.sunLightColor = glm::vec4(renderPacket.sunLightColor, 1.0f);
+
+		glm::vec3 boostedColor = renderPacket.isDay ? glm::vec3(1.0f, 1.0f, 1.0f) : glm::vec3(1.2f, 1.0f, 0.7f);  // Soft glow at night
+		for (int i = 0; i < pointLights.size() && i < gps::MAX_SCENE_POINT_LIGHTS; i++) {
+			glm::vec3 adjustedColor = pointLights[i].color * boostedColor * renderPacket.lampIntensity;
+			frameData.pointLights[i].position = glm::vec4(pointLights[i].position, 1.0f);
+			frameData.pointLights[i].color = glm::vec4(adjustedColor, 1.0f);
+			frameData.pointLights[i].attenuation = glm::vec4(pointLights[i].constant, pointLights[i].linear,
+				pointLights[i].quadratic, pointShadowAtlas.GetLightRadius(i));
+			frameData.pointShadowRects[i] = pointShadowAtlas.GetTileRect(i);
+		}
 
-		// Bind shadow map
+		frameData.evsmExponents = evsmExponents;
+		frameData.shadowKernel = renderPacket.shadowKernel;
+		frameData.shadowSamples = shadowSamples;
+		frameData.shadowFilterRadius = renderPacket.shadowFilterRadius;
+		frameData.shadowMinBias = shadowMinBias;
+		frameData.shadowSlopeBias = shadowSlopeBias;
+		frameData.vsmMinVariance = vsmMinVariance;
+		frameData.lightBleedReduction = lightBleedReduction;
+		frameData.pointShadowsEnabled = pointShadowsEnabled;
+
+		glBindBuffer(GL_UNIFORM_BUFFER, frameDataBuffer);
+		gps::RenderStats::BufferSubData(GL_UNIFORM_BUFFER, 0, sizeof(gps::FrameData), &frameData);
+		glBindBuffer(GL_UNIFORM_BUFFER, 0);
+		passTimer.EndCpuScope();
+
+		// shadow maps, on the units set up by setupScenePermutation
 		glActiveTexture(GL_TEXTURE3);
-		glBindTexture(GL_TEXTURE_2D, depthMapTexture);
-		glUniform1i(glGetUniformLocation(myCustomShader.shaderProgram, "shadowMap"), 3);
-
-		glUniformMatrix4fv(glGetUniformLocation(myCustomShader.shaderProgram, "lightSpaceTrMatrix"),
-			1, GL_FALSE, glm::value_ptr(computeLightSpaceTrMatrix()));
+		gps::RenderStats::BindTexture(GL_TEXTURE_2D, depthMapTexture);
+		glActiveTexture(GL_TEXTURE4);
+		gps::RenderStats::BindTexture(GL_TEXTURE_2D, varianceShadowMap.GetTextureId());
+		pointShadowAtlas.BindTexture(5);
 
 		drawObjects(myCustomShader, false);
 
 		// **🔹 Draw a small white cube at the sun position**
+		passTimer.BeginPass("light markers");
 		lightShader.useShaderProgram();
-		glUniformMatrix4fv(glGetUniformLocation(lightShader.shaderProgram, "view"), 1, GL_FALSE, glm::value_ptr(view));
+		gps::RenderStats::UniformMatrix4fv(glGetUniformLocation(lightShader.shaderProgram, "view"), 1, GL_FALSE, glm::value_ptr(renderPacket.view));
 
-		model = lightRotation;
-		model = glm::translate(model, sunLightDir + glm::vec3(0.5f, 1.0f, 0.0f));
+		model = renderPacket.lightRotation;
+		model = glm::translate(model, renderPacket.sunLightDir + glm::vec3(0.5f, 1.0f, 0.0f));
 		model = glm::scale(model, glm::vec3(0.05f, 0.05f, 0.05f));
-		glUniformMatrix4fv(glGetUniformLocation(lightShader.shaderProgram, "model"), 1, GL_FALSE, glm::value_ptr(model));
+		gps::RenderStats::UniformMatrix4fv(glGetUniformLocation(lightShader.shaderProgram, "model"), 1, GL_FALSE, glm::value_ptr(model));
 		lightCube.Draw(lightShader);
 
-		glm::vec3 boostedColor = isDay ? glm::vec3(1.0f, 1.0f, 1.0f) : glm::vec3(1.2f, 1.0f, 0.7f);  // Soft glow at night
-
-
-		myCustomShader.useShaderProgram();
-		for (int i = 0; i < pointLights.size(); i++) {
-			std::string base = "pointLights[" + std::to_string(i) + "]";
-			glm::vec3 adjustedColor = pointLights[i].color * boostedColor;
-			glUniform3fv(glGetUniformLocation(myCustomShader.shaderProgram, (base + ".color").c_str()), 1, glm::value_ptr(adjustedColor));
-		}
-
 		// **🔹 Draw small cubes at point light positions**
 		for (int i = 0; i < pointLights.size(); i++) {
 			model = glm::mat4(1.0f);
 			model = glm::translate(model, pointLights[i].position);
 			model = glm::scale(model, glm::vec3(0.05f, 0.05f, 0.05f)); // Small glowing cube for point light
-			glUniformMatrix4fv(glGetUniformLocation(lightShader.shaderProgram, "model"), 1, GL_FALSE, glm::value_ptr(model));
+			gps::RenderStats::UniformMatrix4fv(glGetUniformLocation(lightShader.shaderProgram, "model"), 1, GL_FALSE, glm::value_ptr(model));
 			lightCube.Draw(lightShader);
 		}
+		passTimer.EndPass();
+	}
+
+	if (renderPacket.showPassTimes || renderPacket.showRenderStats) {
+		passTimer.BeginPass("overlay");
+		drawStatsOverlay();
+		passTimer.EndPass();
 	}
+
+	// a degraded sun redraws its shadow map a few frames late, the simulation keeps sending frames until it has;
+	// the uploads are only collected while frames are drawn
+	renderWantsFrames = (shadowMapDirty && passScheduler.GetSunLevel() == gps::PASS_DEGRADED)
+		|| frameCapture.IsCapturing() || gps::GLTrace::IsRecording() || uploadThread.GetPending() > 0;
+	lastRenderedFrame = renderPacket.frame;
 }
 
 void cleanup() {
+	// closed before the startup programs were checked
+	gps::Shader::finishPrograms();
+	// includes the scene permutations created while running
+	printShaderSetupStats("Total shader setup");
+	LOG_INFO("Frames: %d rendered, %d idle waits", frameScheduler.GetRenderedFrames(), frameScheduler.GetSkippedFrames());
+	// closed while the scene was still loading: what was not parsed yet is skipped
+	sceneLoad.Cancel();
+	finishSceneLoading();
+	uploadThread.Stop();
+	gps::JobSystem::Stop();
+	gps::GLTrace::Stop();
 	glDeleteTextures(1, &depthMapTexture);
 	glBindFramebuffer(GL_FRAMEBUFFER, 0);
 	glDeleteFramebuffers(1, &shadowMapFBO);
-	glfwDestroyWindow(glWindow);
-	//close GL context and any other GLFW resources
-	glfwTerminate();
+	varianceShadowMap.Delete();
+	pointShadowAtlas.Delete();
+	skyBox.Delete();
+	glDeleteBuffers(1, &frameDataBuffer);
+	glDeleteBuffers(1, &objectDataBuffer);
+	// closed before all the frames were rendered
+	if (profilingFrames) {
+		gps::Profiler::WriteTrace(PROFILE_FRAMES_FILE);
+	}
+	if (writePassTimesOnExit) {
+		writePassTimes();
+	}
+	if (writeRenderStatsOnExit) {
+		writeRenderStats();
+	}
+	// the frames still in flight need the context
+	frameCapture.Stop();
+	passTimer.Delete();
+	textOverlay.Delete();
+	// GLFW only runs with a window (on Linux the headless context is EGL's)
+	if (headless) {
+		headlessContext.Delete();
+	}
+	else {
+		glfwDestroyWindow(glWindow);
+		//close GL context and any other GLFW resources
+		glfwTerminate();
+	}
+	gps::Logger::Stop();
+}
+
+// starts a requested frame capture, or writes the finished one; called at the top of a frame,
+// so the "frame" zone of the last captured frame is closed by then, and once the renderer drew it
+void updateFrameProfile() {
+	if (profilingFrames && profileFramesLeft == 0 && lastRenderedFrame >= lastProfiledFrame) {
+		gps::Profiler::WriteTrace(PROFILE_FRAMES_FILE);
+		profilingFrames = false;
+	}
+	else if (!profilingFrames && profileFramesLeft > 0) {
+		LOG_INFO("Capturing %d frames", profileFramesLeft);
+		gps::Profiler::StartCapture();
+		profilingFrames = true;
+	}
+}
+
+// after the packet of a profiled frame was built (and drawn, without the render thread)
+void frameProfiled() {
+	if (profilingFrames && profileFramesLeft > 0) {
+		profileFramesLeft--;
+		lastProfiledFrame = simulationFrame - 1;
+	}
+}
+
+// owns the GL context while the main loop simulates, and draws the packets it queues
+void renderLoop() {
+	gps::Profiler::SetThreadName("render");
+	glfwMakeContextCurrent(glWindow);
+	while (frameQueue.Pop(renderPacket)) {
+		PROFILE_ZONE("render frame");
+		renderScene();
+		frameCapture.CaptureFrame(sceneFramebuffer, retina_width, retina_height);
+		glfwSwapBuffers(glWindow);
+	}
+	// back to the main thread, for the cleanup
+	glfwMakeContextCurrent(NULL);
+}
+
+// no window: a surfaceless (or hidden) context rendering into an offscreen framebuffer
+bool initHeadless(int width, int height) {
+	if (!headlessContext.Create(width, height)) {
+		return false;
+	}
+	retina_width = headlessContext.GetWidth();
+	retina_height = headlessContext.GetHeight();
+	sceneFramebuffer = headlessContext.GetFramebuffer();
+	return true;
+}
+
+// every frame is rendered and finished, nothing waits for input
+void runHeadless() {
+	std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+	for (int frame = 0; frame < headlessFrames; frame++) {
+		updateFrameProfile();
+		PROFILE_ZONE("frame");
+		processMovement();
+		updateDayNightCycle();
+		buildFramePacket(renderPacket);
+		renderScene();
+		frameCapture.CaptureFrame(sceneFramebuffer, retina_width, retina_height);
+		headlessContext.EndFrame();
+		frameProfiled();
+	}
+	double milliseconds = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+	LOG_INFO("Headless: %d frames at %dx%d in %.1f ms (%.3f ms/frame)", headlessFrames, retina_width, retina_height,
+		milliseconds, headlessFrames > 0 ? milliseconds / headlessFrames : 0.0);
+}
+
+// orbit around the motorcycle from morning to night, used when --benchmark gets no path file
+gps::CameraPath defaultBenchmarkPath() {
+	gps::CameraPath path;
+	const int keyCount = 9;
+	for (int i = 0; i < keyCount; i++) {
+		float u = (float)i / (keyCount - 1);
+		float orbitAngle = u * glm::two_pi<float>();
+		float radius = glm::mix(8.0f, 4.0f, sin(u * glm::pi<float>()));
+		gps::CameraKey key;
+		key.time = u * 20.0f;
+		key.position = glm::vec3(sin(orbitAngle) * radius, glm::mix(3.0f, 1.5f, u), cos(orbitAngle) * radius);
+		key.target = glm::vec3(0.0f, 1.0f, 0.0f);
+		key.timeOfDay = glm::mix(7.0f, 21.0f, u);
+		path.AddKey(key);
+	}
+	return path;
+}
+
+// replays the path at fixed simulation steps, independent of the frame rate and of any input
+void runBenchmark() {
+	gps::CameraPath path;
+	if (benchmarkPathFile.empty() || !path.Load(benchmarkPathFile)) {
+		path = defaultBenchmarkPath();
+	}
+	autoDayCycle = false;
+	if (!headless) {
+		glfwSwapInterval(0);  // vsync would hide the frame times
+	}
+
+	gps::BenchmarkReport report;
+	report.SetInfo("renderer", (const char*)glGetString(GL_RENDERER));
+	report.SetInfo("resolution", std::to_string(retina_width) + "x" + std::to_string(retina_height));
+	report.SetInfo("path", benchmarkPathFile.empty() ? "default orbit" : benchmarkPathFile);
+	report.SetInfo("step", std::to_string(BENCHMARK_STEP));
+	report.SetInfo("capture", !frameCapture.IsCapturing() ? "off" : captureFormat == gps::CAPTURE_PNG ? "png" : "raw");
+
+	int frameCount = (int)(path.GetDuration() / BENCHMARK_STEP) + 1;
+	int firstTimerFrame = -1;
+	int lastResultsFrame = -1;
+	for (int frame = -BENCHMARK_WARMUP_FRAMES; frame < frameCount; frame++) {
+		if (!headless && glfwWindowShouldClose(glWindow)) {
+			break;
+		}
+		std::chrono::steady_clock::time_point frameStart = std::chrono::steady_clock::now();
+
+		gps::CameraKey key = path.Evaluate(glm::max(frame, 0) * BENCHMARK_STEP);
+		myCamera.setCameraPosition(key.position);
+		myCamera.setCameraTarget(key.target);
+		view = myCamera.getViewMatrix();
+		timeOfDay = key.timeOfDay;
+		updateDayNightCycle();
+		buildFramePacket(renderPacket);
+		renderScene();
+		if (frame == 0) {
+			firstTimerFrame = passTimer.GetFrame();
+		}
+		if (frame >= 0) {
+			frameCapture.CaptureFrame(sceneFramebuffer, retina_width, retina_height);
+		}
+
+		std::chrono::steady_clock::time_point submitted = std::chrono::steady_clock::now();
+		if (headless) {
+			headlessContext.EndFrame();
+		}
+		else {
+			glfwSwapBuffers(glWindow);
+			glfwPollEvents();
+		}
+		std::chrono::steady_clock::time_point frameEnd = std::chrono::steady_clock::now();
+
+		// the counters of a frame are closed by the next renderScene
+		if (frame > 0) {
+			report.AddRenderCounters(gps::RenderStats::GetLastFrame());
+		}
+		if (frame >= 0) {
+			report.AddFrame(std::chrono::duration<double, std::milli>(submitted - frameStart).count(),
+				std::chrono::duration<double, std::milli>(frameEnd - frameStart).count());
+		}
+		// GPU times arrive a few frames late, the last frames of the path have none
+		if (firstTimerFrame >= 0 && passTimer.GetResultsFrame() >= firstTimerFrame && passTimer.GetResultsFrame() != lastResultsFrame) {
+			lastResultsFrame = passTimer.GetResultsFrame();
+			report.AddPassTimes(passTimer.GetResults());
+		}
+	}
+
+	LOG_INFO("Benchmark: %s", report.Summary().c_str());
+	if (report.WriteJson(benchmarkOutput)) {
+		LOG_INFO("Benchmark report written to %s", benchmarkOutput.c_str());
+	}
+}
+
+// the motorcycle and the parking lot in the morning, at noon, at sunset and at night
+gps::CameraPath defaultGoldenViews() {
+	gps::CameraPath views;
+	const gps::CameraKey keys[] = {
+		{ 0.0f, glm::vec3(0.0f, 2.0f, 5.5f), glm::vec3(0.0f, 1.0f, 0.0f), 8.0f },
+		{ 1.0f, glm::vec3(6.0f, 2.5f, 2.0f), glm::vec3(0.0f, 1.0f, 0.0f), 12.0f },
+		{ 2.0f, glm::vec3(-8.0f, 4.0f, -6.0f), glm::vec3(0.0f, 0.5f, 0.0f), 18.5f },
+		{ 3.0f, glm::vec3(3.0f, 1.5f, -5.0f), glm::vec3(0.0f, 1.0f, 0.0f), 23.0f },
+	};
+	for (int i = 0; i < (int)(sizeof(keys) / sizeof(keys[0])); i++) {
+		views.AddKey(keys[i]);
+	}
+	return views;
+}
+
+// compares a read back view with its golden image (or replaces it with --golden-update)
+bool checkGoldenView(int view, std::vector<unsigned char>& pixels, gps::BenchmarkReport& report) {
+	int width = retina_width;
+	int height = retina_height;
+	// the alpha of the framebuffer isn't part of the picture, and PNG rows go top down
+	for (size_t i = 3; i < pixels.size(); i += 4) {
+		pixels[i] = 255;
+	}
+	gps::Model3D::FlipRows(pixels.data(), width, height, 4);
+
+	std::string name = "view_" + std::to_string(view);
+	std::string goldenFile = goldenDirectory + "/" + name + ".png";
+	if (goldenUpdate) {
+		return gps::PngWriter::Write(goldenFile, width, height, 4, pixels.data(), false);
+	}
+
+	int goldenWidth, goldenHeight, goldenChannels;
+	unsigned char* golden = stbi_load(goldenFile.c_str(), &goldenWidth, &goldenHeight, &goldenChannels, 4);
+	bool passed = false;
+	gps::ImageDiffResult diff = {};
+	std::vector<unsigned char> diffImage;
+	if (golden == NULL) {
+		LOG_ERROR("%s: no golden image %s (run with --golden-update to create it)", name.c_str(), goldenFile.c_str());
+	}
+	else if (goldenWidth != width || goldenHeight != height) {
+		LOG_ERROR("%s: rendered at %dx%d, the golden image is %dx%d", name.c_str(), width, height, goldenWidth, goldenHeight);
+	}
+	else {
+		diff = gps::ImageDiff::Compare(golden, pixels.data(), width, height, goldenThreshold, &diffImage);
+		passed = diff.differentFraction <= goldenTolerance;
+		LOG_INFO("%s: %s, %d pixels changed (%.4f%%), max difference %.3f", name.c_str(), passed ? "passed" : "FAILED",
+			diff.differentPixels, diff.differentFraction * 100.0, diff.maxDifference);
+	}
+	if (golden != NULL) {
+		stbi_image_free(golden);
+	}
+	report.AddImageDiff(name, diff, passed);
+
+	// kept next to the golden image to see what changed
+	if (!passed) {
+		gps::PngWriter::Write(goldenDirectory + "/" + name + "_actual.png", width, height, 4, pixels.data(), false);
+		if (!diffImage.empty()) {
+			gps::PngWriter::Write(goldenDirectory + "/" + name + "_diff.png", width, height, 4, diffImage.data(), false);
+		}
+	}
+	return passed;
+}
+
+// renders every view until it has settled and reads the last frame back while the next view renders;
+// returns false when a view doesn't match its golden image
+bool runGoldenTest() {
+	gps::CameraPath views;
+	if (goldenViewsFile.empty()) {
+		views = defaultGoldenViews();
+	}
+	// the built-in views would be compared with (or written over) the golden images of the file's views
+	else if (!views.Load(goldenViewsFile)) {
+		LOG_ERROR("could not load the golden views %s", goldenViewsFile.c_str());
+		return false;
+	}
+	autoDayCycle = false;
+
+	gps::AsyncReadback readback;
+	if (!readback.Create(retina_width, retina_height)) {
+		LOG_ERROR("could not create the readback buffers");
+		return false;
+	}
+
+	gps::BenchmarkReport report;
+	report.SetInfo("renderer", (const char*)glGetString(GL_RENDERER));
+	report.SetInfo("resolution", std::to_string(retina_width) + "x" + std::to_string(retina_height));
+	report.SetInfo("views", goldenViewsFile.empty() ? "default views" : goldenViewsFile);
+	report.SetInfo("threshold", std::to_string(goldenThreshold));
+	report.SetInfo("tolerance", std::to_string(goldenTolerance));
+
+	int failures = 0;
+	int lastResultsFrame = -1;
+	std::vector<unsigned char> pixels;
+	int readView;
+	for (int viewIndex = 0; viewIndex < views.GetKeyCount(); viewIndex++) {
+		const gps::CameraKey& key = views.GetKey(viewIndex);
+		for (int frame = 0; frame < GOLDEN_SETTLE_FRAMES; frame++) {
+			std::chrono::steady_clock::time_point frameStart = std::chrono::steady_clock::now();
+			myCamera.setCameraPosition(key.position);
+			myCamera.setCameraTarget(key.target);
+			view = myCamera.getViewMatrix();
+			timeOfDay = key.timeOfDay;
+			updateDayNightCycle();
+			buildFramePacket(renderPacket);
+			renderScene();
+			if (frame == GOLDEN_SETTLE_FRAMES - 1) {
+				// every slot in flight: the oldest view is checked first to make room
+				if (!readback.Request(sceneFramebuffer, viewIndex)) {
+					if (readback.Retrieve(pixels, readView, true)) {
+						failures += checkGoldenView(readView, pixels, report) ? 0 : 1;
+					}
+					if (!readback.Request(sceneFramebuffer, viewIndex)) {
+						LOG_ERROR("golden view %d could not be read back", viewIndex);
+						failures++;
+					}
+				}
+			}
+			std::chrono::steady_clock::time_point submitted = std::chrono::steady_clock::now();
+			headlessContext.EndFrame();
+			std::chrono::steady_clock::time_point frameEnd = std::chrono::steady_clock::now();
+
+			// the counters of a frame are closed by the next renderScene
+			if (viewIndex > 0 || frame > 0) {
+				report.AddRenderCounters(gps::RenderStats::GetLastFrame());
+			}
+			report.AddFrame(std::chrono::duration<double, std::milli>(submitted - frameStart).count(),
+				std::chrono::duration<double, std::milli>(frameEnd - frameStart).count());
+			if (passTimer.GetResultsFrame() >= 0 && passTimer.GetResultsFrame() != lastResultsFrame) {
+				lastResultsFrame = passTimer.GetResultsFrame();
+				report.AddPassTimes(passTimer.GetResults());
+			}
+
+			// the previous view, read back while this one renders
+			while (readback.Retrieve(pixels, readView, false)) {
+				failures += checkGoldenView(readView, pixels, report) ? 0 : 1;
+			}
+		}
+	}
+	while (readback.Retrieve(pixels, readView, true)) {
+		failures += checkGoldenView(readView, pixels, report) ? 0 : 1;
+	}
+	readback.Delete();
+
+	if (goldenUpdate) {
+		LOG_INFO("Golden images of %d views written to %s", views.GetKeyCount(), goldenDirectory.c_str());
+		return failures == 0;
+	}
+	std::string reportFile = goldenDirectory + "/golden_report.json";
+	if (report.WriteJson(reportFile)) {
+		LOG_INFO("Golden test: %d of %d views passed, %s, report written to %s", views.GetKeyCount() - failures, views.GetKeyCount(),
+			report.Summary().c_str(), reportFile.c_str());
+	}
+	return failures == 0;
 }
 
 int main(int argc, const char* argv[]) {
 
-	if (!initOpenGLWindow()) {
+	if (argc > 1 && std::string(argv[1]) == "--bake-cubemaps") {
+		return bakeSkyBoxes() ? 0 : 1;
+	}
+
+	int headlessWidth = glWindowWidth;
+	int headlessHeight = glWindowHeight;
+	for (int i = 1; i < argc; i++) {
+		std::string argument = argv[i];
+		if (argument == "--headless") {
+			headless = true;
+		}
+		else if (argument == "--width" && i + 1 < argc) {
+			headlessWidth = std::atoi(argv[++i]);
+		}
+		else if (argument == "--height" && i + 1 < argc) {
+			headlessHeight = std::atoi(argv[++i]);
+		}
+		else if (argument == "--frames" && i + 1 < argc) {
+			headlessFrames = std::atoi(argv[++i]);
+		}
+		else if (argument == "--benchmark") {
+			benchmark = true;
+			if (i + 1 < argc && std::string(argv[i + 1]).compare(0, 2, "--") != 0) {
+				benchmarkPathFile = argv[++i];
+			}
+		}
+		else if (argument == "--benchmark-output" && i + 1 < argc) {
+			benchmarkOutput = argv[++i];
+		}
+		else if (argument == "--golden" && i + 1 < argc) {
+			goldenTest = true;
+			headless = true;
+			goldenDirectory = argv[++i];
+		}
+		else if (argument == "--golden-update") {
+			goldenUpdate = true;
+		}
+		else if (argument == "--golden-views" && i + 1 < argc) {
+			goldenViewsFile = argv[++i];
+		}
+		else if (argument == "--golden-threshold" && i + 1 < argc) {
+			goldenThreshold = std::atof(argv[++i]);
+		}
+		else if (argument == "--golden-tolerance" && i + 1 < argc) {
+			goldenTolerance = std::atof(argv[++i]);
+		}
+		else if (argument == "--capture") {
+			captureOnStart = true;
+			if (i + 1 < argc && std::string(argv[i + 1]).compare(0, 2, "--") != 0) {
+				captureDirectory = argv[++i];
+			}
+		}
+		else if (argument == "--gl-trace" && i + 1 < argc) {
+			glTraceFile = argv[++i];
+			glTraceFrames = GL_TRACE_FRAMES;
+			if (i + 1 < argc && std::atoi(argv[i + 1]) > 0) {
+				glTraceFrames = std::atoi(argv[++i]);
+			}
+		}
+		else if (argument == "--capture-format" && i + 1 < argc) {
+			captureFormat = std::string(argv[++i]) == "raw" ? gps::CAPTURE_RAW : gps::CAPTURE_PNG;
+		}
+		else if (argument == "--pass-times") {
+			writePassTimesOnExit = true;
+		}
+		else if (argument == "--render-stats") {
+			writeRenderStatsOnExit = true;
+		}
+		else if (argument == "--profile-startup") {
+			profileStartup = true;
+		}
+		else if (argument == "--profile-frames" && i + 1 < argc) {
+			profileFramesLeft = glm::max(std::atoi(argv[++i]), 0);
+		}
+		else if (argument == "--jobs" && i + 1 < argc) {
+			jobThreads = glm::max(std::atoi(argv[++i]), 0);
+		}
+		else if (argument == "--frame-queue" && i + 1 < argc) {
+			frameQueueDepth = glm::max(std::atoi(argv[++i]), 0);
+		}
+	}
+
+	gps::Profiler::SetThreadName("main");
+	if (profileStartup) {
+		gps::Profiler::StartCapture();
+	}
+	gps::Logger::Start();
+
+	if (headless) {
+		if (headlessWidth <= 0 || headlessHeight <= 0 || !initHeadless(headlessWidth, headlessHeight)) {
+			LOG_ERROR("could not start headless rendering at %dx%d", headlessWidth, headlessHeight);
+			gps::Logger::Stop();
+			return 1;
+		}
+	}
+	else if (!initOpenGLWindow()) {
 		glfwTerminate();
+		gps::Logger::Stop();
 		return 1;
 	}
 
 	initOpenGLState();
-	initObjects();
+	gps::JobSystem::Start(jobThreads);
+	LOG_INFO("Job system: %d threads", gps::JobSystem::GetThreadCount());
+	if (!headless) {
+		uploadThread.Start(glWindow);
+	}
+
+	// warm runs load every program from the binary cache instead of compiling it;
+	// the rest compile on the driver's threads while the models load
+	gps::Shader::enableParallelCompile();
+	gps::Shader::setBinaryCacheDirectory("shader_cache");
 	initShaders();
+	initObjects();
 	initUniforms();
-	initSkyBox(true);
+	initSkyBox();
 	initFBO();
 
 	glCheckError();
 
-	while (!glfwWindowShouldClose(glWindow)) {
+	if (profileStartup) {
+		gps::Profiler::WriteTrace(PROFILE_STARTUP_FILE);
+	}
+
+	if (captureOnStart && !goldenTest) {
+		frameCapture.Start(captureDirectory, retina_width, retina_height, captureFormat, 0);
+	}
+	if (glTraceFrames > 0) {
+		gps::GLTrace::Capture(glTraceFile, glTraceFrames, sceneFramebuffer, retina_width, retina_height);
+	}
+
+	int exitCode = 0;
+	if (goldenTest) {
+		exitCode = runGoldenTest() ? 0 : 1;
+	}
+	else if (benchmark) {
+		runBenchmark();
+	}
+	else if (headless) {
+		runHeadless();
+	}
+	// the GL context moves to the render thread, the window events and the simulation stay here
+	bool renderThreaded = !headless && !benchmark && frameQueueDepth > 0;
+	if (renderThreaded) {
+		frameQueue.SetDepth(frameQueueDepth);
+		glfwMakeContextCurrent(NULL);
+		renderThread = std::thread(renderLoop);
+	}
+	while (!headless && !benchmark && !glfwWindowShouldClose(glWindow)) {
+		updateFrameProfile();
+		PROFILE_ZONE("frame");
+		// sleeps until an event arrives when the previous iteration left nothing to draw
+		frameScheduler.WaitForEvents();
+		int readyModels = 0;
+		for (int i = 0; i < SCENE_OBJECT_COUNT; i++) {
+			readyModels += sceneModels[i]->IsReady() ? 1 : 0;
+		}
+		if (readyModels != readySceneModels) {
+			readySceneModels = readyModels;
+			frameScheduler.MarkDirty(gps::FRAME_DIRTY_RESOURCES);
+		}
+		int loadProgress = sceneLoading.IsDone() ? 100 : (int)(sceneLoad.GetProgress() * 100.0f);
+		if (loadProgress != shownLoadProgress) {
+			shownLoadProgress = loadProgress;
+			std::string title = WINDOW_TITLE;
+			if (loadProgress < 100) {
+				title += " - loading " + std::to_string(loadProgress) + "%";
+			}
+			glfwSetWindowTitle(glWindow, title.c_str());
+		}
 		processMovement();
 		updateDayNightCycle();
-		renderScene();
+		// the stats overlays keep drawing so their numbers stay current, the render thread while it records or catches up
+		// the uploads in flight are only collected while frames are drawn, and the render thread may be idle when they start;
+		// a loading scene keeps its progress in the title current and its models arriving
+		bool sceneLoadingRuns = sceneLoading.IsValid() && !sceneLoading.IsDone();
+		frameScheduler.SetAnimating(autoDayCycle || movementKeyHeld() || showPassTimes || showRenderStats || renderWantsFrames
+			|| uploadThread.GetPending() > 0 || sceneLoadingRuns);
+		if (recording) {
+			recordCameraKey();
+		}
 
-		glfwPollEvents();
-		glfwSwapBuffers(glWindow);
+		if (frameScheduler.ShouldRender()) {
+			if (renderThreaded) {
+				gps::FramePacket packet;
+				buildFramePacket(packet);
+				// blocks while the render thread is frameQueueDepth frames behind
+				frameQueue.Push(std::move(packet));
+			}
+			else {
+				buildFramePacket(renderPacket);
+				renderScene();
+				frameCapture.CaptureFrame(sceneFramebuffer, retina_width, retina_height);
+				glfwSwapBuffers(glWindow);
+			}
+			frameScheduler.FrameRendered();
+			frameProfiled();
+		}
+	}
+	if (renderThreaded) {
+		// the packets still queued are drawn first
+		frameQueue.Close();
+		renderThread.join();
+		glfwMakeContextCurrent(glWindow);
+		LOG_INFO("Frame queue: depth %d, the simulation waited %d times for the render thread", frameQueue.GetDepth(), frameQueue.GetStalls());
 	}
 
 	cleanup();
 
-	return 0;
+	return exitCode;
 }
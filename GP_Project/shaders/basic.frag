@@ -7,30 +7,113 @@ in vec4 fragPosLightSpace;
 in vec3 fPosition;
 out vec4 fColor;
 
-// Sunlight (Directional Light)
-uniform vec3 sunLightDir;
-uniform vec3 sunLightColor;
-uniform vec3 sunLightPosition;  
-uniform mat4 model;  
+// Variant selected by the pass scheduler from the light contributions
+// SUN_LIGHTING: 0 = sun ambient only, 1 = diffuse with a single shadow tap, 2 = full
+// POINT_LIGHTING: 0 = lamps off, 1 = lamps without shadows, 2 = full
+#ifndef SUN_LIGHTING
+#define SUN_LIGHTING 2
+#endif
+#ifndef POINT_LIGHTING
+#define POINT_LIGHTING 2
+#endif
+
+// Permutation options, all compiled in rather than branched on per fragment
+// POINT_LIGHT_COUNT: lamps evaluated by the light loop, at most NUM_POINT_LIGHTS
+// SHADOW_TECHNIQUE: one of the SHADOW_TECHNIQUE_* values below
+// HAS_DIFFUSE_TEXTURE / HAS_SPECULAR_TEXTURE: maps bound by the mesh (see gps::MaterialFeature)
+#ifndef POINT_LIGHT_COUNT
+#define POINT_LIGHT_COUNT 3
+#endif
+#ifndef SHADOW_TECHNIQUE
+#define SHADOW_TECHNIQUE 0
+#endif
+#ifndef HAS_DIFFUSE_TEXTURE
+#define HAS_DIFFUSE_TEXTURE 1
+#endif
+#ifndef HAS_SPECULAR_TEXTURE
+#define HAS_SPECULAR_TEXTURE 1
+#endif
+
+// Uniform blocks shared by every permutation, mirrored by gps::FrameData / gps::ObjectData
+#define NUM_POINT_LIGHTS 3
 
 struct PointLight {
-    vec3 position;
-    vec3 color;
-    float constant;
-    float linear;
-    float quadratic;
+    vec4 position;
+    vec4 color;          // already scaled by the lamp intensity
+    vec4 attenuation;    // constant, linear, quadratic, shadow radius
 };
 
-#define NUM_POINT_LIGHTS 3
-uniform PointLight pointLights[NUM_POINT_LIGHTS];
+layout(std140) uniform FrameData {
+    mat4 view;
+    mat4 projection;
+    mat4 lightSpaceTrMatrix;
+    vec4 sunLightDir;    // eye space direction towards the sun
+    vec4 sunLightColor;
+    PointLight pointLights[NUM_POINT_LIGHTS];
+    vec4 pointShadowRects[NUM_POINT_LIGHTS];    // strip origin and tile size, in atlas coordinates
+    vec2 evsmExponents;
+    int shadowKernel;
+    int shadowSamples;
+    float shadowFilterRadius;     // in shadow map texels
+    float shadowMinBias;
+    float shadowSlopeBias;
+    float vsmMinVariance;
+    float lightBleedReduction;
+    int pointShadowsEnabled;
+};
+
+layout(std140) uniform ObjectData {
+    mat4 model;
+    mat4 normalMatrix;   // the upper 3x3 is used
+};
+
+// Point light shadows: cube faces packed into one atlas (see PointShadowAtlas)
+uniform sampler2DShadow pointShadowAtlas;
+float pointShadowBias = 0.05f;                      // world units
+
+// Face order and orientation used when rendering the atlas (+X -X +Y -Y +Z -Z)
+const vec3 cubeFaceDirections[6] = vec3[](
+    vec3(1.0, 0.0, 0.0), vec3(-1.0, 0.0, 0.0),
+    vec3(0.0, 1.0, 0.0), vec3(0.0, -1.0, 0.0),
+    vec3(0.0, 0.0, 1.0), vec3(0.0, 0.0, -1.0)
+);
+const vec3 cubeFaceUps[6] = vec3[](
+    vec3(0.0, -1.0, 0.0), vec3(0.0, -1.0, 0.0),
+    vec3(0.0, 0.0, 1.0), vec3(0.0, 0.0, -1.0),
+    vec3(0.0, -1.0, 0.0), vec3(0.0, -1.0, 0.0)
+);
 
-// Camera Position (for specular reflection)
-uniform vec3 cameraPos;
+// Camera Position (for specular reflection), the lighting is done in eye space
+const vec3 cameraPos = vec3(0.0f);
 
 // Textures
 uniform sampler2D diffuseTexture;
 uniform sampler2D specularTexture;
-uniform sampler2D shadowMap;
+uniform sampler2DShadow shadowMap;
+// Used instead of the diffuse map by meshes that have none
+uniform vec3 materialDiffuse;
+
+// Shadow filtering
+#define SHADOW_KERNEL_HARDWARE 0      // single bilinear PCF tap
+#define SHADOW_KERNEL_POISSON 1       // Poisson disk of bilinear PCF taps
+#define SHADOW_KERNEL_ROTATED_GRID 2  // 4x4 grid rotated per pixel
+
+// Shadow technique: filtered PCF on shadowMap or a single lookup into the prefiltered moments
+#define SHADOW_TECHNIQUE_PCF 0
+#define SHADOW_TECHNIQUE_VSM 1
+#define SHADOW_TECHNIQUE_EVSM 2
+uniform sampler2D shadowMoments;
+
+const vec2 poissonDisk[16] = vec2[](
+    vec2(-0.94201624, -0.39906216), vec2(0.94558609, -0.76890725),
+    vec2(-0.09418410, -0.92938870), vec2(0.34495938, 0.29387760),
+    vec2(-0.91588581, 0.45771432), vec2(-0.81544232, -0.87912464),
+    vec2(-0.38277543, 0.27676845), vec2(0.97484398, 0.75648379),
+    vec2(0.44323325, -0.97511554), vec2(0.53742981, -0.47373420),
+    vec2(-0.26496911, -0.41893023), vec2(0.79197514, 0.19090188),
+    vec2(-0.24188840, 0.99706507), vec2(-0.81409955, 0.91437590),
+    vec2(0.19984126, 0.78641367), vec2(0.14383161, -0.14100790)
+);
 
 // Light intensity settings
 float ambientStrength = 0.2f;
@@ -47,26 +130,65 @@ vec3 ambient;
 vec3 diffuse;
 vec3 specular;
 
+// Compute the shadowing of a point light from its cube faces in the atlas
+float computePointShadow(int light, vec3 fragPosWorld) {
+#if POINT_LIGHTING < 2
+    return 0.0f;
+#else
+    if (pointShadowsEnabled == 0) return 0.0f;
+
+    vec3 toFragment = fragPosWorld - pointLights[light].position.xyz;
+    float reference = (length(toFragment) - pointShadowBias) / pointLights[light].attenuation.w;
+    if (reference >= 1.0f) return 0.0f;
+
+    // the major axis picks the cube face
+    vec3 absolute = abs(toFragment);
+    int face;
+    if (absolute.x >= absolute.y && absolute.x >= absolute.z) face = toFragment.x > 0.0f ? 0 : 1;
+    else if (absolute.y >= absolute.z) face = toFragment.y > 0.0f ? 2 : 3;
+    else face = toFragment.z > 0.0f ? 4 : 5;
+
+    // same basis as the glm::lookAt used for the face, 90 degree projection
+    vec3 forward = cubeFaceDirections[face];
+    vec3 right = normalize(cross(forward, cubeFaceUps[face]));
+    vec3 up = cross(right, forward);
+    vec2 faceCoords = vec2(dot(right, toFragment), dot(up, toFragment)) / dot(forward, toFragment) * 0.5f + 0.5f;
+
+    // keep the bilinear footprint inside the face's tile
+    vec4 rect = pointShadowRects[light];
+    vec2 halfTexel = 0.5f / vec2(textureSize(pointShadowAtlas, 0));
+    vec2 tileMin = rect.xy + vec2(float(face) * rect.z, 0.0f) + halfTexel;
+    vec2 tileMax = tileMin + rect.zw - 2.0f * halfTexel;
+    vec2 atlasCoords = clamp(tileMin - halfTexel + faceCoords * rect.zw, tileMin, tileMax);
+
+    return 1.0f - texture(pointShadowAtlas, vec3(atlasCoords, reference));
+#endif
+}
+
 // Compute point light contribution
 void computePointLight(vec3 fragPosWorld, vec3 normalWorld, vec3 viewDir) {
-    for (int i = 0; i < NUM_POINT_LIGHTS; i++) {
-        vec3 lightDir = normalize(pointLights[i].position - fragPosWorld);
+    for (int i = 0; i < POINT_LIGHT_COUNT; i++) {
+        vec3 lightPosition = pointLights[i].position.xyz;
+        vec3 lightColor = pointLights[i].color.rgb;
+        vec3 lightDir = normalize(lightPosition - fragPosWorld);
 
         // **Force the light to shine mainly downward**
         lightDir = normalize(lightDir + vec3(0.0, -1.2, 0.0)); 
 
-        float distance = length(pointLights[i].position - fragPosWorld);
-        float attenuation = 1.0 / (pointLights[i].constant + pointLights[i].linear * distance + pointLights[i].quadratic * (distance * distance));
+        float distance = length(lightPosition - fragPosWorld);
+        vec4 factors = pointLights[i].attenuation;
+        float attenuation = 1.0 / (factors.x + factors.y * distance + factors.z * (distance * distance));
 
         // **Increase brightness for better visibility**
         float brightness = max(dot(normalWorld, lightDir), 0.0) * 2.5;  
+        float lit = 1.0 - computePointShadow(i, fragPosWorld);
         
-        ambient += pointLights[i].color * 0.2 * attenuation;
-        diffuse += pointLights[i].color * brightness * attenuation;
+        ambient += lightColor * 0.2 * attenuation;
+        diffuse += lightColor * brightness * attenuation * lit;
         
         vec3 reflectDir = reflect(-lightDir, normalWorld);
         float spec = pow(max(dot(viewDir, reflectDir), 0.0), shininess);
-        specular += pointLights[i].color * spec * specularStrength * attenuation;
+        specular += lightColor * spec * specularStrength * attenuation * lit;
     }
 }
 
@@ -74,29 +196,115 @@ void computePointLight(vec3 fragPosWorld, vec3 normalWorld, vec3 viewDir) {
 // Compute sunlight (directional light) contribution
 void computeSunLight() {		
     vec3 normalEye = normalize(fNormal);	
-    vec3 lightDirN = normalize(sunLightDir);
+    vec3 lightDirN = normalize(sunLightDir.xyz);
     vec3 viewDirN = normalize(cameraPos - fPosEye.xyz);
 
     // Compute ambient, diffuse, and specular lighting for sunlight
-    ambient = ambientStrength * sunLightColor;
-    diffuse = max(dot(normalEye, lightDirN), 0.0f) * sunLightColor;
+    ambient = ambientStrength * sunLightColor.rgb;
+    diffuse = vec3(0.0f);
+    specular = vec3(0.0f);
+#if SUN_LIGHTING >= 1
+    diffuse = max(dot(normalEye, lightDirN), 0.0f) * sunLightColor.rgb;
+#endif
     
+#if SUN_LIGHTING >= 2
     vec3 reflection = reflect(-lightDirN, normalEye);
     float specCoeff = pow(max(dot(viewDirN, reflection), 0.0f), shininess);
-    specular = specularStrength * specCoeff * sunLightColor;
+    specular = specularStrength * specCoeff * sunLightColor.rgb;
+#endif
+}
+
+// Per-pixel pseudo random angle, used to rotate the grid kernel
+float interleavedGradientNoise(vec2 pixel) {
+    return fract(52.9829189f * fract(dot(pixel, vec2(0.06711056f, 0.00583715f))));
+}
+
+// Upper bound on the lit fraction from the first two moments (Chebyshev's inequality)
+float chebyshevUpperBound(vec2 moments, float mean, float minVariance) {
+    float variance = max(moments.y - moments.x * moments.x, minVariance);
+    float d = mean - moments.x;
+    float pMax = variance / (variance + d * d);
+    // cut off the low tail of the bound to hide light bleeding
+    pMax = clamp((pMax - lightBleedReduction) / (1.0f - lightBleedReduction), 0.0f, 1.0f);
+    return mean <= moments.x ? 1.0f : pMax;
+}
+
+// Single mip-filtered lookup into the blurred moments (1.0 = lit)
+float computeMomentsVisibility(vec3 normalizedCoords) {
+    vec4 moments = texture(shadowMoments, normalizedCoords.xy);
+
+#if SHADOW_TECHNIQUE == SHADOW_TECHNIQUE_EVSM
+    {
+        float warpedDepth = 2.0f * normalizedCoords.z - 1.0f;
+        float positive = exp(evsmExponents.x * warpedDepth);
+        float negative = -exp(-evsmExponents.y * warpedDepth);
+        // the minimum variance has to follow the warp's derivative
+        vec2 depthScale = vsmMinVariance * evsmExponents * vec2(positive, negative);
+        vec2 minVariance = depthScale * depthScale;
+        float positiveBound = chebyshevUpperBound(moments.xy, positive, minVariance.x);
+        float negativeBound = chebyshevUpperBound(moments.zw, negative, minVariance.y);
+        return min(positiveBound, negativeBound);
+    }
+#else
+    return chebyshevUpperBound(moments.xy, normalizedCoords.z, vsmMinVariance);
+#endif
 }
 
 // Compute shadow mapping
 float computeShadow() {
+#if SUN_LIGHTING == 0
+    return 0.0f;
+#else
     vec3 normalizedCoords = fragPosLightSpace.xyz / fragPosLightSpace.w;
     normalizedCoords = normalizedCoords * 0.5 + 0.5;
     if (normalizedCoords.z > 1.0f) return 0.0f;
 
-    float closestDepth = texture(shadowMap, normalizedCoords.xy).r;
-    float currentDepth = normalizedCoords.z;
-    float bias = 0.005f;
-    float shadow = currentDepth - bias > closestDepth ? 1.0f : 0.0f;
-    return shadow;
+#if SHADOW_TECHNIQUE != SHADOW_TECHNIQUE_PCF
+    return 1.0f - computeMomentsVisibility(normalizedCoords);
+#else
+    // slope-scaled bias: surfaces at grazing angles to the sun need a larger offset
+    float cosTheta = clamp(dot(normalize(fNormal), normalize(sunLightDir.xyz)), 0.0f, 1.0f);
+    float tanTheta = sqrt(1.0f - cosTheta * cosTheta) / max(cosTheta, 0.05f);
+    float bias = clamp(shadowMinBias + shadowSlopeBias * tanTheta, shadowMinBias, 0.01f);
+    float currentDepth = normalizedCoords.z - bias;
+
+    // every tap is a hardware-compared, bilinearly filtered lookup (1.0 = lit)
+    vec2 texelSize = 1.0f / vec2(textureSize(shadowMap, 0));
+    float lit = 0.0f;
+
+    // a degraded sun only gets the single hardware filtered tap
+    int kernel = shadowKernel;
+#if SUN_LIGHTING < 2
+    kernel = SHADOW_KERNEL_HARDWARE;
+#endif
+
+    if (kernel == SHADOW_KERNEL_POISSON) {
+        int taps = clamp(shadowSamples, 1, 16);
+        for (int i = 0; i < taps; i++) {
+            vec2 offset = poissonDisk[i] * shadowFilterRadius * texelSize;
+            lit += texture(shadowMap, vec3(normalizedCoords.xy + offset, currentDepth));
+        }
+        lit /= float(taps);
+    }
+    else if (kernel == SHADOW_KERNEL_ROTATED_GRID) {
+        float angle = 6.2831853f * interleavedGradientNoise(gl_FragCoord.xy);
+        mat2 rotation = mat2(cos(angle), sin(angle), -sin(angle), cos(angle));
+        for (int y = 0; y < 4; y++) {
+            for (int x = 0; x < 4; x++) {
+                vec2 gridPoint = (vec2(x, y) - 1.5f) / 1.5f;
+                vec2 offset = rotation * gridPoint * shadowFilterRadius * texelSize;
+                lit += texture(shadowMap, vec3(normalizedCoords.xy + offset, currentDepth));
+            }
+        }
+        lit /= 16.0f;
+    }
+    else {
+        lit = texture(shadowMap, vec3(normalizedCoords.xy, currentDepth));
+    }
+
+    return 1.0f - lit;
+#endif
+#endif
 }
 
 // Main fragment shader logic
@@ -107,12 +315,23 @@ void main() {
     vec3 normalWorld = normalize(fNormal);
     vec3 viewDir = normalize(-fragPosWorld);
 
+#if POINT_LIGHTING > 0 && POINT_LIGHT_COUNT > 0
     computePointLight(fragPosWorld, normalWorld, viewDir); // Apply point lights
+#endif
     // Apply textures to light components
+#if HAS_DIFFUSE_TEXTURE
     vec3 baseColor = texture(diffuseTexture, fTexCoords).rgb;
+#else
+    vec3 baseColor = materialDiffuse;
+#endif
     ambient *= baseColor;
     diffuse *= baseColor;
+#if HAS_SPECULAR_TEXTURE
     specular *= texture(specularTexture, fTexCoords).rgb;
+#else
+    // without a specular map the highlight is tinted by the surface color
+    specular *= baseColor;
+#endif
 
     // Apply shadowing effect
     float shadow = computeShadow();
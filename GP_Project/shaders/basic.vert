@@ -8,21 +8,57 @@ out vec3 fNormal;
 out vec4 fPosEye;
 out vec2 fTexCoords;
 out vec4 fragPosLightSpace;
-out vec3 fPostition;
+out vec3 fPosition;
 
-uniform mat4 model;
-uniform mat4 view;
-uniform mat4 projection;
-uniform	mat3 normalMatrix;
-uniform mat4 lightSpaceTrMatrix;
+// Vertex format of the mesh (see gps::MaterialFeature)
+#ifndef HAS_TEXCOORDS
+#define HAS_TEXCOORDS 1
+#endif
+
+// Uniform blocks shared by every permutation, mirrored by gps::FrameData / gps::ObjectData
+#define NUM_POINT_LIGHTS 3
+
+struct PointLight {
+    vec4 position;
+    vec4 color;          // already scaled by the lamp intensity
+    vec4 attenuation;    // constant, linear, quadratic, shadow radius
+};
+
+layout(std140) uniform FrameData {
+    mat4 view;
+    mat4 projection;
+    mat4 lightSpaceTrMatrix;
+    vec4 sunLightDir;    // eye space direction towards the sun
+    vec4 sunLightColor;
+    PointLight pointLights[NUM_POINT_LIGHTS];
+    vec4 pointShadowRects[NUM_POINT_LIGHTS];    // strip origin and tile size, in atlas coordinates
+    vec2 evsmExponents;
+    int shadowKernel;
+    int shadowSamples;
+    float shadowFilterRadius;     // in shadow map texels
+    float shadowMinBias;
+    float shadowSlopeBias;
+    float vsmMinVariance;
+    float lightBleedReduction;
+    int pointShadowsEnabled;
+};
+
+layout(std140) uniform ObjectData {
+    mat4 model;
+    mat4 normalMatrix;   // the upper 3x3 is used
+};
 
 void main() 
 {
 	//compute eye space coordinates
 	fPosEye = view * model * vec4(vPosition, 1.0f);
-	fNormal = normalize(normalMatrix * vNormal);
+	fNormal = normalize(mat3(normalMatrix) * vNormal);
+#if HAS_TEXCOORDS
 	fTexCoords = vTexCoords;
-	fPostition = vPosition;
+#else
+	fTexCoords = vec2(0.0f);
+#endif
+	fPosition = vPosition;
 	fragPosLightSpace = lightSpaceTrMatrix * model * vec4(vPosition, 1.0f);
 	gl_Position = projection * view * model * vec4(vPosition, 1.0f);
 }
@@ -0,0 +1,13 @@
+#version 410 core
+
+in vec2 fTexCoords;
+in vec4 fColor;
+
+out vec4 outColor;
+
+uniform sampler2D fontTexture;
+
+void main() 
+{
+	outColor = vec4(fColor.rgb, fColor.a * texture(fontTexture, fTexCoords).r);
+}
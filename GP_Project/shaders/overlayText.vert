@@ -0,0 +1,19 @@
+#version 410 core
+
+layout(location=0) in vec2 vPosition;
+layout(location=1) in vec2 vTexCoords;
+layout(location=2) in vec4 vColor;
+
+out vec2 fTexCoords;
+out vec4 fColor;
+
+//in pixels, the origin is the top left corner
+uniform vec2 screenSize;
+
+void main() 
+{
+	fTexCoords = vTexCoords;
+	fColor = vColor;
+	vec2 ndc = vPosition / screenSize * 2.0f - 1.0f;
+	gl_Position = vec4(ndc.x, -ndc.y, 0.0f, 1.0f);
+}
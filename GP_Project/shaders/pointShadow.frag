@@ -0,0 +1,10 @@
+#version 410 core
+
+in vec3 fWorldPosition;
+flat in vec4 fLight;
+
+void main()
+{
+    //linear distance to the light, normalized by its radius
+    gl_FragDepth = length(fWorldPosition - fLight.xyz) / fLight.w;
+}
@@ -0,0 +1,14 @@
+#version 410 core
+
+layout(location=0) in vec3 vPosition;
+
+out vec3 gWorldPosition;
+
+uniform mat4 model;
+
+void main()
+{
+    //the geometry shader projects the vertex into every cube face tile
+    gWorldPosition = vec3(model * vec4(vPosition, 1.0f));
+    gl_Position = vec4(gWorldPosition, 1.0f);
+}
@@ -0,0 +1,113 @@
+#version 410 core
+
+// Analytic sky (Preetham et al. daylight model) plus a star field,
+// drawn on the skybox cube instead of sampling cubemap textures
+
+in vec3 textureCoordinates;
+out vec4 color;
+
+// world space direction towards the sun
+uniform vec3 sunDirection;
+// 0 during the day, 1 at night
+uniform float starIntensity;
+uniform float turbidity = 2.5;
+uniform float exposure = 0.1;
+
+const float PI = 3.14159265;
+const vec3 nightColor = vec3(0.004, 0.006, 0.015);
+const vec3 groundColor = vec3(0.05, 0.045, 0.04);
+
+// Perez sky luminance distribution
+float perez(float cosTheta, float gamma, float cosGamma, float A, float B, float C, float D, float E)
+{
+    return (1.0 + A * exp(B / max(cosTheta, 0.01))) * (1.0 + C * exp(D * gamma) + E * cosGamma * cosGamma);
+}
+
+vec3 preetham(vec3 viewDir, vec3 sunDir)
+{
+    float T = turbidity;
+    // keep the sun just above the horizon, the zenith formulas break down below it
+    float thetaS = min(acos(clamp(sunDir.y, -1.0, 1.0)), PI * 0.5 - 0.01);
+    float thetaS2 = thetaS * thetaS;
+    float thetaS3 = thetaS2 * thetaS;
+
+    float cosTheta = max(viewDir.y, 0.0);
+    float cosGamma = clamp(dot(viewDir, sunDir), -1.0, 1.0);
+    float gamma = acos(cosGamma);
+
+    // Perez coefficients for Y, x and y
+    float AY = 0.1787 * T - 1.4630, BY = -0.3554 * T + 0.4275, CY = -0.0227 * T + 5.3251, DY = 0.1206 * T - 2.5771, EY = -0.0670 * T + 0.3703;
+    float Ax = -0.0193 * T - 0.2592, Bx = -0.0665 * T + 0.0008, Cx = -0.0004 * T + 0.2125, Dx = -0.0641 * T - 0.8989, Ex = -0.0033 * T + 0.0452;
+    float Ay = -0.0167 * T - 0.2608, By = -0.0950 * T + 0.0092, Cy = -0.0079 * T + 0.2102, Dy = -0.0441 * T - 1.6537, Ey = -0.0109 * T + 0.0529;
+
+    // zenith luminance (kcd/m^2) and chromaticity
+    float chi = (4.0 / 9.0 - T / 120.0) * (PI - 2.0 * thetaS);
+    float Yz = (4.0453 * T - 4.9710) * tan(chi) - 0.2155 * T + 2.4192;
+    float xz = dot(vec3(T * T, T, 1.0), vec3(
+        dot(vec4(0.00166, -0.00375, 0.00209, 0.0), vec4(thetaS3, thetaS2, thetaS, 1.0)),
+        dot(vec4(-0.02903, 0.06377, -0.03202, 0.00394), vec4(thetaS3, thetaS2, thetaS, 1.0)),
+        dot(vec4(0.11693, -0.21196, 0.06052, 0.25886), vec4(thetaS3, thetaS2, thetaS, 1.0))));
+    float yz = dot(vec3(T * T, T, 1.0), vec3(
+        dot(vec4(0.00275, -0.00610, 0.00317, 0.0), vec4(thetaS3, thetaS2, thetaS, 1.0)),
+        dot(vec4(-0.04214, 0.08970, -0.04153, 0.00516), vec4(thetaS3, thetaS2, thetaS, 1.0)),
+        dot(vec4(0.15346, -0.26756, 0.06670, 0.26688), vec4(thetaS3, thetaS2, thetaS, 1.0))));
+
+    float cosThetaS = cos(thetaS);
+    float Y = Yz * perez(cosTheta, gamma, cosGamma, AY, BY, CY, DY, EY) / perez(1.0, thetaS, cosThetaS, AY, BY, CY, DY, EY);
+    float x = xz * perez(cosTheta, gamma, cosGamma, Ax, Bx, Cx, Dx, Ex) / perez(1.0, thetaS, cosThetaS, Ax, Bx, Cx, Dx, Ex);
+    float y = yz * perez(cosTheta, gamma, cosGamma, Ay, By, Cy, Dy, Ey) / perez(1.0, thetaS, cosThetaS, Ay, By, Cy, Dy, Ey);
+
+    // xyY -> XYZ -> linear sRGB
+    vec3 XYZ = vec3(x * Y / y, Y, (1.0 - x - y) * Y / y);
+    vec3 rgb = mat3(3.2406, -0.9689, 0.0557,
+                    -1.5372, 1.8758, -0.2040,
+                    -0.4986, 0.0415, 1.0570) * XYZ;
+    return max(rgb, vec3(0.0));
+}
+
+float hash(vec3 p)
+{
+    p = fract(p * vec3(443.897, 441.423, 437.195));
+    p += dot(p, p.yzx + 19.19);
+    return fract((p.x + p.y) * p.z);
+}
+
+// one candidate star per cell of a grid on the view direction
+float stars(vec3 viewDir)
+{
+    vec3 cell = floor(viewDir * 200.0);
+    float h = hash(cell);
+    if (h < 0.996) {
+        return 0.0;
+    }
+    vec3 center = (cell + 0.5) / 200.0;
+    float d = length(viewDir - normalize(center)) * 200.0;
+    float twinkle = hash(cell + 7.0);
+    return smoothstep(0.6, 0.0, d) * (0.4 + 0.6 * twinkle);
+}
+
+void main()
+{
+    vec3 viewDir = normalize(textureCoordinates);
+    vec3 sunDir = normalize(sunDirection);
+
+    // the daylight model fades out once the sun is below the horizon
+    float daylight = smoothstep(-0.1, 0.05, sunDir.y);
+    vec3 sky = (vec3(1.0) - exp(-exposure * preetham(viewDir, sunDir))) * daylight;
+
+    // sun disk
+    float sunDisk = smoothstep(0.9995, 0.9998, dot(viewDir, sunDir));
+    sky += vec3(1.0, 0.95, 0.85) * sunDisk * daylight;
+
+    sky += nightColor;
+
+    // stars, hidden by the daylight and near the horizon
+    float horizonFade = smoothstep(0.0, 0.15, viewDir.y);
+    sky += vec3(stars(viewDir)) * starIntensity * horizonFade;
+
+    // darker ground below the horizon
+    float belowHorizon = smoothstep(0.0, -0.05, viewDir.y);
+    sky = mix(sky, groundColor * (daylight + 0.1), belowHorizon);
+
+    color = vec4(sky, 1.0);
+}
@@ -0,0 +1,25 @@
+#version 410 core
+
+in vec2 fTexCoords;
+
+out vec4 fColor;
+
+uniform sampler2D sourceTexture;
+uniform vec2 blurDirection;   // one texel along the blur axis
+uniform int blurRadius;
+
+void main()
+{
+    //separable gaussian, sigma chosen so the kernel fades out at the radius
+    float sigma = max(float(blurRadius) * 0.5f, 0.5f);
+    vec4 sum = vec4(0.0f);
+    float weightSum = 0.0f;
+
+    for (int i = -blurRadius; i <= blurRadius; i++) {
+        float weight = exp(-float(i * i) / (2.0f * sigma * sigma));
+        sum += textureLod(sourceTexture, fTexCoords + blurDirection * float(i), 0.0f) * weight;
+        weightSum += weight;
+    }
+
+    fColor = sum / weightSum;
+}
@@ -0,0 +1,28 @@
+#version 410 core
+
+#define SHADOW_TECHNIQUE_VSM 1
+#define SHADOW_TECHNIQUE_EVSM 2
+
+uniform int shadowTechnique;
+uniform vec2 evsmExponents;
+
+out vec4 fMoments;
+
+void main()
+{
+    float depth = gl_FragCoord.z;
+
+    if (shadowTechnique == SHADOW_TECHNIQUE_EVSM) {
+        //exponentially warped depth, positive and negative moments
+        float warpedDepth = 2.0f * depth - 1.0f;
+        float positive = exp(evsmExponents.x * warpedDepth);
+        float negative = -exp(-evsmExponents.y * warpedDepth);
+        fMoments = vec4(positive, positive * positive, negative, negative * negative);
+    }
+    else {
+        //second moment biased by the depth slope to reduce acne on sloped surfaces
+        float dx = dFdx(depth);
+        float dy = dFdy(depth);
+        fMoments = vec4(depth, depth * depth + 0.25f * (dx * dx + dy * dy), 0.0f, 0.0f);
+    }
+}
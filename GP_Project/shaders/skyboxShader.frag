@@ -4,8 +4,10 @@ in vec3 textureCoordinates;
 out vec4 color;
 
 uniform samplerCube skybox;
+uniform samplerCube nightSkybox;
+uniform float blendFactor;  // 0 = day, 1 = night
 
 void main()
 {
-    color = texture(skybox, textureCoordinates);
+    color = mix(texture(skybox, textureCoordinates), texture(nightSkybox, textureCoordinates), blendFactor);
 }
@@ -0,0 +1,138 @@
+#include "BenchmarkReport.hpp"
+#include "HeadlessContext.hpp"
+#include "Logger.hpp"
+#include "PassTimer.hpp"
+#include "PngWriter.hpp"
+#include "TraceReplayer.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <string>
+#include <vector>
+
+//Plays a GL trace (recorded by GP_Project with O or --gl-trace) back offscreen, over and over,
+//and writes the frame times and the times of every call group (render pass) on the GPU and the CPU
+//as a benchmark report; the same trace on two drivers, or two builds of one, gives comparable numbers
+//usage: GP_Replay trace [--loops n] [--json file] [--screenshot file.png]
+
+namespace {
+
+    const int DEFAULT_LOOPS = 20;
+    //the first pass over the trace creates its objects, and is not timed
+    const int WARMUP_LOOPS = 1;
+
+    bool writeScreenshot(const std::string& fileName, GLuint framebuffer, int width, int height) {
+
+        std::vector<unsigned char> pixels((size_t)width * height * 4);
+        glBindFramebuffer(GL_READ_FRAMEBUFFER, framebuffer);
+        glReadBuffer(GL_COLOR_ATTACHMENT0);
+        glPixelStorei(GL_PACK_ALIGNMENT, 1);
+        glReadPixels(0, 0, width, height, GL_RGBA, GL_UNSIGNED_BYTE, pixels.data());
+        return gps::PngWriter::Write(fileName, width, height, 4, pixels.data(), true);
+    }
+
+    int runReplay(int argc, const char* argv[]) {
+
+        std::string traceFile;
+        int loops = DEFAULT_LOOPS;
+        std::string jsonOutput = "replay_report.json";
+        std::string screenshotFile;
+
+        for (int i = 1; i < argc; i++) {
+            std::string argument = argv[i];
+            if (argument == "--loops" && i + 1 < argc) {
+                loops = std::max(std::atoi(argv[++i]), 1);
+            }
+            else if (argument == "--json" && i + 1 < argc) {
+                jsonOutput = argv[++i];
+            }
+            else if (argument == "--screenshot" && i + 1 < argc) {
+                screenshotFile = argv[++i];
+            }
+            else if (traceFile.empty() && argument.compare(0, 2, "--") != 0) {
+                traceFile = argument;
+            }
+            else {
+                LOG_WARNING("unknown argument %s", argument.c_str());
+            }
+        }
+        if (traceFile.empty()) {
+            LOG_ERROR("usage: GP_Replay trace [--loops n] [--json file] [--screenshot file.png]");
+            return EXIT_FAILURE;
+        }
+
+        gps::TraceReplayer replayer;
+        if (!replayer.Load(traceFile)) {
+            return EXIT_FAILURE;
+        }
+        gps::HeadlessContext context;
+        if (!context.Create(replayer.GetWidth(), replayer.GetHeight())) {
+            LOG_ERROR("could not create a %dx%d context to replay on", replayer.GetWidth(), replayer.GetHeight());
+            return EXIT_FAILURE;
+        }
+        replayer.SetTarget(context.GetFramebuffer());
+
+        gps::PassTimer timer;
+        gps::BenchmarkReport report;
+        report.SetInfo("trace", traceFile);
+        report.SetInfo("renderer", (const char*)glGetString(GL_RENDERER));
+        report.SetInfo("resolution", std::to_string(replayer.GetWidth()) + "x" + std::to_string(replayer.GetHeight()));
+        report.SetInfo("trace_frames", std::to_string(replayer.GetFrameCount()));
+        report.SetInfo("loops", std::to_string(loops));
+
+        int firstTimerFrame = -1;
+        int lastResultsFrame = -1;
+        for (int loop = -WARMUP_LOOPS; loop < loops; loop++) {
+            for (int frame = 0; frame < replayer.GetFrameCount(); frame++) {
+                std::chrono::steady_clock::time_point frameStart = std::chrono::steady_clock::now();
+                timer.BeginFrame();
+                replayer.PlayFrame(frame, timer);
+                if (loop == 0 && frame == 0) {
+                    firstTimerFrame = timer.GetFrame();
+                }
+                std::chrono::steady_clock::time_point submitted = std::chrono::steady_clock::now();
+                context.EndFrame();
+                std::chrono::steady_clock::time_point frameEnd = std::chrono::steady_clock::now();
+
+                if (loop >= 0) {
+                    report.AddFrame(std::chrono::duration<double, std::milli>(submitted - frameStart).count(),
+                        std::chrono::duration<double, std::milli>(frameEnd - frameStart).count());
+                }
+                //GPU times arrive a few frames late, the last frames have none
+                if (firstTimerFrame >= 0 && timer.GetResultsFrame() >= firstTimerFrame && timer.GetResultsFrame() != lastResultsFrame) {
+                    lastResultsFrame = timer.GetResultsFrame();
+                    report.AddPassTimes(timer.GetResults());
+                }
+            }
+        }
+
+        LOG_INFO("Replay: %s", report.Summary().c_str());
+        if (replayer.GetSkippedCalls() > 0) {
+            LOG_WARNING("%d calls skipped, on objects or uniforms the trace does not define", replayer.GetSkippedCalls());
+        }
+        int status = EXIT_SUCCESS;
+        if (report.WriteJson(jsonOutput)) {
+            LOG_INFO("Replay report written to %s", jsonOutput.c_str());
+        }
+        else {
+            status = EXIT_FAILURE;
+        }
+        if (!screenshotFile.empty() && !writeScreenshot(screenshotFile, context.GetFramebuffer(), replayer.GetWidth(), replayer.GetHeight())) {
+            status = EXIT_FAILURE;
+        }
+
+        timer.Delete();
+        replayer.Delete();
+        context.Delete();
+        return status;
+    }
+}
+
+int main(int argc, const char* argv[]) {
+
+    gps::Logger::Start();
+    int status = runReplay(argc, argv);
+    gps::Logger::Stop();
+    return status;
+}
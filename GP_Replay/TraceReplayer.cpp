@@ -0,0 +1,810 @@
+#include "TraceReplayer.hpp"
+#include "Logger.hpp"
+
+#include <cstring>
+#include <fstream>
+
+namespace gps {
+
+    namespace {
+
+        //reads the values of a payload in the order they were written
+        class Reader {
+
+        public:
+            Reader(const unsigned char* data, uint32_t size) : data(data), end(data + size) {
+            }
+            uint32_t U32() {
+                uint32_t value = 0;
+                Read(&value, sizeof(value));
+                return value;
+            }
+            GLint I32() {
+                return (GLint)U32();
+            }
+            uint64_t U64() {
+                uint64_t value = 0;
+                Read(&value, sizeof(value));
+                return value;
+            }
+            GLfloat F32() {
+                GLfloat value = 0.0f;
+                Read(&value, sizeof(value));
+                return value;
+            }
+            std::string String() {
+                uint32_t length = U32();
+                if (length > (uint32_t)(end - data)) {
+                    data = end;
+                    return std::string();
+                }
+                std::string text((const char*)data, length);
+                data += length;
+                return text;
+            }
+            //the rest of the payload, as 32 bit words
+            void Words(std::vector<uint32_t>& words) {
+                words.resize((end - data) / sizeof(uint32_t));
+                memcpy(words.data(), data, words.size() * sizeof(uint32_t));
+                data = end;
+            }
+
+        private:
+            const unsigned char* data;
+            const unsigned char* end;
+
+            void Read(void* value, size_t size) {
+                if ((size_t)(end - data) >= size) {
+                    memcpy(value, data, size);
+                    data += size;
+                }
+            }
+        };
+
+        GLenum mapColorBuffer(GLenum buffer) {
+
+            //the window's buffers are the target's color attachment
+            if (buffer == GL_BACK || buffer == GL_FRONT || buffer == GL_BACK_LEFT || buffer == GL_FRONT_LEFT) {
+                return GL_COLOR_ATTACHMENT0;
+            }
+            return buffer;
+        }
+
+        GLenum textureBindingQuery(GLenum target) {
+
+            switch (target) {
+            case GL_TEXTURE_CUBE_MAP: return GL_TEXTURE_BINDING_CUBE_MAP;
+            case GL_TEXTURE_2D_ARRAY: return GL_TEXTURE_BINDING_2D_ARRAY;
+            case GL_TEXTURE_3D: return GL_TEXTURE_BINDING_3D;
+            default: return GL_TEXTURE_BINDING_2D;
+            }
+        }
+
+        GLint getInteger(GLenum pname) {
+
+            GLint value = 0;
+            glGetIntegerv(pname, &value);
+            return value;
+        }
+    }
+
+    TraceReplayer::TraceReplayer() : width(0), height(0), presentedFramebuffer(0), target(0), skippedCalls(0), currentProgram(0) {
+    }
+
+    bool TraceReplayer::Load(const std::string& fileName) {
+
+        std::ifstream file(fileName.c_str(), std::ios::binary | std::ios::ate);
+        if (!file) {
+            LOG_ERROR("could not open GL trace %s", fileName.c_str());
+            return false;
+        }
+        contents.resize((size_t)file.tellg());
+        file.seekg(0);
+        file.read((char*)contents.data(), contents.size());
+        uint32_t header[2] = {};
+        if (contents.size() >= sizeof(header)) {
+            memcpy(header, contents.data(), sizeof(header));
+        }
+        if (!file || header[0] != GLTRACE_MAGIC || header[1] != GLTRACE_VERSION) {
+            LOG_ERROR("%s is not a GL trace of version %u", fileName.c_str(), GLTRACE_VERSION);
+            return false;
+        }
+
+        size_t offset = sizeof(header);
+        bool ended = false;
+        while (!ended && offset + 6 <= contents.size()) {
+            Record record;
+            memcpy(&record.op, &contents[offset], sizeof(record.op));
+            memcpy(&record.size, &contents[offset + 2], sizeof(record.size));
+            record.data = contents.data() + offset + 6;
+            if (offset + 6 + record.size > contents.size()) {
+                break;
+            }
+            offset += 6 + record.size;
+
+            Reader reader(record.data, record.size);
+            switch (record.op) {
+            case GLTRACE_INFO:
+                width = reader.I32();
+                height = reader.I32();
+                presentedFramebuffer = reader.U32();
+                break;
+            case GLTRACE_BLOB: {
+                uint32_t id = reader.U32();
+                blobs[id] = std::make_pair(record.data + 4, record.size - 4);
+                break;
+            }
+            case GLTRACE_END:
+                ended = true;
+                break;
+            case GLTRACE_FRAME:
+                frameStarts.push_back(records.size());
+                records.push_back(record);
+                break;
+            default:
+                records.push_back(record);
+                break;
+            }
+        }
+        if (!ended) {
+            LOG_WARNING("%s is truncated, replaying the frames it has", fileName.c_str());
+        }
+        //the last frame ends with the records
+        frameStarts.push_back(records.size());
+        if (GetFrameCount() <= 0 || width <= 0 || height <= 0) {
+            LOG_ERROR("%s has no frames", fileName.c_str());
+            return false;
+        }
+        LOG_INFO("Loaded %s: %d frames at %dx%d, %d calls, %d blobs",
+            fileName.c_str(), GetFrameCount(), width, height, (int)records.size(), (int)blobs.size());
+        return true;
+    }
+
+    void TraceReplayer::Delete() {
+
+        for (std::unordered_map<GLuint, GLuint>::iterator it = buffers.begin(); it != buffers.end(); ++it) {
+            glDeleteBuffers(1, &it->second);
+        }
+        for (std::unordered_map<GLuint, GLuint>::iterator it = textures.begin(); it != textures.end(); ++it) {
+            glDeleteTextures(1, &it->second);
+        }
+        for (std::unordered_map<GLuint, GLuint>::iterator it = renderbuffers.begin(); it != renderbuffers.end(); ++it) {
+            glDeleteRenderbuffers(1, &it->second);
+        }
+        for (std::unordered_map<GLuint, GLuint>::iterator it = framebuffers.begin(); it != framebuffers.end(); ++it) {
+            glDeleteFramebuffers(1, &it->second);
+        }
+        for (std::unordered_map<GLuint, GLuint>::iterator it = vertexArrays.begin(); it != vertexArrays.end(); ++it) {
+            glDeleteVertexArrays(1, &it->second);
+        }
+        for (std::unordered_map<GLuint, GLuint>::iterator it = programs.begin(); it != programs.end(); ++it) {
+            glDeleteProgram(it->second);
+        }
+        buffers.clear();
+        textures.clear();
+        renderbuffers.clear();
+        framebuffers.clear();
+        vertexArrays.clear();
+        programs.clear();
+        uniformLocations.clear();
+    }
+
+    int TraceReplayer::GetWidth() const {
+
+        return width;
+    }
+
+    int TraceReplayer::GetHeight() const {
+
+        return height;
+    }
+
+    int TraceReplayer::GetFrameCount() const {
+
+        return (int)frameStarts.size() - 1;
+    }
+
+    void TraceReplayer::SetTarget(GLuint framebuffer) {
+
+        target = framebuffer;
+    }
+
+    int TraceReplayer::GetSkippedCalls() const {
+
+        return skippedCalls;
+    }
+
+    void TraceReplayer::PlayFrame(int frame, PassTimer& timer) {
+
+        if (frame < 0 || frame >= GetFrameCount()) {
+            return;
+        }
+        if (frame == 0) {
+            for (size_t i = 0; i < frameStarts[0]; i++) {
+                Play(records[i], timer);
+            }
+        }
+        for (size_t i = frameStarts[frame] + 1; i < frameStarts[frame + 1]; i++) {
+            Play(records[i], timer);
+        }
+    }
+
+    const void* TraceReplayer::Blob(uint32_t id) {
+
+        std::unordered_map<uint32_t, std::pair<const unsigned char*, uint32_t> >::iterator found = blobs.find(id);
+        return found != blobs.end() ? found->second.first : NULL;
+    }
+
+    GLuint TraceReplayer::Map(const std::unordered_map<GLuint, GLuint>& objects, GLuint name) {
+
+        if (name == 0) {
+            return 0;
+        }
+        std::unordered_map<GLuint, GLuint>::const_iterator found = objects.find(name);
+        if (found == objects.end()) {
+            skippedCalls++;
+            return 0;
+        }
+        return found->second;
+    }
+
+    GLuint TraceReplayer::MapFramebuffer(GLuint name) {
+
+        if (name == 0 || name == presentedFramebuffer) {
+            return target;
+        }
+        return Map(framebuffers, name);
+    }
+
+    void TraceReplayer::SetUniform(GLuint program, GLint location, GLenum type, GLsizei count, GLboolean transpose, const uint32_t* values) {
+
+        const GLfloat* floats = (const GLfloat*)values;
+        const GLint* ints = (const GLint*)values;
+        switch (type) {
+        case GL_FLOAT: glProgramUniform1fv(program, location, count, floats); break;
+        case GL_FLOAT_VEC2: glProgramUniform2fv(program, location, count, floats); break;
+        case GL_FLOAT_VEC3: glProgramUniform3fv(program, location, count, floats); break;
+        case GL_FLOAT_VEC4: glProgramUniform4fv(program, location, count, floats); break;
+        case GL_FLOAT_MAT2: glProgramUniformMatrix2fv(program, location, count, transpose, floats); break;
+        case GL_FLOAT_MAT3: glProgramUniformMatrix3fv(program, location, count, transpose, floats); break;
+        case GL_FLOAT_MAT4: glProgramUniformMatrix4fv(program, location, count, transpose, floats); break;
+        case GL_UNSIGNED_INT: glProgramUniform1uiv(program, location, count, (const GLuint*)values); break;
+        case GL_INT_VEC2: case GL_BOOL_VEC2: glProgramUniform2iv(program, location, count, ints); break;
+        case GL_INT_VEC3: case GL_BOOL_VEC3: glProgramUniform3iv(program, location, count, ints); break;
+        case GL_INT_VEC4: case GL_BOOL_VEC4: glProgramUniform4iv(program, location, count, ints); break;
+        //int, bool and the samplers
+        default: glProgramUniform1iv(program, location, count, ints); break;
+        }
+    }
+
+    void TraceReplayer::Play(const Record& record, PassTimer& timer) {
+
+        Reader reader(record.data, record.size);
+        switch (record.op) {
+        case GLTRACE_FRAME:
+        case GLTRACE_END:
+            break;
+        case GLTRACE_GROUP_BEGIN: {
+            std::string name = reader.String();
+            timer.BeginPass(name.c_str());
+            break;
+        }
+        case GLTRACE_GROUP_END:
+            timer.EndPass();
+            break;
+
+        case GLTRACE_DEFINE_BUFFER:
+            DefineBuffer(record);
+            break;
+        case GLTRACE_DEFINE_TEXTURE:
+            DefineTexture(record);
+            break;
+        case GLTRACE_DEFINE_RENDERBUFFER:
+            DefineRenderbuffer(record);
+            break;
+        case GLTRACE_DEFINE_FRAMEBUFFER:
+            DefineFramebuffer(record);
+            break;
+        case GLTRACE_DEFINE_VERTEX_ARRAY:
+            DefineVertexArray(record);
+            break;
+        case GLTRACE_DEFINE_PROGRAM:
+            DefineProgram(record);
+            break;
+
+        case GLTRACE_VIEWPORT: {
+            GLint x = reader.I32(), y = reader.I32(), viewportWidth = reader.I32(), viewportHeight = reader.I32();
+            glViewport(x, y, viewportWidth, viewportHeight);
+            break;
+        }
+        case GLTRACE_VIEWPORT_INDEXEDF: {
+            GLuint index = reader.U32();
+            GLfloat x = reader.F32(), y = reader.F32(), viewportWidth = reader.F32(), viewportHeight = reader.F32();
+            glViewportIndexedf(index, x, y, viewportWidth, viewportHeight);
+            break;
+        }
+        case GLTRACE_SCISSOR: {
+            GLint x = reader.I32(), y = reader.I32(), scissorWidth = reader.I32(), scissorHeight = reader.I32();
+            glScissor(x, y, scissorWidth, scissorHeight);
+            break;
+        }
+        case GLTRACE_CLEAR:
+            glClear(reader.U32());
+            break;
+        case GLTRACE_CLEAR_COLOR: {
+            GLfloat red = reader.F32(), green = reader.F32(), blue = reader.F32(), alpha = reader.F32();
+            glClearColor(red, green, blue, alpha);
+            break;
+        }
+        case GLTRACE_CLEAR_BUFFERFV: {
+            GLenum buffer = reader.U32();
+            GLint drawBuffer = reader.I32();
+            GLfloat value[4];
+            for (int i = 0; i < 4; i++) {
+                value[i] = reader.F32();
+            }
+            glClearBufferfv(buffer, drawBuffer, value);
+            break;
+        }
+        case GLTRACE_ENABLE:
+            glEnable(reader.U32());
+            break;
+        case GLTRACE_DISABLE:
+            glDisable(reader.U32());
+            break;
+        case GLTRACE_DEPTH_FUNC:
+            glDepthFunc(reader.U32());
+            break;
+        case GLTRACE_DEPTH_MASK:
+            glDepthMask((GLboolean)reader.U32());
+            break;
+        case GLTRACE_CULL_FACE:
+            glCullFace(reader.U32());
+            break;
+        case GLTRACE_FRONT_FACE:
+            glFrontFace(reader.U32());
+            break;
+        case GLTRACE_BLEND_FUNC_SEPARATE: {
+            GLenum sourceRgb = reader.U32(), destinationRgb = reader.U32(), sourceAlpha = reader.U32(), destinationAlpha = reader.U32();
+            glBlendFuncSeparate(sourceRgb, destinationRgb, sourceAlpha, destinationAlpha);
+            break;
+        }
+        case GLTRACE_DRAW_BUFFER:
+            glDrawBuffer(mapColorBuffer(reader.U32()));
+            break;
+        case GLTRACE_READ_BUFFER:
+            glReadBuffer(mapColorBuffer(reader.U32()));
+            break;
+        case GLTRACE_PIXEL_STOREI: {
+            GLenum pname = reader.U32();
+            glPixelStorei(pname, reader.I32());
+            break;
+        }
+        case GLTRACE_ACTIVE_TEXTURE:
+            glActiveTexture(reader.U32());
+            break;
+        case GLTRACE_BIND_TEXTURE: {
+            GLenum textureTarget = reader.U32();
+            glBindTexture(textureTarget, Map(textures, reader.U32()));
+            break;
+        }
+        case GLTRACE_TEX_PARAMETERI: {
+            GLenum textureTarget = reader.U32(), pname = reader.U32();
+            glTexParameteri(textureTarget, pname, reader.I32());
+            break;
+        }
+        case GLTRACE_TEX_PARAMETERFV: {
+            GLenum textureTarget = reader.U32(), pname = reader.U32();
+            GLfloat value[4];
+            for (int i = 0; i < 4; i++) {
+                value[i] = reader.F32();
+            }
+            glTexParameterfv(textureTarget, pname, value);
+            break;
+        }
+        case GLTRACE_TEX_IMAGE_2D: {
+            GLenum textureTarget = reader.U32();
+            GLint level = reader.I32(), internalFormat = reader.I32(), imageWidth = reader.I32(), imageHeight = reader.I32();
+            GLenum format = reader.U32(), type = reader.U32();
+            glTexImage2D(textureTarget, level, internalFormat, imageWidth, imageHeight, 0, format, type, Blob(reader.U32()));
+            break;
+        }
+        case GLTRACE_GENERATE_MIPMAP:
+            glGenerateMipmap(reader.U32());
+            break;
+        case GLTRACE_BIND_BUFFER: {
+            GLenum bufferTarget = reader.U32();
+            glBindBuffer(bufferTarget, Map(buffers, reader.U32()));
+            break;
+        }
+        case GLTRACE_BIND_BUFFER_BASE: {
+            GLenum bufferTarget = reader.U32();
+            GLuint index = reader.U32();
+            glBindBufferBase(bufferTarget, index, Map(buffers, reader.U32()));
+            break;
+        }
+        case GLTRACE_BIND_BUFFER_RANGE: {
+            GLenum bufferTarget = reader.U32();
+            GLuint index = reader.U32();
+            GLuint buffer = Map(buffers, reader.U32());
+            GLintptr offset = (GLintptr)reader.U64();
+            GLsizeiptr size = (GLsizeiptr)reader.U64();
+            glBindBufferRange(bufferTarget, index, buffer, offset, size);
+            break;
+        }
+        case GLTRACE_BUFFER_DATA: {
+            GLenum bufferTarget = reader.U32();
+            GLsizeiptr size = (GLsizeiptr)reader.U64();
+            GLenum usage = reader.U32();
+            glBufferData(bufferTarget, size, Blob(reader.U32()), usage);
+            break;
+        }
+        case GLTRACE_BUFFER_SUB_DATA: {
+            GLenum bufferTarget = reader.U32();
+            GLintptr offset = (GLintptr)reader.U64();
+            GLsizeiptr size = (GLsizeiptr)reader.U64();
+            const void* data = Blob(reader.U32());
+            if (data != NULL) {
+                glBufferSubData(bufferTarget, offset, size, data);
+            }
+            break;
+        }
+        case GLTRACE_BIND_VERTEX_ARRAY:
+            glBindVertexArray(Map(vertexArrays, reader.U32()));
+            break;
+        case GLTRACE_VERTEX_ATTRIB_POINTER: {
+            GLuint index = reader.U32();
+            GLint size = reader.I32();
+            GLenum type = reader.U32();
+            GLboolean normalized = (GLboolean)reader.U32();
+            GLsizei stride = reader.I32();
+            glVertexAttribPointer(index, size, type, normalized, stride, (const void*)(uintptr_t)reader.U64());
+            break;
+        }
+        case GLTRACE_ENABLE_VERTEX_ATTRIB_ARRAY:
+            glEnableVertexAttribArray(reader.U32());
+            break;
+        case GLTRACE_USE_PROGRAM:
+            currentProgram = reader.U32();
+            glUseProgram(Map(programs, currentProgram));
+            break;
+        case GLTRACE_UNIFORM: {
+            GLint location = reader.I32();
+            GLenum type = reader.U32();
+            GLsizei count = reader.I32();
+            GLboolean transpose = (GLboolean)reader.U32();
+            std::map<std::pair<GLuint, GLint>, GLint>::iterator found = uniformLocations.find(std::make_pair(currentProgram, location));
+            if (found == uniformLocations.end()) {
+                skippedCalls++;
+                break;
+            }
+            reader.Words(uniformValues);
+            SetUniform(Map(programs, currentProgram), found->second, type, count, transpose, uniformValues.data());
+            break;
+        }
+        case GLTRACE_DRAW_ARRAYS: {
+            GLenum mode = reader.U32();
+            GLint first = reader.I32();
+            glDrawArrays(mode, first, reader.I32());
+            break;
+        }
+        case GLTRACE_DRAW_ELEMENTS: {
+            GLenum mode = reader.U32();
+            GLsizei count = reader.I32();
+            GLenum type = reader.U32();
+            glDrawElements(mode, count, type, (const void*)(uintptr_t)reader.U64());
+            break;
+        }
+        case GLTRACE_BIND_FRAMEBUFFER: {
+            GLenum framebufferTarget = reader.U32();
+            glBindFramebuffer(framebufferTarget, MapFramebuffer(reader.U32()));
+            break;
+        }
+        case GLTRACE_BIND_RENDERBUFFER: {
+            GLenum renderbufferTarget = reader.U32();
+            glBindRenderbuffer(renderbufferTarget, Map(renderbuffers, reader.U32()));
+            break;
+        }
+        case GLTRACE_FRAMEBUFFER_TEXTURE_2D: {
+            GLenum framebufferTarget = reader.U32(), attachment = reader.U32(), textureTarget = reader.U32();
+            GLuint texture = Map(textures, reader.U32());
+            glFramebufferTexture2D(framebufferTarget, attachment, textureTarget, texture, reader.I32());
+            break;
+        }
+        case GLTRACE_FRAMEBUFFER_RENDERBUFFER: {
+            GLenum framebufferTarget = reader.U32(), attachment = reader.U32(), renderbufferTarget = reader.U32();
+            glFramebufferRenderbuffer(framebufferTarget, attachment, renderbufferTarget, Map(renderbuffers, reader.U32()));
+            break;
+        }
+        case GLTRACE_RENDERBUFFER_STORAGE: {
+            GLenum renderbufferTarget = reader.U32(), internalFormat = reader.U32();
+            GLsizei storageWidth = reader.I32();
+            glRenderbufferStorage(renderbufferTarget, internalFormat, storageWidth, reader.I32());
+            break;
+        }
+        default:
+            skippedCalls++;
+            break;
+        }
+    }
+
+    void TraceReplayer::DefineBuffer(const Record& record) {
+
+        Reader reader(record.data, record.size);
+        GLuint name = reader.U32();
+        if (buffers.count(name) != 0) {
+            return;
+        }
+        GLsizeiptr size = (GLsizeiptr)reader.U64();
+        GLenum usage = reader.U32();
+        const void* data = Blob(reader.U32());
+
+        GLuint buffer;
+        glGenBuffers(1, &buffer);
+        GLint previous = getInteger(GL_COPY_WRITE_BUFFER_BINDING);
+        glBindBuffer(GL_COPY_WRITE_BUFFER, buffer);
+        glBufferData(GL_COPY_WRITE_BUFFER, size, data, usage);
+        glBindBuffer(GL_COPY_WRITE_BUFFER, previous);
+        buffers[name] = buffer;
+    }
+
+    void TraceReplayer::DefineTexture(const Record& record) {
+
+        Reader reader(record.data, record.size);
+        GLuint name = reader.U32();
+        if (textures.count(name) != 0) {
+            return;
+        }
+        GLenum textureTarget = reader.U32();
+        const GLenum intParameters[] = { GL_TEXTURE_MIN_FILTER, GL_TEXTURE_MAG_FILTER, GL_TEXTURE_WRAP_S, GL_TEXTURE_WRAP_T,
+            GL_TEXTURE_WRAP_R, GL_TEXTURE_COMPARE_MODE, GL_TEXTURE_COMPARE_FUNC, GL_TEXTURE_BASE_LEVEL, GL_TEXTURE_MAX_LEVEL };
+        const int intParameterCount = sizeof(intParameters) / sizeof(intParameters[0]);
+        GLint intValues[intParameterCount];
+        for (int i = 0; i < intParameterCount; i++) {
+            intValues[i] = reader.I32();
+        }
+        GLfloat borderColor[4];
+        for (int i = 0; i < 4; i++) {
+            borderColor[i] = reader.F32();
+        }
+
+        GLuint texture;
+        glGenTextures(1, &texture);
+        GLint previous = getInteger(textureBindingQuery(textureTarget));
+        GLint previousAlignment = getInteger(GL_UNPACK_ALIGNMENT);
+        glBindTexture(textureTarget, texture);
+        //rows of the read back images are whole texels of 4 bytes or more
+        glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+        for (int i = 0; i < intParameterCount; i++) {
+            glTexParameteri(textureTarget, intParameters[i], intValues[i]);
+        }
+        glTexParameterfv(textureTarget, GL_TEXTURE_BORDER_COLOR, borderColor);
+
+        uint32_t imageCount = reader.U32();
+        for (uint32_t i = 0; i < imageCount; i++) {
+            GLenum imageTarget = reader.U32();
+            GLint level = reader.I32(), internalFormat = reader.I32();
+            GLsizei imageWidth = reader.I32(), imageHeight = reader.I32(), depth = reader.I32();
+            bool compressed = reader.U32() != 0;
+            GLenum format = reader.U32(), type = reader.U32();
+            uint32_t id = reader.U32();
+            const void* data = Blob(id);
+            bool layered = textureTarget == GL_TEXTURE_2D_ARRAY || textureTarget == GL_TEXTURE_3D;
+            if (compressed) {
+                GLsizei size = blobs.count(id) != 0 ? (GLsizei)blobs[id].second : 0;
+                if (layered) {
+                    glCompressedTexImage3D(imageTarget, level, internalFormat, imageWidth, imageHeight, depth, 0, size, data);
+                }
+                else {
+                    glCompressedTexImage2D(imageTarget, level, internalFormat, imageWidth, imageHeight, 0, size, data);
+                }
+            }
+            else if (layered) {
+                glTexImage3D(imageTarget, level, internalFormat, imageWidth, imageHeight, depth, 0, format, type, data);
+            }
+            else {
+                glTexImage2D(imageTarget, level, internalFormat, imageWidth, imageHeight, 0, format, type, data);
+            }
+        }
+        glPixelStorei(GL_UNPACK_ALIGNMENT, previousAlignment);
+        glBindTexture(textureTarget, previous);
+        textures[name] = texture;
+        textureTargets[name] = textureTarget;
+    }
+
+    void TraceReplayer::DefineRenderbuffer(const Record& record) {
+
+        Reader reader(record.data, record.size);
+        GLuint name = reader.U32();
+        if (renderbuffers.count(name) != 0) {
+            return;
+        }
+        GLenum internalFormat = reader.U32();
+        GLsizei storageWidth = reader.I32(), storageHeight = reader.I32(), samples = reader.I32();
+
+        GLuint renderbuffer;
+        glGenRenderbuffers(1, &renderbuffer);
+        GLint previous = getInteger(GL_RENDERBUFFER_BINDING);
+        glBindRenderbuffer(GL_RENDERBUFFER, renderbuffer);
+        if (storageWidth > 0 && storageHeight > 0) {
+            glRenderbufferStorageMultisample(GL_RENDERBUFFER, samples, internalFormat, storageWidth, storageHeight);
+        }
+        glBindRenderbuffer(GL_RENDERBUFFER, previous);
+        renderbuffers[name] = renderbuffer;
+    }
+
+    void TraceReplayer::DefineFramebuffer(const Record& record) {
+
+        Reader reader(record.data, record.size);
+        GLuint name = reader.U32();
+        if (framebuffers.count(name) != 0 || name == presentedFramebuffer) {
+            return;
+        }
+
+        GLuint framebuffer;
+        glGenFramebuffers(1, &framebuffer);
+        GLint previousDraw = getInteger(GL_DRAW_FRAMEBUFFER_BINDING);
+        GLint previousRead = getInteger(GL_READ_FRAMEBUFFER_BINDING);
+        glBindFramebuffer(GL_FRAMEBUFFER, framebuffer);
+
+        uint32_t attachmentCount = reader.U32();
+        for (uint32_t i = 0; i < attachmentCount; i++) {
+            GLenum attachment = reader.U32(), type = reader.U32();
+            GLuint object = reader.U32();
+            GLint level = reader.I32();
+            GLenum cubeFace = reader.U32();
+            GLint layer = reader.I32();
+            bool layered = reader.U32() != 0;
+            if (type == GL_RENDERBUFFER) {
+                glFramebufferRenderbuffer(GL_FRAMEBUFFER, attachment, GL_RENDERBUFFER, Map(renderbuffers, object));
+                continue;
+            }
+            GLuint texture = Map(textures, object);
+            GLenum textureTarget = textureTargets.count(object) != 0 ? textureTargets[object] : GL_TEXTURE_2D;
+            if (layered) {
+                glFramebufferTexture(GL_FRAMEBUFFER, attachment, texture, level);
+            }
+            else if (cubeFace != 0) {
+                glFramebufferTexture2D(GL_FRAMEBUFFER, attachment, cubeFace, texture, level);
+            }
+            else if (textureTarget == GL_TEXTURE_2D_ARRAY || textureTarget == GL_TEXTURE_3D) {
+                glFramebufferTextureLayer(GL_FRAMEBUFFER, attachment, texture, level, layer);
+            }
+            else {
+                glFramebufferTexture2D(GL_FRAMEBUFFER, attachment, GL_TEXTURE_2D, texture, level);
+            }
+        }
+        uint32_t drawBufferCount = reader.U32();
+        std::vector<GLenum> drawBuffers;
+        for (uint32_t i = 0; i < drawBufferCount; i++) {
+            drawBuffers.push_back(reader.U32());
+        }
+        glDrawBuffers((GLsizei)drawBuffers.size(), drawBuffers.data());
+        glReadBuffer(reader.U32());
+        if (glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE) {
+            LOG_WARNING("replayed framebuffer %u is not complete", name);
+        }
+
+        glBindFramebuffer(GL_DRAW_FRAMEBUFFER, previousDraw);
+        glBindFramebuffer(GL_READ_FRAMEBUFFER, previousRead);
+        framebuffers[name] = framebuffer;
+    }
+
+    void TraceReplayer::DefineVertexArray(const Record& record) {
+
+        Reader reader(record.data, record.size);
+        GLuint name = reader.U32();
+        if (vertexArrays.count(name) != 0) {
+            return;
+        }
+
+        GLuint vertexArray;
+        glGenVertexArrays(1, &vertexArray);
+        GLint previous = getInteger(GL_VERTEX_ARRAY_BINDING);
+        GLint previousArrayBuffer = getInteger(GL_ARRAY_BUFFER_BINDING);
+        glBindVertexArray(vertexArray);
+        glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, Map(buffers, reader.U32()));
+        uint32_t attributeCount = reader.U32();
+        for (uint32_t i = 0; i < attributeCount; i++) {
+            GLuint index = reader.U32();
+            bool enabled = reader.U32() != 0;
+            GLint size = reader.I32();
+            GLenum type = reader.U32();
+            GLboolean normalized = (GLboolean)reader.U32();
+            bool integer = reader.U32() != 0;
+            GLsizei stride = reader.I32();
+            const void* offset = (const void*)(uintptr_t)reader.U64();
+            glBindBuffer(GL_ARRAY_BUFFER, Map(buffers, reader.U32()));
+            if (integer) {
+                glVertexAttribIPointer(index, size, type, stride, offset);
+            }
+            else {
+                glVertexAttribPointer(index, size, type, normalized, stride, offset);
+            }
+            if (enabled) {
+                glEnableVertexAttribArray(index);
+            }
+        }
+        glBindVertexArray(previous);
+        glBindBuffer(GL_ARRAY_BUFFER, previousArrayBuffer);
+        vertexArrays[name] = vertexArray;
+    }
+
+    void TraceReplayer::DefineProgram(const Record& record) {
+
+        Reader reader(record.data, record.size);
+        GLuint name = reader.U32();
+        if (programs.count(name) != 0) {
+            return;
+        }
+
+        GLuint program = glCreateProgram();
+        GLint linked = GL_FALSE;
+        GLenum binaryFormat = reader.U32();
+        uint32_t binary = reader.U32();
+        if (Blob(binary) != NULL) {
+            glProgramBinary(program, binaryFormat, Blob(binary), (GLsizei)blobs[binary].second);
+            glGetProgramiv(program, GL_LINK_STATUS, &linked);
+        }
+
+        //the binary is rejected by any other driver, the sources are compiled instead
+        uint32_t shaderCount = reader.U32();
+        std::vector<GLuint> shaders;
+        for (uint32_t i = 0; i < shaderCount; i++) {
+            GLenum type = reader.U32();
+            std::string source = reader.String();
+            if (linked) {
+                continue;
+            }
+            GLuint shader = glCreateShader(type);
+            const GLchar* text = source.c_str();
+            glShaderSource(shader, 1, &text, NULL);
+            glCompileShader(shader);
+            glAttachShader(program, shader);
+            shaders.push_back(shader);
+        }
+        if (!linked && !shaders.empty()) {
+            glLinkProgram(program);
+            glGetProgramiv(program, GL_LINK_STATUS, &linked);
+        }
+        for (size_t i = 0; i < shaders.size(); i++) {
+            glDetachShader(program, shaders[i]);
+            glDeleteShader(shaders[i]);
+        }
+        if (!linked) {
+            GLchar infoLog[512] = "";
+            glGetProgramInfoLog(program, sizeof(infoLog), NULL, infoLog);
+            LOG_ERROR("could not recreate program %u of the trace: %s", name, infoLog);
+        }
+
+        uint32_t blockCount = reader.U32();
+        for (uint32_t i = 0; i < blockCount; i++) {
+            std::string blockName = reader.String();
+            GLuint binding = reader.U32();
+            GLuint index = glGetUniformBlockIndex(program, blockName.c_str());
+            if (index != GL_INVALID_INDEX) {
+                glUniformBlockBinding(program, index, binding);
+            }
+        }
+
+        uint32_t uniformCount = reader.U32();
+        std::vector<uint32_t> values;
+        for (uint32_t i = 0; i < uniformCount; i++) {
+            std::string uniformName = reader.String();
+            GLint recordedLocation = reader.I32();
+            GLenum type = reader.U32();
+            uint32_t valueCount = reader.U32();
+            values.resize(valueCount);
+            for (uint32_t j = 0; j < valueCount; j++) {
+                values[j] = reader.U32();
+            }
+            GLint location = glGetUniformLocation(program, uniformName.c_str());
+            if (location < 0) {
+                continue;
+            }
+            uniformLocations[std::make_pair(name, recordedLocation)] = location;
+            SetUniform(program, location, type, 1, GL_FALSE, values.data());
+        }
+        programs[name] = program;
+    }
+}
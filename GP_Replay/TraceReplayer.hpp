@@ -0,0 +1,91 @@
+#ifndef TraceReplayer_hpp
+#define TraceReplayer_hpp
+
+#if defined (__APPLE__)
+    #define GL_SILENCE_DEPRECATION
+    #include <OpenGL/gl3.h>
+#else
+    #define GLEW_STATIC
+    #include <GL/glew.h>
+#endif
+
+#include "GLTraceFormat.hpp"
+#include "PassTimer.hpp"
+
+#include <cstdint>
+#include <map>
+#include <string>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+namespace gps {
+
+    //Plays a trace written by GLTrace back on the current context
+    //the objects are created the first time their definition is played; the window (and the
+    //framebuffer the trace was presented in) is replaced by the target framebuffer
+    class TraceReplayer {
+
+    public:
+        TraceReplayer();
+        //reads the whole trace into memory
+        bool Load(const std::string& fileName);
+        void Delete();
+        int GetWidth() const;
+        int GetHeight() const;
+        int GetFrameCount() const;
+        void SetTarget(GLuint framebuffer);
+        //plays the calls of frame, frame 0 preceded by the starting state of the capture;
+        //the call groups are timed as the passes of timer
+        void PlayFrame(int frame, PassTimer& timer);
+        //uniforms of unknown locations and calls on objects the trace does not define
+        int GetSkippedCalls() const;
+
+    private:
+        struct Record {
+            uint16_t op;
+            uint32_t size;
+            const unsigned char* data;
+        };
+
+        std::vector<unsigned char> contents;
+        std::vector<Record> records;
+        //index of the FRAME record of every frame, then of the END record
+        std::vector<size_t> frameStarts;
+        std::unordered_map<uint32_t, std::pair<const unsigned char*, uint32_t> > blobs;
+        int width;
+        int height;
+        GLuint presentedFramebuffer;
+        GLuint target;
+        int skippedCalls;
+
+        //recorded name to the replayed object
+        std::unordered_map<GLuint, GLuint> buffers;
+        std::unordered_map<GLuint, GLuint> textures;
+        std::unordered_map<GLuint, GLenum> textureTargets;
+        std::unordered_map<GLuint, GLuint> renderbuffers;
+        std::unordered_map<GLuint, GLuint> framebuffers;
+        std::unordered_map<GLuint, GLuint> vertexArrays;
+        std::unordered_map<GLuint, GLuint> programs;
+        //recorded program and uniform location to the replayed location
+        std::map<std::pair<GLuint, GLint>, GLint> uniformLocations;
+        //recorded name of the program in use
+        GLuint currentProgram;
+        std::vector<uint32_t> uniformValues;
+
+        void Play(const Record& record, PassTimer& timer);
+        const void* Blob(uint32_t id);
+        GLuint Map(const std::unordered_map<GLuint, GLuint>& objects, GLuint name);
+        GLuint MapFramebuffer(GLuint name);
+        void SetUniform(GLuint program, GLint location, GLenum type, GLsizei count, GLboolean transpose, const uint32_t* values);
+
+        void DefineBuffer(const Record& record);
+        void DefineTexture(const Record& record);
+        void DefineRenderbuffer(const Record& record);
+        void DefineFramebuffer(const Record& record);
+        void DefineVertexArray(const Record& record);
+        void DefineProgram(const Record& record);
+    };
+}
+
+#endif /* TraceReplayer_hpp */